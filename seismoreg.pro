@@ -1,5 +1,5 @@
 # This is Qt5 project! It will not work with Qt4
-QT       += core gui widgets svg
+QT       += core gui widgets svg concurrent
 # This project uses C+11 features! It requires GCC 4.7
 CONFIG += c++11
 
@@ -8,6 +8,7 @@ TEMPLATE = app
 
 include(3rdparty/qextserialport/src/qextserialport.pri)
 include(3rdparty/qwt/src/qwt.pri)
+include(src/dataio.pri)
 
 SOURCES += src/main.cpp\
         src/mainwindow.cpp \
@@ -22,11 +23,33 @@ SOURCES += src/main.cpp\
     src/gui/timeplot.cpp \
     src/settings.cpp \
     src/gui/portsettingsdialog.cpp \
-    src/performancereporter.cpp \
-    src/system.cpp
+    src/system.cpp \
+    src/benchmark.cpp \
+    src/extracttool.cpp \
+    src/archivewriter.cpp \
+    src/writers/spillfile.cpp \
+    src/dsp/stage.cpp \
+    src/dsp/stagegraph.cpp \
+    src/dsp/staltatrigger.cpp \
+    src/dsp/realfft.cpp \
+    src/dsp/spectrumstage.cpp \
+    src/dsp/ppsdhistogram.cpp \
+    src/dsp/ppsdstage.cpp \
+    src/dsp/filterstage.cpp \
+    src/dsp/responsefilter.cpp \
+    src/dsp/responsestage.cpp \
+    src/dsp/aicpicker.cpp \
+    src/dsp/pickerstage.cpp \
+    src/dsp/magnitudestage.cpp \
+    src/dsp/polarization.cpp \
+    src/dsp/polarizationstage.cpp \
+    src/dsp/templatematcher.cpp \
+    src/dsp/templatestage.cpp \
+    src/dsp/statsstage.cpp \
+    src/dsp/qualitystage.cpp \
+    src/gui/spectrogramplot.cpp
 
 HEADERS  += src/mainwindow.h \
-    src/protocol.h \
     src/protocols/testprotocol.h \
     src/gui/qled/qled.h \
     src/worker.h \
@@ -38,8 +61,32 @@ HEADERS  += src/mainwindow.h \
     src/gui/timeplot.h \
     src/settings.h \
     src/gui/portsettingsdialog.h \
-    src/performancereporter.h \
-    src/system.h
+    src/system.h \
+    src/benchmark.h \
+    src/extracttool.h \
+    src/archivewriter.h \
+    src/writers/spillfile.h \
+    src/dsp/stage.h \
+    src/dsp/stagegraph.h \
+    src/dsp/sinkstage.h \
+    src/dsp/staltatrigger.h \
+    src/dsp/realfft.h \
+    src/dsp/spectrumstage.h \
+    src/dsp/ppsdhistogram.h \
+    src/dsp/ppsdstage.h \
+    src/dsp/filterstage.h \
+    src/dsp/responsefilter.h \
+    src/dsp/responsestage.h \
+    src/dsp/aicpicker.h \
+    src/dsp/pickerstage.h \
+    src/dsp/magnitudestage.h \
+    src/dsp/polarization.h \
+    src/dsp/polarizationstage.h \
+    src/dsp/templatematcher.h \
+    src/dsp/templatestage.h \
+    src/dsp/statsstage.h \
+    src/dsp/qualitystage.h \
+    src/gui/spectrogramplot.h
 
 FORMS    += mainwindow.ui \
     src/gui/statsbox.ui \
@@ -0,0 +1,598 @@
+#include "archive.h"
+#include "chunkcodec.h"
+#include "../logger.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtEndian>
+#include <zlib.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+const QString Archive::CATALOG_FILE = "chunks.cat";
+const QString Archive::OPEN_FILE = "open.chunks";
+const QString Archive::CHUNK_SUFFIX = ".chunk";
+
+namespace {
+    const char CHUNK_MAGIC[4] = {'S', 'R', 'G', 'C'};
+    const char CATALOG_MAGIC[4] = {'S', 'R', 'G', 'K'};
+    const char OPEN_MAGIC[4] = {'S', 'R', 'G', 'O'};
+    const quint16 VERSION = 1;
+    const int CHUNK_HEADER_SIZE = 32;
+    const int CATALOG_HEADER_SIZE = 16;
+    const int ENTRY_SIZE = 32;
+    const int OPEN_HEADER_SIZE = 24;
+    const int OPEN_ITEM_SIZE = CHANNELS_NUM*sizeof(qint32);
+
+    template <typename T>
+    void putLittleEndian(char * dst, T value) {
+        qToLittleEndian(value, reinterpret_cast<uchar*>(dst));
+    }
+
+    template <typename T>
+    T getLittleEndian(const char * src) {
+        return qFromLittleEndian<T>(reinterpret_cast<const uchar*>(src));
+    }
+
+    void putDouble(char * dst, double value) {
+        quint64 bits;
+        memcpy(&bits, &value, sizeof(bits));
+        putLittleEndian<quint64>(dst, bits);
+    }
+
+    double getDouble(const char * src) {
+        quint64 bits = getLittleEndian<quint64>(src);
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    quint32 checksum(const char * data, int size) {
+        return quint32(crc32(crc32(0, Z_NULL, 0), reinterpret_cast<const Bytef*>(data), uInt(size)));
+    }
+
+    void encodeEntry(char * e, const Archive::Chunk & chunk) {
+        putDouble(e, chunk.start);
+        putDouble(e + 8, chunk.period);
+        putLittleEndian<quint32>(e + 16, chunk.count);
+        putLittleEndian<quint16>(e + 20, chunk.channel);
+        putLittleEndian<quint16>(e + 22, 0);
+        putLittleEndian<quint32>(e + 24, chunk.bytes);
+        putLittleEndian<quint32>(e + 28, chunk.crc);
+    }
+
+    Archive::Chunk decodeEntry(const char * e) {
+        Archive::Chunk chunk;
+        chunk.start = getDouble(e);
+        chunk.period = getDouble(e + 8);
+        chunk.count = getLittleEndian<quint32>(e + 16);
+        chunk.channel = getLittleEndian<quint16>(e + 20);
+        chunk.bytes = getLittleEndian<quint32>(e + 24);
+        chunk.crc = getLittleEndian<quint32>(e + 28);
+        return chunk;
+    }
+
+    bool startsBefore(const Archive::Chunk & a, const Archive::Chunk & b) {
+        return a.start < b.start;
+    }
+
+    // Averages every `factor` values into one. Incomplete group at the end is dropped.
+    QVector<DataType> decimate(const QVector<DataType> & values, int factor) {
+        QVector<DataType> res(values.size() / factor);
+        for (int i = 0; i < res.size(); ++i) {
+            qint64 sum = 0;
+            for (int j = 0; j < factor; ++j) {
+                sum += values[i*factor + j];
+            }
+            res[i] = DataType(qRound64(double(sum) / factor));
+        }
+        return res;
+    }
+}
+
+Archive::Archive(QString directory, int chunkSecs) :
+    dir(directory), chunkMsecs(qMax(1, chunkSecs)*1000.0), readOnly(false), flushedCount(0),
+    openStart(0), openPeriod(0), partitionEnd(0)
+{}
+
+Archive::~Archive() {
+    seal();
+}
+
+bool Archive::exists(const QString & directory) {
+    return QFileInfo(QDir(directory).filePath(CATALOG_FILE)).isFile();
+}
+
+bool Archive::open(bool readOnly) {
+    this->readOnly = readOnly;
+    if ( ! loadCatalog() ) {
+        return false;
+    }
+    loadOpen();
+    const int count = openValues[0].size();
+    if (readOnly || count == 0) {
+        return true;
+    }
+    // Left after a crash: sealed now, unless that was done right before the crash
+    const QVector<Chunk> & sealed = chunks[0];
+    const bool wasSealed = std::any_of(sealed.constBegin(), sealed.constEnd(),
+                                       [this](const Chunk & chunk) { return chunk.start == openStart; });
+    if (wasSealed) {
+        QWriteLocker locker(&lock);
+        for (QVector<DataType> & values: openValues) {
+            values.resize(0);
+        }
+        QFile::remove(QDir(dir).filePath(OPEN_FILE));
+        flushedCount = 0;
+    } else {
+        Logger::info(tr("Sealing %1 s of data left in open chunks of archive %2").arg(count*openPeriod / 1000.0, 0, 'f', 1).arg(dir));
+        seal();
+    }
+    return true;
+}
+
+bool Archive::loadCatalog() {
+    if (readOnly && ! QFileInfo(dir).isDir()) {
+        Logger::error(tr("Archive directory %1 doesn't exist").arg(dir));
+        return false;
+    }
+    if ( ! readOnly && ! QDir().mkpath(dir) ) {
+        Logger::error(tr("Failed to create archive directory %1").arg(dir));
+        return false;
+    }
+    QWriteLocker locker(&lock);
+    for (QVector<Chunk> & list: chunks) {
+        list.clear();
+    }
+    catalog.setFileName(QDir(dir).filePath(CATALOG_FILE));
+    if ( ! catalog.exists() ) {
+        if (readOnly) {
+            Logger::error(tr("Directory %1 is not an archive: there is no catalog").arg(dir));
+            return false;
+        }
+        return rebuildCatalog(); // New archive, or the catalog is lost
+    }
+    if ( ! catalog.open(QIODevice::ReadOnly) ) {
+        Logger::error(tr("Failed to open catalog of archive %1: %2").arg(dir, catalog.errorString()));
+        return false;
+    }
+    const QByteArray bytes = catalog.readAll();
+    catalog.close();
+    const char * data = bytes.constData();
+    if (bytes.size() < CATALOG_HEADER_SIZE || memcmp(data, CATALOG_MAGIC, sizeof(CATALOG_MAGIC)) != 0
+     || getLittleEndian<quint16>(data + 4) != VERSION || getLittleEndian<quint16>(data + 6) != ENTRY_SIZE) {
+        if (readOnly) {
+            Logger::error(tr("Catalog of archive %1 is damaged or has unsupported version").arg(dir));
+            return false;
+        }
+        Logger::warning(tr("Catalog of archive %1 is damaged or has unsupported version, it is rebuilt").arg(dir));
+        return rebuildCatalog();
+    }
+    const int count = (bytes.size() - CATALOG_HEADER_SIZE) / ENTRY_SIZE;
+    for (int i = 0; i < count; ++i) {
+        const Chunk chunk = decodeEntry(data + CATALOG_HEADER_SIZE + i*ENTRY_SIZE);
+        if (chunk.channel < CHANNELS_NUM) {
+            chunks[chunk.channel] << chunk;
+        }
+    }
+    for (QVector<Chunk> & list: chunks) {
+        std::sort(list.begin(), list.end(), startsBefore);
+    }
+    if (readOnly) {
+        return true; // Incomplete entry at the end (being written) is skipped
+    }
+    if (bytes.size() != CATALOG_HEADER_SIZE + count*ENTRY_SIZE) {
+        return createCatalog(); // Drops incomplete entry at the end
+    }
+    if ( ! catalog.open(QIODevice::WriteOnly | QIODevice::Append) ) {
+        Logger::error(tr("Failed to open catalog of archive %1: %2").arg(dir, catalog.errorString()));
+        return false;
+    }
+    return true;
+}
+
+bool Archive::rebuildCatalog() {
+    QDirIterator it(dir, QStringList("*" + CHUNK_SUFFIX), QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        QFile file(it.next());
+        if ( ! file.open(QIODevice::ReadOnly) ) {
+            continue;
+        }
+        const QByteArray bytes = file.readAll();
+        const char * h = bytes.constData();
+        if (bytes.size() < CHUNK_HEADER_SIZE || memcmp(h, CHUNK_MAGIC, sizeof(CHUNK_MAGIC)) != 0
+         || getLittleEndian<quint16>(h + 4) != VERSION) {
+            continue;
+        }
+        Chunk chunk;
+        chunk.channel = getLittleEndian<quint16>(h + 6);
+        chunk.count = getLittleEndian<quint32>(h + 8);
+        chunk.bytes = getLittleEndian<quint32>(h + 12);
+        chunk.start = getDouble(h + 16);
+        chunk.period = getDouble(h + 24);
+        if (chunk.channel >= CHANNELS_NUM || qint64(bytes.size()) != CHUNK_HEADER_SIZE + qint64(chunk.bytes)) {
+            continue; // Incomplete
+        }
+        chunk.crc = checksum(h + CHUNK_HEADER_SIZE, int(chunk.bytes));
+        chunks[chunk.channel] << chunk;
+    }
+    for (QVector<Chunk> & list: chunks) {
+        std::sort(list.begin(), list.end(), startsBefore);
+    }
+    return createCatalog();
+}
+
+bool Archive::createCatalog() {
+    // Written anew and then replaces the old one, so that the catalog is never half-written
+    catalog.close();
+    QSaveFile out(catalog.fileName());
+    if ( ! out.open(QIODevice::WriteOnly) ) {
+        Logger::error(tr("Failed to write catalog of archive %1: %2").arg(dir, out.errorString()));
+        return false;
+    }
+    char header[CATALOG_HEADER_SIZE] = {0};
+    memcpy(header, CATALOG_MAGIC, sizeof(CATALOG_MAGIC));
+    putLittleEndian<quint16>(header + 4, VERSION);
+    putLittleEndian<quint16>(header + 6, ENTRY_SIZE);
+    out.write(header, CATALOG_HEADER_SIZE);
+    char entry[ENTRY_SIZE];
+    for (const QVector<Chunk> & list: chunks) {
+        for (const Chunk & chunk: list) {
+            encodeEntry(entry, chunk);
+            out.write(entry, ENTRY_SIZE);
+        }
+    }
+    if ( ! out.commit() || ! catalog.open(QIODevice::WriteOnly | QIODevice::Append) ) {
+        Logger::error(tr("Failed to write catalog of archive %1: %2").arg(dir, catalog.errorString()));
+        return false;
+    }
+    return true;
+}
+
+void Archive::writeCatalogEntry(const Chunk & chunk) {
+    char entry[ENTRY_SIZE];
+    encodeEntry(entry, chunk);
+    catalog.write(entry, ENTRY_SIZE);
+}
+
+void Archive::addChunk(const Chunk & chunk) {
+    // Normally the latest one, but time can jump back (e.g. when the clock is corrected)
+    QVector<Chunk> & list = chunks[chunk.channel];
+    list.insert(std::upper_bound(list.begin(), list.end(), chunk, startsBefore), chunk);
+}
+
+QString Archive::chunkFileName(const Chunk & chunk) const {
+    const QDateTime time = QDateTime::fromMSecsSinceEpoch(qint64(std::floor(chunk.start)), Qt::UTC);
+    const qint64 microsecond = qint64(std::floor(chunk.start*1000)) % 1000000;
+    const QString name = QString("%1/%2-%3_%4%5")
+            .arg(time.toString("yyyy-MM-dd"), time.toString("hhmmss"))
+            .arg(microsecond, 6, 10, QChar('0')).arg(chunk.channel).arg(CHUNK_SUFFIX);
+    return QDir(dir).filePath(name);
+}
+
+bool Archive::writeChunk(const Chunk & chunk, const QByteArray & payload) {
+    const QString fileName = chunkFileName(chunk);
+    QDir().mkpath(QFileInfo(fileName).path());
+    QSaveFile file(fileName);
+    if ( ! file.open(QIODevice::WriteOnly) ) {
+        Logger::error(tr("Failed to write chunk %1: %2").arg(fileName, file.errorString()));
+        return false;
+    }
+    char header[CHUNK_HEADER_SIZE];
+    memcpy(header, CHUNK_MAGIC, sizeof(CHUNK_MAGIC));
+    putLittleEndian<quint16>(header + 4, VERSION);
+    putLittleEndian<quint16>(header + 6, chunk.channel);
+    putLittleEndian<quint32>(header + 8, chunk.count);
+    putLittleEndian<quint32>(header + 12, chunk.bytes);
+    putDouble(header + 16, chunk.start);
+    putDouble(header + 24, chunk.period);
+    file.write(header, CHUNK_HEADER_SIZE);
+    file.write(payload);
+    if ( ! file.commit() ) {
+        Logger::error(tr("Failed to write chunk %1: %2").arg(fileName, file.errorString()));
+        return false;
+    }
+    return true;
+}
+
+bool Archive::readChunk(const Chunk & chunk, QVector<DataType> & values) const {
+    const QString fileName = chunkFileName(chunk);
+    QFile file(fileName);
+    if ( ! file.open(QIODevice::ReadOnly) ) {
+        Logger::warning(tr("Failed to read chunk %1: %2").arg(fileName, file.errorString()));
+        return false;
+    }
+    const QByteArray bytes = file.readAll();
+    const char * payload = bytes.constData() + CHUNK_HEADER_SIZE;
+    if (qint64(bytes.size()) != CHUNK_HEADER_SIZE + qint64(chunk.bytes)
+     || memcmp(bytes.constData(), CHUNK_MAGIC, sizeof(CHUNK_MAGIC)) != 0
+     || checksum(payload, int(chunk.bytes)) != chunk.crc
+     || ! ChunkCodec::decode(payload, int(chunk.bytes), int(chunk.count), values)) {
+        Logger::warning(tr("Chunk %1 is damaged, its data are skipped").arg(fileName));
+        return false;
+    }
+    return true;
+}
+
+bool Archive::continuesOpen(TimeStampType time, qint64 index, double period) const {
+    // Only samples at the expected time (give or take half a period) and in the same partition
+    return period == openPeriod && time < partitionEnd
+        && std::abs(time - (openStart + index*period)) <= period/2;
+}
+
+void Archive::append(const DataBlock & block, int samplingFreq) {
+    if (samplingFreq <= 0) {
+        return;
+    }
+    // Open chunks are only changed by this thread, so they are read without lock here
+    const double period = 1000.0 / samplingFreq;
+    const int size = block.size();
+    int i = 0;
+    while (i < size) {
+        const TimeStampType time = block.timestamps[i];
+        qint64 openCount = openValues[0].size();
+        if (openCount > 0 && ! continuesOpen(time, openCount, period)) {
+            seal();
+            openCount = 0;
+        }
+        if (openCount == 0) {
+            QWriteLocker locker(&lock);
+            openStart = time;
+            openPeriod = period;
+            partitionEnd = (std::floor(time / chunkMsecs) + 1)*chunkMsecs;
+        }
+        int end = i + 1;
+        while (end < size && continuesOpen(block.timestamps[end], openCount + end - i, period)) {
+            ++end;
+        }
+        QWriteLocker locker(&lock);
+        for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+            QVector<DataType> & values = openValues[ch];
+            values.reserve(values.size() + end - i);
+            for (int j = i; j < end; ++j) {
+                values << block.data[j].byChannel[ch];
+            }
+        }
+        i = end;
+    }
+    if (openValues[0].size() - flushedCount >= FLUSH_SECS*samplingFreq) {
+        flushOpen();
+    }
+}
+
+void Archive::seal() {
+    const int count = openValues[0].size();
+    if (count == 0 || readOnly) {
+        return;
+    }
+    // Encoded and written without lock: queries read open chunks meanwhile
+    QVector<Chunk> sealed;
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        Chunk chunk;
+        chunk.start = openStart;
+        chunk.period = openPeriod;
+        chunk.count = quint32(count);
+        chunk.channel = quint16(ch);
+        const QByteArray payload = ChunkCodec::encode(openValues[ch].constData(), count);
+        chunk.bytes = quint32(payload.size());
+        chunk.crc = checksum(payload.constData(), payload.size());
+        if ( ! payload.isEmpty() && writeChunk(chunk, payload) ) {
+            sealed << chunk;
+        }
+    }
+    QWriteLocker locker(&lock);
+    for (const Chunk & chunk: sealed) {
+        addChunk(chunk);
+        writeCatalogEntry(chunk);
+    }
+    catalog.flush();
+    for (QVector<DataType> & values: openValues) {
+        values.resize(0);
+    }
+    openFile.close();
+    QFile::remove(QDir(dir).filePath(OPEN_FILE));
+    flushedCount = 0;
+}
+
+void Archive::flushOpen() {
+    const int count = openValues[0].size();
+    if (flushedCount == 0) {
+        // New group: the file starts with its time
+        openFile.setFileName(QDir(dir).filePath(OPEN_FILE));
+        if (openFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            char header[OPEN_HEADER_SIZE] = {0};
+            memcpy(header, OPEN_MAGIC, sizeof(OPEN_MAGIC));
+            putLittleEndian<quint16>(header + 4, VERSION);
+            putDouble(header + 8, openStart);
+            putDouble(header + 16, openPeriod);
+            openFile.write(header, OPEN_HEADER_SIZE);
+        } else {
+            Logger::warning(tr("Failed to write open chunks of archive %1, they are lost on crash: %2").arg(dir, openFile.errorString()));
+        }
+    }
+    if (openFile.isOpen()) {
+        QByteArray bytes((count - flushedCount)*OPEN_ITEM_SIZE, Qt::Uninitialized);
+        char * item = bytes.data();
+        for (int i = flushedCount; i < count; ++i, item += OPEN_ITEM_SIZE) {
+            for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+                putLittleEndian<qint32>(item + ch*sizeof(qint32), qint32(openValues[ch][i]));
+            }
+        }
+        openFile.write(bytes);
+        openFile.flush(); // To the OS: it is not lost when the program crashes
+    }
+    flushedCount = count;
+}
+
+void Archive::loadOpen() {
+    QFile file(QDir(dir).filePath(OPEN_FILE));
+    if ( ! file.open(QIODevice::ReadOnly) ) {
+        return; // Nothing left
+    }
+    const QByteArray bytes = file.readAll();
+    const char * h = bytes.constData();
+    if (bytes.size() < OPEN_HEADER_SIZE || memcmp(h, OPEN_MAGIC, sizeof(OPEN_MAGIC)) != 0
+     || getLittleEndian<quint16>(h + 4) != VERSION || ! (getDouble(h + 16) > 0)) {
+        Logger::warning(tr("Open chunks of archive %1 are damaged, they are skipped").arg(dir));
+        return;
+    }
+    const int count = (bytes.size() - OPEN_HEADER_SIZE) / OPEN_ITEM_SIZE; // Torn item at the end is dropped
+    QWriteLocker locker(&lock);
+    openStart = getDouble(h + 8);
+    openPeriod = getDouble(h + 16);
+    partitionEnd = (std::floor(openStart / chunkMsecs) + 1)*chunkMsecs;
+    const char * item = h + OPEN_HEADER_SIZE;
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        openValues[ch].resize(count);
+    }
+    for (int i = 0; i < count; ++i, item += OPEN_ITEM_SIZE) {
+        for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+            openValues[ch][i] = DataType(getLittleEndian<qint32>(item + ch*sizeof(qint32)));
+        }
+    }
+    flushedCount = count;
+}
+
+int Archive::expire(TimeStampType time) {
+    QStringList fileNames;
+    {
+        QWriteLocker locker(&lock);
+        for (QVector<Chunk> & list: chunks) {
+            auto expired = [time](const Chunk & chunk) { return chunk.end() <= time; };
+            for (const Chunk & chunk: list) {
+                if (expired(chunk)) {
+                    fileNames << chunkFileName(chunk);
+                }
+            }
+            list.erase(std::remove_if(list.begin(), list.end(), expired), list.end());
+        }
+        if (fileNames.isEmpty()) {
+            return 0;
+        }
+        createCatalog(); // Before the files are removed: catalog never lists missing chunks
+    }
+    for (const QString & fileName: fileNames) {
+        QFile::remove(fileName);
+        QDir(dir).rmdir(QFileInfo(fileName).path()); // Only if it is empty
+    }
+    return fileNames.size();
+}
+
+QList<Archive::Series> Archive::query(const QList<int> & channels, TimeStampType from, TimeStampType to, double rate) const {
+    QList<Series> result;
+    for (int ch: channels) {
+        if (ch < 0 || ch >= int(CHANNELS_NUM)) {
+            continue;
+        }
+        QVector<Chunk> selected;
+        Series open;
+        {
+            QReadLocker locker(&lock);
+            // Chunks of a channel don't overlap: the first one to read is the last that starts before `from`
+            const QVector<Chunk> & list = chunks[ch];
+            auto it = std::upper_bound(list.constBegin(), list.constEnd(), from,
+                                       [](TimeStampType t, const Chunk & chunk) { return t < chunk.start; });
+            if (it != list.constBegin()) {
+                --it;
+            }
+            for (; it != list.constEnd() && it->start < to; ++it) {
+                if (it->end() > from) {
+                    selected << *it;
+                }
+            }
+            open.start = openStart;
+            open.period = openPeriod;
+            open.values = openValues[ch]; // Implicitly shared: copied only when appended to
+        }
+
+        QList<Series> pieces;
+        auto add = [&](TimeStampType start, double period, const QVector<DataType> & values) {
+            // Part of values in [from, to)
+            const int first = qBound(0, int(std::ceil((from - start)/period - 1e-6)), values.size());
+            const int last = qBound(first, int(std::ceil((to - start)/period - 1e-6)), values.size());
+            if (first == last) {
+                return;
+            }
+            const TimeStampType pieceStart = start + first*period;
+            if ( ! pieces.isEmpty() && pieces.last().period == period
+              && std::abs(pieces.last().end() - pieceStart) <= period/2 ) {
+                pieces.last().values += values.mid(first, last - first);
+            } else {
+                Series piece;
+                piece.channel = ch;
+                piece.start = pieceStart;
+                piece.period = period;
+                piece.values = values.mid(first, last - first);
+                pieces << piece;
+            }
+        };
+        QVector<DataType> values;
+        for (const Chunk & chunk: selected) {
+            if (readChunk(chunk, values)) {
+                add(chunk.start, chunk.period, values);
+            }
+        }
+        if ( ! open.values.isEmpty() ) {
+            add(open.start, open.period, open.values);
+        }
+
+        for (Series & piece: pieces) {
+            const int factor = (rate > 0) ? qMax(1, qRound(1000.0 / piece.period / rate)) : 1;
+            if (factor > 1) {
+                piece.values = decimate(piece.values, factor);
+                piece.period *= factor;
+            }
+        }
+        result += pieces;
+    }
+    return result;
+}
+
+bool Archive::timeRange(TimeStampType * first, TimeStampType * last) const {
+    QReadLocker locker(&lock);
+    bool found = false;
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        if (chunks[ch].isEmpty()) {
+            continue;
+        }
+        const TimeStampType start = chunks[ch].first().start;
+        TimeStampType end = 0;
+        for (const Chunk & chunk: chunks[ch]) {
+            end = qMax(end, chunk.end());
+        }
+        *first = found ? qMin(*first, start) : start;
+        *last = found ? qMax(*last, end) : end;
+        found = true;
+    }
+    if ( ! openValues[0].isEmpty() ) {
+        const TimeStampType end = openStart + openValues[0].size()*openPeriod;
+        *first = found ? qMin(*first, openStart) : openStart;
+        *last = found ? qMax(*last, end) : end;
+        found = true;
+    }
+    return found;
+}
+
+int Archive::chunksCount() const {
+    QReadLocker locker(&lock);
+    int count = 0;
+    for (const QVector<Chunk> & list: chunks) {
+        count += list.size();
+    }
+    return count;
+}
+
+qint64 Archive::diskBytes() const {
+    QReadLocker locker(&lock);
+    qint64 bytes = 0;
+    for (const QVector<Chunk> & list: chunks) {
+        for (const Chunk & chunk: list) {
+            bytes += CHUNK_HEADER_SIZE + chunk.bytes;
+        }
+    }
+    return bytes;
+}
@@ -0,0 +1,173 @@
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include "../protocol.h"
+#include <QFile>
+#include <QList>
+#include <QReadWriteLock>
+#include <QVector>
+#include <QCoreApplication>
+
+/*!
+ * \brief Continuous store of data of one station, split into chunks by time and channel
+ *
+ * Data are appended into an open chunk group (one chunk per channel) in memory.
+ * The group is sealed, i.e. each of its chunks is encoded (\see ChunkCodec) and
+ * written into its own file, when its time partition ends (partitions are
+ * aligned to multiples of \a chunkSecs), when there is a gap in data or the
+ * sample rate changes, and when the archive is closed. Sealed chunks never change.
+ *
+ * Until then, the open group is appended to a file every FLUSH_SECS of data, so a crash
+ * of the program loses only the data after that: the file is sealed into chunks when
+ * the archive is opened next time.
+ *
+ * Every sealed chunk is registered in the catalog, so that a query reads only
+ * the files of requested channels that overlap requested time, and doesn't even
+ * open the others (\see query). Old chunks are removed by expire, according
+ * to a retention policy of the caller.
+ *
+ * Directory layout:
+ *
+ *     <directory>/chunks.cat                      catalog
+ *     <directory>/open.chunks                     open chunk group
+ *     <directory>/<yyyy-MM-dd>/<hhmmss-uuuuuu>_<channel>.chunk
+ *
+ * (the time of the first sample in UTC, with microseconds). Chunk file (little-endian):
+ *
+ *     "SRGC", quint16 version, quint16 channel, quint32 count, quint32 payload size,
+ *     double start time (ms since Epoch), double sampling period (ms), payload
+ *
+ * Catalog: "SRGK", quint16 version, quint16 entry size, 8 bytes reserved, then entries:
+ *
+ *     double start time, double period, quint32 count, quint16 channel,
+ *     quint16 reserved, quint32 payload size, quint32 CRC-32 of payload
+ *
+ * Open chunk group: "SRGO", quint16 version, quint16 reserved, double start time,
+ * double sampling period, then items: a qint32 value of each channel.
+ *
+ * A chunk file is written before its catalog entry, so after a crash the catalog
+ * only lists complete chunks. If the catalog is lost, it is rebuilt from chunk files.
+ *
+ * Appending and sealing are done by one thread (\see ArchiveWriter); queries
+ * can be made from any other thread at the same time. An archive opened for reading
+ * only (\see ArchiveReader) is never changed, it can be written by another process.
+ */
+class Archive
+{
+    Q_DECLARE_TR_FUNCTIONS(Archive)
+public:
+    static const int DEFAULT_CHUNK_SECS = 10*60;
+    static const int DEFAULT_RETENTION_DAYS = 30;
+    static const int FLUSH_SECS = 10;
+    static const QString CATALOG_FILE;
+    static const QString OPEN_FILE;
+    static const QString CHUNK_SUFFIX;
+
+    /// Catalog entry: one sealed chunk of one channel
+    struct Chunk {
+        TimeStampType start;
+        double period;       // ms
+        quint32 count;
+        quint16 channel;
+        quint32 bytes;       // Size of encoded payload
+        quint32 crc;
+        TimeStampType end() const { return start + count*period; }
+    };
+
+    /// Continuous piece of one channel: values at start, start + period, ...
+    struct Series {
+        int channel;
+        TimeStampType start;
+        double period;
+        QVector<DataType> values;
+        TimeStampType end() const { return start + values.size()*period; }
+    };
+
+    explicit Archive(QString directory, int chunkSecs = DEFAULT_CHUNK_SECS);
+    /// Seals the open chunks
+    ~Archive();
+
+    /*!
+     * \brief Creates the directory if needed and loads the catalog.
+     *        Seals the open chunk group left after a crash.
+     * \param readOnly - don't change anything: the archive must exist, open chunk group
+     *        is only read, and append, seal and expire must not be called
+     * \return false if failed (reported to Logger)
+     */
+    bool open(bool readOnly = false);
+
+    /// Whether \a directory has an archive
+    static bool exists(const QString & directory);
+
+    QString directory() const { return dir; }
+
+    /*!
+     * \brief Appends data sampled at \a samplingFreq (Hz) to the open chunks
+     *        (sealing them first if needed)
+     */
+    void append(const DataBlock & block, int samplingFreq);
+
+    /*!
+     * \brief Writes the open chunks, so that subsequent data go to new chunks
+     */
+    void seal();
+
+    /*!
+     * \brief Removes chunks that end before \a time (e.g. older than retention period)
+     * \return number of removed chunks
+     */
+    int expire(TimeStampType time);
+
+    /*!
+     * \brief Reads data of \a channels between \a from and \a to, including the open chunks
+     * \param rate - sampling frequency (Hz) of result: data are averaged over groups
+     *        of samples to reduce their rate to about this one. 0 - the original rate.
+     * \return continuous series, ordered by channel (as in \a channels), then by time.
+     *         Gaps in data (and damaged chunks) separate series.
+     */
+    QList<Series> query(const QList<int> & channels, TimeStampType from, TimeStampType to, double rate = 0) const;
+
+    /*!
+     * \brief Time of the first and after the last stored sample
+     * \return false if the archive is empty
+     */
+    bool timeRange(TimeStampType * first, TimeStampType * last) const;
+
+    /// Number of sealed chunks and their size on disk
+    int chunksCount() const;
+    qint64 diskBytes() const;
+
+    /// Decodes values of sealed \a chunk from its file
+    bool readChunk(const Chunk & chunk, QVector<DataType> & values) const;
+
+private:
+    bool loadCatalog();
+    void loadOpen();
+    void flushOpen();
+    QString chunkFileName(const Chunk & chunk) const;
+    bool writeChunk(const Chunk & chunk, const QByteArray & payload);
+    bool createCatalog();
+    bool rebuildCatalog();
+    void writeCatalogEntry(const Chunk & chunk);
+    void addChunk(const Chunk & chunk);
+    bool continuesOpen(TimeStampType time, qint64 index, double period) const;
+
+    QString dir;
+    TimeStampType chunkMsecs;
+    bool readOnly;
+    QFile catalog;
+    QFile openFile;   // Of open chunk group
+    int flushedCount; // Items of open chunk group in openFile
+
+    mutable QReadWriteLock lock;         // Guards everything below
+    QVector<Chunk> chunks[CHANNELS_NUM]; // Sealed, sorted by time
+    // Open chunks: the same time for all channels
+    TimeStampType openStart;
+    double openPeriod;
+    TimeStampType partitionEnd;
+    QVector<DataType> openValues[CHANNELS_NUM];
+
+    Q_DISABLE_COPY(Archive)
+};
+
+#endif // ARCHIVE_H
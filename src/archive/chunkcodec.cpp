@@ -0,0 +1,81 @@
+#include "chunkcodec.h"
+#include <zlib.h>
+
+namespace {
+    const int MAX_VARINT_SIZE = 5; // 32 bits of difference in 7-bit groups
+
+    inline quint32 zigzag(qint32 value) {
+        return (quint32(value) << 1) ^ quint32(value >> 31);
+    }
+
+    inline qint32 unzigzag(quint32 value) {
+        return qint32(value >> 1) ^ -qint32(value & 1);
+    }
+}
+
+void ChunkCodec::encodeDeltas(const DataType * values, int count, QByteArray & out) {
+    const int start = out.size();
+    out.resize(start + count*MAX_VARINT_SIZE);
+    uchar * dst = reinterpret_cast<uchar*>(out.data()) + start;
+    qint32 previous = 0;
+    for (int i = 0; i < count; ++i) {
+        // Wraps around on overflow: decoding wraps back the same way
+        quint32 rest = zigzag(qint32(quint32(values[i]) - quint32(previous)));
+        previous = values[i];
+        while (rest >= 0x80) {
+            *dst++ = uchar(rest | 0x80);
+            rest >>= 7;
+        }
+        *dst++ = uchar(rest);
+    }
+    out.resize(int(dst - reinterpret_cast<uchar*>(out.data())));
+}
+
+bool ChunkCodec::decodeDeltas(const char * data, int size, int count, DataType * values) {
+    const uchar * src = reinterpret_cast<const uchar*>(data);
+    const uchar * end = src + size;
+    qint32 previous = 0;
+    for (int i = 0; i < count; ++i) {
+        quint32 value = 0;
+        int shift = 0;
+        uchar byte;
+        do {
+            if (src == end || shift >= 7*MAX_VARINT_SIZE) {
+                return false;
+            }
+            byte = *src++;
+            value |= quint32(byte & 0x7f) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        previous = qint32(quint32(previous) + quint32(unzigzag(value)));
+        values[i] = previous;
+    }
+    return src == end;
+}
+
+QByteArray ChunkCodec::encode(const DataType * values, int count, int level) {
+    QByteArray deltas;
+    encodeDeltas(values, count, deltas);
+    uLongf size = compressBound(uLong(deltas.size()));
+    QByteArray out(int(size), Qt::Uninitialized);
+    if (compress2(reinterpret_cast<Bytef*>(out.data()), &size,
+                  reinterpret_cast<const Bytef*>(deltas.constData()), uLong(deltas.size()), level) != Z_OK) {
+        return QByteArray();
+    }
+    out.resize(int(size));
+    return out;
+}
+
+bool ChunkCodec::decode(const char * data, int size, int count, QVector<DataType> & values) {
+    if (count < 0) {
+        return false;
+    }
+    QByteArray deltas(count*MAX_VARINT_SIZE, Qt::Uninitialized);
+    uLongf deltasSize = uLongf(deltas.size());
+    if (uncompress(reinterpret_cast<Bytef*>(deltas.data()), &deltasSize,
+                   reinterpret_cast<const Bytef*>(data), uLong(size)) != Z_OK) {
+        return false;
+    }
+    values.resize(count);
+    return decodeDeltas(deltas.constData(), int(deltasSize), count, values.data());
+}
@@ -0,0 +1,41 @@
+#ifndef CHUNKCODEC_H
+#define CHUNKCODEC_H
+
+#include "../protocol.h"
+#include <QByteArray>
+#include <QVector>
+
+/*!
+ * \brief Compact encoding of one channel of data for chunks of Archive
+ *
+ * Seismic samples change little from one to the next, so the values are stored
+ * as differences from the previous one (the first one from zero), each difference
+ * zigzag-mapped to unsigned (small negative numbers become small positive ones)
+ * and written as a variable-length integer: 7 bits per byte, high bit set if
+ * more bytes follow. Typical differences take one or two bytes instead of four.
+ * Then the result is compressed with zlib (deflate), which takes care of
+ * repeating patterns (e.g. noise of a quiet channel).
+ */
+class ChunkCodec
+{
+public:
+    static const int DEFAULT_LEVEL = 6;
+
+    /*!
+     * \brief Encodes \a count values
+     * \return encoded bytes, empty if failed (should not normally happen)
+     */
+    static QByteArray encode(const DataType * values, int count, int level = DEFAULT_LEVEL);
+
+    /*!
+     * \brief Decodes \a size bytes of \a data, which must contain exactly \a count values
+     * \return false if data are damaged
+     */
+    static bool decode(const char * data, int size, int count, QVector<DataType> & values);
+
+    /// Delta and varint stage only, without deflate (\see encode)
+    static void encodeDeltas(const DataType * values, int count, QByteArray & out);
+    static bool decodeDeltas(const char * data, int size, int count, DataType * values);
+};
+
+#endif // CHUNKCODEC_H
@@ -0,0 +1,203 @@
+#include "historyring.h"
+#include "../logger.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <atomic>
+#include <cstring>
+
+const QString HistoryRing::DEFAULT_FILE_NAME = "seismoreg-history.ring";
+
+QString HistoryRing::defaultPath() {
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)).filePath(DEFAULT_FILE_NAME);
+}
+
+namespace {
+    const char MAGIC[4] = {'S', 'R', 'G', 'R'};
+    const quint16 VERSION = 1;
+}
+
+struct HistoryRing::Header {
+    char magic[4];
+    quint16 version;
+    quint16 channels;
+    quint32 itemSize;
+    quint32 reserved;
+    qint64 capacity;
+    qint64 begin;
+    qint64 end;
+};
+
+HistoryRing::HistoryRing(QString fileName) :
+    file(fileName), map(NULL), header(NULL), times(NULL), items(NULL)
+{}
+
+HistoryRing::~HistoryRing() {
+    close();
+}
+
+bool HistoryRing::open(qint64 capacity) {
+    close();
+    QWriteLocker locker(&lock);
+    if (capacity <= 0) {
+        return false;
+    }
+    const qint64 size = HEADER_SIZE + capacity*qint64(sizeof(TimeStampType) + sizeof(DataItem));
+    const QString dir = QFileInfo(file).absolutePath();
+    if ( ! QDir().mkpath(dir) ) {
+        Logger::error(tr("Failed to create directory %1 for history file").arg(dir));
+        return false;
+    }
+    if ( ! file.open(QIODevice::ReadWrite) ) {
+        Logger::error(tr("Failed to open history file %1: %2").arg(file.fileName(), file.errorString()));
+        return false;
+    }
+    const bool sameSize = (file.size() == size);
+    if ( ! sameSize && ! (file.resize(0) && file.resize(size)) ) {
+        Logger::error(tr("Failed to create history file %1: %2").arg(file.fileName(), file.errorString()));
+        file.close();
+        return false;
+    }
+    map = file.map(0, size);
+    if (map == NULL) {
+        Logger::error(tr("Failed to map history file %1: %2").arg(file.fileName(), file.errorString()));
+        file.close();
+        return false;
+    }
+    header = reinterpret_cast<Header*>(map);
+    times = reinterpret_cast<TimeStampType*>(map + HEADER_SIZE);
+    items = reinterpret_cast<DataItem*>(map + HEADER_SIZE + capacity*qint64(sizeof(TimeStampType)));
+
+    const bool valid = sameSize && memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0
+            && header->version == VERSION && header->channels == CHANNELS_NUM
+            && header->itemSize == sizeof(DataItem) && header->capacity == capacity
+            && header->begin >= 0 && header->begin <= header->end && header->end - header->begin <= capacity;
+    if ( ! valid ) {
+        memset(header, 0, sizeof(Header));
+        memcpy(header->magic, MAGIC, sizeof(MAGIC));
+        header->version = VERSION;
+        header->channels = CHANNELS_NUM;
+        header->itemSize = sizeof(DataItem);
+        header->capacity = capacity;
+        header->begin = header->end = 0;
+    }
+    return true;
+}
+
+void HistoryRing::close() {
+    QWriteLocker locker(&lock);
+    if (map != NULL) {
+        file.unmap(map);
+    }
+    file.close();
+    map = NULL;
+    header = NULL;
+    times = NULL;
+    items = NULL;
+}
+
+qint64 HistoryRing::capacity() const {
+    QReadLocker locker(&lock);
+    return header != NULL ? header->capacity : 0;
+}
+
+qint64 HistoryRing::size() const {
+    QReadLocker locker(&lock);
+    return header != NULL ? header->end - header->begin : 0;
+}
+
+void HistoryRing::append(const DataBlock & block) {
+    QWriteLocker locker(&lock);
+    if (header == NULL) {
+        return;
+    }
+    const qint64 capacity = header->capacity;
+    const TimeStampType * newTimes = block.timestamps.constData();
+    const DataItem * newItems = block.data.constData();
+    qint64 count = block.size();
+    if (count > capacity) {
+        // Only the latest ones fit
+        newTimes += count - capacity;
+        newItems += count - capacity;
+        count = capacity;
+    }
+    const qint64 newEnd = header->end + count;
+    if (newEnd - header->begin > capacity) {
+        header->begin = newEnd - capacity; // Before the items are overwritten
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    // One or two pieces: before and after wrapping around
+    const qint64 pos = header->end % capacity;
+    const qint64 first = qMin(count, capacity - pos);
+    memcpy(times + pos, newTimes, size_t(first)*sizeof(TimeStampType));
+    memcpy(items + pos, newItems, size_t(first)*sizeof(DataItem));
+    memcpy(times, newTimes + first, size_t(count - first)*sizeof(TimeStampType));
+    memcpy(items, newItems + first, size_t(count - first)*sizeof(DataItem));
+    std::atomic_thread_fence(std::memory_order_release);
+    header->end = newEnd; // After the items are copied
+}
+
+void HistoryRing::clear() {
+    QWriteLocker locker(&lock);
+    if (header != NULL) {
+        header->begin = header->end;
+    }
+}
+
+bool HistoryRing::timeRange(TimeStampType * first, TimeStampType * last) const {
+    QReadLocker locker(&lock);
+    if (header == NULL || header->begin == header->end) {
+        return false;
+    }
+    *first = timeAt(header->begin);
+    *last = timeAt(header->end - 1);
+    return true;
+}
+
+DataBlock HistoryRing::last(qint64 count) const {
+    QReadLocker locker(&lock);
+    if (header == NULL) {
+        return DataBlock();
+    }
+    return copy(qMax(header->begin, header->end - count), header->end);
+}
+
+DataBlock HistoryRing::read(TimeStampType from, TimeStampType to) const {
+    QReadLocker locker(&lock);
+    if (header == NULL) {
+        return DataBlock();
+    }
+    return copy(lowerBound(from), lowerBound(to));
+}
+
+qint64 HistoryRing::lowerBound(TimeStampType time) const {
+    qint64 low = header->begin, high = header->end;
+    while (low < high) {
+        const qint64 middle = low + (high - low)/2;
+        if (timeAt(middle) < time) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+DataBlock HistoryRing::copy(qint64 from, qint64 to) const {
+    DataBlock block;
+    const qint64 count = to - from;
+    if (count <= 0) {
+        return block;
+    }
+    block.timestamps.resize(int(count));
+    block.data.resize(int(count));
+    const qint64 capacity = header->capacity;
+    const qint64 pos = from % capacity;
+    const qint64 first = qMin(count, capacity - pos);
+    memcpy(block.timestamps.data(), times + pos, size_t(first)*sizeof(TimeStampType));
+    memcpy(block.data.data(), items + pos, size_t(first)*sizeof(DataItem));
+    memcpy(block.timestamps.data() + first, times, size_t(count - first)*sizeof(TimeStampType));
+    memcpy(block.data.data() + first, items, size_t(count - first)*sizeof(DataItem));
+    return block;
+}
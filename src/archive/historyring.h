@@ -0,0 +1,96 @@
+#ifndef HISTORYRING_H
+#define HISTORYRING_H
+
+#include "../protocol.h"
+#include <QFile>
+#include <QReadWriteLock>
+#include <QCoreApplication>
+
+/*!
+ * \brief Fixed-size ring of the latest data items in a memory-mapped file
+ *
+ * Keeps the last \a capacity items (e.g. a few hours) in the same form as they
+ * are in memory, so that appending is just copying into mapped pages (the OS
+ * writes them to disk in background), and reading is copying out of them,
+ * without any parsing. The file survives restarts of the program (and its
+ * crashes: mapped pages are written by the OS anyway), so that recent history
+ * is available immediately after start, to plots and to stages of processing
+ * (\see MainWindow::restoreHistory, MainWindow::restartProcessing).
+ *
+ * File layout (native byte order: the file is only for this machine):
+ *
+ *     header (HEADER_SIZE bytes): "SRGR", quint16 version, quint16 channels,
+ *         quint32 item size, quint32 reserved, qint64 capacity, qint64 begin, qint64 end
+ *     capacity timestamps (TimeStampType)
+ *     capacity items (DataItem)
+ *
+ * where [begin, end) are numbers of stored items counted since the file was
+ * created, item number n being at position n % capacity. Before items are
+ * overwritten, begin is moved past them, and end is moved only after new items
+ * are copied, so an interrupted append never leaves damaged items in [begin, end).
+ *
+ * Times of items are expected to grow: reading by time uses binary search.
+ * All methods are thread-safe.
+ */
+class HistoryRing
+{
+    Q_DECLARE_TR_FUNCTIONS(HistoryRing)
+public:
+    static const QString DEFAULT_FILE_NAME;
+    static const int DEFAULT_HOURS = 2;
+    /// DEFAULT_FILE_NAME in the local data directory of application: doesn't depend on working directory
+    static QString defaultPath();
+    static const int HEADER_SIZE = 4096; // Page, so that arrays are aligned
+
+    /// Capacity for \a hours of data at \a samplingFreq
+    static qint64 capacityFor(int hours, int samplingFreq) { return qint64(hours)*60*60*samplingFreq; }
+
+    explicit HistoryRing(QString fileName);
+    ~HistoryRing();
+
+    /*!
+     * \brief Maps the file (creating its directory if needed). Keeps stored items
+     *        if the file has the same capacity, otherwise creates it anew.
+     * \return false if failed (reported to Logger)
+     */
+    bool open(qint64 capacity);
+    void close();
+    bool isOpen() const { return header != NULL; }
+
+    qint64 capacity() const;
+    /// Number of stored items
+    qint64 size() const;
+
+    void append(const DataBlock & block);
+    void clear();
+
+    /*!
+     * \brief Time of the first and the last stored item
+     * \return false if the ring is empty
+     */
+    bool timeRange(TimeStampType * first, TimeStampType * last) const;
+
+    /// The last \a count items (or less, if there are not so many)
+    DataBlock last(qint64 count) const;
+
+    /// Items with times in [from, to)
+    DataBlock read(TimeStampType from, TimeStampType to) const;
+
+private:
+    struct Header;
+
+    qint64 lowerBound(TimeStampType time) const;
+    DataBlock copy(qint64 from, qint64 to) const;
+    TimeStampType timeAt(qint64 number) const { return times[number % header->capacity]; }
+
+    QFile file;
+    uchar * map;
+    Header * header; // NULL if not opened
+    TimeStampType * times;
+    DataItem * items;
+    mutable QReadWriteLock lock;
+
+    Q_DISABLE_COPY(HistoryRing)
+};
+
+#endif // HISTORYRING_H
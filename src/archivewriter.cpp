@@ -0,0 +1,88 @@
+#include "archivewriter.h"
+#include "logger.h"
+
+#include <QDir>
+
+const QString ArchiveWriter::DEFAULT_ARCHIVE_DIR = "archive";
+
+namespace {
+    const QString UNKNOWN_STATION = "station";
+    const TimeStampType MSECS_IN_DAY = 24*60*60*1000.0;
+}
+
+ArchiveWriter::ArchiveWriter(QObject *parent) :
+    QObject(parent), enabled(false), failed(false), rootDir(DEFAULT_ARCHIVE_DIR),
+    chunkSecs(Archive::DEFAULT_CHUNK_SECS), retentionDays(Archive::DEFAULT_RETENTION_DAYS),
+    samplingFreq(0), lastExpire(-1)
+{}
+
+void ArchiveWriter::setArchivePolicy(bool enabled, QString directory, int chunkSecs, int retentionDays) {
+    close();
+    this->enabled = enabled;
+    rootDir = directory;
+    this->chunkSecs = chunkSecs;
+    this->retentionDays = retentionDays;
+    failed = false;
+}
+
+void ArchiveWriter::setDeviceID(QString id) {
+    if (id != deviceID) {
+        close();
+        deviceID = id;
+        failed = false;
+    }
+}
+
+void ArchiveWriter::setFrequencies(int samplingFreq, int filterFreq) {
+    Q_UNUSED(filterFreq);
+    this->samplingFreq = samplingFreq;
+}
+
+void ArchiveWriter::receiveData(TimeStampsVector t, DataVector d) {
+    if ( ! enabled || ! openIfClosed() ) {
+        return;
+    }
+    const DataBlock block(t, d);
+    if (block.size() == 0) {
+        return;
+    }
+    archive->append(block, samplingFreq);
+
+    const TimeStampType now = block.timestamps.last();
+    if (retentionDays > 0 && (lastExpire < 0 || now - lastExpire >= EXPIRE_INTERVAL_MSECS)) {
+        const int expired = archive->expire(now - retentionDays*MSECS_IN_DAY);
+        if (expired > 0) {
+            Logger::trace(tr("Removed %1 chunks older than %2 days from archive").arg(expired).arg(retentionDays));
+        }
+        lastExpire = now;
+    }
+}
+
+void ArchiveWriter::finish() {
+    if ( ! archive.isNull() ) {
+        archive->seal();
+    }
+}
+
+bool ArchiveWriter::openIfClosed() {
+    if ( ! archive.isNull() ) {
+        return true;
+    }
+    if (failed) {
+        return false;
+    }
+    const QString station = deviceID.trimmed().isEmpty() ? UNKNOWN_STATION : deviceID.trimmed();
+    archive.reset(new Archive(QDir(rootDir).filePath(station), chunkSecs));
+    if ( ! archive->open() ) {
+        Logger::error(tr("Data are not archived"));
+        archive.reset();
+        failed = true;
+        return false;
+    }
+    lastExpire = -1;
+    return true;
+}
+
+void ArchiveWriter::close() {
+    archive.reset(); // Seals open chunks
+}
@@ -0,0 +1,68 @@
+#ifndef ARCHIVEWRITER_H
+#define ARCHIVEWRITER_H
+
+#include "protocol.h"
+#include "archive/archive.h"
+
+#include <QObject>
+#include <QScopedPointer>
+
+/*!
+ * \brief ArchiveWriter appends received data to the archive of the station (\see Archive)
+ *
+ * It is a sink next to FileWriter: receives the same data, but keeps them in one
+ * continuous store per station (subdirectory of archive directory named by device ID),
+ * instead of files for exchange. Chunks older than the retention period are removed
+ * as new data come (by time of data, not by the clock of computer).
+ *
+ * Like FileWriter, it can be running in a separate thread, so its slots should not be
+ * called directly. Archives are read by ArchiveReader (e.g. exported by seismoconvert),
+ * also while they are being written.
+ */
+class ArchiveWriter : public QObject
+{
+    Q_OBJECT
+public:
+    static const QString DEFAULT_ARCHIVE_DIR;
+    static const int EXPIRE_INTERVAL_MSECS = 60*1000;
+
+    explicit ArchiveWriter(QObject *parent = nullptr);
+
+public slots:
+    /*!
+     * \brief Sets where and how data are archived. Seals and closes the current archive.
+     * \param enabled - whether to archive data at all
+     * \param directory - where archives of stations are
+     * \param chunkSecs - length of time partition of chunks
+     * \param retentionDays - chunks older than this number of days are removed (0 - never)
+     */
+    void setArchivePolicy(bool enabled, QString directory, int chunkSecs, int retentionDays);
+
+    void receiveData(TimeStampsVector t, DataVector d);
+
+    /// Archive of another station is used for the next data
+    void setDeviceID(QString id);
+    void setFrequencies(int samplingFreq, int filterFreq);
+
+    /*!
+     * \brief Seals open chunks: useful when receiving of data is stopped
+     */
+    void finish();
+
+private:
+    bool openIfClosed();
+    void close();
+
+    bool enabled;
+    bool failed; // Failed to open archive: not tried again until settings change
+    QString rootDir;
+    int chunkSecs;
+    int retentionDays;
+    QString deviceID;
+    int samplingFreq;
+    TimeStampType lastExpire; // Negative if not expired yet
+
+    QScopedPointer<Archive> archive; // NULL if disabled or not opened yet
+};
+
+#endif // ARCHIVEWRITER_H
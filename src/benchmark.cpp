@@ -0,0 +1,1472 @@
+#include "benchmark.h"
+#include "logger.h"
+#include "protocol.h"
+#include "writers/textencoder.h"
+#include "writers/miniseedencoder.h"
+#include "writers/outputformat.h"
+#include "writers/gzipcompressor.h"
+#include "writers/asyncfilesink.h"
+#include "writers/journal.h"
+#include "writers/fileindex.h"
+#include "extracttool.h"
+#include "archive/archive.h"
+#include "archive/historyring.h"
+#include "dsp/stagegraph.h"
+#include "dsp/staltatrigger.h"
+#include "dsp/spectrumstage.h"
+#include "dsp/realfft.h"
+#include "dsp/ppsdstage.h"
+#include "dsp/butterworthfilter.h"
+#include "dsp/filterstage.h"
+#include "dsp/slidingstats.h"
+#include "dsp/qualitystage.h"
+#include "dsp/responsestage.h"
+#include "dsp/pickerstage.h"
+#include "dsp/magnitudestage.h"
+#include "dsp/polarizationstage.h"
+#include "dsp/templatestage.h"
+
+#include <QBuffer>
+#include <QElapsedTimer>
+#include <QQueue>
+#include <QDir>
+#include <QFile>
+#include <QScopedPointer>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <QAtomicInteger>
+#include <qmath.h>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+const QString Benchmark::ARGUMENT = "--benchmark";
+
+namespace {
+    const int ITEMS_PER_BLOCK = 200; // One second of data at the highest frequency
+    const int BLOCKS_COUNT = 3600;   // One hour of data
+    const int AMPLITUDE = 9000000;
+    const int SAMPLING_FREQ = ITEMS_PER_BLOCK; // Hz
+
+    TimeStampsVector generateTimes(int block) {
+        const TimeStampType start = 1500000000000.0;
+        TimeStampsVector times(ITEMS_PER_BLOCK);
+        for (int i = 0; i < ITEMS_PER_BLOCK; ++i) {
+            times[i] = start + (block*ITEMS_PER_BLOCK + i) * 1000.0 / SAMPLING_FREQ;
+        }
+        return times;
+    }
+
+    QVector<DataVector> generateBlocks() {
+        QVector<DataVector> blocks(BLOCKS_COUNT);
+        int n = 0;
+        for (DataVector & block: blocks) {
+            block.resize(ITEMS_PER_BLOCK);
+            for (DataItem & item: block) {
+                for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+                    item.byChannel[ch] = DataType(AMPLITUDE*qSin(0.01*n + ch) * qCos(0.0003*n));
+                }
+                ++n;
+            }
+        }
+        return blocks;
+    }
+
+    // The way FileWriter formatted data before TextEncoder
+    QByteArray formatLegacy(const QVector<DataVector> & blocks) {
+        QQueue<QString> queue;
+        for (const DataVector & d: blocks) {
+            QByteArray allData;
+            QByteArray number;
+            foreach(const DataItem & item, d) {
+                for(unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+                    number.setNum(item.byChannel[ch]);
+                    allData += number;
+                    if (ch < CHANNELS_NUM-1) {
+                        allData += "    ";
+                    }
+                }
+                allData += '\n';
+            }
+            queue.enqueue(allData);
+        }
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly | QIODevice::Text); // As files were opened
+        {
+            QTextStream out(&buffer);
+            foreach (auto str, queue) {
+                out << str;
+            }
+        }
+        return buffer.data();
+    }
+
+    QByteArray formatEncoder(const QVector<DataVector> & blocks) {
+        QQueue<QByteArray> queue;
+        for (const DataVector & d: blocks) {
+            queue.enqueue(TextEncoder::encode(d));
+        }
+        QBuffer buffer;
+        buffer.open(QIODevice::WriteOnly);
+        foreach (const QByteArray & block, queue) {
+            buffer.write(block);
+        }
+        return buffer.data();
+    }
+
+    // Counts items that come out of a branch of StageGraph
+    class CountingStage : public Stage {
+    public:
+        CountingStage() : Stage("count") {}
+        QAtomicInteger<qint64> items;
+    protected:
+        void process(const DataBlock & block) override { items.fetchAndAddRelaxed(block.size()); }
+    };
+
+    void reportThroughput(QString name, qint64 bytes, qint64 nsecs) {
+        double mbPerSec = (nsecs > 0) ? (bytes / 1e6) / (nsecs / 1e9) : 0;
+        Logger::info(Benchmark::tr("%1: %2 MB in %3 ms, %4 MB/s")
+                     .arg(name, -24)
+                     .arg(bytes / 1e6, 0, 'f', 1)
+                     .arg(nsecs / 1e6, 0, 'f', 1)
+                     .arg(mbPerSec, 0, 'f', 1));
+    }
+}
+
+bool Benchmark::runAll() {
+    bool ok = true;
+    ok = textFormatting() && ok;
+    ok = miniSeedEncoding() && ok;
+    ok = outputFormats() && ok;
+    ok = compression() && ok;
+    ok = journal() && ok;
+    ok = extraction() && ok;
+    ok = archive() && ok;
+    ok = historyRing() && ok;
+    ok = stageGraph() && ok;
+    ok = staLtaTrigger() && ok;
+    ok = spectrum() && ok;
+    ok = ppsd() && ok;
+    ok = filterBank() && ok;
+    ok = slidingStats() && ok;
+    ok = quality() && ok;
+    ok = responseCorrection() && ok;
+    ok = picker() && ok;
+    ok = magnitude() && ok;
+    ok = polarization() && ok;
+    ok = templateMatching() && ok;
+    return ok;
+}
+
+bool Benchmark::textFormatting() {
+    Logger::info(tr("Benchmark: text formatting of %1 items").arg(ITEMS_PER_BLOCK*BLOCKS_COUNT));
+    QVector<DataVector> blocks = generateBlocks();
+    QElapsedTimer timer;
+
+    timer.start();
+    QByteArray legacy = formatLegacy(blocks);
+    reportThroughput(tr("setNum + QTextStream"), legacy.size(), timer.nsecsElapsed());
+
+    timer.start();
+    QByteArray encoded = formatEncoder(blocks);
+    reportThroughput(tr("TextEncoder"), encoded.size(), timer.nsecsElapsed());
+
+    if (legacy != encoded) {
+        Logger::error(tr("TextEncoder output differs from the former format!"));
+        return false;
+    }
+    return true;
+}
+
+bool Benchmark::miniSeedEncoding() {
+    Logger::info(tr("Benchmark: MiniSEED encoding of %1 items").arg(ITEMS_PER_BLOCK*BLOCKS_COUNT));
+    QVector<DataVector> blocks = generateBlocks();
+    QVector<TimeStampsVector> times(BLOCKS_COUNT);
+    for (int b = 0; b < BLOCKS_COUNT; ++b) {
+        times[b] = generateTimes(b);
+    }
+    qint64 textSize = formatEncoder(blocks).size();
+    const qint64 samplesCount = qint64(ITEMS_PER_BLOCK)*BLOCKS_COUNT*CHANNELS_NUM;
+
+    bool ok = true;
+    for (int recordLength: {MiniSeedEncoder::SMALL_RECORD_LENGTH, MiniSeedEncoder::DEFAULT_RECORD_LENGTH}) {
+        MiniSeedEncoder encoder(recordLength, MiniSeedEncoder::DEFAULT_NETWORK, "BENCH", SAMPLING_FREQ);
+        QElapsedTimer timer;
+        timer.start();
+        QByteArray encoded;
+        for (int b = 0; b < BLOCKS_COUNT; ++b) {
+            encoded += encoder.appendBlock(times[b], blocks[b]);
+        }
+        encoded += encoder.flush();
+        qint64 nsecs = timer.nsecsElapsed();
+        // Throughput in terms of text data, to compare with text formatting
+        reportThroughput(tr("MiniSEED, %1-byte records").arg(recordLength), textSize, nsecs);
+        Logger::info(tr("%1 bytes per sample (text: %2), %3 times smaller")
+                     .arg(double(encoded.size())/samplesCount, 0, 'f', 2)
+                     .arg(double(textSize)/samplesCount, 0, 'f', 2)
+                     .arg(double(textSize)/encoded.size(), 0, 'f', 1));
+
+        // Decode back and compare, channel by channel
+        QVector<qint32> decoded[CHANNELS_NUM];
+        QVector<qint32> samples;
+        for (int offset = 0; offset + recordLength <= encoded.size(); offset += recordLength) {
+            const char * record = encoded.constData() + offset;
+            const char * component = strchr(CHANNEL_COMPONENTS, record[17]);
+            if (component == NULL || MiniSeedEncoder::decodeRecord(record, recordLength, samples) < 0) {
+                ok = false;
+                break;
+            }
+            decoded[component - CHANNEL_COMPONENTS] += samples;
+        }
+        for (unsigned ch = 0; ch < CHANNELS_NUM && ok; ++ch) {
+            int i = 0;
+            for (const DataVector & block: blocks) {
+                for (const DataItem & item: block) {
+                    if (i >= decoded[ch].size() || decoded[ch][i] != item.byChannel[ch]) {
+                        ok = false;
+                    }
+                    ++i;
+                }
+            }
+            ok = ok && (i == decoded[ch].size());
+        }
+        if ( ! ok ) {
+            Logger::error(tr("MiniSEED records don't decode into original samples!"));
+            break;
+        }
+    }
+    return ok;
+}
+
+bool Benchmark::outputFormats() {
+    Logger::info(tr("Benchmark: output formats for %1 items").arg(ITEMS_PER_BLOCK*BLOCKS_COUNT));
+    QVector<DataBlock> blocks;
+    QVector<DataVector> data = generateBlocks();
+    for (int b = 0; b < BLOCKS_COUNT; ++b) {
+        blocks << DataBlock(generateTimes(b), data[b]);
+    }
+    OutputFormat::FileInfo info;
+    info.deviceID = "BENCH";
+    info.samplingFreq = SAMPLING_FREQ;
+    info.startTime = QDateTime::fromMSecsSinceEpoch(qint64(blocks.first().timestamps.first()));
+    // Throughput is measured in terms of raw data, so that backends can be compared
+    const qint64 rawSize = qint64(sizeof(DataType))*CHANNELS_NUM*ITEMS_PER_BLOCK*BLOCKS_COUNT;
+
+    // Each backend alone, then all of them on the same stream, as FileWriter does
+    QList<OutputFormat::Types> combinations;
+    for (OutputFormat::Type type: OutputFormat::ALL_TYPES) {
+        combinations << type;
+    }
+    combinations << (OutputFormat::Text | OutputFormat::MiniSeed | OutputFormat::Binary);
+
+    for (OutputFormat::Types types: combinations) {
+        QList<OutputFormat*> formats;
+        QStringList names;
+        for (OutputFormat::Type type: OutputFormat::ALL_TYPES) {
+            if (types.testFlag(type)) {
+                formats << OutputFormat::create(type);
+                names << OutputFormat::typeName(type);
+            }
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        qint64 outputSize = 0;
+        for (OutputFormat * format: formats) {
+            format->open(info);
+            outputSize += format->header(info).size();
+        }
+        for (const DataBlock & block: blocks) {
+            for (OutputFormat * format: formats) {
+                outputSize += format->appendBlock(block).size();
+            }
+        }
+        for (OutputFormat * format: formats) {
+            outputSize += format->flush().size();
+            format->close();
+        }
+        reportThroughput(names.join('+'), rawSize, timer.nsecsElapsed());
+        Logger::info(tr("%1 MB written, %2 bytes per sample")
+                     .arg(outputSize / 1e6, 0, 'f', 1)
+                     .arg(double(outputSize) / (rawSize / sizeof(DataType)), 0, 'f', 2));
+        qDeleteAll(formats);
+    }
+    return true;
+}
+
+bool Benchmark::compression() {
+    QByteArray text = formatEncoder(generateBlocks());
+    Logger::info(tr("Benchmark: gzip compression of %1 MB of text").arg(text.size() / 1e6, 0, 'f', 1));
+    bool ok = true;
+    for (int level: {GzipCompressor::FAST_LEVEL, int(GzipCompressor::DEFAULT_LEVEL), 9}) {
+        GzipCompressor compressor(level);
+        QByteArray compressed, out;
+        QElapsedTimer timer;
+        timer.start();
+        for (int pos = 0; pos < text.size(); pos += AsyncFileSink::BUFFER_SIZE) {
+            int size = qMin(int(AsyncFileSink::BUFFER_SIZE), text.size() - pos);
+            compressor.compress(text.constData() + pos, size, out);
+            compressed += out;
+        }
+        compressor.finish(out);
+        compressed += out;
+        reportThroughput(tr("gzip level %1").arg(level), text.size(), timer.nsecsElapsed());
+        Logger::info(tr("%1 MB written, ratio %2")
+                     .arg(compressed.size() / 1e6, 0, 'f', 1)
+                     .arg(compressor.ratio(), 0, 'f', 2));
+        QByteArray decompressed;
+        if ( ! GzipCompressor::decompress(compressed.constData(), compressed.size(), decompressed) || decompressed != text) {
+            Logger::error(tr("gzip level %1: decompressed data differ").arg(level));
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool Benchmark::journal() {
+    Logger::info(tr("Benchmark: journal of %1 items").arg(ITEMS_PER_BLOCK*BLOCKS_COUNT));
+    QTemporaryDir dir(QDir::currentPath() + "/seismoreg-bench-XXXXXX"); // On the disk of data files, not in tmpfs
+    if ( ! dir.isValid() ) {
+        Logger::error(tr("Failed to create temporary directory for journal"));
+        return false;
+    }
+    QVector<DataBlock> blocks;
+    QVector<DataVector> data = generateBlocks();
+    for (int b = 0; b < BLOCKS_COUNT; ++b) {
+        blocks << DataBlock(generateTimes(b), data[b]);
+    }
+    const qint64 rawSize = qint64(sizeof(DataType))*CHANNELS_NUM*ITEMS_PER_BLOCK*BLOCKS_COUNT;
+    Journal::Header header;
+    header.info.deviceID = "BENCH";
+    header.info.samplingFreq = SAMPLING_FREQ;
+
+    bool ok = true;
+    const int policies[][2] = {{1, 0}, {Journal::DEFAULT_COMMIT_BLOCKS, 0}, {64, 0}, {0, 0}}; // Blocks, msecs
+    for (const auto & policy: policies) {
+        const QString name = dir.filePath(QString("commit-%1").arg(policy[0]) + Journal::FILE_SUFFIX);
+        QElapsedTimer timer;
+        timer.start();
+        {
+            Journal journal(name, Journal::CommitPolicy(policy[0], policy[1]));
+            ok = journal.open(header) && ok;
+            for (const DataBlock & block: blocks) {
+                journal.append(block);
+            }
+            journal.keep(); // To be read back
+            journal.finish();
+        } // Waits for the I/O thread to sync the rest, reports its latencies
+        reportThroughput(policy[0] > 0 ? tr("sync every %1 blocks").arg(policy[0]) : tr("sync at the end"),
+                         rawSize, timer.nsecsElapsed());
+        Journal::Reader reader(name);
+        Journal::Header readHeader;
+        DataBlock block;
+        int blocksRead = 0;
+        if (reader.open(readHeader)) {
+            while (reader.readBlock(block) && blocksRead < BLOCKS_COUNT
+                   && block.timestamps == blocks[blocksRead].timestamps
+                   && memcmp(block.data.constData(), blocks[blocksRead].data.constData(), sizeof(DataItem)*ITEMS_PER_BLOCK) == 0) {
+                ++blocksRead;
+            }
+        }
+        if (blocksRead != BLOCKS_COUNT || readHeader.info.deviceID != header.info.deviceID) {
+            Logger::error(tr("Journal is read back incorrectly: %1 of %2 blocks").arg(blocksRead).arg(BLOCKS_COUNT));
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+bool Benchmark::extraction() {
+    Logger::info(tr("Benchmark: extraction of one minute from %1 items of text").arg(ITEMS_PER_BLOCK*BLOCKS_COUNT));
+    QTemporaryDir dir(QDir::currentPath() + "/seismoreg-bench-XXXXXX");
+    if ( ! dir.isValid() ) {
+        Logger::error(tr("Failed to create temporary directory for data file"));
+        return false;
+    }
+    // Write data file with index, as FileWriter does
+    const QString dataFile = dir.filePath("data.w00");
+    QVector<DataVector> data = generateBlocks();
+    {
+        QScopedPointer<OutputFormat> format(OutputFormat::create(OutputFormat::Text));
+        OutputFormat::FileInfo info;
+        info.deviceID = "BENCH";
+        info.samplingFreq = SAMPLING_FREQ;
+        info.startTime = QDateTime::fromMSecsSinceEpoch(qint64(generateTimes(0).first()));
+        QFile file(dataFile);
+        FileIndex index;
+        if ( ! file.open(QIODevice::WriteOnly) || ! index.create(FileIndex::fileNameFor(dataFile)) ) {
+            Logger::error(tr("Failed to create data file %1").arg(dataFile));
+            return false;
+        }
+        format->open(info);
+        file.write(format->header(info));
+        for (int b = 0; b < BLOCKS_COUNT; ++b) {
+            DataBlock block(generateTimes(b), data[b]);
+            index.addBlock(block, file.pos());
+            file.write(format->appendBlock(block));
+        }
+    }
+
+    // A minute in the middle of the hour
+    const TimeStampType from = generateTimes(BLOCKS_COUNT/2).first();
+    const TimeStampType to = from + 60*1000.0;
+    QElapsedTimer timer;
+    timer.start();
+    qint64 indexed = ExtractTool::extract(dataFile, from, to, dir.filePath("indexed.w00"));
+    const qint64 indexedNsecs = timer.nsecsElapsed();
+    QFile::remove(FileIndex::fileNameFor(dataFile));
+    timer.start();
+    qint64 scanned = ExtractTool::extract(dataFile, from, to, dir.filePath("scanned.w00"));
+    const qint64 scannedNsecs = timer.nsecsElapsed();
+    Logger::info(tr("with index: %1 ms, without index: %2 ms")
+                 .arg(indexedNsecs / 1e6, 0, 'f', 1).arg(scannedNsecs / 1e6, 0, 'f', 1));
+
+    QFile indexedFile(dir.filePath("indexed.w00")), scannedFile(dir.filePath("scanned.w00"));
+    bool ok = indexed == 60*SAMPLING_FREQ && scanned == indexed
+           && indexedFile.open(QIODevice::ReadOnly) && scannedFile.open(QIODevice::ReadOnly)
+           && indexedFile.readAll() == scannedFile.readAll();
+    if ( ! ok ) {
+        Logger::error(tr("Extracted data differ: %1 items with index, %2 without").arg(indexed).arg(scanned));
+    }
+    return ok;
+}
+
+bool Benchmark::archive() {
+    Logger::info(tr("Benchmark: archive of %1 items").arg(ITEMS_PER_BLOCK*BLOCKS_COUNT));
+    QTemporaryDir dir(QDir::currentPath() + "/seismoreg-bench-XXXXXX");
+    if ( ! dir.isValid() ) {
+        Logger::error(tr("Failed to create temporary directory for archive"));
+        return false;
+    }
+    Archive archive(dir.path());
+    if ( ! archive.open() ) {
+        return false;
+    }
+    QVector<DataVector> data = generateBlocks();
+    QElapsedTimer timer;
+    timer.start();
+    for (int b = 0; b < BLOCKS_COUNT; ++b) {
+        archive.append(DataBlock(generateTimes(b), data[b]), SAMPLING_FREQ);
+    }
+    archive.seal();
+    const qint64 rawBytes = qint64(sizeof(DataItem))*ITEMS_PER_BLOCK*BLOCKS_COUNT;
+    reportThroughput(tr("append"), rawBytes, timer.nsecsElapsed());
+    Logger::info(tr("%1 chunks, %2 MB on disk, compression ratio %3")
+                 .arg(archive.chunksCount()).arg(archive.diskBytes() / 1e6, 0, 'f', 1)
+                 .arg(double(rawBytes) / archive.diskBytes(), 0, 'f', 2));
+
+    // A minute of one channel in the middle of the hour
+    const int firstBlock = BLOCKS_COUNT/2;
+    const int channel = 1;
+    const TimeStampType from = generateTimes(firstBlock).first();
+    timer.start();
+    const QList<Archive::Series> minute = archive.query(QList<int>() << channel, from, from + 60*1000.0);
+    const qint64 minuteNsecs = timer.nsecsElapsed();
+    timer.start();
+    TimeStampType first = 0, last = 0;
+    archive.timeRange(&first, &last);
+    const QList<Archive::Series> hour = archive.query(QList<int>() << 0 << 1 << 2, first, last, 1);
+    const qint64 hourNsecs = timer.nsecsElapsed();
+    Logger::info(tr("query of one minute: %1 ms, of the whole hour at 1 Hz: %2 ms")
+                 .arg(minuteNsecs / 1e6, 0, 'f', 1).arg(hourNsecs / 1e6, 0, 'f', 1));
+
+    bool ok = minute.size() == 1 && minute.first().values.size() == 60*SAMPLING_FREQ
+           && minute.first().start == from;
+    for (int i = 0; ok && i < 60*SAMPLING_FREQ; ++i) {
+        ok = minute.first().values[i] == data[firstBlock + i/ITEMS_PER_BLOCK][i%ITEMS_PER_BLOCK].byChannel[channel];
+    }
+    ok = ok && hour.size() == int(CHANNELS_NUM) && hour.first().values.size() == BLOCKS_COUNT;
+    if ( ! ok ) {
+        Logger::error(tr("Data queried from archive differ from appended"));
+    }
+    return ok;
+}
+
+bool Benchmark::historyRing() {
+    Logger::info(tr("Benchmark: history ring of %1 items").arg(ITEMS_PER_BLOCK*BLOCKS_COUNT/2));
+    QTemporaryDir dir(QDir::currentPath() + "/seismoreg-bench-XXXXXX");
+    if ( ! dir.isValid() ) {
+        Logger::error(tr("Failed to create temporary directory for history"));
+        return false;
+    }
+    const QString fileName = dir.filePath(HistoryRing::DEFAULT_FILE_NAME);
+    const qint64 capacity = qint64(ITEMS_PER_BLOCK)*BLOCKS_COUNT/2; // Wraps around
+    QVector<DataVector> data = generateBlocks();
+    QElapsedTimer timer;
+    {
+        HistoryRing ring(fileName);
+        if ( ! ring.open(capacity) ) {
+            return false;
+        }
+        timer.start();
+        for (int b = 0; b < BLOCKS_COUNT; ++b) {
+            ring.append(DataBlock(generateTimes(b), data[b]));
+        }
+        reportThroughput(tr("append"), qint64(sizeof(DataItem) + sizeof(TimeStampType))*ITEMS_PER_BLOCK*BLOCKS_COUNT,
+                         timer.nsecsElapsed());
+    }
+
+    // As after restart
+    timer.start();
+    HistoryRing ring(fileName);
+    TimeStampType first = 0, last = 0;
+    const bool opened = ring.open(capacity) && ring.timeRange(&first, &last);
+    const DataBlock minute = ring.read(last + 1 - 60*1000.0, last + 1); // Exactly a minute up to the last item
+    Logger::info(tr("open and read of the last minute: %1 ms").arg(timer.nsecsElapsed() / 1e6, 0, 'f', 2));
+
+    const int items = 60*SAMPLING_FREQ;
+    bool ok = opened && ring.size() == capacity && minute.size() == items
+           && first == generateTimes(BLOCKS_COUNT/2).first();
+    for (int i = 0; ok && i < items; ++i) {
+        const int n = ITEMS_PER_BLOCK*BLOCKS_COUNT - items + i;
+        ok = memcmp(&minute.data[i], &data[n/ITEMS_PER_BLOCK][n%ITEMS_PER_BLOCK], sizeof(DataItem)) == 0
+          && minute.timestamps[i] == generateTimes(n/ITEMS_PER_BLOCK)[n%ITEMS_PER_BLOCK];
+    }
+    if ( ! ok ) {
+        Logger::error(tr("Data read from history ring differ from appended"));
+    }
+    return ok;
+}
+
+bool Benchmark::stageGraph() {
+    const int BRANCHES = 4;
+    const int FILTERS = 3; // Per branch
+    const qint64 itemsPerBranch = qint64(ITEMS_PER_BLOCK)*BLOCKS_COUNT;
+    Logger::info(tr("Benchmark: stage graph of %1 branches with %2 filters").arg(BRANCHES).arg(FILTERS));
+    ButterworthFilter::Parameters params;
+    params.type = ButterworthFilter::BandPass;
+    params.order = 2;
+    QVector<DataVector> data = generateBlocks();
+    bool ok = true;
+    for (int threads: {1, QThread::idealThreadCount()}) {
+        StageGraph graph;
+        graph.setThreadCount(threads);
+        QList<CountingStage*> counters;
+        for (int b = 0; b < BRANCHES; ++b) {
+            Stage * last = NULL;
+            for (int f = 0; f < FILTERS; ++f) {
+                last = graph.add(new FilterStage(QString("filter %1/%2").arg(b).arg(f), params), last);
+            }
+            counters << graph.add(new CountingStage, last);
+        }
+        graph.setFrequencies(SAMPLING_FREQ, SAMPLING_FREQ);
+        QElapsedTimer timer;
+        timer.start();
+        for (int b = 0; b < BLOCKS_COUNT; ++b) {
+            graph.receiveData(generateTimes(b), data[b]);
+        }
+        graph.waitForDone();
+        reportThroughput(tr("%1 threads").arg(threads),
+                         qint64(sizeof(DataItem))*ITEMS_PER_BLOCK*BLOCKS_COUNT*BRANCHES, timer.nsecsElapsed());
+        for (CountingStage * counter: counters) {
+            ok = ok && counter->items.load() == itemsPerBranch;
+        }
+    }
+    if ( ! ok ) {
+        Logger::error(tr("Stages of graph lost data"));
+    }
+    return ok;
+}
+
+bool Benchmark::staLtaTrigger() {
+    Logger::info(tr("Benchmark: STA/LTA trigger on one hour of noise with a burst"));
+    const int BURST_BLOCK = BLOCKS_COUNT/2;
+    const int BURST_BLOCKS = 10; // Seconds
+    const int NOISE = 1000;
+    QVector<DataVector> data(BLOCKS_COUNT);
+    quint32 random = 1;
+    for (int b = 0; b < BLOCKS_COUNT; ++b) {
+        const int amplitude = (b >= BURST_BLOCK && b < BURST_BLOCK + BURST_BLOCKS) ? 20*NOISE : NOISE;
+        data[b].resize(ITEMS_PER_BLOCK);
+        for (DataItem & item: data[b]) {
+            for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+                random = random*1103515245 + 12345;
+                item.byChannel[ch] = DataType(100000 + int((random >> 16) % (2*amplitude + 1)) - amplitude);
+            }
+        }
+    }
+
+    StageGraph graph;
+    StaLtaTrigger * trigger = graph.add(new StaLtaTrigger("trigger", StaLtaTrigger::Parameters()));
+    QList<TimeStampType> onTimes, offTimes; // Filled in the thread of stage, read after waitForDone
+    QObject::connect(trigger, &StaLtaTrigger::triggerOn, [&onTimes](TimeStampType time, int) {
+        onTimes << time;
+    });
+    QObject::connect(trigger, &StaLtaTrigger::triggerOff, [&offTimes](TimeStampType, TimeStampType time, double) {
+        offTimes << time;
+    });
+    graph.setFrequencies(SAMPLING_FREQ, SAMPLING_FREQ);
+    QElapsedTimer timer;
+    timer.start();
+    for (int b = 0; b < BLOCKS_COUNT; ++b) {
+        graph.receiveData(generateTimes(b), data[b]);
+    }
+    graph.waitForDone();
+    const qint64 nsecs = timer.nsecsElapsed();
+    Logger::info(tr("%1 samples of %2 channels in %3 ms: %4 samples per second, %5 ms per %6 Hz block")
+                 .arg(ITEMS_PER_BLOCK*BLOCKS_COUNT).arg(CHANNELS_NUM)
+                 .arg(nsecs / 1e6, 0, 'f', 1)
+                 .arg(ITEMS_PER_BLOCK*BLOCKS_COUNT / (nsecs / 1e9), 0, 'f', 0)
+                 .arg(trigger->performance().percentile(50), 0, 'f', 3).arg(SAMPLING_FREQ));
+
+    const TimeStampType burstStart = generateTimes(BURST_BLOCK).first();
+    const TimeStampType burstEnd = generateTimes(BURST_BLOCK + BURST_BLOCKS).first();
+    const bool ok = onTimes.size() == 1 && offTimes.size() == 1
+                 && onTimes.first() >= burstStart && onTimes.first() < burstStart + 1000
+                 && offTimes.first() >= burstEnd;
+    if ( ! ok ) {
+        Logger::error(tr("STA/LTA trigger detected %1 events instead of one at the burst").arg(onTimes.size()));
+    }
+    return ok;
+}
+
+bool Benchmark::spectrum() {
+    Logger::info(tr("Benchmark: spectrum of one hour of data on all channels"));
+    // Transform against the definition
+    const int FFT_SIZE = 256;
+    RealFft fft(FFT_SIZE);
+    QVector<double> signal(FFT_SIZE);
+    for (int i = 0; i < FFT_SIZE; ++i) {
+        signal[i] = qSin(0.3*i) + (i % 7) - qCos(0.01*i*i);
+    }
+    QVector<RealFft::Complex> bins(fft.bins());
+    fft.transform(signal.constData(), bins.data());
+    double error = 0;
+    for (int k = 0; k < fft.bins(); ++k) {
+        RealFft::Complex direct = 0;
+        for (int j = 0; j < FFT_SIZE; ++j) {
+            direct += signal[j] * std::polar(1.0, -2*M_PI*j*k/FFT_SIZE);
+        }
+        error = qMax(error, std::abs(direct - bins[k]));
+    }
+    bool ok = error < 1e-9;
+    if ( ! ok ) {
+        Logger::error(tr("FFT differs from direct DFT by %1").arg(error));
+    }
+
+    // Sines of 10, 25 and 40 Hz in channels
+    const double FREQUENCIES[CHANNELS_NUM] = {10, 25, 40};
+    QVector<DataVector> data(BLOCKS_COUNT);
+    for (int b = 0; b < BLOCKS_COUNT; ++b) {
+        data[b].resize(ITEMS_PER_BLOCK);
+        for (int i = 0; i < ITEMS_PER_BLOCK; ++i) {
+            const double t = double(b*ITEMS_PER_BLOCK + i) / SAMPLING_FREQ;
+            for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+                data[b][i].byChannel[ch] = DataType(1000 + AMPLITUDE*qSin(2*M_PI*FREQUENCIES[ch]*t));
+            }
+        }
+    }
+    StageGraph graph;
+    SpectrumStage * stages[CHANNELS_NUM];
+    double peaks[CHANNELS_NUM]; // Frequency of maximum in the last spectrum, written in threads of stages
+    int spectra[CHANNELS_NUM];
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        stages[ch] = graph.add(new SpectrumStage(QString("spectrum %1").arg(ch + 1), ch, SpectrumStage::Parameters()));
+        peaks[ch] = 0;
+        spectra[ch] = 0;
+        double * peak = &peaks[ch];
+        int * count = &spectra[ch];
+        QObject::connect(stages[ch], &SpectrumStage::spectrumReady, [peak, count](TimeStampType, double binWidth, QVector<double> psd) {
+            *peak = (std::max_element(psd.constBegin(), psd.constEnd()) - psd.constBegin()) * binWidth;
+            ++*count;
+        });
+    }
+    graph.setFrequencies(SAMPLING_FREQ, SAMPLING_FREQ);
+    QElapsedTimer timer;
+    timer.start();
+    for (int b = 0; b < BLOCKS_COUNT; ++b) {
+        graph.receiveData(generateTimes(b), data[b]);
+    }
+    graph.waitForDone();
+    Logger::info(tr("%1 spectra per channel in %2 ms").arg(spectra[0]).arg(timer.nsecsElapsed() / 1e6, 0, 'f', 1));
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        Logger::info(tr("channel %1: %2% of one core, peak at %3 Hz")
+                     .arg(ch + 1).arg(stages[ch]->load()*100, 0, 'f', 3).arg(peaks[ch], 0, 'f', 2));
+        const double binWidth = double(SAMPLING_FREQ) / stages[ch]->parameters().windowSize;
+        ok = ok && qAbs(peaks[ch] - FREQUENCIES[ch]) <= binWidth;
+    }
+    if ( ! ok ) {
+        Logger::error(tr("Spectra don't peak at frequencies of signals"));
+    }
+    return ok;
+}
+
+bool Benchmark::ppsd() {
+    const int SEGMENT_SECS = 10*60;
+    const int NOISE = 1000; // Uniform in [-NOISE, NOISE]: variance NOISE^2/3
+    Logger::info(tr("Benchmark: PPSD of one hour of white noise, %1 s segments").arg(SEGMENT_SECS));
+    QTemporaryDir dir(QDir::currentPath() + "/seismoreg-bench-XXXXXX");
+    if ( ! dir.isValid() ) {
+        Logger::error(tr("Failed to create temporary directory for PPSD"));
+        return false;
+    }
+    QVector<DataVector> data(BLOCKS_COUNT);
+    quint32 random = 1;
+    for (DataVector & block: data) {
+        block.resize(ITEMS_PER_BLOCK);
+        for (DataItem & item: block) {
+            random = random*1103515245 + 12345;
+            item.byChannel[0] = DataType(int((random >> 8) % (2*NOISE + 1)) - NOISE);
+        }
+    }
+    const double expectedDb = 10*log10(2.0*NOISE*NOISE/3 / SAMPLING_FREQ); // One-sided density
+
+    StageGraph graph;
+    PpsdStage * stage = graph.add(new PpsdStage("ppsd", 0, dir.path(), SEGMENT_SECS));
+    stage->setThreadPriority(QThread::IdlePriority);
+    qint64 segments = 0;
+    double maxDeviation = 0;
+    QObject::connect(stage, &PpsdStage::segmentAdded, [&](TimeStampType, QVector<double>, QVector<double> db, qint64 count) {
+        segments = count;
+        for (double level: db) {
+            maxDeviation = qMax(maxDeviation, qAbs(level - expectedDb));
+        }
+    });
+    graph.setFrequencies(SAMPLING_FREQ, SAMPLING_FREQ);
+    QElapsedTimer timer;
+    timer.start();
+    for (int b = 0; b < BLOCKS_COUNT; ++b) {
+        graph.receiveData(generateTimes(b), data[b]);
+    }
+    graph.waitForDone();
+    Logger::info(tr("%1 segments in %2 ms, %3% of one core, deviation from %4 dB up to %5 dB")
+                 .arg(segments).arg(timer.nsecsElapsed() / 1e6, 0, 'f', 1).arg(stage->load()*100, 0, 'f', 3)
+                 .arg(expectedDb, 0, 'f', 1).arg(maxDeviation, 0, 'f', 1));
+
+    PpsdHistogram histogram;
+    const bool loaded = histogram.load(stage->fileName());
+    const qint64 expectedSegments = (BLOCKS_COUNT - SEGMENT_SECS) / (SEGMENT_SECS/2) + 1;
+    const bool ok = segments == expectedSegments && maxDeviation < 3
+                 && loaded && histogram.segments() == segments;
+    if ( ! ok ) {
+        Logger::error(tr("PPSD has %1 segments instead of %2, or wrong levels").arg(segments).arg(expectedSegments));
+    }
+    return ok;
+}
+
+bool Benchmark::filterBank() {
+    Logger::info(tr("Benchmark: band-pass filter of one hour of data on all channels"));
+    ButterworthFilter::Parameters params;
+    params.type = ButterworthFilter::BandPass;
+    params.order = 4;
+    params.lowFreq = 1;
+    params.highFreq = 10;
+    ButterworthFilter filter(params);
+    filter.design(SAMPLING_FREQ);
+    // -3 dB at cutoffs, flat in the middle of the band
+    const double centre = qSqrt(params.lowFreq * params.highFreq);
+    bool ok = qAbs(filter.gain(params.lowFreq) - M_SQRT1_2) < 0.01
+           && qAbs(filter.gain(params.highFreq) - M_SQRT1_2) < 0.01
+           && qAbs(filter.gain(centre) - 1) < 0.01;
+    if ( ! ok ) {
+        Logger::error(tr("Gain of filter is %1 at %2 Hz, %3 at %4 Hz and %5 at %6 Hz")
+                      .arg(filter.gain(params.lowFreq)).arg(params.lowFreq)
+                      .arg(filter.gain(centre)).arg(centre)
+                      .arg(filter.gain(params.highFreq)).arg(params.highFreq));
+    }
+
+    // Offset, microseismic noise (0.1 Hz), signal (3 Hz) and mains hum (50 Hz)
+    const double SIGNAL_FREQ = 3;
+    const int SIGNAL = 100000;
+    QVector<DataVector> data(BLOCKS_COUNT);
+    for (int b = 0; b < BLOCKS_COUNT; ++b) {
+        data[b].resize(ITEMS_PER_BLOCK);
+        for (int i = 0; i < ITEMS_PER_BLOCK; ++i) {
+            const double t = double(b*ITEMS_PER_BLOCK + i) / SAMPLING_FREQ;
+            for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+                data[b][i].byChannel[ch] = DataType(1000000 + 10*SIGNAL*qSin(2*M_PI*0.1*t + ch)
+                                                    + SIGNAL*qSin(2*M_PI*SIGNAL_FREQ*t + ch)
+                                                    + SIGNAL*qSin(2*M_PI*50*t));
+            }
+        }
+    }
+    QVector<DataBlock> blocks(BLOCKS_COUNT);
+    for (int b = 0; b < BLOCKS_COUNT; ++b) {
+        blocks[b] = DataBlock(generateTimes(b), data[b]);
+    }
+    QElapsedTimer timer;
+    timer.start();
+    for (DataBlock & block: blocks) {
+        filter.filter(block);
+    }
+    const qint64 nsecs = timer.nsecsElapsed();
+    const double samples = double(BLOCKS_COUNT) * ITEMS_PER_BLOCK * CHANNELS_NUM;
+    Logger::info(tr("%1 sections: %2 samples in %3 ms, %4 million samples/s on one core")
+                 .arg(filter.sectionsCount()).arg(samples).arg(nsecs / 1e6, 0, 'f', 1)
+                 .arg(nsecs > 0 ? samples / (nsecs / 1e9) / 1e6 : 0, 0, 'f', 1));
+    // After the filter settles, only the signal is left
+    int peak = 0;
+    for (int b = BLOCKS_COUNT/2; b < BLOCKS_COUNT; ++b) {
+        for (const DataItem & item: blocks[b].data) {
+            for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+                peak = qMax(peak, qAbs(item.byChannel[ch]));
+            }
+        }
+    }
+    const bool passed = qAbs(peak - SIGNAL) < SIGNAL / 50;
+    if ( ! passed ) {
+        Logger::error(tr("Filtered signal has amplitude %1 instead of %2").arg(peak).arg(SIGNAL));
+    }
+    ok = ok && passed;
+
+    // The same in StageGraph, as in MainWindow
+    StageGraph graph;
+    FilterStage * stage = graph.add(new FilterStage("filter", params));
+    CountingStage * counter = graph.add(new CountingStage, stage);
+    graph.setFrequencies(SAMPLING_FREQ, SAMPLING_FREQ);
+    timer.start();
+    for (int b = 0; b < BLOCKS_COUNT; ++b) {
+        graph.receiveData(generateTimes(b), data[b]);
+    }
+    graph.waitForDone();
+    Logger::info(tr("FilterStage: %1 ms, %2% of one core")
+                 .arg(timer.nsecsElapsed() / 1e6, 0, 'f', 1).arg(stage->load()*100, 0, 'f', 3));
+    const bool complete = counter->items.load() == qint64(BLOCKS_COUNT) * ITEMS_PER_BLOCK;
+    if ( ! complete ) {
+        Logger::error(tr("FilterStage passed %1 items instead of %2").arg(counter->items.load()).arg(BLOCKS_COUNT * ITEMS_PER_BLOCK));
+    }
+    return ok && complete;
+}
+
+bool Benchmark::slidingStats() {
+    const int WINDOW = 10*SAMPLING_FREQ;
+    Logger::info(tr("Benchmark: statistics of one hour of data over %1 items").arg(WINDOW));
+    QVector<DataVector> blocks = generateBlocks();
+    QElapsedTimer timer;
+
+    // The way StatsBox computed them: min, max and average of each block, channel by channel
+    timer.start();
+    qint64 checksum = 0;
+    for (const DataVector & block: blocks) {
+        for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+            DataType min, max;
+            min = max = block[0].byChannel[ch];
+            double avg = 0;
+            foreach (DataItem item, block) {
+                DataType val = item.byChannel[ch];
+                min = qMin(min, val);
+                max = qMax(max, val);
+                avg += val;
+            }
+            checksum += min + max + qint64(avg / block.size());
+        }
+    }
+    Logger::info(tr("%1: %2 ms").arg(tr("per block (former)"), -24).arg(timer.nsecsElapsed() / 1e6, 0, 'f', 1));
+
+    SlidingStats stats(WINDOW);
+    timer.start();
+    for (const DataVector & block: blocks) {
+        stats.add(block);
+        for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+            checksum += stats.values(ch).max;
+        }
+    }
+    Logger::info(tr("%1: %2 ms").arg(tr("SlidingStats"), -24).arg(timer.nsecsElapsed() / 1e6, 0, 'f', 1));
+    Q_UNUSED(checksum);
+
+    // Against direct computation over the last window
+    bool ok = stats.size() == WINDOW;
+    for (unsigned ch = 0; ch < CHANNELS_NUM && ok; ++ch) {
+        DataType min = std::numeric_limits<DataType>::max();
+        DataType max = std::numeric_limits<DataType>::min();
+        double sum = 0;
+        double squares = 0;
+        for (int i = 0; i < WINDOW; ++i) {
+            const DataType val = blocks[BLOCKS_COUNT - 1 - i / ITEMS_PER_BLOCK][ITEMS_PER_BLOCK - 1 - i % ITEMS_PER_BLOCK].byChannel[ch];
+            min = qMin(min, val);
+            max = qMax(max, val);
+            sum += val;
+            squares += double(val) * val;
+        }
+        const double mean = sum / WINDOW;
+        const double rms = qSqrt(squares / WINDOW);
+        const SlidingStats::Values values = stats.values(ch);
+        ok = values.min == min && values.max == max
+          && qAbs(values.mean - mean) < 1e-6 * AMPLITUDE
+          && qAbs(values.rms - rms) < 1e-6 * AMPLITUDE;
+    }
+    if ( ! ok ) {
+        Logger::error(tr("SlidingStats differ from statistics computed over the window"));
+    }
+    return ok;
+}
+
+bool Benchmark::quality() {
+    Logger::info(tr("Benchmark: data quality of one hour of data with injected problems"));
+    QVector<DataVector> blocks = generateBlocks();
+    QualityStage::Parameters params;
+    params.fullScale = 2*AMPLITUDE;
+    // Clipping in channel 1: the first quarter of a second at full scale
+    for (int i = 0; i < ITEMS_PER_BLOCK/4; ++i) {
+        blocks[100][i].byChannel[0] = params.fullScale;
+    }
+    // Flatline in channel 2: two seconds of the same value
+    const int FLAT_BLOCKS = 2;
+    for (int b = 200; b < 200 + FLAT_BLOCKS; ++b) {
+        for (DataItem & item: blocks[b]) {
+            item.byChannel[1] = 12345;
+        }
+    }
+    // Spikes in channel 3: single samples moved by the amplitude of signal towards the other sign
+    const int SPIKES = 5;
+    for (int s = 0; s < SPIKES; ++s) {
+        DataType & value = blocks[300 + 10*s][ITEMS_PER_BLOCK/2].byChannel[2];
+        value += (value > 0) ? -AMPLITUDE : AMPLITUDE;
+    }
+    // Gap: the first quarter of a block is lost; overlap: a block is repeated
+    const int GAP_BLOCK = 400;
+    const int GAP_ITEMS = ITEMS_PER_BLOCK/4;
+    const int REPEATED_BLOCK = 500;
+
+    StageGraph graph;
+    QualityStage * stage = graph.add(new QualityStage("quality", params));
+    QualityStage::Metrics total; // Of all finished minutes
+    int minutes = 0;
+    QObject::connect(stage, &QualityStage::minuteReady, [&](QualityStage::Metrics metrics) {
+        total.add(metrics);
+        ++minutes;
+    });
+    graph.setFrequencies(SAMPLING_FREQ, SAMPLING_FREQ);
+    QElapsedTimer timer;
+    timer.start();
+    for (int b = 0; b < BLOCKS_COUNT; ++b) {
+        if (b == GAP_BLOCK) {
+            graph.receiveData(generateTimes(b).mid(GAP_ITEMS), blocks[b].mid(GAP_ITEMS));
+            continue;
+        }
+        graph.receiveData(generateTimes(b), blocks[b]);
+        if (b == REPEATED_BLOCK) {
+            graph.receiveData(generateTimes(b), blocks[b]);
+        }
+    }
+    graph.waitForDone();
+    const double samples = double(BLOCKS_COUNT) * ITEMS_PER_BLOCK * CHANNELS_NUM;
+    Logger::info(tr("%1 minutes in %2 ms, %3 ns per sample, %4% of one core")
+                 .arg(minutes).arg(timer.nsecsElapsed() / 1e6, 0, 'f', 1)
+                 .arg(stage->performance().totalTime() * 1e6 / samples, 0, 'f', 1)
+                 .arg(stage->load()*100, 0, 'f', 3));
+    Logger::info(tr("Found: %1").arg(total.describe()));
+
+    const TimeStampType period = 1000.0 / SAMPLING_FREQ;
+    bool ok = total.clipped[0] == ITEMS_PER_BLOCK/4 && total.clipped[1] == 0 && total.clipped[2] == 0
+           && total.flatlines[0] == 0 && total.flatlines[1] == 1 && total.flatlines[2] == 0
+           && total.flatItems[1] == FLAT_BLOCKS*ITEMS_PER_BLOCK
+           && total.spikes[0] == 0 && total.spikes[1] == 0 && total.spikes[2] == SPIKES
+           && total.gaps == 1 && qFuzzyCompare(total.gapMsecs, GAP_ITEMS*period)
+           && total.overlaps == 1 && qFuzzyCompare(total.overlapMsecs, ITEMS_PER_BLOCK*period);
+    if ( ! ok ) {
+        Logger::error(tr("Quality metrics differ from injected problems"));
+    }
+    return ok;
+}
+
+bool Benchmark::responseCorrection() {
+    Logger::info(tr("Benchmark: instrument response correction of one hour of data on all channels"));
+    ResponseFilter::Parameters params; // 1 Hz geophone, velocity above 0.1 Hz
+    params.sensitivity = 2e8;          // Counts per m/s
+    ResponseFilter filter(params);
+    bool ok = filter.design(SAMPLING_FREQ);
+    // Gain of the geophone relative to referenceFreq, where sensitivity is given
+    auto sensorGain = [&](double freq) {
+        const ResponseFilter::Root s(0, 2*M_PI*freq);
+        const ResponseFilter::Root ref(0, 2*M_PI*params.referenceFreq);
+        ResponseFilter::Root res = 1;
+        for (const ResponseFilter::Root & zero: params.zeros) {
+            res *= (s - zero) / (ref - zero);
+        }
+        for (const ResponseFilter::Root & pole: params.poles) {
+            res /= (s - pole) / (ref - pole);
+        }
+        return std::abs(res);
+    };
+    // Above the high-pass, counts times gain are nm/s at any frequency
+    for (double freq: {1.0, 2.0, 5.0, 10.0, 30.0}) {
+        const double flatness = filter.gain(freq) * sensorGain(freq) * params.sensitivity / ResponseFilter::UNITS_PER_METRE;
+        if (qAbs(flatness - 1) > 0.02) {
+            Logger::error(tr("Corrected response is %1 at %2 Hz instead of 1").arg(flatness).arg(freq));
+            ok = false;
+        }
+    }
+
+    // Offset, and a sine of velocity as the geophone records it
+    const double SIGNAL_FREQ = 2;
+    const int SIGNAL = 100000; // nm/s
+    const double signalCounts = SIGNAL / ResponseFilter::UNITS_PER_METRE * params.sensitivity * sensorGain(SIGNAL_FREQ);
+    QVector<DataVector> data(BLOCKS_COUNT);
+    for (int b = 0; b < BLOCKS_COUNT; ++b) {
+        data[b].resize(ITEMS_PER_BLOCK);
+        for (int i = 0; i < ITEMS_PER_BLOCK; ++i) {
+            const double t = double(b*ITEMS_PER_BLOCK + i) / SAMPLING_FREQ;
+            for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+                data[b][i].byChannel[ch] = DataType(100000 + signalCounts*qSin(2*M_PI*SIGNAL_FREQ*t + ch));
+            }
+        }
+    }
+    QVector<DataBlock> blocks(BLOCKS_COUNT);
+    for (int b = 0; b < BLOCKS_COUNT; ++b) {
+        blocks[b] = DataBlock(generateTimes(b), data[b]);
+    }
+    QElapsedTimer timer;
+    timer.start();
+    for (DataBlock & block: blocks) {
+        filter.filter(block);
+    }
+    const qint64 nsecs = timer.nsecsElapsed();
+    const double samples = double(BLOCKS_COUNT) * ITEMS_PER_BLOCK * CHANNELS_NUM;
+    Logger::info(tr("%1 sections: %2 samples in %3 ms, %4 million samples/s on one core")
+                 .arg(filter.sectionsCount()).arg(samples).arg(nsecs / 1e6, 0, 'f', 1)
+                 .arg(nsecs > 0 ? samples / (nsecs / 1e9) / 1e6 : 0, 0, 'f', 1));
+    // After the high-pass settles, the offset is gone and the sine is in nm/s
+    int peak = 0;
+    for (int b = BLOCKS_COUNT/2; b < BLOCKS_COUNT; ++b) {
+        for (const DataItem & item: blocks[b].data) {
+            for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+                peak = qMax(peak, qAbs(item.byChannel[ch]));
+            }
+        }
+    }
+    const bool passed = qAbs(peak - SIGNAL) < SIGNAL / 50;
+    if ( ! passed ) {
+        Logger::error(tr("Corrected signal has amplitude %1 %2 instead of %3").arg(peak).arg(filter.unitName()).arg(SIGNAL));
+    }
+    ok = ok && passed;
+
+    // The same in StageGraph, as in MainWindow
+    StageGraph graph;
+    ResponseStage * stage = graph.add(new ResponseStage("response", params));
+    CountingStage * counter = graph.add(new CountingStage, stage);
+    graph.setFrequencies(SAMPLING_FREQ, SAMPLING_FREQ);
+    timer.start();
+    for (int b = 0; b < BLOCKS_COUNT; ++b) {
+        graph.receiveData(generateTimes(b), data[b]);
+    }
+    graph.waitForDone();
+    Logger::info(tr("ResponseStage: %1 ms, %2% of one core")
+                 .arg(timer.nsecsElapsed() / 1e6, 0, 'f', 1).arg(stage->load()*100, 0, 'f', 3));
+    const bool complete = counter->items.load() == qint64(BLOCKS_COUNT) * ITEMS_PER_BLOCK;
+    if ( ! complete ) {
+        Logger::error(tr("ResponseStage passed %1 items instead of %2").arg(counter->items.load()).arg(BLOCKS_COUNT * ITEMS_PER_BLOCK));
+    }
+    return ok && complete;
+}
+
+bool Benchmark::picker() {
+    Logger::info(tr("Benchmark: AIC picker of events in one hour of data"));
+    // AIC by the definition, with two passes over each part
+    const int AIC_SIZE = 500;
+    QVector<double> signal(AIC_SIZE);
+    quint32 random = 1;
+    for (int i = 0; i < AIC_SIZE; ++i) {
+        random = random*1103515245 + 12345;
+        signal[i] = int((random >> 16) % 201) - 100 + (i >= 300 ? 500*qSin(0.7*i) : 0);
+    }
+    auto variance = [&](int from, int to) {
+        double mean = 0, squares = 0;
+        for (int i = from; i < to; ++i) {
+            mean += signal[i];
+        }
+        mean /= to - from;
+        for (int i = from; i < to; ++i) {
+            squares += (signal[i] - mean)*(signal[i] - mean);
+        }
+        return squares / (to - from);
+    };
+    int direct = -1;
+    double directAic = 0;
+    for (int k = 2; k <= AIC_SIZE - 2; ++k) {
+        const double aic = k*qLn(variance(0, k)) + (AIC_SIZE - k - 1)*qLn(variance(k, AIC_SIZE));
+        if (direct < 0 || aic < directAic) {
+            direct = k;
+            directAic = aic;
+        }
+    }
+    const int fast = AicPicker::aicMinimum(signal.constData(), AIC_SIZE);
+    bool ok = fast == direct;
+    if ( ! ok ) {
+        Logger::error(tr("AIC minimum is at %1 instead of %2").arg(fast).arg(direct));
+    }
+
+    // Noise, with events: P strongest on the vertical channel, S 3 s later on horizontal ones
+    const int NOISE = 1000;
+    const int EVENT_SECS = 30;
+    const double S_DELAY_SECS = 3;
+    const double TRIGGER_DELAY_SECS = 0.3; // Of trigger after P
+    const int EVENTS = BLOCKS_COUNT / EVENT_SECS - 1;
+    auto onset = [&](int event) { return generateTimes((event + 1) * EVENT_SECS).first() + 123.0; };
+    QVector<DataVector> data(BLOCKS_COUNT);
+    for (int b = 0; b < BLOCKS_COUNT; ++b) {
+        data[b].resize(ITEMS_PER_BLOCK);
+        const TimeStampsVector times = generateTimes(b);
+        for (int i = 0; i < ITEMS_PER_BLOCK; ++i) {
+            const int event = b / EVENT_SECS - 1;
+            const double p = event >= 0 ? (times[i] - onset(event)) / 1000 : -1;
+            const double s = p - S_DELAY_SECS;
+            for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+                random = random*1103515245 + 12345;
+                double value = 100000 + int((random >> 16) % (2*NOISE + 1)) - NOISE;
+                if (p >= 0) {
+                    value += (ch == 0 ? 10 : 3) * NOISE * qExp(-p/2) * qSin(2*M_PI*5*p + ch);
+                }
+                if (s >= 0) {
+                    value += (ch == 0 ? 5 : 20) * NOISE * qExp(-s/2) * qSin(2*M_PI*3*s + ch);
+                }
+                data[b][i].byChannel[ch] = DataType(value);
+            }
+        }
+    }
+
+    StageGraph graph;
+    PickerStage * stage = graph.add(new PickerStage("picker", AicPicker::Parameters()));
+    QMutex resultsMutex;
+    QVector<AicPicker::Result> results;
+    QObject::connect(stage, &PickerStage::picked, [&](AicPicker::Result result) {
+        QMutexLocker lock(&resultsMutex);
+        results << result;
+    });
+    // A burst: all triggers are known at once, so events are picked as fast as data come
+    for (int e = 0; e < EVENTS; ++e) {
+        stage->addEvent(onset(e) + TRIGGER_DELAY_SECS*1000);
+    }
+    graph.setFrequencies(SAMPLING_FREQ, SAMPLING_FREQ);
+    QElapsedTimer timer;
+    timer.start();
+    for (int b = 0; b < BLOCKS_COUNT; ++b) {
+        graph.receiveData(generateTimes(b), data[b]);
+    }
+    graph.waitForDone();
+    const qint64 streamNsecs = timer.nsecsElapsed();
+    stage->waitForDone();
+    const qint64 nsecs = timer.nsecsElapsed();
+    Logger::info(tr("%1 events of %2 s windows: stream in %3 ms (%4% of one core), all picked in %5 ms, %6 events per second")
+                 .arg(EVENTS).arg(stage->parameters().preSecs + stage->parameters().postSecs)
+                 .arg(streamNsecs / 1e6, 0, 'f', 1).arg(stage->load()*100, 0, 'f', 3)
+                 .arg(nsecs / 1e6, 0, 'f', 1).arg(EVENTS / (nsecs / 1e9), 0, 'f', 0));
+
+    int good = 0;
+    for (const AicPicker::Result & result: results) {
+        const int event = qRound((result.triggerTime - onset(0)) / (EVENT_SECS*1000.0));
+        bool p = false;
+        int s = 0;
+        for (const AicPicker::Pick & pick: result.picks) {
+            const double error = qAbs(pick.time - onset(event)) / 1000;
+            if (pick.phase == AicPicker::P) {
+                p = error < 0.05;
+            } else {
+                s += qAbs(error - S_DELAY_SECS) < 0.1;
+            }
+        }
+        good += (p && s == int(CHANNELS_NUM) - 1);
+    }
+    const bool picked = results.size() == EVENTS && good == EVENTS;
+    if ( ! picked ) {
+        Logger::error(tr("%1 of %2 events are picked correctly, %3 are picked at all")
+                      .arg(good).arg(EVENTS).arg(results.size()));
+    }
+    return ok && picked;
+}
+
+bool Benchmark::magnitude() {
+    Logger::info(tr("Benchmark: local magnitude of events in one hour of data"));
+    // Velocity in nm/s: noise, with a 5 Hz burst of 10 s every minute, 1 um/s to 128 um/s
+    const int NOISE = 10;
+    const int EVENT_SECS = 60;
+    const int BURST_SECS = 10;
+    const double SIGNAL_FREQ = 5;
+    const int EVENTS = BLOCKS_COUNT / EVENT_SECS - 1;
+    auto onset = [&](int event) { return generateTimes((event + 1) * EVENT_SECS).first() + 123.0; };
+    auto amplitude = [&](int event) { return 1000.0 * (1 << (event % 8)); };
+    quint32 random = 1;
+    QVector<DataVector> data(BLOCKS_COUNT);
+    for (int b = 0; b < BLOCKS_COUNT; ++b) {
+        data[b].resize(ITEMS_PER_BLOCK);
+        const TimeStampsVector times = generateTimes(b);
+        for (int i = 0; i < ITEMS_PER_BLOCK; ++i) {
+            const int event = b / EVENT_SECS - 1;
+            const double t = event >= 0 ? (times[i] - onset(event)) / 1000 : -1;
+            for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+                random = random*1103515245 + 12345;
+                double value = int((random >> 16) % (2*NOISE + 1)) - NOISE;
+                if (t >= 0 && t < BURST_SECS) {
+                    // Hann envelope; the vertical channel is stronger, but doesn't count
+                    const double envelope = 0.5 - 0.5*qCos(2*M_PI*t / BURST_SECS);
+                    value += (ch == 0 ? 10 : 1) * amplitude(event) * envelope * qSin(2*M_PI*SIGNAL_FREQ*t + ch);
+                }
+                data[b][i].byChannel[ch] = DataType(qRound(value));
+            }
+        }
+    }
+
+    StageGraph graph;
+    MagnitudeStage * stage = graph.add(new MagnitudeStage("magnitude", MagnitudeStage::Parameters()));
+    QMutex resultsMutex;
+    QVector<MagnitudeStage::Result> results;
+    QObject::connect(stage, &MagnitudeStage::magnitudeReady, [&](MagnitudeStage::Result result) {
+        QMutexLocker lock(&resultsMutex);
+        results << result;
+    });
+    // As the trigger would report them, a second before and after the burst
+    for (int e = 0; e < EVENTS; ++e) {
+        stage->startEvent(onset(e) - 1000);
+        stage->endEvent(onset(e) - 1000, onset(e) + (BURST_SECS + 1)*1000);
+    }
+    graph.setFrequencies(SAMPLING_FREQ, SAMPLING_FREQ);
+    QElapsedTimer timer;
+    timer.start();
+    for (int b = 0; b < BLOCKS_COUNT; ++b) {
+        graph.receiveData(generateTimes(b), data[b]);
+    }
+    graph.waitForDone();
+    Logger::info(tr("%1 events: %2 ms, %3% of one core")
+                 .arg(EVENTS).arg(timer.nsecsElapsed() / 1e6, 0, 'f', 1).arg(stage->load()*100, 0, 'f', 3));
+
+    // At the natural frequency: magnification over twice the damping, per rad/s of velocity
+    const double natural = 2*M_PI / MagnitudeStage::WOOD_ANDERSON_PERIOD;
+    const double nominal = MagnitudeStage::WOOD_ANDERSON_GAIN * 1000 / ResponseFilter::UNITS_PER_METRE
+                           / (2*MagnitudeStage::WOOD_ANDERSON_DAMPING) / natural;
+    bool ok = qAbs(stage->gain(1 / MagnitudeStage::WOOD_ANDERSON_PERIOD) / nominal - 1) < 0.001;
+    if ( ! ok ) {
+        Logger::error(tr("Wood-Anderson gain is %1 mm per nm/s instead of %2")
+                      .arg(stage->gain(1 / MagnitudeStage::WOOD_ANDERSON_PERIOD)).arg(nominal));
+    }
+
+    int good = 0;
+    for (const MagnitudeStage::Result & result: results) {
+        const int event = qRound((result.onTime + 1000 - onset(0)) / (EVENT_SECS*1000.0));
+        const double expected = MagnitudeStage::magnitude(amplitude(event) * stage->gain(SIGNAL_FREQ), stage->parameters());
+        good += result.valid && qAbs(result.magnitude - expected) < 0.05;
+    }
+    const bool estimated = results.size() == EVENTS && good == EVENTS;
+    if ( ! estimated ) {
+        Logger::error(tr("%1 of %2 magnitudes are correct, %3 are estimated at all")
+                      .arg(good).arg(EVENTS).arg(results.size()));
+    }
+    return ok && estimated;
+}
+
+bool Benchmark::polarization() {
+    Logger::info(tr("Benchmark: polarization of one hour of data"));
+    // Random symmetric matrices: residuals of eigenpairs relative to the largest eigenvalue
+    const int MATRICES = 1000000;
+    QVector<double> elements(MATRICES * 6);
+    quint32 random = 1;
+    for (double & element: elements) {
+        random = random*1103515245 + 12345;
+        element = int((random >> 16) % 20001) - 10000;
+    }
+    double worst = 0;
+    double checksum = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int k = 0; k < MATRICES; ++k) {
+        const double * e = elements.constData() + 6*k;
+        const double m[3][3] = {{e[0], e[1], e[2]}, {e[1], e[3], e[4]}, {e[2], e[4], e[5]}};
+        double values[3];
+        double vectors[3][3];
+        Polarization::eigen(m, values, vectors);
+        checksum += values[0];
+        if (k % 100 == 0) {
+            const double scale = qMax(qAbs(values[0]), qAbs(values[2]));
+            for (int v = 0; v < 3; ++v) {
+                for (int i = 0; i < 3; ++i) {
+                    const double residual = m[i][0]*vectors[v][0] + m[i][1]*vectors[v][1] + m[i][2]*vectors[v][2]
+                                            - values[v]*vectors[v][i];
+                    worst = qMax(worst, qAbs(residual) / scale);
+                }
+            }
+        }
+    }
+    const qint64 solveNsecs = timer.nsecsElapsed();
+    Q_UNUSED(checksum);
+    Logger::info(tr("Eigen-decomposition of 3x3: %1 ns, %2 million per second on one core")
+                 .arg(double(solveNsecs) / MATRICES, 0, 'f', 1)
+                 .arg(solveNsecs > 0 ? MATRICES / (solveNsecs / 1e9) / 1e6 : 0, 0, 'f', 1));
+    bool ok = worst < 1e-6;
+    if ( ! ok ) {
+        Logger::error(tr("Eigenpairs have relative residual %1").arg(worst));
+    }
+
+    // Noise, with a 5 Hz P wave every minute: up and away from the source
+    const int NOISE = 1000;
+    const int SIGNAL = 100000;
+    const int EVENT_SECS = 60;
+    const int WAVE_SECS = 3;
+    const int EVENTS = BLOCKS_COUNT / EVENT_SECS - 1;
+    auto onset = [&](int event) { return generateTimes((event + 1) * EVENT_SECS).first() + 123.0; };
+    auto backAzimuth = [&](int event) { return double((event * 37) % 360); };
+    auto incidence = [&](int event) { return 20.0 + 10*(event % 5); };
+    QVector<DataVector> data(BLOCKS_COUNT);
+    for (int b = 0; b < BLOCKS_COUNT; ++b) {
+        data[b].resize(ITEMS_PER_BLOCK);
+        const TimeStampsVector times = generateTimes(b);
+        for (int i = 0; i < ITEMS_PER_BLOCK; ++i) {
+            const int event = b / EVENT_SECS - 1;
+            const double t = event >= 0 ? (times[i] - onset(event)) / 1000 : -1;
+            double motion[CHANNELS_NUM] = {0};
+            if (t >= 0 && t < WAVE_SECS) {
+                const double s = SIGNAL * (0.5 - 0.5*qCos(2*M_PI*t / WAVE_SECS)) * qSin(2*M_PI*5*t);
+                const double azimuth = qDegreesToRadians(backAzimuth(event));
+                const double angle = qDegreesToRadians(incidence(event));
+                motion[0] = s*qCos(angle);
+                motion[1] = -s*qSin(angle)*qCos(azimuth);
+                motion[2] = -s*qSin(angle)*qSin(azimuth);
+            }
+            for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+                random = random*1103515245 + 12345;
+                data[b][i].byChannel[ch] = DataType(qRound(motion[ch])) + int((random >> 16) % (2*NOISE + 1)) - NOISE;
+            }
+        }
+    }
+
+    StageGraph graph;
+    PolarizationStage * stage = graph.add(new PolarizationStage("polarization", PolarizationStage::Parameters()));
+    QMutex resultsMutex;
+    QVector<PolarizationStage::Event> results;
+    QAtomicInteger<qint64> values(0);
+    QObject::connect(stage, &PolarizationStage::valuesReady, [&](QVector<Polarization::Values> series) {
+        values.fetchAndAddRelaxed(series.size());
+    });
+    QObject::connect(stage, &PolarizationStage::eventReady, [&](PolarizationStage::Event event) {
+        QMutexLocker lock(&resultsMutex);
+        results << event;
+    });
+    // As the trigger would report them
+    for (int e = 0; e < EVENTS; ++e) {
+        stage->startEvent(onset(e) - 1000);
+        stage->endEvent(onset(e) - 1000, onset(e) + (WAVE_SECS + 1)*1000);
+    }
+    graph.setFrequencies(SAMPLING_FREQ, SAMPLING_FREQ);
+    timer.start();
+    for (int b = 0; b < BLOCKS_COUNT; ++b) {
+        graph.receiveData(generateTimes(b), data[b]);
+    }
+    graph.waitForDone();
+    Logger::info(tr("%1 values of %2 s windows: %3 ms, %4% of one core")
+                 .arg(values.load()).arg(stage->parameters().windowSecs)
+                 .arg(timer.nsecsElapsed() / 1e6, 0, 'f', 1).arg(stage->load()*100, 0, 'f', 3));
+
+    int good = 0;
+    for (const PolarizationStage::Event & result: results) {
+        const int event = qRound((result.onTime + 1000 - onset(0)) / (EVENT_SECS*1000.0));
+        const int principal = result.principal();
+        if (principal < 0) {
+            continue;
+        }
+        const Polarization::Values & found = result.series[principal];
+        double azimuthError = qAbs(found.backAzimuth - backAzimuth(event));
+        azimuthError = qMin(azimuthError, 360 - azimuthError);
+        good += found.rectilinearity > 0.9 && azimuthError < 2 && qAbs(found.incidence - incidence(event)) < 2;
+    }
+    const bool found = results.size() == EVENTS && good == EVENTS;
+    if ( ! found ) {
+        Logger::error(tr("%1 of %2 events have correct polarization, %3 are reported at all")
+                      .arg(good).arg(EVENTS).arg(results.size()));
+    }
+    return ok && found;
+}
+
+bool Benchmark::templateMatching() {
+    Logger::info(tr("Benchmark: template matching of one hour of data"));
+    // Round trip of the real FFT
+    RealFft fft(4096);
+    QVector<double> signal(fft.size());
+    QVector<RealFft::Complex> spectrum(fft.bins());
+    QVector<double> restored(fft.size());
+    quint32 random = 1;
+    for (double & value: signal) {
+        random = random*1103515245 + 12345;
+        value = int((random >> 16) % 20001) - 10000;
+    }
+    fft.transform(signal.constData(), spectrum.data());
+    fft.inverse(spectrum.constData(), restored.data());
+    double worst = 0;
+    for (int i = 0; i < fft.size(); ++i) {
+        worst = qMax(worst, qAbs(restored[i] - signal[i]));
+    }
+    bool ok = worst < 1e-6;
+    if ( ! ok ) {
+        Logger::error(tr("Inverse FFT differs from the signal by %1").arg(worst));
+    }
+
+    // Templates of 4 s: 3-component noise decaying by half a second
+    const int TEMPLATES = 16;
+    const int TEMPLATE_SECS = 4;
+    const int NOISE = 1000;
+    QVector<TemplateMatcher::Template> templates(TEMPLATES);
+    for (int k = 0; k < TEMPLATES; ++k) {
+        TemplateMatcher::Template & t = templates[k];
+        t.name = QString("template%1").arg(k);
+        t.samplingFreq = SAMPLING_FREQ;
+        t.data.resize(TEMPLATE_SECS * SAMPLING_FREQ);
+        for (int j = 0; j < t.data.size(); ++j) {
+            const double decay = 2*NOISE * qExp(-j / (2.0*SAMPLING_FREQ));
+            for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+                random = random*1103515245 + 12345;
+                t.data[j].byChannel[ch] = DataType(qRound(decay * (int((random >> 16) % 2001) - 1000) / 1000));
+            }
+        }
+    }
+
+    // Noise, with a template at a quarter of its amplitude every minute, by turns
+    const int EVENT_SECS = 60;
+    const int ONSET_ITEM = 123;
+    const int EVENTS = BLOCKS_COUNT / EVENT_SECS - 1;
+    auto onset = [&](int event) { return generateTimes((event + 1) * EVENT_SECS)[ONSET_ITEM]; };
+    QVector<DataVector> data(BLOCKS_COUNT);
+    for (int b = 0; b < BLOCKS_COUNT; ++b) {
+        data[b].resize(ITEMS_PER_BLOCK);
+        for (int i = 0; i < ITEMS_PER_BLOCK; ++i) {
+            for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+                random = random*1103515245 + 12345;
+                data[b][i].byChannel[ch] = int((random >> 16) % (2*NOISE + 1)) - NOISE;
+            }
+        }
+    }
+    for (int e = 0; e < EVENTS; ++e) {
+        const DataVector & t = templates[e % TEMPLATES].data;
+        for (int j = 0; j < t.size(); ++j) {
+            const int item = (e + 1) * EVENT_SECS * ITEMS_PER_BLOCK + ONSET_ITEM + j;
+            for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+                data[item / ITEMS_PER_BLOCK][item % ITEMS_PER_BLOCK].byChannel[ch] += t[j].byChannel[ch] / 4;
+            }
+        }
+    }
+
+    // On one core for templates per core, then on all of them
+    const int cores = QThread::idealThreadCount();
+    for (int threads: {1, cores}) {
+        StageGraph graph;
+        TemplateStage * stage = graph.add(new TemplateStage("templates", templates, TemplateMatcher::Parameters()));
+        stage->setThreadCount(threads);
+        QMutex resultsMutex;
+        QVector<TemplateMatcher::Detection> results;
+        QObject::connect(stage, &TemplateStage::detected, [&](TemplateMatcher::Detection detection) {
+            QMutexLocker lock(&resultsMutex);
+            results << detection;
+        });
+        graph.setFrequencies(SAMPLING_FREQ, SAMPLING_FREQ);
+        QElapsedTimer timer;
+        timer.start();
+        for (int b = 0; b < BLOCKS_COUNT; ++b) {
+            graph.receiveData(generateTimes(b), data[b]);
+        }
+        graph.waitForDone();
+        const double load = stage->load();
+        Logger::info(tr("%1 templates of %2 s on %3 threads, FFT of %4: %5 ms, %6% of real time, %7 templates per core")
+                     .arg(TEMPLATES).arg(TEMPLATE_SECS).arg(stage->matcher().groupsCount()).arg(stage->matcher().fftSize())
+                     .arg(timer.nsecsElapsed() / 1e6, 0, 'f', 1).arg(load*100, 0, 'f', 2)
+                     .arg(load > 0 ? TEMPLATES / load / stage->matcher().groupsCount() : 0, 0, 'f', 0));
+
+        int good = 0;
+        for (const TemplateMatcher::Detection & result: results) {
+            const int event = qRound((result.time - onset(0)) / (EVENT_SECS*1000.0));
+            good += event >= 0 && event < EVENTS && result.time == onset(event) && result.templateIndex == event % TEMPLATES;
+        }
+        if (results.size() != EVENTS || good != EVENTS) {
+            Logger::error(tr("%1 of %2 templates are detected at their times, %3 detections at all")
+                          .arg(good).arg(EVENTS).arg(results.size()));
+            ok = false;
+        }
+    }
+    return ok;
+}
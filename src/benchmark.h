@@ -0,0 +1,168 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QObject>
+
+/**
+ * @brief Performance benchmarks of data processing code
+ *
+ * Just a set of static functions that measure throughput of
+ * different parts of the program on generated data and report
+ * results to Logger. Run the program with --benchmark argument to invoke them.
+ */
+class Benchmark : public QObject
+{
+    Q_OBJECT
+public:
+    static const QString ARGUMENT;
+
+    /**
+     * @brief Runs all benchmarks
+     * @return true if all benchmarks passed their self-checks
+     */
+    static bool runAll();
+
+    /**
+     * @brief Compares text formatting of FileWriter with the former
+     *        QByteArray::setNum + QString + QTextStream approach
+     * @return true if both produce identical output
+     */
+    static bool textFormatting();
+
+    /**
+     * @brief Measures MiniSEED encoding throughput and size compared to text
+     * @return true if all records decode back into the original samples
+     */
+    static bool miniSeedEncoding();
+
+    /**
+     * @brief Compares throughput of output format backends, separately and all together
+     * @return true (no self-checks)
+     */
+    static bool outputFormats();
+
+    /**
+     * @brief Measures gzip compression of text output at several levels,
+     *        the way AsyncFileSink compresses it (1 MiB buffers with block flush)
+     * @return true if compressed data decompress back into the original
+     */
+    static bool compression();
+
+    /**
+     * @brief Measures cost of journaling one hour of data with different group commit
+     *        policies, from a sync per block to a single sync at the end
+     * @return true if all blocks are read back from journals
+     */
+    static bool journal();
+
+    /**
+     * @brief Compares extraction of a one-minute window from one hour of text
+     *        with and without file index
+     * @return true if both extract the same data
+     */
+    static bool extraction();
+
+    /**
+     * @brief Measures appending of one hour of data to Archive, its size on disk,
+     *        and queries of one minute of one channel and of the whole hour at 1 Hz
+     * @return true if queried data are the same as appended
+     */
+    static bool archive();
+
+    /**
+     * @brief Measures appending of one hour of data to HistoryRing that holds half of it,
+     *        and reading of the last minute after the ring is opened again
+     * @return true if read data are the same as appended
+     */
+    static bool historyRing();
+
+    /**
+     * @brief Measures StageGraph with several independent branches of filters
+     *        on one thread and on all cores
+     * @return true if all branches output all data in both cases
+     */
+    static bool stageGraph();
+
+    /**
+     * @brief Measures STA/LTA trigger on one hour of noise with a burst in the middle
+     * @return true if the burst, and nothing else, is detected
+     */
+    static bool staLtaTrigger();
+
+    /**
+     * @brief Checks RealFft against direct DFT and measures SpectrumStage on all channels
+     *        for one hour of sines of different frequencies, with CPU usage
+     * @return true if transforms match and spectra peak at the frequencies of sines
+     */
+    static bool spectrum();
+
+    /**
+     * @brief Measures PpsdStage on one hour of white noise with 10-minute segments,
+     *        and saving and loading of its histogram
+     * @return true if all segments are added at the level of the noise, and the histogram is loaded back
+     */
+    static bool ppsd();
+
+    /**
+     * @brief Measures ButterworthFilter (band-pass of order 4) on one hour of data
+     *        in samples per second on one core, and FilterStage in StageGraph
+     * @return true if the gain of the filter is as designed, and the in-band sine passes
+     *         while the offset and out-of-band sines are removed
+     */
+    static bool filterBank();
+
+    /**
+     * @brief Compares SlidingStats over a 10-second window with the former per-block
+     *        min/max/avg of StatsBox (a pass over the block for each channel)
+     * @return true if statistics match the ones computed directly over the window
+     */
+    static bool slidingStats();
+
+    /**
+     * @brief Measures QualityStage on one hour of data with injected clipping,
+     *        a flatline, spikes, a gap and an overlap
+     * @return true if exactly the injected problems are counted
+     */
+    static bool quality();
+
+    /**
+     * @brief Measures ResponseFilter (1 Hz geophone to velocity) on one hour of data
+     *        in samples per second on one core, and ResponseStage in StageGraph
+     * @return true if the corrected response is flat above the high-pass, and a sine
+     *         recorded by the geophone comes out with its true amplitude
+     */
+    static bool responseCorrection();
+
+    /**
+     * @brief Measures AicPicker and PickerStage on one hour of noise with an event
+     *        every half a minute, all of them triggered at once
+     * @return true if AIC of prefix sums matches the direct one, and P and S onsets
+     *         of all events are picked within 0.05 and 0.1 s
+     */
+    static bool picker();
+
+    /**
+     * @brief Measures MagnitudeStage on one hour of velocity with an event every minute
+     * @return true if the Wood-Anderson simulation has its nominal gain at its natural
+     *         frequency, and ML of each event matches the one of its known amplitude
+     */
+    static bool magnitude();
+
+    /**
+     * @brief Measures the closed-form eigen-solver of Polarization in solves per second,
+     *        and PolarizationStage on one hour of data with a P wave every minute
+     * @return true if eigenpairs of random matrices are accurate, and back-azimuth and
+     *         incidence of each P wave are found within 2 degrees
+     */
+    static bool polarization();
+
+    /**
+     * @brief Measures TemplateStage on one hour of noise with a template planted every
+     *        minute, in templates per core in real time, and its speedup on all cores
+     * @return true if the inverse FFT restores the signal, and each planted template
+     *         is detected at its exact item with no false detections
+     */
+    static bool templateMatching();
+};
+
+#endif // BENCHMARK_H
@@ -0,0 +1,366 @@
+#include "converter.h"
+#include "logger.h"
+#include "readers/datareader.h"
+#include "archive/archive.h"
+#include "writers/fileindex.h"
+#include "writers/gzipcompressor.h"
+#include "writers/journal.h"
+#include "dsp/butterworthfilter.h"
+
+#include <QCommandLineParser>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QScopedPointer>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <algorithm>
+
+namespace {
+    const int WRITE_BUFFER_SIZE = 1 << 20;
+    const int ANTI_ALIAS_ORDER = 8;
+    const double ANTI_ALIAS_CUTOFF = 0.4; // Of the new sampling frequency: a bit below its Nyquist frequency
+
+    /*!
+     * Low-pass filters items (Butterworth) so that they don't alias, then keeps every N-th
+     * of them, continuing across blocks.
+     */
+    class Decimator {
+    public:
+        Decimator(int factor, int samplingFreq) : factor(factor), next(0), filter(lowPass(factor, samplingFreq)) {
+            filter.design(samplingFreq);
+        }
+
+        /// \a in is filtered in place
+        void process(DataBlock & in, DataBlock & out) {
+            filter.filter(in);
+            out.timestamps.resize(0);
+            out.data.resize(0);
+            out.timestamps.reserve(in.size() / factor + 1);
+            out.data.reserve(in.size() / factor + 1);
+            int i = next;
+            for (; i < in.size(); i += factor) {
+                out.timestamps << in.timestamps[i];
+                out.data << in.data[i];
+            }
+            next = i - in.size();
+        }
+
+    private:
+        static ButterworthFilter::Parameters lowPass(int factor, int samplingFreq) {
+            ButterworthFilter::Parameters params;
+            params.type = ButterworthFilter::LowPass;
+            params.order = ANTI_ALIAS_ORDER;
+            params.highFreq = ANTI_ALIAS_CUTOFF * samplingFreq / factor;
+            return params;
+        }
+
+        int factor;
+        int next; // Index of the next item to keep in the next block
+        ButterworthFilter filter;
+    };
+
+    /// Output file with optional compression and buffering of small appends
+    class Output {
+    public:
+        Output(const QString & fileName, int compressionLevel) :
+            file(fileName),
+            compressor(compressionLevel >= 0 ? new GzipCompressor(compressionLevel) : NULL),
+            bytes(0)
+        {}
+
+        bool open() { return file.open(QIODevice::WriteOnly); }
+        QString errorString() const { return file.errorString(); }
+        qint64 size() const { return bytes; }
+
+        void write(const QByteArray & data) {
+            buffer += data;
+            if (buffer.size() >= WRITE_BUFFER_SIZE) {
+                writeBuffer();
+            }
+        }
+
+        bool commit() {
+            writeBuffer();
+            if ( ! compressor.isNull() ) {
+                QByteArray trailer;
+                compressor->finish(trailer);
+                writeBytes(trailer);
+            }
+            return file.commit();
+        }
+
+        void cancel() { file.cancelWriting(); }
+
+    private:
+        void writeBuffer() {
+            if (compressor.isNull()) {
+                writeBytes(buffer);
+            } else {
+                // Not flushed at each portion: the file is written at once, not recorded
+                QByteArray compressed;
+                compressor->compress(buffer.constData(), buffer.size(), compressed, false);
+                writeBytes(compressed);
+            }
+            buffer.resize(0);
+        }
+
+        void writeBytes(const QByteArray & data) {
+            file.write(data);
+            bytes += data.size();
+        }
+
+        QSaveFile file; // Appears under its name only when finished
+        QScopedPointer<GzipCompressor> compressor;
+        QByteArray buffer;
+        qint64 bytes;
+    };
+
+    // For QtConcurrent::blockingMapped, which needs result_type
+    struct ConvertFunctor {
+        typedef Converter::Result result_type;
+        const Converter::Options & options;
+        explicit ConvertFunctor(const Converter::Options & options) : options(options) {}
+        Converter::Result operator()(const QString & inputFile) const { return Converter::convertFile(inputFile, options); }
+    };
+
+    TimeStampType parseTime(const QString & text, bool * ok) {
+        const QDateTime time = QDateTime::fromString(text, Qt::ISODate);
+        *ok = time.isValid();
+        return *ok ? time.toMSecsSinceEpoch() : 0;
+    }
+}
+
+Converter::Options::Options() :
+    format(OutputFormat::Binary), from(-1), to(-1), decimation(1), compressionLevel(-1), threads(0)
+{}
+
+QString Converter::outputFileName(const QString & inputFile, OutputFormat::Type inputType, const Options & options) {
+    const QFileInfo input(QDir::cleanPath(inputFile)); // Without trailing slash of directory of archive
+    QString base = input.fileName();
+    if (base.endsWith(GzipCompressor::FILE_SUFFIX)) {
+        base.chop(GzipCompressor::FILE_SUFFIX.size());
+    }
+    const QScopedPointer<OutputFormat> inputFormat(OutputFormat::create(inputType));
+    const QString inputSuffix = inputFormat->fileSuffix();
+    if ( ! inputSuffix.isEmpty() && base.endsWith(inputSuffix) ) {
+        base.chop(inputSuffix.size());
+    }
+    const QScopedPointer<OutputFormat> format(OutputFormat::create(options.format, options.formatOptions));
+    QString fileName = base + format->fileSuffix();
+    if (options.compressionLevel >= 0) {
+        fileName += GzipCompressor::FILE_SUFFIX;
+    }
+    const QDir dir = options.outputDir.isEmpty() ? input.dir() : QDir(options.outputDir);
+    return dir.filePath(fileName);
+}
+
+Converter::Result Converter::convertFile(const QString & inputFile, const Options & options) {
+    Result result;
+    result.inputFile = inputFile;
+    result.inputBytes = QFileInfo(inputFile).size();
+    QScopedPointer<DataReader> reader(DataReader::open(inputFile));
+    if (reader.isNull()) {
+        return result;
+    }
+    if (QFileInfo(inputFile).isDir()) {
+        result.inputBytes = reader->dataSize(); // Chunks of archive
+    }
+    OutputFormat::FileInfo info = reader->info();
+    const int decimation = qMax(1, options.decimation);
+    if (info.samplingFreq % decimation != 0) {
+        Logger::error(tr("Sample rate %1 Hz of %2 is not divisible by %3").arg(info.samplingFreq).arg(inputFile).arg(decimation));
+        return result;
+    }
+    Decimator decimator(decimation, info.samplingFreq);
+    info.samplingFreq /= decimation;
+
+    result.outputFile = outputFileName(inputFile, reader->type(), options);
+    if (QFileInfo(result.outputFile) == QFileInfo(inputFile)) {
+        Logger::error(tr("Output file for %1 is the same, choose another output directory").arg(inputFile));
+        return result;
+    }
+
+    if (options.from >= 0) {
+        FileIndex index;
+        const bool indexed = ! reader->isCompressed() && index.load(FileIndex::fileNameFor(inputFile));
+        if ( ! reader->seekTime(options.from, indexed ? &index : NULL) ) {
+            result.ok = true; // Nothing in the window
+            result.outputFile.clear();
+            return result;
+        }
+    }
+
+    Output out(result.outputFile, options.compressionLevel);
+    if ( ! out.open() ) {
+        Logger::error(tr("Failed to create file %1: %2").arg(result.outputFile, out.errorString()));
+        return result;
+    }
+    QScopedPointer<OutputFormat> format(OutputFormat::create(options.format, options.formatOptions));
+    DataBlock block, decimated;
+    bool windowEnded = false;
+    while ( ! windowEnded && reader->readBlock(block) ) {
+        if (options.to >= 0) {
+            const TimeStampType * begin = block.timestamps.constData();
+            const int count = int(std::lower_bound(begin, begin + block.size(), options.to) - begin);
+            if (count < block.size()) {
+                block = block.mid(0, count);
+                windowEnded = true;
+            }
+        }
+        if (decimation > 1) {
+            decimator.process(block, decimated);
+            block = decimated;
+        }
+        if (block.size() == 0) {
+            continue;
+        }
+        if (result.items == 0) {
+            info.startTime = QDateTime::fromMSecsSinceEpoch(qint64(block.timestamps.first()));
+            format->open(info);
+            out.write(format->header(info));
+        }
+        out.write(format->appendBlock(block));
+        result.items += block.size();
+    }
+    if (result.items == 0) {
+        out.cancel();
+        result.ok = true;
+        result.outputFile.clear();
+        return result;
+    }
+    out.write(format->flush());
+    format->close();
+    if ( ! out.commit() ) {
+        Logger::error(tr("Failed to write file %1: %2").arg(result.outputFile, out.errorString()));
+        return result;
+    }
+    result.outputBytes = out.size();
+    result.ok = true;
+    return result;
+}
+
+QList<Converter::Result> Converter::convertFiles(const QStringList & inputFiles, const Options & options) {
+    if (options.threads > 0) {
+        QThreadPool::globalInstance()->setMaxThreadCount(options.threads);
+    }
+    Logger::instance(); // Created before threads use it
+    QElapsedTimer timer;
+    timer.start();
+    // One file per thread: files are independent, and each one is read sequentially
+    const QList<Result> results = QtConcurrent::blockingMapped<QList<Result> >(inputFiles, ConvertFunctor(options));
+    const qint64 elapsed = qMax(Q_INT64_C(1), timer.elapsed());
+
+    qint64 inputBytes = 0, outputBytes = 0, items = 0;
+    int failed = 0;
+    for (const Result & result: results) {
+        inputBytes += result.inputBytes;
+        outputBytes += result.outputBytes;
+        items += result.items;
+        if ( ! result.ok ) {
+            ++failed;
+        }
+    }
+    const double minutes = elapsed / 60000.0;
+    Logger::info(tr("Converted %1 files (%2 failed) in %3 s on %4 threads: %5 GB/min read, %6 GB/min written, %7 items/s")
+                 .arg(results.size()).arg(failed).arg(elapsed / 1000.0, 0, 'f', 1)
+                 .arg(QThreadPool::globalInstance()->maxThreadCount())
+                 .arg(inputBytes / 1e9 / minutes, 0, 'f', 2)
+                 .arg(outputBytes / 1e9 / minutes, 0, 'f', 2)
+                 .arg(items * 1000.0 / elapsed, 0, 'f', 0));
+    return results;
+}
+
+QStringList Converter::findInputFiles(const QStringList & paths) {
+    QStringList files;
+    for (const QString & path: paths) {
+        if ( ! QFileInfo(path).isDir() || Archive::exists(path) ) {
+            files << path; // Archive is converted as one file
+            continue;
+        }
+        QDirIterator it(path, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            const QString file = it.next();
+            const QFileInfo info(file);
+            if (info.fileName() == Archive::CATALOG_FILE) {
+                files << info.path();
+            } else if (info.fileName() != Archive::OPEN_FILE && ! file.endsWith(Archive::CHUNK_SUFFIX)
+                    && ! file.endsWith(FileIndex::FILE_SUFFIX) && ! file.endsWith(Journal::FILE_SUFFIX)) {
+                files << file;
+            }
+        }
+    }
+    files.sort();
+    return files;
+}
+
+int Converter::run(QStringList arguments) {
+    QCommandLineParser parser;
+    parser.setApplicationDescription(tr("Converts recorded data files into another format, in parallel"));
+    parser.addHelpOption();
+    parser.addPositionalArgument("inputs", tr("Data files, archives of stations or directories with them"), "<inputs...>");
+    const QCommandLineOption formatOption(QStringList() << "f" << "format", tr("Output format: text, mseed or bin (default)"), "format", "bin");
+    const QCommandLineOption outputDirOption(QStringList() << "o" << "output-dir", tr("Directory for output files (default: next to input files)"), "dir");
+    const QCommandLineOption fromOption("from", tr("Start of time window (2017-07-14T14:32:05.250)"), "time");
+    const QCommandLineOption toOption("to", tr("End of time window"), "time");
+    const QCommandLineOption decimateOption(QStringList() << "d" << "decimate", tr("Low-pass filter and keep every N-th sample"), "N", "1");
+    const QCommandLineOption gzipOption(QStringList() << "z" << "gzip", tr("Compress output files"));
+    const QCommandLineOption levelOption("level", tr("Compression level, 1-9"), "level", QString::number(int(GzipCompressor::DEFAULT_LEVEL)));
+    const QCommandLineOption jobsOption(QStringList() << "j" << "jobs", tr("Number of threads (default: number of cores)"), "N", "0");
+    const QCommandLineOption networkOption("mseed-network", tr("Network code of MiniSEED records"), "code");
+    const QCommandLineOption recordOption("mseed-record", tr("Length of MiniSEED records, bytes"), "length");
+    parser.addOptions(QList<QCommandLineOption>() << formatOption << outputDirOption << fromOption << toOption
+                      << decimateOption << gzipOption << levelOption << jobsOption << networkOption << recordOption);
+    parser.process(arguments);
+
+    Options options;
+    options.format = OutputFormat::typeFromName(parser.value(formatOption));
+    if (options.format == 0) {
+        Logger::error(tr("Unknown format: %1").arg(parser.value(formatOption)));
+        return 1;
+    }
+    options.outputDir = parser.value(outputDirOption);
+    bool ok = true;
+    if (parser.isSet(fromOption)) {
+        options.from = parseTime(parser.value(fromOption), &ok);
+    }
+    if (ok && parser.isSet(toOption)) {
+        options.to = parseTime(parser.value(toOption), &ok);
+    }
+    if ( ! ok ) {
+        Logger::error(tr("Invalid time, expected full date and time like 2017-07-14T14:32:05.250"));
+        return 1;
+    }
+    options.decimation = parser.value(decimateOption).toInt(&ok);
+    if ( ! ok || options.decimation < 1 ) {
+        Logger::error(tr("Invalid decimation factor: %1").arg(parser.value(decimateOption)));
+        return 1;
+    }
+    if (parser.isSet(gzipOption)) {
+        options.compressionLevel = qBound(1, parser.value(levelOption).toInt(), 9);
+    }
+    options.threads = qMax(0, parser.value(jobsOption).toInt());
+    if (parser.isSet(networkOption)) {
+        options.formatOptions.miniSeedNetwork = parser.value(networkOption);
+    }
+    if (parser.isSet(recordOption)) {
+        options.formatOptions.miniSeedRecordLength = parser.value(recordOption).toInt();
+    }
+    if ( ! options.outputDir.isEmpty() && ! QDir().mkpath(options.outputDir) ) {
+        Logger::error(tr("Failed to create directory %1").arg(options.outputDir));
+        return 1;
+    }
+
+    const QStringList files = findInputFiles(parser.positionalArguments());
+    if (files.isEmpty()) {
+        parser.showHelp(1);
+    }
+    for (const Result & result: convertFiles(files, options)) {
+        if ( ! result.ok ) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,77 @@
+#ifndef CONVERTER_H
+#define CONVERTER_H
+
+#include "protocol.h"
+#include "writers/outputformat.h"
+#include <QObject>
+#include <QStringList>
+
+/**
+ * @brief Converts recorded data files into another format, in parallel
+ *
+ * Each input file is mapped into memory and parsed by DataReader, optionally
+ * clipped to a time window (using the index of the file, if there is one) and
+ * decimated, then encoded by OutputFormat: the same code that writes files
+ * while recording. Files are converted on all cores, one file per thread.
+ *
+ * Built as a separate command line program (tools/seismoconvert):
+ *
+ *     seismoconvert -f bin -o converted/ --decimate 4 data/
+ *
+ * Inputs are files, archives of stations (\see ArchiveReader), e.g. to export a time
+ * window of the archive:
+ *
+ *     seismoconvert -f mseed --from 2017-07-14T14:00:00 --to 2017-07-14T15:00:00 archive/00
+ *
+ * or directories (with data files and archives in them, recursively).
+ */
+class Converter : public QObject
+{
+    Q_OBJECT
+public:
+    struct Options {
+        OutputFormat::Type format;
+        OutputFormat::Options formatOptions;
+        QString outputDir;        // Empty: next to input files
+        TimeStampType from, to;   // Window of time, negative: not clipped
+        int decimation;           // Every N-th sample is kept, after anti-alias low-pass filter
+        int compressionLevel;     // Of gzip, negative: not compressed
+        int threads;              // 0: as many as cores
+        Options();
+    };
+
+    struct Result {
+        QString inputFile;
+        QString outputFile;
+        qint64 inputBytes;
+        qint64 outputBytes;
+        qint64 items;             // Written, after decimation
+        bool ok;
+        Result() : inputBytes(0), outputBytes(0), items(0), ok(false) {}
+    };
+
+    /**
+     * @brief Runs the converter with command line arguments of the program
+     * @return exit code
+     */
+    static int run(QStringList arguments);
+
+    /**
+     * @brief Converts one file (failure is reported to Logger)
+     */
+    static Result convertFile(const QString & inputFile, const Options & options);
+
+    /**
+     * @brief Converts files in parallel, then reports total throughput to Logger
+     * @return results in the order of files
+     */
+    static QList<Result> convertFiles(const QStringList & inputFiles, const Options & options);
+
+    /// Name of output file for \a inputFile of given \a type
+    static QString outputFileName(const QString & inputFile, OutputFormat::Type inputType, const Options & options);
+
+    /// Data files in \a paths (files, or directories searched recursively)
+    static QStringList findInputFiles(const QStringList & paths);
+};
+
+#endif // CONVERTER_H
@@ -0,0 +1,56 @@
+# Data formats: writing and reading of data files, shared by the recorder and tools
+
+INCLUDEPATH += $$PWD
+
+# zlib for compression of output files: the one bundled with Qt on Windows, system library elsewhere
+win32: INCLUDEPATH += $$[QT_INSTALL_HEADERS]/QtZlib
+else: LIBS += -lz
+
+SOURCES += \
+    $$PWD/writers/textencoder.cpp \
+    $$PWD/writers/steim2.cpp \
+    $$PWD/writers/miniseedencoder.cpp \
+    $$PWD/writers/outputformat.cpp \
+    $$PWD/writers/textformat.cpp \
+    $$PWD/writers/miniseedformat.cpp \
+    $$PWD/writers/binaryformat.cpp \
+    $$PWD/writers/gzipcompressor.cpp \
+    $$PWD/writers/fileindex.cpp \
+    $$PWD/writers/asyncfilesink.cpp \
+    $$PWD/writers/journal.cpp \
+    $$PWD/performancereporter.cpp \
+    $$PWD/readers/datareader.cpp \
+    $$PWD/readers/textreader.cpp \
+    $$PWD/readers/binaryreader.cpp \
+    $$PWD/readers/archivereader.cpp \
+    $$PWD/archive/chunkcodec.cpp \
+    $$PWD/archive/archive.cpp \
+    $$PWD/archive/historyring.cpp \
+    $$PWD/dsp/slidingstats.cpp \
+    $$PWD/dsp/biquadcascade.cpp \
+    $$PWD/dsp/butterworthfilter.cpp
+
+HEADERS += \
+    $$PWD/protocol.h \
+    $$PWD/writers/textencoder.h \
+    $$PWD/writers/steim2.h \
+    $$PWD/writers/miniseedencoder.h \
+    $$PWD/writers/outputformat.h \
+    $$PWD/writers/textformat.h \
+    $$PWD/writers/miniseedformat.h \
+    $$PWD/writers/binaryformat.h \
+    $$PWD/writers/gzipcompressor.h \
+    $$PWD/writers/fileindex.h \
+    $$PWD/writers/asyncfilesink.h \
+    $$PWD/writers/journal.h \
+    $$PWD/performancereporter.h \
+    $$PWD/readers/datareader.h \
+    $$PWD/readers/textreader.h \
+    $$PWD/readers/binaryreader.h \
+    $$PWD/readers/archivereader.h \
+    $$PWD/archive/chunkcodec.h \
+    $$PWD/archive/archive.h \
+    $$PWD/archive/historyring.h \
+    $$PWD/dsp/slidingstats.h \
+    $$PWD/dsp/biquadcascade.h \
+    $$PWD/dsp/butterworthfilter.h
@@ -0,0 +1,154 @@
+#include "aicpicker.h"
+
+#include <QDateTime>
+#include <QStringList>
+#include <qmath.h>
+#include <algorithm>
+#include <numeric>
+
+namespace {
+    const double MIN_VARIANCE = 1e-12; // Of a constant part, instead of log(0)
+
+    QString timeToString(TimeStampType time) {
+        return QDateTime::fromMSecsSinceEpoch(qint64(time)).toString("hh:mm:ss.zzz");
+    }
+}
+
+AicPicker::Parameters::Parameters() :
+    preSecs(10), postSecs(10), sPicks(true), sDelaySecs(0.5), snrSecs(1), minSnr(2)
+{
+}
+
+QString AicPicker::Result::describe() const {
+    if (picks.isEmpty()) {
+        return tr("no clear onset");
+    }
+    QStringList res;
+    for (const Pick & pick: picks) {
+        res << tr("%1 on %2 at %3 (SNR %4)").arg(pick.phase == P ? "P" : "S")
+               .arg(CHANNEL_COMPONENTS[pick.channel]).arg(timeToString(pick.time)).arg(pick.snr, 0, 'f', 1);
+    }
+    return res.join(", ");
+}
+
+AicPicker::AicPicker(const Parameters & parameters) :
+    params(parameters)
+{
+}
+
+int AicPicker::aicMinimum(const double * x, int n) {
+    if (n < 4) {
+        return -1;
+    }
+    // Sums of deviations from mean, not of raw values: offset of data would cost precision
+    double mean = 0;
+    for (int i = 0; i < n; ++i) {
+        mean += x[i];
+    }
+    mean /= n;
+    double total = 0, totalSquares = 0;
+    for (int i = 0; i < n; ++i) {
+        const double d = x[i] - mean;
+        total += d;
+        totalSquares += d*d;
+    }
+    int best = -1;
+    double bestAic = 0;
+    double sum = 0, squares = 0; // Of x[0..k)
+    for (int k = 1; k <= n - 2; ++k) {
+        const double d = x[k - 1] - mean;
+        sum += d;
+        squares += d*d;
+        if (k < 2) {
+            continue;
+        }
+        const double before = qMax(MIN_VARIANCE, squares/k - (sum/k)*(sum/k));
+        const int rest = n - k;
+        const double restSum = total - sum;
+        const double after = qMax(MIN_VARIANCE, (totalSquares - squares)/rest - (restSum/rest)*(restSum/rest));
+        const double aic = k*qLn(before) + (rest - 1)*qLn(after);
+        if (best < 0 || aic < bestAic) {
+            best = k;
+            bestAic = aic;
+        }
+    }
+    return best;
+}
+
+double AicPicker::rms(const double * x, int n, int from, int to) {
+    from = qBound(0, from, n);
+    to = qBound(from, to, n);
+    const int count = to - from;
+    if (count == 0) {
+        return 0;
+    }
+    double sum = 0, squares = 0;
+    for (int i = from; i < to; ++i) {
+        sum += x[i];
+        squares += x[i]*x[i];
+    }
+    const double mean = sum / count;
+    return qSqrt(qMax(0.0, squares/count - mean*mean));
+}
+
+int AicPicker::addPick(Result & result, Phase phase, unsigned channel, const QVector<double> & x,
+                       int from, int to, int snrItems, const DataBlock & window) const {
+    const int k = aicMinimum(x.constData() + from, to - from);
+    if (k < 0) {
+        return -1;
+    }
+    const int onset = from + k;
+    const double before = qMax(1.0, rms(x.constData(), x.size(), onset - snrItems, onset));
+    const double after = rms(x.constData(), x.size(), onset, onset + snrItems);
+    const double snr = after / before;
+    if (snr < params.minSnr) {
+        return -1;
+    }
+    Pick pick;
+    pick.phase = phase;
+    pick.channel = channel;
+    pick.time = window.timestamps[onset];
+    pick.snr = snr;
+    result.picks << pick;
+    return onset;
+}
+
+AicPicker::Result AicPicker::pick(const DataBlock & window, TimeStampType triggerTime, int samplingFreq) const {
+    Result result;
+    result.triggerTime = triggerTime;
+    const int n = window.size();
+    if (n < 4 || samplingFreq <= 0) {
+        return result;
+    }
+    QVector<double> x[CHANNELS_NUM];
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        x[ch].resize(n);
+        for (int i = 0; i < n; ++i) {
+            x[ch][i] = window.data[i].byChannel[ch];
+        }
+    }
+    const TimeStampType * times = window.timestamps.constData();
+    const int trigger = int(std::lower_bound(times, times + n, triggerTime) - times);
+    const int preItems = qRound(params.preSecs * samplingFreq);
+    const int snrItems = qMax(2, qRound(params.snrSecs * samplingFreq));
+
+    const int p = addPick(result, P, 0, x[0], qMax(0, trigger - preItems), qMin(n, trigger + preItems), snrItems, window);
+    if (p < 0 || ! params.sPicks) {
+        return result;
+    }
+    const int sFrom = p + qRound(params.sDelaySecs * samplingFreq);
+    const int sEnd = qMin(n, trigger + qRound(params.postSecs * samplingFreq));
+    for (unsigned ch = 1; ch < CHANNELS_NUM; ++ch) {
+        // S is the strongest arrival: up to its peak, the window has only P coda and S onset
+        // (over the decaying coda of S, AIC would find a split in the coda instead)
+        const double offset = std::accumulate(x[ch].constBegin(), x[ch].constBegin() + p, 0.0) / p;
+        int peak = sFrom;
+        for (int i = sFrom; i < sEnd; ++i) {
+            if (qAbs(x[ch][i] - offset) > qAbs(x[ch][peak] - offset)) {
+                peak = i;
+            }
+        }
+        addPick(result, S, ch, x[ch], sFrom, qMin(sEnd, peak + snrItems), snrItems, window);
+    }
+    return result;
+}
@@ -0,0 +1,88 @@
+#ifndef AICPICKER_H
+#define AICPICKER_H
+
+#include "../protocol.h"
+
+#include <QVector>
+#include <QCoreApplication>
+
+/*!
+ * \brief Picks onsets of P and S waves in a window of data around a trigger by AIC
+ *
+ * Akaike Information Criterion of a split of the window x[0..n) at k, computed
+ * directly from data (Maeda, 1985):
+ *
+ *     AIC(k) = k*log(var(x[0..k))) + (n - k - 1)*log(var(x[k..n)))
+ *
+ * is minimal where the window is best described by two stationary parts, noise
+ * before the onset and the signal after it. Variances of both parts are taken
+ * from prefix sums of x and x^2 (the ones of the second part are totals less
+ * prefixes), so all splits are evaluated in one pass: O(n) for the whole window.
+ *
+ * P is picked on the vertical channel (the first one, \see CHANNEL_COMPONENTS)
+ * within preSecs on both sides of the trigger; S is picked on each horizontal
+ * channel, from sDelaySecs after P to snrSecs after the peak of amplitude (within
+ * postSecs after the trigger), the S wave being the strongest. A pick is kept
+ * if amplitude after it is at least minSnr times the one before it (RMS over snrSecs
+ * each, below one count taken as one).
+ */
+class AicPicker
+{
+    Q_DECLARE_TR_FUNCTIONS(AicPicker)
+public:
+    enum Phase { P, S };
+
+    struct Parameters {
+        double preSecs;    // Before the trigger
+        double postSecs;   // After the trigger
+        bool sPicks;       // Whether S is picked on horizontal channels
+        double sDelaySecs; // S window starts this long after P
+        double snrSecs;
+        double minSnr;
+        /// 10 s before and after the trigger, S picks 0.5 s after P, SNR of at least 2 over 1 s
+        Parameters();
+    };
+
+    struct Pick {
+        Phase phase;
+        unsigned channel;
+        TimeStampType time;
+        double snr;
+    };
+
+    /// Picks of one event
+    struct Result {
+        TimeStampType triggerTime;
+        QVector<Pick> picks; // Empty if no onset is clear enough
+        Result() : triggerTime(0) {}
+        /// Picks in one line, e.g. for Logger
+        QString describe() const;
+    };
+
+    explicit AicPicker(const Parameters & parameters = Parameters());
+
+    const Parameters & parameters() const { return params; }
+
+    /*!
+     * \brief Picks phases of the event triggered at \a triggerTime in \a window
+     *        (which should span from preSecs before it to postSecs after it)
+     */
+    Result pick(const DataBlock & window, TimeStampType triggerTime, int samplingFreq) const;
+
+    /*!
+     * \brief Index of the minimum of AIC of x[0..n): the first sample after the onset,
+     *        from 2 to n - 2 (two samples on each side at least), or -1 if \a n is less than 4
+     */
+    static int aicMinimum(const double * x, int n);
+
+    /// RMS of x[from..to) without its mean, clipped to the array of \a n
+    static double rms(const double * x, int n, int from, int to);
+
+private:
+    int addPick(Result & result, Phase phase, unsigned channel, const QVector<double> & x,
+                int from, int to, int snrItems, const DataBlock & window) const;
+
+    Parameters params;
+};
+
+#endif // AICPICKER_H
@@ -0,0 +1,95 @@
+#include "biquadcascade.h"
+
+#include <qmath.h>
+#include <limits>
+
+void BiquadCascade::setSections(const QVector<Section> & sections) {
+    sections_ = sections;
+    state.fill(0, sections_.size()*2*LANES);
+    reset();
+}
+
+void BiquadCascade::initState(const double * x) {
+    double input[LANES];
+    for (int lane = 0; lane < LANES; ++lane) {
+        input[lane] = x[lane];
+    }
+    for (int s = 0; s < sections_.size(); ++s) {
+        const Section & c = sections_[s];
+        double * z1 = state.data() + 2*s*LANES;
+        double * z2 = z1 + LANES;
+        const double dcGain = (c.b0 + c.b1 + c.b2) / (1 + c.a1 + c.a2);
+        for (int lane = 0; lane < LANES; ++lane) {
+            // Steady state for constant input: output is dcGain times it
+            const double y = dcGain * input[lane];
+            z1[lane] = y - c.b0*input[lane];
+            z2[lane] = c.b2*input[lane] - c.a2*y;
+            input[lane] = y;
+        }
+    }
+}
+
+template <class Store>
+void BiquadCascade::run(const DataItem * items, int size, Store store) {
+    const int sectionsNum = sections_.size();
+    const Section * coefs = sections_.constData();
+    double * z = state.data();
+    for (int i = 0; i < size; ++i) {
+        double x[LANES] = {0};
+        for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+            x[ch] = items[i].byChannel[ch];
+        }
+        if ( ! started ) {
+            initState(x);
+            started = true;
+        }
+        // Fixed number of lanes and no branches: each statement is one vector operation
+        for (int s = 0; s < sectionsNum; ++s) {
+            const Section & c = coefs[s];
+            double * z1 = z + 2*s*LANES;
+            double * z2 = z1 + LANES;
+            for (int lane = 0; lane < LANES; ++lane) {
+                const double y = c.b0*x[lane] + z1[lane];
+                z1[lane] = c.b1*x[lane] - c.a1*y + z2[lane];
+                z2[lane] = c.b2*x[lane] - c.a2*y;
+                x[lane] = y;
+            }
+        }
+        store(i, x);
+    }
+}
+
+void BiquadCascade::filter(DataBlock & block) {
+    if (sections_.isEmpty()) {
+        return;
+    }
+    DataItem * items = block.data.data();
+    const double low  = std::numeric_limits<DataType>::min();
+    const double high = std::numeric_limits<DataType>::max();
+    run(items, block.size(), [=](int i, const double * x) {
+        for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+            items[i].byChannel[ch] = DataType(qRound64(qBound(low, x[ch], high)));
+        }
+    });
+}
+
+void BiquadCascade::filter(const DataBlock & block, double * output) {
+    run(block.data.constData(), block.size(), [=](int i, const double * x) {
+        for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+            output[i*CHANNELS_NUM + ch] = x[ch];
+        }
+    });
+}
+
+std::complex<double> BiquadCascade::response(double freq, int samplingFreq) const {
+    if (samplingFreq <= 0) {
+        return 1;
+    }
+    const std::complex<double> z1 = std::polar(1.0, -2*M_PI*freq / samplingFreq); // z^-1
+    const std::complex<double> z2 = z1*z1;
+    std::complex<double> res = 1;
+    for (const Section & s: sections_) {
+        res *= (s.b0 + s.b1*z1 + s.b2*z2) / (1.0 + s.a1*z1 + s.a2*z2);
+    }
+    return res;
+}
@@ -0,0 +1,69 @@
+#ifndef BIQUADCASCADE_H
+#define BIQUADCASCADE_H
+
+#include "../protocol.h"
+
+#include <QVector>
+#include <complex>
+
+/*!
+ * \brief Streaming IIR filter of all channels: a cascade of second-order sections
+ *
+ * Sections are run in transposed direct form II, in double precision, with state
+ * kept between blocks, so that blocks are filtered as one continuous series.
+ * All channels are filtered together: samples of one item are padded to LANES
+ * values, and every step of a section is made for all of them at once, which
+ * compilers turn into one vector instruction per step (SSE2 or AVX for doubles).
+ *
+ * The state is initialized by the first sample after reset as if the input had been
+ * constant before it: there is no transient from the offset of data, and high-pass
+ * output starts from zero.
+ *
+ * Designs of filters (\see ButterworthFilter, ResponseFilter) only compute sections.
+ */
+class BiquadCascade
+{
+public:
+    /// Values filtered together: CHANNELS_NUM rounded up to a vector of doubles
+    static const int LANES = 4;
+
+    /// y[n] = b0*x[n] + b1*x[n-1] + b2*x[n-2] - a1*y[n-1] - a2*y[n-2]
+    struct Section {
+        double b0, b1, b2, a1, a2;
+    };
+
+    BiquadCascade() : started(false) {}
+
+    /// Replaces sections (none - data pass unchanged) and resets the state
+    void setSections(const QVector<Section> & sections);
+    const QVector<Section> & sections() const { return sections_; }
+    bool isEmpty() const { return sections_.isEmpty(); }
+
+    /// Starts a new series: the next sample initializes the state
+    void reset() { started = false; }
+
+    /// Filters \a block in place, continuing from the previous one; results are rounded
+    void filter(DataBlock & block);
+
+    /*!
+     * \brief Filters \a block into \a output without rounding, continuing from the previous one
+     * \param output - block.size()*CHANNELS_NUM values, channels of each item together
+     */
+    void filter(const DataBlock & block, double * output);
+
+    /// Frequency response at \a freq (Hz) for \a samplingFreq (Hz), from coefficients
+    std::complex<double> response(double freq, int samplingFreq) const;
+
+private:
+    void initState(const double * x);
+    /// Runs sections over \a size items, passing output of each item to \a store(i, x)
+    template <class Store>
+    void run(const DataItem * items, int size, Store store);
+
+    QVector<Section> sections_;
+    // Per section: z1 and z2 of all lanes, i.e. state[(2*s + k)*LANES + lane]
+    QVector<double> state;
+    bool started;
+};
+
+#endif // BIQUADCASCADE_H
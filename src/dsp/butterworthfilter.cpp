@@ -0,0 +1,89 @@
+#include "butterworthfilter.h"
+#include "../logger.h"
+
+#include <qmath.h>
+
+ButterworthFilter::Parameters::Parameters() :
+    type(None), order(4), lowFreq(1), highFreq(10)
+{
+}
+
+ButterworthFilter::ButterworthFilter(const Parameters & parameters) :
+    params(parameters), samplingFreq(0)
+{
+    params.order = qBound(1, params.order, MAX_ORDER);
+}
+
+bool ButterworthFilter::design(int samplingFreq) {
+    this->samplingFreq = samplingFreq;
+    sections.clear();
+    bool ok = true;
+    if (params.type != None && samplingFreq > 0) {
+        const double nyquist = samplingFreq / 2.0;
+        const bool hasLow  = (params.type == HighPass || params.type == BandPass);
+        const bool hasHigh = (params.type == LowPass  || params.type == BandPass);
+        ok = ( ! hasLow  || (params.lowFreq  > 0 && params.lowFreq  < nyquist) )
+          && ( ! hasHigh || (params.highFreq > 0 && params.highFreq < nyquist) )
+          && ( params.type != BandPass || params.lowFreq < params.highFreq );
+        if ( ! ok ) {
+            Logger::warning(tr("Filter %1-%2 Hz doesn't fit sampling frequency %3 Hz, data are not filtered")
+                            .arg(params.lowFreq).arg(params.highFreq).arg(samplingFreq));
+        } else {
+            if (hasLow) {
+                addButterworth(true, params.lowFreq);
+            }
+            if (hasHigh) {
+                addButterworth(false, params.highFreq);
+            }
+        }
+    }
+    cascade.setSections(sections);
+    return ok;
+}
+
+void ButterworthFilter::addButterworth(bool highPass, double freq) {
+    const int order = params.order;
+    // Poles of prototype are at angles phi from negative real axis, a pair per section
+    for (int k = 1; k <= order/2; ++k) {
+        const double phi = M_PI * (2*k - 1 + order % 2) / (2*order);
+        addSecondOrder(highPass, freq, 1 / (2*qCos(phi)));
+    }
+    if (order % 2 != 0) {
+        addFirstOrder(highPass, freq); // The real pole
+    }
+}
+
+void ButterworthFilter::addSecondOrder(bool highPass, double freq, double q) {
+    const double w = 2*M_PI*freq / samplingFreq;
+    const double cosW = qCos(w);
+    const double alpha = qSin(w) / (2*q);
+    const double a0 = 1 + alpha;
+    BiquadCascade::Section s;
+    if (highPass) {
+        s.b0 = (1 + cosW) / 2 / a0;
+        s.b1 = -(1 + cosW) / a0;
+    } else {
+        s.b0 = (1 - cosW) / 2 / a0;
+        s.b1 = (1 - cosW) / a0;
+    }
+    s.b2 = s.b0;
+    s.a1 = -2*cosW / a0;
+    s.a2 = (1 - alpha) / a0;
+    sections << s;
+}
+
+void ButterworthFilter::addFirstOrder(bool highPass, double freq) {
+    const double k = qTan(M_PI*freq / samplingFreq);
+    BiquadCascade::Section s;
+    if (highPass) {
+        s.b0 = 1 / (1 + k);
+        s.b1 = -s.b0;
+    } else {
+        s.b0 = k / (1 + k);
+        s.b1 = s.b0;
+    }
+    s.b2 = 0;
+    s.a1 = (k - 1) / (k + 1);
+    s.a2 = 0;
+    sections << s;
+}
@@ -0,0 +1,76 @@
+#ifndef BUTTERWORTHFILTER_H
+#define BUTTERWORTHFILTER_H
+
+#include "biquadcascade.h"
+
+#include <QVector>
+#include <QCoreApplication>
+
+/*!
+ * \brief Streaming Butterworth filter of all channels, run as BiquadCascade
+ *
+ * The filter is designed by bilinear transform of analog Butterworth prototype
+ * (prewarped, so that cutoff frequencies are exact): each pair of conjugate poles
+ * becomes a second-order section, an odd order adds a first-order one. Band-pass
+ * is a high-pass at lowFreq followed by a low-pass at highFreq, each of \a order.
+ */
+class ButterworthFilter
+{
+    Q_DECLARE_TR_FUNCTIONS(ButterworthFilter)
+public:
+    enum Type {
+        None,     // Data pass unchanged
+        LowPass,  // Below highFreq
+        HighPass, // Above lowFreq
+        BandPass  // Between lowFreq and highFreq
+    };
+
+    struct Parameters {
+        Type type;
+        int order;       // Of each of high-pass and low-pass parts
+        double lowFreq;  // Hz
+        double highFreq; // Hz
+        /// No filter; order 4, 1-10 Hz when enabled
+        Parameters();
+    };
+
+    static const int MAX_ORDER = 10;
+
+    explicit ButterworthFilter(const Parameters & parameters = Parameters());
+
+    const Parameters & parameters() const { return params; }
+
+    /*!
+     * \brief Computes coefficients for \a samplingFreq (Hz) and resets the state
+     * \return false if frequencies of the filter don't fit below Nyquist frequency
+     *         (reported to Logger): then the filter passes data unchanged
+     */
+    bool design(int samplingFreq);
+
+    /// Whether the filter changes data: designed and not of type None
+    bool isActive() const { return ! cascade.isEmpty(); }
+    int sectionsCount() const { return cascade.sections().size(); }
+
+    /// Starts a new series: the next sample initializes the state
+    void reset() { cascade.reset(); }
+
+    /// Filters \a block in place, continuing from the previous one
+    void filter(DataBlock & block) { cascade.filter(block); }
+
+    /*!
+     * \brief Gain of the filter at \a freq (Hz), from its coefficients
+     */
+    double gain(double freq) const { return std::abs(cascade.response(freq, samplingFreq)); }
+
+private:
+    void addSecondOrder(bool highPass, double freq, double q);
+    void addFirstOrder(bool highPass, double freq);
+    void addButterworth(bool highPass, double freq);
+
+    Parameters params;
+    int samplingFreq;
+    QVector<BiquadCascade::Section> sections; // Being designed
+    BiquadCascade cascade;
+};
+
+#endif // BUTTERWORTHFILTER_H
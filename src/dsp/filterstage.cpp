@@ -0,0 +1,20 @@
+#include "filterstage.h"
+
+FilterStage::FilterStage(QString name, const ButterworthFilter::Parameters & parameters, QObject *parent) :
+    Stage(name, parent), filter(parameters)
+{
+}
+
+void FilterStage::process(const DataBlock & block) {
+    DataBlock out = block;
+    filter.filter(out);
+    output(out);
+}
+
+void FilterStage::frequencyChanged() {
+    filter.design(samplingFrequency());
+}
+
+void FilterStage::reset() {
+    filter.reset();
+}
@@ -0,0 +1,31 @@
+#ifndef FILTERSTAGE_H
+#define FILTERSTAGE_H
+
+#include "stage.h"
+#include "butterworthfilter.h"
+
+/*!
+ * \brief Filters data of all channels by ButterworthFilter and passes them further
+ *
+ * Put it first in StageGraph, before the stages that should see filtered data
+ * (display, trigger, recording). The filter is designed anew when the sampling
+ * frequency changes; until then, and if it cannot be designed, data pass unchanged.
+ */
+class FilterStage : public Stage
+{
+    Q_OBJECT
+public:
+    FilterStage(QString name, const ButterworthFilter::Parameters & parameters, QObject *parent = nullptr);
+
+    const ButterworthFilter::Parameters & parameters() const { return filter.parameters(); }
+
+protected:
+    void process(const DataBlock & block) override;
+    void frequencyChanged() override;
+    void reset() override;
+
+private:
+    ButterworthFilter filter;
+};
+
+#endif // FILTERSTAGE_H
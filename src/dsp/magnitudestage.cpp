@@ -0,0 +1,219 @@
+#include "magnitudestage.h"
+#include "../logger.h"
+
+#include <QDateTime>
+#include <QStringList>
+#include <qmath.h>
+
+namespace {
+    QString timeToString(TimeStampType time) {
+        return QDateTime::fromMSecsSinceEpoch(qint64(time)).toString("yyyy-MM-dd hh:mm:ss.zzz");
+    }
+}
+
+const double MagnitudeStage::WOOD_ANDERSON_PERIOD = 0.8;
+const double MagnitudeStage::WOOD_ANDERSON_DAMPING = 0.7;
+const double MagnitudeStage::WOOD_ANDERSON_GAIN = 2080;
+
+MagnitudeStage::Parameters::Parameters() :
+    inputQuantity(ResponseFilter::Velocity), distanceKm(100), a(1.11), b(0.00189), c(3.0)
+{
+}
+
+MagnitudeStage::Result::Result() :
+    onTime(0), offTime(0), magnitude(0), valid(false)
+{
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        amplitude[ch] = 0;
+    }
+}
+
+MagnitudeStage::MagnitudeStage(QString name, const Parameters & parameters, QObject *parent) :
+    Stage(name, parent), params(parameters), ringSize(1), ringPos(0), ringFill(0)
+{
+}
+
+double MagnitudeStage::magnitude(double amplitudeMm, const Parameters & parameters) {
+    const double r = parameters.distanceKm;
+    return std::log10(amplitudeMm) + parameters.a*std::log10(r / 100) + parameters.b*(r - 100) + parameters.c;
+}
+
+double MagnitudeStage::gain(double freq) const {
+    return std::abs(simulation.response(freq, samplingFrequency()));
+}
+
+void MagnitudeStage::frequencyChanged() {
+    const int freq = samplingFrequency();
+    QVector<BiquadCascade::Section> sections;
+    if (freq > 0) {
+        // G*s^n / (s^2 + 2*h*w0*s + w0^2), n = 2 for displacement, less by one for each derivative;
+        // bilinear transform prewarped at w0, output in mm of record
+        const double w0 = 2*M_PI / WOOD_ANDERSON_PERIOD;
+        const double h = WOOD_ANDERSON_DAMPING;
+        const double k = w0 / qTan(w0 / (2.0*freq));
+        const double g = WOOD_ANDERSON_GAIN * 1000 / ResponseFilter::UNITS_PER_METRE;
+        const double a0 = k*k + 2*h*w0*k + w0*w0;
+        BiquadCascade::Section s;
+        switch (params.inputQuantity) {
+        case ResponseFilter::Displacement:
+            s.b0 = g*k*k;
+            s.b1 = -2*g*k*k;
+            s.b2 = g*k*k;
+            break;
+        case ResponseFilter::Velocity:
+            s.b0 = g*k;
+            s.b1 = 0;
+            s.b2 = -g*k;
+            break;
+        case ResponseFilter::Acceleration:
+            s.b0 = g;
+            s.b1 = 2*g;
+            s.b2 = g;
+            break;
+        }
+        s.b0 /= a0;
+        s.b1 /= a0;
+        s.b2 /= a0;
+        s.a1 = (2*w0*w0 - 2*k*k) / a0;
+        s.a2 = (k*k - 2*h*w0*k + w0*w0) / a0;
+        sections << s;
+    }
+    simulation.setSections(sections);
+    ringSize = qMax(1, LATE_TRIGGER_SECS * freq);
+    ringTimes.resize(ringSize);
+    ring.resize(ringSize * CHANNELS_NUM);
+    reset();
+}
+
+void MagnitudeStage::reset() {
+    // Events interrupted by reset are measured on the data there are
+    takeNewEvents();
+    for (Event & event: events) {
+        if (event.result.offTime < 0) {
+            event.result.offTime = event.scannedUntil;
+        }
+        finish(event);
+    }
+    events.clear();
+    simulation.reset();
+    ringPos = 0;
+    ringFill = 0;
+}
+
+void MagnitudeStage::startEvent(TimeStampType onTime, int channels) {
+    Q_UNUSED(channels);
+    QMutexLocker lock(&eventsMutex);
+    started << onTime;
+}
+
+void MagnitudeStage::endEvent(TimeStampType onTime, TimeStampType offTime, double peakRatio) {
+    Q_UNUSED(peakRatio);
+    QMutexLocker lock(&eventsMutex);
+    ended << qMakePair(onTime, offTime);
+}
+
+void MagnitudeStage::takeNewEvents() {
+    QMutexLocker lock(&eventsMutex);
+    for (TimeStampType onTime: started) {
+        Event event;
+        event.result.onTime = onTime;
+        event.result.offTime = -1; // Not known yet
+        event.scannedUntil = -1;   // From the oldest item of ring
+        events << event;
+    }
+    started.clear();
+    for (const QPair<TimeStampType,TimeStampType> & times: ended) {
+        bool found = false;
+        for (Event & event: events) {
+            if (event.result.onTime == times.first) {
+                event.result.offTime = times.second;
+                found = true;
+            }
+        }
+        if ( ! found ) { // Started before the stage, or before reset
+            Event event;
+            event.result.onTime = times.first;
+            event.result.offTime = times.second;
+            event.scannedUntil = -1;
+            events << event;
+        }
+    }
+    ended.clear();
+}
+
+void MagnitudeStage::process(const DataBlock & block) {
+    const int size = block.size();
+    if (size == 0 || samplingFrequency() <= 0) {
+        return;
+    }
+    output.resize(size * CHANNELS_NUM);
+    simulation.filter(block, output.data());
+    for (int i = 0; i < size; ++i) {
+        ringTimes[ringPos] = block.timestamps[i];
+        for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+            ring[ringPos*CHANNELS_NUM + ch] = output[i*CHANNELS_NUM + ch];
+        }
+        ringPos = (ringPos + 1) % ringSize;
+        ringFill = qMin(ringFill + 1, ringSize);
+    }
+
+    takeNewEvents();
+    const TimeStampType latest = block.timestamps[size - 1];
+    for (int e = 0; e < events.size(); ) {
+        Event & event = events[e];
+        if (event.result.onTime > latest) { // Known in advance: scanned from the ring when it comes
+            ++e;
+            continue;
+        }
+        const bool ended = event.result.offTime >= 0 && latest >= event.result.offTime;
+        scan(event, ended ? event.result.offTime : latest);
+        if (ended) {
+            finish(event);
+            events.remove(e);
+        } else {
+            ++e;
+        }
+    }
+}
+
+void MagnitudeStage::scan(Event & event, TimeStampType until) {
+    // From the newest item back to the ones scanned before: each item is visited once
+    for (int k = 1; k <= ringFill; ++k) {
+        const int pos = (ringPos - k + ringSize) % ringSize;
+        const TimeStampType time = ringTimes[pos];
+        if (time <= event.scannedUntil) {
+            break;
+        }
+        if (time >= event.result.onTime && time <= until) {
+            for (unsigned ch = 1; ch < CHANNELS_NUM; ++ch) {
+                event.result.amplitude[ch] = qMax(event.result.amplitude[ch], qAbs(ring[pos*CHANNELS_NUM + ch]));
+            }
+            event.result.valid = true;
+        }
+    }
+    event.scannedUntil = qMax(event.scannedUntil, until);
+}
+
+void MagnitudeStage::finish(Event & event) {
+    Result & result = event.result;
+    double sum = 0;
+    int count = 0;
+    QStringList amplitudes;
+    for (unsigned ch = 1; ch < CHANNELS_NUM; ++ch) {
+        if (result.amplitude[ch] > 0) {
+            sum += magnitude(result.amplitude[ch], params);
+            ++count;
+        }
+        amplitudes << QString::number(result.amplitude[ch], 'g', 3);
+    }
+    result.valid = result.valid && count > 0;
+    result.magnitude = count > 0 ? sum / count : 0;
+    emit magnitudeReady(result);
+    if (result.valid) {
+        Logger::info(tr("Local magnitude of event at %1: ML %2 (Wood-Anderson peaks %3 mm at %4 km)")
+                     .arg(timeToString(result.onTime)).arg(result.magnitude, 0, 'f', 1)
+                     .arg(amplitudes.join(", ")).arg(params.distanceKm));
+    } else {
+        Logger::info(tr("Local magnitude of event at %1 is unknown: no data").arg(timeToString(result.onTime)));
+    }
+}
@@ -0,0 +1,114 @@
+#ifndef MAGNITUDESTAGE_H
+#define MAGNITUDESTAGE_H
+
+#include "stage.h"
+#include "biquadcascade.h"
+#include "responsefilter.h"
+
+#include <QMutex>
+#include <QPair>
+
+/*!
+ * \brief Local magnitude (ML) of triggered events from simulated Wood-Anderson records
+ *
+ * Data must be in physical units (of ResponseFilter: nanometres, per second...),
+ * so put the stage after ResponseStage. The standard Wood-Anderson seismograph
+ * (period 0.8 s, damping 0.7, magnification 2080) is simulated on all data, as one
+ * biquad section converted by bilinear transform, so the simulation is settled
+ * when an event comes and costs a few operations per sample.
+ *
+ * Events come from the trigger (connect triggerOn to startEvent and triggerOff to
+ * endEvent). While an event goes on, the peak of simulated amplitude on each
+ * horizontal channel is updated with each block; the latest LATE_TRIGGER_SECS of
+ * simulated records are kept for triggers that come late (the trigger runs
+ * in parallel with this stage). When data reach the end of event, ML of each
+ * horizontal channel is
+ *
+ *     ML = log10(A) + a*log10(r/100) + b*(r - 100) + c
+ *
+ * for A - peak amplitude in mm, r - distance in km, and the magnitude of event
+ * is their mean. The defaults are of Hutton and Boore (1987) for Southern California.
+ */
+class MagnitudeStage : public Stage
+{
+    Q_OBJECT
+public:
+    struct Parameters {
+        ResponseFilter::Quantity inputQuantity; // Of data, in ResponseFilter units
+        double distanceKm;
+        // Distance correction, -log10(A0)
+        double a;
+        double b;
+        double c;
+        /// Velocity at 100 km, Hutton and Boore correction
+        Parameters();
+    };
+
+    /// Magnitude of one event
+    struct Result {
+        TimeStampType onTime;
+        TimeStampType offTime;
+        double amplitude[CHANNELS_NUM]; // Peak, mm (0 for the vertical channel)
+        double magnitude;               // Mean of horizontal channels
+        bool valid;                     // Whether there was data of event
+        Result();
+    };
+
+    static const int LATE_TRIGGER_SECS = 30;
+    static const double WOOD_ANDERSON_PERIOD;
+    static const double WOOD_ANDERSON_DAMPING;
+    static const double WOOD_ANDERSON_GAIN;
+
+    MagnitudeStage(QString name, const Parameters & parameters = Parameters(), QObject *parent = nullptr);
+
+    const Parameters & parameters() const { return params; }
+
+    /// Gain of the simulation at \a freq (Hz): mm of Wood-Anderson record per input unit
+    double gain(double freq) const;
+
+    /// Magnitude for peak amplitude \a amplitudeMm with the distance correction of \a parameters
+    static double magnitude(double amplitudeMm, const Parameters & parameters);
+
+public slots:
+    /// Thread-safe, \see StaLtaTrigger::triggerOn: connect with Qt::DirectConnection
+    void startEvent(TimeStampType onTime, int channels = 0);
+    /// Thread-safe, \see StaLtaTrigger::triggerOff: connect with Qt::DirectConnection
+    void endEvent(TimeStampType onTime, TimeStampType offTime, double peakRatio = 0);
+
+signals:
+    void magnitudeReady(MagnitudeStage::Result result);
+
+protected:
+    void process(const DataBlock & block) override;
+    void frequencyChanged() override;
+    void reset() override;
+
+private:
+    struct Event {
+        Result result;
+        TimeStampType scannedUntil; // Time of the last item included in peaks
+    };
+
+    void takeNewEvents();
+    void scan(Event & event, TimeStampType until);
+    void finish(Event & event);
+
+    Parameters params;
+    BiquadCascade simulation; // Output in mm
+
+    // Simulated records of the latest LATE_TRIGGER_SECS, a ring
+    int ringSize;
+    QVector<TimeStampType> ringTimes;
+    QVector<double> ring; // CHANNELS_NUM values per item
+    int ringPos;          // Where the next item goes
+    int ringFill;
+    QVector<double> output; // Of the current block
+
+    QVector<Event> events; // In progress, the oldest first
+
+    QMutex eventsMutex;    // Guards the ones below: slots are called from the thread of trigger
+    QVector<TimeStampType> started;
+    QVector<QPair<TimeStampType,TimeStampType>> ended;
+};
+
+#endif // MAGNITUDESTAGE_H
@@ -0,0 +1,115 @@
+#include "pickerstage.h"
+#include "../logger.h"
+
+#include <QDateTime>
+#include <QRunnable>
+#include <algorithm>
+
+namespace {
+    QString timeToString(TimeStampType time) {
+        return QDateTime::fromMSecsSinceEpoch(qint64(time)).toString("yyyy-MM-dd hh:mm:ss.zzz");
+    }
+
+    /// Picks one window in a thread of the pool
+    class PickTask : public QRunnable
+    {
+    public:
+        PickTask(PickerStage * stage, const AicPicker & picker, const DataBlock & window,
+                 TimeStampType triggerTime, int samplingFreq) :
+            stage(stage), picker(picker), window(window), triggerTime(triggerTime), samplingFreq(samplingFreq)
+        {
+        }
+
+        void run() override {
+            // The only priority below normal that has effect on Linux (SCHED_IDLE); the pool is own
+            QThread::currentThread()->setPriority(QThread::IdlePriority);
+            const AicPicker::Result result = picker.pick(window, triggerTime, samplingFreq);
+            Logger::info(PickerStage::tr("Picks of event at %1: %2").arg(timeToString(triggerTime), result.describe()));
+            emit stage->picked(result);
+        }
+
+    private:
+        PickerStage * stage;
+        const AicPicker picker;
+        const DataBlock window;
+        const TimeStampType triggerTime;
+        const int samplingFreq;
+    };
+}
+
+PickerStage::PickerStage(QString name, const AicPicker::Parameters & parameters, QObject *parent) :
+    Stage(name, parent), picker(parameters)
+{
+}
+
+PickerStage::~PickerStage() {
+    pool.waitForDone(); // Tasks emit signals of this stage
+}
+
+void PickerStage::addEvent(TimeStampType time, int channels) {
+    Q_UNUSED(channels);
+    QMutexLocker lock(&eventsMutex);
+    pending << time;
+}
+
+void PickerStage::process(const DataBlock & block) {
+    if (block.size() == 0) {
+        return;
+    }
+    recent << block;
+    const AicPicker::Parameters & params = picker.parameters();
+    const TimeStampType latest = block.timestamps.last();
+    const TimeStampType oldest = latest - (params.preSecs + params.postSecs + LATE_TRIGGER_SECS)*1000;
+    while (recent.first().timestamps.last() < oldest) {
+        recent.removeFirst();
+    }
+
+    QVector<TimeStampType> ready;
+    {
+        QMutexLocker lock(&eventsMutex);
+        for (int i = 0; i < pending.size(); ) {
+            if (pending[i] + params.postSecs*1000 <= latest) {
+                ready << pending[i];
+                pending.remove(i);
+            } else {
+                ++i;
+            }
+        }
+    }
+    for (TimeStampType time: ready) {
+        startPicking(time);
+    }
+}
+
+void PickerStage::reset() {
+    QVector<TimeStampType> interrupted;
+    {
+        QMutexLocker lock(&eventsMutex);
+        interrupted.swap(pending);
+    }
+    for (TimeStampType time: interrupted) {
+        startPicking(time);
+    }
+    recent.clear();
+}
+
+void PickerStage::startPicking(TimeStampType triggerTime) {
+    const AicPicker::Parameters & params = picker.parameters();
+    const DataBlock window = extract(triggerTime - params.preSecs*1000, triggerTime + params.postSecs*1000);
+    pool.start(new PickTask(this, picker, window, triggerTime, samplingFrequency()));
+}
+
+DataBlock PickerStage::extract(TimeStampType from, TimeStampType to) const {
+    DataBlock res;
+    for (const DataBlock & block: recent) {
+        const TimeStampType * begin = block.timestamps.constData();
+        const TimeStampType * end = begin + block.size();
+        const int first = int(std::lower_bound(begin, end, from) - begin);
+        const int last = int(std::lower_bound(begin, end, to) - begin);
+        if (first < last) {
+            res.timestamps += block.timestamps.mid(first, last - first);
+            res.data += block.data.mid(first, last - first);
+        }
+    }
+    return res;
+}
@@ -0,0 +1,72 @@
+#ifndef PICKERSTAGE_H
+#define PICKERSTAGE_H
+
+#include "stage.h"
+#include "aicpicker.h"
+
+#include <QMutex>
+#include <QThreadPool>
+
+/*!
+ * \brief Picks phases of triggered events by AicPicker in background
+ *
+ * Put it next to StaLtaTrigger, fed by the same stage, and connect triggerOn to
+ * addEvent. The stage itself only keeps the latest data: enough for windows
+ * of AicPicker around triggers, and for triggers that come late (the trigger
+ * runs in parallel with this stage and may lag behind it). When data reach
+ * the end of window of a trigger, the window is copied and picked on the own
+ * thread pool of the stage, with idle priority: the stream is never delayed
+ * by picking, and many events of a burst are picked on all cores at once.
+ *
+ * Results are emitted by picked (from threads of the pool) and reported to Logger.
+ * On reset, pending events are picked with the data there are.
+ */
+class PickerStage : public Stage
+{
+    Q_OBJECT
+public:
+    /// Data kept beyond windows of AicPicker, for triggers that come late
+    static const int LATE_TRIGGER_SECS = 30;
+
+    PickerStage(QString name, const AicPicker::Parameters & parameters, QObject *parent = nullptr);
+    /// Waits for events being picked
+    ~PickerStage();
+
+    const AicPicker::Parameters & parameters() const { return picker.parameters(); }
+
+    /// Number of events picked at once (the number of cores by default)
+    void setThreadCount(int count) { pool.setMaxThreadCount(count); }
+
+    /// Blocks until all events with complete windows are picked
+    void waitForDone() { pool.waitForDone(); }
+
+public slots:
+    /*!
+     * \brief Queues the event triggered at \a time for picking, \see StaLtaTrigger::triggerOn
+     *
+     * Thread-safe: connect it with Qt::DirectConnection, so that triggers don't wait
+     * for the event loop of the thread where the stage was created.
+     */
+    void addEvent(TimeStampType time, int channels = 0);
+
+signals:
+    void picked(AicPicker::Result result);
+
+protected:
+    void process(const DataBlock & block) override;
+    void reset() override;
+
+private:
+    void startPicking(TimeStampType triggerTime);
+    /// Items of recent blocks in [from, to)
+    DataBlock extract(TimeStampType from, TimeStampType to) const;
+
+    AicPicker picker;
+    QThreadPool pool;
+    QList<DataBlock> recent; // The oldest first
+
+    QMutex eventsMutex;
+    QVector<TimeStampType> pending; // Trigger times, guarded by eventsMutex
+};
+
+#endif // PICKERSTAGE_H
@@ -0,0 +1,236 @@
+#include "polarization.h"
+
+#include <qmath.h>
+
+namespace {
+    void cross(const double a[3], const double b[3], double res[3]) {
+        res[0] = a[1]*b[2] - a[2]*b[1];
+        res[1] = a[2]*b[0] - a[0]*b[2];
+        res[2] = a[0]*b[1] - a[1]*b[0];
+    }
+
+    double dot(const double a[3], const double b[3]) {
+        return a[0]*b[0] + a[1]*b[1] + a[2]*b[2];
+    }
+
+    /// Scales \a v to unit length, returns false if it is zero
+    bool normalize(double v[3]) {
+        const double norm = qSqrt(dot(v, v));
+        if (norm == 0) {
+            return false;
+        }
+        for (int i = 0; i < 3; ++i) {
+            v[i] /= norm;
+        }
+        return true;
+    }
+
+    /*!
+     * Eigenvector of \a m for its simple eigenvalue \a value: orthogonal to rows of m - value*I,
+     * the largest of their cross products is the most accurate; false if the value is repeated
+     */
+    bool eigenvector(const double m[3][3], double value, double res[3]) {
+        double rows[3][3];
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 3; ++j) {
+                rows[i][j] = m[i][j] - (i == j ? value : 0);
+            }
+        }
+        double best = 0;
+        for (int i = 0; i < 3; ++i) {
+            double v[3];
+            cross(rows[i], rows[(i + 1) % 3], v);
+            const double norm = dot(v, v);
+            if (norm > best) {
+                best = norm;
+                res[0] = v[0];
+                res[1] = v[1];
+                res[2] = v[2];
+            }
+        }
+        return best > 0 && normalize(res);
+    }
+}
+
+Polarization::Polarization(int window) :
+    window_(2), total(0)
+{
+    setWindow(window);
+}
+
+void Polarization::setWindow(int items) {
+    window_ = qMax(2, items);
+    ring.resize(window_);
+    reset();
+}
+
+void Polarization::reset() {
+    total = 0;
+    for (unsigned c = 0; c < CHANNELS_NUM; ++c) {
+        reference[c] = sums[c] = 0;
+        for (unsigned d = 0; d < CHANNELS_NUM; ++d) {
+            products[c][d] = 0;
+        }
+    }
+}
+
+void Polarization::add(const DataItem & item) {
+    const qint64 number = total++;
+    DataItem & slot = ring[int(number % window_)];
+    double value[CHANNELS_NUM];
+    for (unsigned c = 0; c < CHANNELS_NUM; ++c) {
+        value[c] = item.byChannel[c] - reference[c];
+    }
+    if (number >= window_) {
+        // The new item replaces the oldest one in the window
+        double old[CHANNELS_NUM];
+        for (unsigned c = 0; c < CHANNELS_NUM; ++c) {
+            old[c] = slot.byChannel[c] - reference[c];
+            sums[c] += value[c] - old[c];
+        }
+        for (unsigned c = 0; c < CHANNELS_NUM; ++c) {
+            for (unsigned d = c; d < CHANNELS_NUM; ++d) {
+                products[c][d] += value[c]*value[d] - old[c]*old[d];
+            }
+        }
+    } else {
+        for (unsigned c = 0; c < CHANNELS_NUM; ++c) {
+            sums[c] += value[c];
+            for (unsigned d = c; d < CHANNELS_NUM; ++d) {
+                products[c][d] += value[c]*value[d];
+            }
+        }
+    }
+    slot = item;
+    if (total % window_ == 0) {
+        recompute();
+    }
+}
+
+void Polarization::recompute() {
+    const int count = size();
+    for (unsigned c = 0; c < CHANNELS_NUM; ++c) {
+        double sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum += ring[i].byChannel[c];
+        }
+        reference[c] = qRound(sum / count); // Integer: values less it are exact
+    }
+    for (unsigned c = 0; c < CHANNELS_NUM; ++c) {
+        sums[c] = 0;
+        for (unsigned d = c; d < CHANNELS_NUM; ++d) {
+            products[c][d] = 0;
+        }
+    }
+    for (int i = 0; i < count; ++i) {
+        double value[CHANNELS_NUM];
+        for (unsigned c = 0; c < CHANNELS_NUM; ++c) {
+            value[c] = ring[i].byChannel[c] - reference[c];
+            sums[c] += value[c];
+        }
+        for (unsigned c = 0; c < CHANNELS_NUM; ++c) {
+            for (unsigned d = c; d < CHANNELS_NUM; ++d) {
+                products[c][d] += value[c]*value[d];
+            }
+        }
+    }
+}
+
+void Polarization::covariance(double cov[CHANNELS_NUM][CHANNELS_NUM]) const {
+    const int count = qMax(1, size());
+    for (unsigned c = 0; c < CHANNELS_NUM; ++c) {
+        for (unsigned d = c; d < CHANNELS_NUM; ++d) {
+            cov[c][d] = cov[d][c] = products[c][d] / count - (sums[c] / count) * (sums[d] / count);
+        }
+    }
+}
+
+Polarization::Values Polarization::values(TimeStampType time) const {
+    Values res;
+    res.time = time;
+    if (size() < 2) {
+        return res;
+    }
+    double cov[CHANNELS_NUM][CHANNELS_NUM];
+    covariance(cov);
+    double eigenvalues[3];
+    double eigenvectors[3][3];
+    eigen(cov, eigenvalues, eigenvectors);
+    if (eigenvalues[0] <= 0) {
+        return res; // No motion
+    }
+    res.amplitude = qSqrt(eigenvalues[0]);
+    res.rectilinearity = 1 - (qMax(0.0, eigenvalues[1]) + qMax(0.0, eigenvalues[2])) / (2*eigenvalues[0]);
+    // Up and away from the source: the horizontal part points from it, if vertical one is up
+    const double * principal = eigenvectors[0];
+    const double sign = principal[0] < 0 ? -1 : 1;
+    const double z = sign*principal[0], n = sign*principal[1], e = sign*principal[2];
+    res.incidence = qRadiansToDegrees(qAcos(qMin(1.0, z)));
+    res.backAzimuth = qRadiansToDegrees(qAtan2(-e, -n));
+    if (res.backAzimuth < 0) {
+        res.backAzimuth += 360;
+    }
+    return res;
+}
+
+void Polarization::eigen(const double m[3][3], double eigenvalues[3], double eigenvectors[3][3]) {
+    // Eigenvalues of m are q + p*(those of b), b = (m - q*I) / p has trace 0 and
+    // the sum of squares 6: its characteristic polynomial is x^3 - 3x - det(b)
+    const double offDiagonal = m[0][1]*m[0][1] + m[0][2]*m[0][2] + m[1][2]*m[1][2];
+    const double q = (m[0][0] + m[1][1] + m[2][2]) / 3;
+    const double p2 = (m[0][0] - q)*(m[0][0] - q) + (m[1][1] - q)*(m[1][1] - q)
+                      + (m[2][2] - q)*(m[2][2] - q) + 2*offDiagonal;
+    const double p = qSqrt(p2 / 6);
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            eigenvectors[i][j] = (i == j);
+        }
+    }
+    if (p == 0) {
+        // Multiple of I: any basis
+        eigenvalues[0] = eigenvalues[1] = eigenvalues[2] = q;
+        return;
+    }
+    double b[3][3];
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            b[i][j] = (m[i][j] - (i == j ? q : 0)) / p;
+        }
+    }
+    const double det = b[0][0]*(b[1][1]*b[2][2] - b[1][2]*b[2][1])
+                     - b[0][1]*(b[1][0]*b[2][2] - b[1][2]*b[2][0])
+                     + b[0][2]*(b[1][0]*b[2][1] - b[1][1]*b[2][0]);
+    const double phi = qAcos(qBound(-1.0, det / 2, 1.0)) / 3;
+    eigenvalues[0] = q + 2*p*qCos(phi);
+    eigenvalues[2] = q + 2*p*qCos(phi + 2*M_PI/3);
+    eigenvalues[1] = 3*q - eigenvalues[0] - eigenvalues[2];
+
+    // The largest and the smallest ones are simple unless two eigenvalues are equal;
+    // the middle one is orthogonal to both
+    double * v1 = eigenvectors[0];
+    double * v2 = eigenvectors[1];
+    double * v3 = eigenvectors[2];
+    const bool first = eigenvector(m, eigenvalues[0], v1);
+    const bool last = eigenvector(m, eigenvalues[2], v3);
+    if ( ! first && ! last ) {
+        return;
+    }
+    if ( ! first ) {
+        // l1 = l2: any unit vector orthogonal to v3
+        const double axis[3] = {qAbs(v3[0]) < 0.9 ? 1.0 : 0.0, qAbs(v3[0]) < 0.9 ? 0.0 : 1.0, 0};
+        cross(v3, axis, v1);
+        normalize(v1);
+    } else if ( ! last ) {
+        const double axis[3] = {qAbs(v1[0]) < 0.9 ? 1.0 : 0.0, qAbs(v1[0]) < 0.9 ? 0.0 : 1.0, 0};
+        cross(v1, axis, v3);
+        normalize(v3);
+    } else {
+        // Rounding: keep v3 exactly orthogonal to v1
+        const double projection = dot(v1, v3);
+        for (int i = 0; i < 3; ++i) {
+            v3[i] -= projection * v1[i];
+        }
+        normalize(v3);
+    }
+    cross(v3, v1, v2);
+}
@@ -0,0 +1,79 @@
+#ifndef POLARIZATION_H
+#define POLARIZATION_H
+
+#include "../protocol.h"
+
+#include <QVector>
+
+/*!
+ * \brief Polarization of 3-component motion over a sliding window of the latest items
+ *
+ * Channels are taken as Z, N and E components (\see CHANNEL_COMPONENTS). The 3x3
+ * covariance matrix of the window is kept by sums of values and of their pairwise
+ * products, less a reference per channel (the mean of window when they were last
+ * recomputed, so that the sums stay small): the item entering the window is added,
+ * the one leaving it is subtracted, O(1) per item. Rounding errors of these updates
+ * would accumulate over days of data, so once per window length they are recomputed
+ * from the window.
+ *
+ * On request, eigenvalues l1 >= l2 >= l3 and eigenvectors of the covariance are found
+ * in closed form: eigenvalues as roots of the characteristic cubic by the trigonometric
+ * method, eigenvectors as cross products of rows of (C - l*I). From them (Jurkevics, 1988):
+ *  - rectilinearity = 1 - (l2 + l3) / (2*l1): 1 for linear motion (a body wave),
+ *    0 for isotropic one (noise);
+ *  - incidence: the angle of the principal eigenvector from the vertical, degrees;
+ *  - back-azimuth: the direction to the source, degrees clockwise from N, taking the
+ *    motion as of a P wave: up and away from the source, or down and towards it.
+ */
+class Polarization
+{
+public:
+    struct Values {
+        TimeStampType time;    // Of the last item of window
+        double rectilinearity;
+        double backAzimuth;    // Degrees, 0 to 360
+        double incidence;      // Degrees, 0 to 90
+        double amplitude;      // Along the principal eigenvector, RMS: sqrt(l1)
+        Values() : time(0), rectilinearity(0), backAzimuth(0), incidence(0), amplitude(0) {}
+    };
+
+    explicit Polarization(int window = 2);
+
+    int window() const { return window_; }
+
+    /// Sets the number of items in window (2 at least), and resets
+    void setWindow(int items);
+
+    /// Forgets all items
+    void reset();
+
+    void add(const DataItem & item);
+
+    /// Number of items in window
+    int size() const { return int(qMin<qint64>(total, window_)); }
+
+    /// Covariance matrix of the window (of population), rows and columns in order of channels
+    void covariance(double cov[CHANNELS_NUM][CHANNELS_NUM]) const;
+
+    /// Polarization of the window, at \a time; zeros if there are less than 2 items
+    Values values(TimeStampType time) const;
+
+    /*!
+     * \brief Eigen-decomposition of a symmetric 3x3 matrix \a m in closed form
+     * \param eigenvalues - in decreasing order
+     * \param eigenvectors - unit ones, eigenvectors[i] is of eigenvalues[i]
+     */
+    static void eigen(const double m[3][3], double eigenvalues[3], double eigenvectors[3][3]);
+
+private:
+    void recompute();
+
+    int window_;
+    qint64 total;           // Items added since reset: number of the next item
+    QVector<DataItem> ring; // The last window_ items, item number n at n % window_
+    double reference[CHANNELS_NUM];
+    double sums[CHANNELS_NUM];                // Of values less reference
+    double products[CHANNELS_NUM][CHANNELS_NUM]; // Of the same, upper triangle
+};
+
+#endif // POLARIZATION_H
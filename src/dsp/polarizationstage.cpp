@@ -0,0 +1,144 @@
+#include "polarizationstage.h"
+#include "../logger.h"
+
+#include <QDateTime>
+
+namespace {
+    QString timeToString(TimeStampType time) {
+        return QDateTime::fromMSecsSinceEpoch(qint64(time)).toString("yyyy-MM-dd hh:mm:ss.zzz");
+    }
+}
+
+PolarizationStage::Parameters::Parameters() :
+    windowSecs(1), hopSecs(0.1)
+{
+}
+
+int PolarizationStage::Event::principal() const {
+    int res = -1;
+    for (int i = 0; i < series.size(); ++i) {
+        if (res < 0 || series[i].rectilinearity > series[res].rectilinearity) {
+            res = i;
+        }
+    }
+    return res;
+}
+
+PolarizationStage::PolarizationStage(QString name, const Parameters & parameters, QObject *parent) :
+    Stage(name, parent), params(parameters), hopItems(1), sinceHop(0)
+{
+}
+
+void PolarizationStage::frequencyChanged() {
+    const int freq = samplingFrequency();
+    analysis.setWindow(qRound(params.windowSecs * freq));
+    hopItems = qMax(1, qRound(params.hopSecs * freq));
+    reset();
+}
+
+void PolarizationStage::reset() {
+    // Events interrupted by reset are reported with the values there are
+    takeNewEvents();
+    for (const Event & event: events) {
+        finish(event);
+    }
+    events.clear();
+    analysis.reset();
+    sinceHop = 0;
+    recent.clear();
+}
+
+void PolarizationStage::startEvent(TimeStampType onTime, int channels) {
+    Q_UNUSED(channels);
+    QMutexLocker lock(&eventsMutex);
+    started << onTime;
+}
+
+void PolarizationStage::endEvent(TimeStampType onTime, TimeStampType offTime, double peakRatio) {
+    Q_UNUSED(peakRatio);
+    QMutexLocker lock(&eventsMutex);
+    ended << qMakePair(onTime, offTime);
+}
+
+void PolarizationStage::takeNewEvents() {
+    QMutexLocker lock(&eventsMutex);
+    for (TimeStampType onTime: started) {
+        Event event;
+        event.onTime = onTime;
+        event.offTime = -1; // Not known yet
+        for (const Polarization::Values & values: recent) {
+            if (values.time >= onTime) {
+                event.series << values;
+            }
+        }
+        events << event;
+    }
+    started.clear();
+    for (const QPair<TimeStampType,TimeStampType> & times: ended) {
+        for (Event & event: events) {
+            if (event.onTime == times.first) {
+                event.offTime = times.second;
+                // The end may come late too
+                while ( ! event.series.isEmpty() && event.series.last().time > event.offTime ) {
+                    event.series.removeLast();
+                }
+            }
+        }
+    }
+    ended.clear();
+}
+
+void PolarizationStage::process(const DataBlock & block) {
+    const int size = block.size();
+    if (size == 0 || samplingFrequency() <= 0) {
+        return;
+    }
+    takeNewEvents();
+    QVector<Polarization::Values> res;
+    for (int i = 0; i < size; ++i) {
+        analysis.add(block.data[i]);
+        if (++sinceHop >= hopItems && analysis.size() == analysis.window()) {
+            sinceHop = 0;
+            res << analysis.values(block.timestamps[i]);
+        }
+    }
+    if ( ! res.isEmpty() ) {
+        emit valuesReady(res);
+    }
+
+    for (const Polarization::Values & values: res) {
+        recent << values;
+    }
+    const TimeStampType latest = block.timestamps[size - 1];
+    while ( ! recent.isEmpty() && recent.first().time < latest - LATE_TRIGGER_SECS*1000.0 ) {
+        recent.removeFirst();
+    }
+    for (int e = 0; e < events.size(); ) {
+        Event & event = events[e];
+        for (const Polarization::Values & values: res) {
+            if (values.time >= event.onTime && (event.offTime < 0 || values.time <= event.offTime)) {
+                event.series << values;
+            }
+        }
+        if (event.offTime >= 0 && latest >= event.offTime) {
+            finish(event);
+            events.remove(e);
+        } else {
+            ++e;
+        }
+    }
+}
+
+void PolarizationStage::finish(const Event & event) {
+    emit eventReady(event);
+    const int principal = event.principal();
+    if (principal < 0) {
+        Logger::info(tr("Polarization of event at %1 is unknown: no data").arg(timeToString(event.onTime)));
+        return;
+    }
+    const Polarization::Values & values = event.series[principal];
+    Logger::info(tr("Polarization of event at %1: rectilinearity %2 at %3, back-azimuth %4, incidence %5 degrees")
+                 .arg(timeToString(event.onTime)).arg(values.rectilinearity, 0, 'f', 2)
+                 .arg(timeToString(values.time)).arg(values.backAzimuth, 0, 'f', 0)
+                 .arg(values.incidence, 0, 'f', 0));
+}
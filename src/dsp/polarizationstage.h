@@ -0,0 +1,84 @@
+#ifndef POLARIZATIONSTAGE_H
+#define POLARIZATIONSTAGE_H
+
+#include "stage.h"
+#include "polarization.h"
+
+#include <QList>
+#include <QMutex>
+#include <QPair>
+
+/*!
+ * \brief Streaming 3-component polarization: rectilinearity, back-azimuth and incidence
+ *
+ * Polarization of a sliding window of windowSecs is computed every hopSecs
+ * (\see Polarization), and the series is reported by valuesReady for each block.
+ * Put the stage after a filter: polarization of a band with body waves is far
+ * more stable than the one of broadband noise.
+ *
+ * Events come from the trigger (connect triggerOn to startEvent and triggerOff to
+ * endEvent): when data reach the end of an event, its part of the series is reported
+ * by eventReady, and the most rectilinear values of it to Logger. Values of the latest
+ * LATE_TRIGGER_SECS are kept for triggers that come late.
+ */
+class PolarizationStage : public Stage
+{
+    Q_OBJECT
+public:
+    struct Parameters {
+        double windowSecs;
+        double hopSecs;
+        /// 1 s window every 0.1 s
+        Parameters();
+    };
+
+    /// Series of a triggered event
+    struct Event {
+        TimeStampType onTime;
+        TimeStampType offTime;
+        QVector<Polarization::Values> series;
+        Event() : onTime(0), offTime(0) {}
+        /// Index of the most rectilinear values in series, -1 if it is empty
+        int principal() const;
+    };
+
+    static const int LATE_TRIGGER_SECS = 30;
+
+    PolarizationStage(QString name, const Parameters & parameters = Parameters(), QObject *parent = nullptr);
+
+    const Parameters & parameters() const { return params; }
+
+public slots:
+    /// Thread-safe, \see StaLtaTrigger::triggerOn: connect with Qt::DirectConnection
+    void startEvent(TimeStampType onTime, int channels = 0);
+    /// Thread-safe, \see StaLtaTrigger::triggerOff: connect with Qt::DirectConnection
+    void endEvent(TimeStampType onTime, TimeStampType offTime, double peakRatio = 0);
+
+signals:
+    /// Values computed from the latest block, the oldest first
+    void valuesReady(QVector<Polarization::Values> values);
+    void eventReady(PolarizationStage::Event event);
+
+protected:
+    void process(const DataBlock & block) override;
+    void frequencyChanged() override;
+    void reset() override;
+
+private:
+    void takeNewEvents();
+    void finish(const Event & event);
+
+    Parameters params;
+    Polarization analysis;
+    int hopItems;
+    int sinceHop; // Items since the last values
+    QList<Polarization::Values> recent; // Of the latest LATE_TRIGGER_SECS, the oldest first
+
+    QVector<Event> events; // In progress, the oldest first
+
+    QMutex eventsMutex;    // Guards the ones below: slots are called from the thread of trigger
+    QVector<TimeStampType> started;
+    QVector<QPair<TimeStampType,TimeStampType>> ended;
+};
+
+#endif // POLARIZATIONSTAGE_H
@@ -0,0 +1,130 @@
+#include "ppsdhistogram.h"
+#include "../logger.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+#include <qmath.h>
+
+namespace {
+    const quint32 MAGIC = 0x50475253; // "SRGP" in little-endian
+    const quint16 VERSION = 1;
+}
+
+PpsdHistogram::PpsdHistogram() :
+    channel(0), samplingFreq(0), windowSize(0), segments_(0), first(0), last(0)
+{}
+
+void PpsdHistogram::reset(unsigned channel, int samplingFreq, int windowSize, const QVector<double> & periods) {
+    this->channel = quint16(channel);
+    this->samplingFreq = samplingFreq;
+    this->windowSize = windowSize;
+    periods_ = periods;
+    segments_ = 0;
+    first = last = 0;
+    counts.fill(0, periods.size()*dbBins());
+}
+
+bool PpsdHistogram::isCompatible(unsigned channel, int samplingFreq, int windowSize, const QVector<double> & periods) const {
+    return this->channel == channel && this->samplingFreq == samplingFreq
+        && this->windowSize == windowSize && periods_ == periods;
+}
+
+void PpsdHistogram::add(TimeStampType time, const QVector<double> & db) {
+    const int count = qMin(db.size(), periods_.size());
+    for (int p = 0; p < count; ++p) {
+        const int bin = qBound(0, int(qFloor(db[p])) - DB_MIN, dbBins() - 1);
+        ++counts[p*dbBins() + bin];
+    }
+    if (segments_ == 0) {
+        first = time;
+    }
+    last = time;
+    ++segments_;
+}
+
+QVector<double> PpsdHistogram::percentile(double p) const {
+    QVector<double> res(periods_.size(), qQNaN());
+    if (segments_ == 0) {
+        return res;
+    }
+    const double threshold = segments_ * p / 100;
+    for (int period = 0; period < periods_.size(); ++period) {
+        qint64 sum = 0;
+        for (int bin = 0; bin < dbBins(); ++bin) {
+            sum += count(period, bin);
+            if (sum >= threshold) {
+                res[period] = DB_MIN + bin + 0.5;
+                break;
+            }
+        }
+    }
+    return res;
+}
+
+QVector<double> PpsdHistogram::mode() const {
+    QVector<double> res(periods_.size(), qQNaN());
+    if (segments_ == 0) {
+        return res;
+    }
+    for (int period = 0; period < periods_.size(); ++period) {
+        int best = 0;
+        for (int bin = 1; bin < dbBins(); ++bin) {
+            if (count(period, bin) > count(period, best)) {
+                best = bin;
+            }
+        }
+        res[period] = DB_MIN + best + 0.5;
+    }
+    return res;
+}
+
+bool PpsdHistogram::save(const QString & fileName) const {
+    QSaveFile file(fileName);
+    if ( ! file.open(QIODevice::WriteOnly) ) {
+        Logger::error(tr("Failed to write PPSD to %1: %2").arg(fileName, file.errorString()));
+        return false;
+    }
+    {
+        QDataStream out(&file);
+        out.setVersion(QDataStream::Qt_5_0);
+        out.setByteOrder(QDataStream::LittleEndian);
+        out << MAGIC << VERSION << channel << samplingFreq << windowSize
+            << periods_ << segments_ << first << last << counts;
+    }
+    if ( ! file.commit() ) {
+        Logger::error(tr("Failed to write PPSD to %1: %2").arg(fileName, file.errorString()));
+        return false;
+    }
+    return true;
+}
+
+bool PpsdHistogram::load(const QString & fileName) {
+    QFile file(fileName);
+    if ( ! file.exists() ) {
+        return false;
+    }
+    if ( ! file.open(QIODevice::ReadOnly) ) {
+        Logger::error(tr("Failed to read PPSD from %1: %2").arg(fileName, file.errorString()));
+        return false;
+    }
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_0);
+    in.setByteOrder(QDataStream::LittleEndian);
+    quint32 magic;
+    quint16 version;
+    PpsdHistogram loaded;
+    in >> magic >> version;
+    if (magic != MAGIC || version != VERSION) {
+        Logger::error(tr("File %1 is not a PPSD of supported version").arg(fileName));
+        return false;
+    }
+    in >> loaded.channel >> loaded.samplingFreq >> loaded.windowSize
+       >> loaded.periods_ >> loaded.segments_ >> loaded.first >> loaded.last >> loaded.counts;
+    if (in.status() != QDataStream::Ok || loaded.counts.size() != loaded.periods_.size()*dbBins()) {
+        Logger::error(tr("PPSD in %1 is damaged").arg(fileName));
+        return false;
+    }
+    *this = loaded;
+    return true;
+}
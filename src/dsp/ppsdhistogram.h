@@ -0,0 +1,73 @@
+#ifndef PPSDHISTOGRAM_H
+#define PPSDHISTOGRAM_H
+
+#include "../protocol.h"
+#include <QVector>
+#include <QCoreApplication>
+
+/*!
+ * \brief Probabilistic power spectral density: histogram of PSD levels by period
+ *
+ * For each period bin, counts how many segment PSDs had each level in dB
+ * (1 dB bins from DB_MIN to DB_MAX, levels outside are counted in the extreme bins).
+ * Its size depends only on the number of period bins, so it takes the same
+ * memory however many segments are added.
+ *
+ * File (QDataStream): "SRGP", quint16 version, quint16 channel, qint32 sampling frequency,
+ * qint32 FFT window size, periods (QVector<double>, seconds), qint64 number of segments,
+ * double time of the first and the last segment, counts (QVector<quint32>, period after period).
+ * Files are replaced atomically, so a crash never leaves a half-written one.
+ */
+class PpsdHistogram
+{
+    Q_DECLARE_TR_FUNCTIONS(PpsdHistogram)
+public:
+    static const int DB_MIN = -100;
+    static const int DB_MAX = 200;
+
+    PpsdHistogram();
+
+    /// Starts a new empty histogram for \a periods (with spectra computed by the given parameters)
+    void reset(unsigned channel, int samplingFreq, int windowSize, const QVector<double> & periods);
+
+    /// Whether the histogram was made with the same parameters (so that it can be continued)
+    bool isCompatible(unsigned channel, int samplingFreq, int windowSize, const QVector<double> & periods) const;
+
+    static int dbBins() { return DB_MAX - DB_MIN; }
+
+    const QVector<double> & periods() const { return periods_; }
+    qint64 segments() const { return segments_; }
+    TimeStampType firstTime() const { return first; }
+    TimeStampType lastTime() const { return last; }
+
+    quint32 count(int period, int dbBin) const { return counts[period*dbBins() + dbBin]; }
+
+    /*!
+     * \brief Adds PSD of a segment
+     * \param time - start of the segment
+     * \param db - level in dB for each period
+     */
+    void add(TimeStampType time, const QVector<double> & db);
+
+    /// The level (dB, middle of bin) below which \a p percent of segments are, for each period
+    QVector<double> percentile(double p) const;
+    /// The most probable level (dB, middle of bin) for each period
+    QVector<double> mode() const;
+
+    /// \return false if failed (reported to Logger)
+    bool save(const QString & fileName) const;
+    /// \return false if there is no such file or it cannot be read (reported to Logger)
+    bool load(const QString & fileName);
+
+private:
+    quint16 channel;
+    qint32 samplingFreq;
+    qint32 windowSize;
+    QVector<double> periods_;
+    qint64 segments_;
+    TimeStampType first;
+    TimeStampType last;
+    QVector<quint32> counts;
+};
+
+#endif // PPSDHISTOGRAM_H
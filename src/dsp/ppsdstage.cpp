@@ -0,0 +1,166 @@
+#include "ppsdstage.h"
+#include "../logger.h"
+
+#include <QDir>
+#include <qmath.h>
+
+const QString PpsdStage::DEFAULT_DIR = "ppsd";
+const QString PpsdStage::FILE_SUFFIX = ".ppsd";
+
+namespace {
+    const double OCTAVE_STEP = 0.125;      // Of centers of bands
+    const int MIN_WINDOWS_PER_SEGMENT = 4;
+    const double MIN_DENSITY = 1e-30;      // To take logarithm of zero
+}
+
+PpsdStage::PpsdStage(QString name, unsigned channel, QString directory, int segmentSecs, QObject *parent) :
+    Stage(name, parent), channel_(channel), dir(directory), segmentSecs(qMax(1, segmentSecs)),
+    segmentSamples(0), windowSize(0), hop(0), scale(0), position(0), sampleNumber(0)
+{}
+
+QString PpsdStage::fileName() const {
+    return QDir(dir).filePath(QString::number(channel_ + 1) + FILE_SUFFIX);
+}
+
+void PpsdStage::frequencyChanged() {
+    const int freq = samplingFrequency();
+    fft.reset();
+    if (freq <= 0) {
+        return;
+    }
+    segmentSamples = qint64(segmentSecs) * freq;
+    windowSize = 4;
+    while (windowSize*2 <= segmentSamples/4) {
+        windowSize *= 2;
+    }
+    hop = windowSize/4;
+    if (segmentSamples < qint64(windowSize) + qint64(hop)*(MIN_WINDOWS_PER_SEGMENT - 1)) {
+        Logger::warning(tr("Segments of %1 are too short for PPSD").arg(name()));
+        return;
+    }
+    fft.reset(new RealFft(windowSize));
+    taper.resize(windowSize);
+    double taperPower = 0;
+    for (int i = 0; i < windowSize; ++i) {
+        taper[i] = 0.5*(1 - qCos(2*M_PI*i/windowSize)); // Hann
+        taperPower += taper[i]*taper[i];
+    }
+    scale = 1 / (taperPower * freq);
+    samples.resize(windowSize);
+    segment.resize(windowSize);
+    bins.resize(fft->bins());
+    for (Segment & s: segments) {
+        s.sum.resize(fft->bins());
+    }
+    initBins();
+
+    QDir().mkpath(dir);
+    if ( ! histogram.load(fileName()) || ! histogram.isCompatible(channel_, freq, windowSize, periods) ) {
+        if (histogram.segments() > 0) {
+            Logger::warning(tr("PPSD in %1 was made with other parameters, it is started anew").arg(fileName()));
+        }
+        histogram.reset(channel_, freq, windowSize, periods);
+    } else {
+        Logger::info(tr("Continuing PPSD of %1 segments in %2").arg(histogram.segments()).arg(fileName()));
+    }
+    reset();
+}
+
+void PpsdStage::initBins() {
+    // Full octave bands, with centers from the highest that fits below Nyquist frequency
+    // down to the lowest that still contains a few FFT bins
+    const double binWidth = double(samplingFrequency()) / windowSize;
+    const double nyquist = samplingFrequency() / 2.0;
+    periods.clear();
+    bandFirst.clear();
+    bandLast.clear();
+    for (double center = nyquist / M_SQRT2; center / M_SQRT2 >= 2*binWidth; center /= qPow(2, OCTAVE_STEP)) {
+        periods << 1 / center;
+        bandFirst << qCeil(center / M_SQRT2 / binWidth);
+        bandLast << qMin(fft->bins() - 1, qFloor(center * M_SQRT2 / binWidth));
+    }
+}
+
+void PpsdStage::reset() {
+    samples.fill(0);
+    position = 0;
+    sampleNumber = 0;
+    for (int i = 0; i < 2; ++i) {
+        segments[i].start = i * (segmentSamples / 2);
+        segments[i].time = 0;
+        segments[i].sum.fill(0);
+        segments[i].windows = 0;
+    }
+}
+
+void PpsdStage::process(const DataBlock & block) {
+    if (fft.isNull()) {
+        return;
+    }
+    const DataItem * items = block.data.constData();
+    for (int i = 0; i < block.size(); ++i) {
+        for (Segment & s: segments) {
+            if (sampleNumber == s.start) {
+                s.time = block.timestamps[i];
+            }
+        }
+        samples[position] = items[i].byChannel[channel_];
+        position = (position + 1) % windowSize;
+        ++sampleNumber;
+        if (sampleNumber >= windowSize && (sampleNumber - windowSize) % hop == 0) {
+            processWindow();
+        }
+        for (int s = 0; s < 2; ++s) {
+            if (sampleNumber == segments[s].start + segmentSamples) {
+                finishSegment(s);
+            }
+        }
+    }
+}
+
+void PpsdStage::processWindow() {
+    double mean = 0;
+    for (int i = 0; i < windowSize; ++i) {
+        segment[i] = samples[(position + i) % windowSize];
+        mean += segment[i];
+    }
+    mean /= windowSize;
+    for (int i = 0; i < windowSize; ++i) {
+        segment[i] = (segment[i] - mean) * taper[i];
+    }
+    fft->transform(segment.constData(), bins.data());
+    // The window is [sampleNumber - windowSize, sampleNumber): add it to segments that contain it
+    const qint64 windowStart = sampleNumber - windowSize;
+    for (Segment & s: segments) {
+        if (windowStart >= s.start && sampleNumber <= s.start + segmentSamples) {
+            for (int k = 0; k < bins.size(); ++k) {
+                s.sum[k] += std::norm(bins[k]);
+            }
+            ++s.windows;
+        }
+    }
+}
+
+void PpsdStage::finishSegment(int index) {
+    Segment & s = segments[index];
+    if (s.windows > 0 && ! isReplaying()) { // Segments of history were added by the run that received them
+        // One-sided density, averaged over windows and then over octave bands
+        const double factor = 2 * scale / s.windows;
+        QVector<double> db(periods.size());
+        for (int p = 0; p < periods.size(); ++p) {
+            double sum = 0;
+            for (int k = bandFirst[p]; k <= bandLast[p]; ++k) {
+                sum += s.sum[k];
+            }
+            const double density = sum * factor / (bandLast[p] - bandFirst[p] + 1);
+            db[p] = 10*log10(qMax(density, MIN_DENSITY));
+        }
+        histogram.add(s.time, db);
+        histogram.save(fileName());
+        emit segmentAdded(s.time, periods, db, histogram.segments());
+    }
+    // The next segment starts in the middle of the other one
+    s.start += segmentSamples;
+    s.sum.fill(0);
+    s.windows = 0;
+}
@@ -0,0 +1,96 @@
+#ifndef PPSDSTAGE_H
+#define PPSDSTAGE_H
+
+#include "stage.h"
+#include "realfft.h"
+#include "ppsdhistogram.h"
+
+#include <QScopedPointer>
+
+/*!
+ * \brief Long-term noise monitoring of one channel by probabilistic PSD
+ *
+ * Data are divided into segments of segmentSecs (one hour by default) that
+ * overlap by half. PSD of each segment is estimated by Welch's method from
+ * windows of about a quarter of segment (a power of 2) overlapping by 75%,
+ * then smoothed by averaging over full octaves at 1/8 octave steps,
+ * converted into dB and added to PpsdHistogram, which is saved after each segment.
+ *
+ * Windows are transformed as soon as they are complete, and their periodograms
+ * are summed into two running segments, so the stage keeps only one window
+ * of samples and two sums, and takes the same memory however long it runs.
+ * The stage should be run with idle thread priority (\see Stage::setThreadPriority),
+ * so that it uses only CPU time left by acquisition: its FFTs are large, but they
+ * are needed only once in a few minutes.
+ */
+class PpsdStage : public Stage
+{
+    Q_OBJECT
+public:
+    static const int DEFAULT_SEGMENT_SECS = 60*60;
+    static const QString DEFAULT_DIR;
+    static const QString FILE_SUFFIX;
+
+    /*!
+     * \param directory - where histogram is saved: <directory>/<channel number from 1><FILE_SUFFIX>.
+     *        An existing histogram there is continued if it was made with the same parameters.
+     */
+    PpsdStage(QString name, unsigned channel, QString directory, int segmentSecs = DEFAULT_SEGMENT_SECS, QObject *parent = nullptr);
+
+    QString fileName() const;
+
+signals:
+    /*!
+     * \brief PSD of a segment is added to histogram and saved
+     * \param start - time of the first sample of segment
+     * \param periods - centers of period bins, seconds
+     * \param db - smoothed PSD, dB relative to 1 (unit of data)^2/Hz
+     * \param segments - number of segments in histogram
+     */
+    void segmentAdded(TimeStampType start, QVector<double> periods, QVector<double> db, qint64 segments);
+
+protected:
+    void process(const DataBlock & block) override;
+    void frequencyChanged() override;
+    void reset() override;
+
+private:
+    void processWindow();
+    void finishSegment(int index);
+    void initBins();
+
+    const unsigned channel_;
+    const QString dir;
+    const int segmentSecs;
+
+    // Parameters for the current sampling frequency
+    qint64 segmentSamples;
+    int windowSize;
+    int hop;
+    QScopedPointer<RealFft> fft;
+    QVector<double> taper;
+    double scale;
+    // Octave bands: for each period, range of FFT bins averaged
+    QVector<double> periods;
+    QVector<int> bandFirst;
+    QVector<int> bandLast;
+
+    QVector<double> samples; // Ring of the latest window
+    int position;
+    qint64 sampleNumber;     // Since reset
+    QVector<double> segment;
+    QVector<RealFft::Complex> bins;
+
+    // Two segments overlapping by half: [start, start + segmentSamples)
+    struct Segment {
+        qint64 start;
+        TimeStampType time;
+        QVector<double> sum;
+        int windows;
+    };
+    Segment segments[2];
+
+    PpsdHistogram histogram;
+};
+
+#endif // PPSDSTAGE_H
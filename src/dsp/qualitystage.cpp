@@ -0,0 +1,219 @@
+#include "qualitystage.h"
+#include "../logger.h"
+
+#include <QDateTime>
+#include <QStringList>
+#include <qmath.h>
+#include <algorithm>
+#include <limits>
+
+namespace {
+    const double MAD_TO_SIGMA = 1.4826; // For normal distribution
+
+    QString timeToString(TimeStampType time) {
+        return QDateTime::fromMSecsSinceEpoch(qint64(time)).toString("yyyy-MM-dd hh:mm");
+    }
+}
+
+QualityStage::Parameters::Parameters() :
+    fullScale(std::numeric_limits<DataType>::max()), clipPercent(99.9), flatlineSecs(1),
+    spikeHalfWindow(5), spikeThreshold(8), spikeMinDeviation(16)
+{
+}
+
+void QualityStage::Metrics::clear(TimeStampType start, TimeStampType end) {
+    this->start = start;
+    this->end = end;
+    items = 0;
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        clipped[ch] = flatlines[ch] = flatItems[ch] = spikes[ch] = 0;
+    }
+    gaps = overlaps = 0;
+    gapMsecs = overlapMsecs = 0;
+}
+
+void QualityStage::Metrics::add(const Metrics & other) {
+    items += other.items;
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        clipped[ch]   += other.clipped[ch];
+        flatlines[ch] += other.flatlines[ch];
+        flatItems[ch] += other.flatItems[ch];
+        spikes[ch]    += other.spikes[ch];
+    }
+    gaps += other.gaps;
+    overlaps += other.overlaps;
+    gapMsecs += other.gapMsecs;
+    overlapMsecs += other.overlapMsecs;
+}
+
+bool QualityStage::Metrics::isClean() const {
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        if (clipped[ch] > 0 || flatlines[ch] > 0 || spikes[ch] > 0) {
+            return false;
+        }
+    }
+    return gaps == 0 && overlaps == 0;
+}
+
+QString QualityStage::Metrics::describe() const {
+    QStringList problems;
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        QStringList counts;
+        if (clipped[ch] > 0) {
+            counts << tr("%1 clipped").arg(clipped[ch]);
+        }
+        if (flatlines[ch] > 0) {
+            counts << tr("%1 flatline(s) of %2 samples").arg(flatlines[ch]).arg(flatItems[ch]);
+        }
+        if (spikes[ch] > 0) {
+            counts << tr("%1 spike(s)").arg(spikes[ch]);
+        }
+        if ( ! counts.isEmpty() ) {
+            problems << tr("channel %1: %2").arg(ch + 1).arg(counts.join(", "));
+        }
+    }
+    if (gaps > 0) {
+        problems << tr("%1 gap(s) of %2 ms").arg(gaps).arg(gapMsecs, 0, 'f', 0);
+    }
+    if (overlaps > 0) {
+        problems << tr("%1 overlap(s) of %2 ms").arg(overlaps).arg(overlapMsecs, 0, 'f', 0);
+    }
+    return problems.join("; ");
+}
+
+QualityStage::QualityStage(QString name, const Parameters & parameters, QObject *parent) :
+    Stage(name, parent), params(parameters), flatlineItems(2), period(0), started(false), lastTime(0),
+    windowPos(0), windowFill(0)
+{
+    params.spikeHalfWindow = qMax(1, params.spikeHalfWindow);
+    clipLevel = qMax(Q_INT64_C(1), qint64(params.fullScale * params.clipPercent / 100));
+    windowSize = 2*params.spikeHalfWindow + 1;
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        window[ch].resize(windowSize);
+    }
+    sorted.resize(windowSize);
+    reset();
+}
+
+void QualityStage::frequencyChanged() {
+    const int freq = samplingFrequency();
+    period = freq > 0 ? 1000.0 / freq : 0;
+    flatlineItems = qMax(Q_INT64_C(2), qint64(qRound64(params.flatlineSecs * freq)));
+    reset();
+}
+
+void QualityStage::reset() {
+    started = false;
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        lastValue[ch] = 0;
+        runLength[ch] = 0;
+    }
+    windowPos = 0;
+    windowFill = 0;
+}
+
+void QualityStage::startIntervals(TimeStampType time) {
+    const TimeStampType minuteStart = qFloor(time / MINUTE_MSECS) * TimeStampType(MINUTE_MSECS);
+    minute.clear(minuteStart, minuteStart + MINUTE_MSECS);
+    const TimeStampType hourStart = qFloor(time / HOUR_MSECS) * TimeStampType(HOUR_MSECS);
+    if ( ! started || time >= hour.end ) {
+        hour.clear(hourStart, hourStart + HOUR_MSECS);
+    }
+}
+
+void QualityStage::finishIntervals(TimeStampType time) {
+    emit minuteReady(minute);
+    if ( ! minute.isClean() && ! isReplaying() ) {
+        Logger::warning(tr("Data quality at %1: %2").arg(timeToString(minute.start), minute.describe()));
+    }
+    hour.add(minute);
+    if (time >= hour.end && ! isReplaying()) {
+        emit hourReady(hour);
+        Logger::info(tr("Data quality for the hour from %1: %2 samples, %3")
+                     .arg(timeToString(hour.start)).arg(hour.items)
+                     .arg(hour.isClean() ? tr("no problems") : hour.describe()));
+    }
+    startIntervals(time);
+}
+
+bool QualityStage::isSpike(unsigned ch) {
+    const QVector<DataType> & samples = window[ch];
+    const int half = params.spikeHalfWindow;
+    // The oldest sample is at windowPos, so the one in the middle of window is tested
+    const DataType centre = samples[(windowPos + half) % windowSize];
+    std::copy(samples.constBegin(), samples.constEnd(), sorted.begin());
+    std::nth_element(sorted.begin(), sorted.begin() + half, sorted.end());
+    const qint64 median = sorted[half];
+    const qint64 deviation = qAbs(centre - median);
+    if (deviation <= params.spikeMinDeviation) {
+        return false; // Most samples: no need for MAD
+    }
+    for (int i = 0; i < windowSize; ++i) {
+        sorted[i] = DataType(qMin<qint64>(qAbs(samples[i] - median), std::numeric_limits<DataType>::max()));
+    }
+    std::nth_element(sorted.begin(), sorted.begin() + half, sorted.end());
+    return deviation > params.spikeThreshold * MAD_TO_SIGMA * sorted[half];
+}
+
+void QualityStage::process(const DataBlock & block) {
+    if (period <= 0) {
+        return;
+    }
+    const int size = block.size();
+    const TimeStampType * times = block.timestamps.constData();
+    const DataItem * items = block.data.constData();
+    for (int i = 0; i < size; ++i) {
+        const TimeStampType time = times[i];
+        if ( ! started ) {
+            startIntervals(time);
+            started = true;
+            lastTime = time - period;
+            for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+                lastValue[ch] = items[i].byChannel[ch];
+            }
+        } else if (time >= minute.end) {
+            finishIntervals(time);
+        }
+
+        const double interval = time - lastTime;
+        if (interval > 1.5*period) {
+            ++minute.gaps;
+            minute.gapMsecs += interval - period;
+        } else if (interval < 0.5*period) {
+            ++minute.overlaps;
+            minute.overlapMsecs += period - interval;
+        }
+        lastTime = time;
+        ++minute.items;
+
+        for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+            const qint64 value = items[i].byChannel[ch];
+            if (value >= clipLevel || value <= -clipLevel) {
+                ++minute.clipped[ch];
+            }
+            if (value == lastValue[ch]) {
+                if (++runLength[ch] == flatlineItems) {
+                    ++minute.flatlines[ch];
+                    minute.flatItems[ch] += flatlineItems;
+                } else if (runLength[ch] > flatlineItems) {
+                    ++minute.flatItems[ch];
+                }
+            } else {
+                lastValue[ch] = DataType(value);
+                runLength[ch] = 1;
+            }
+            window[ch][windowPos] = DataType(value);
+        }
+        windowPos = (windowPos + 1) % windowSize;
+        if (windowFill < windowSize) {
+            ++windowFill;
+        }
+        if (windowFill == windowSize) {
+            for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+                if (isSpike(ch)) {
+                    ++minute.spikes[ch];
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,109 @@
+#ifndef QUALITYSTAGE_H
+#define QUALITYSTAGE_H
+
+#include "stage.h"
+
+/*!
+ * \brief Streaming data quality metrics: clipping, flatlines, spikes and timing
+ *
+ * For each channel, counts:
+ *  - clipped samples: not less than clipPercent of fullScale of ADC by absolute value;
+ *  - flatlines: runs of equal samples lasting at least flatlineSecs (a dead sensor
+ *    or a stuck ADC), and samples in them;
+ *  - spikes by Hampel test: a sample is a spike if it deviates from the median of
+ *    spikeHalfWindow samples on each side of it by more than spikeThreshold robust
+ *    standard deviations (1.4826 MAD of the same samples), and by more than
+ *    spikeMinDeviation (so that quantization of quiet data is not taken for spikes).
+ *    Samples are tested with the delay of spikeHalfWindow.
+ * For all channels together, counts gaps and overlaps in time stamps: intervals between
+ * successive items (also across blocks) longer or shorter than the sampling period
+ * by more than half of it.
+ *
+ * Counts are aggregated over minutes and hours aligned to the clock (by time stamps
+ * of data), reported by minuteReady and hourReady, and to Logger: a warning for each
+ * minute with problems, a summary for each hour. Memory is constant, and the cost
+ * per sample is a few comparisons, except for spike test: selection of median in a
+ * ring of 2*spikeHalfWindow + 1 samples (MAD is only needed for large deviations).
+ *
+ * Unfinished intervals are dropped on reset.
+ */
+class QualityStage : public Stage
+{
+    Q_OBJECT
+public:
+    struct Parameters {
+        DataType fullScale;     // Of ADC, counts
+        double clipPercent;
+        double flatlineSecs;
+        int spikeHalfWindow;    // Samples
+        double spikeThreshold;  // Robust standard deviations
+        DataType spikeMinDeviation;
+        /// Full scale of DataType, clipped above 99.9% of it, 1 s flatlines, spikes above 8 sigmas in 11 samples
+        Parameters();
+    };
+
+    /// Counts over an interval of time
+    struct Metrics {
+        TimeStampType start; // ms since Epoch
+        TimeStampType end;
+        qint64 items;
+        qint64 clipped[CHANNELS_NUM];
+        qint64 flatlines[CHANNELS_NUM];
+        qint64 flatItems[CHANNELS_NUM];
+        qint64 spikes[CHANNELS_NUM];
+        int gaps;
+        int overlaps;
+        double gapMsecs;     // Missing time in gaps
+        double overlapMsecs; // Time covered twice
+        Metrics() { clear(0, 0); }
+        void clear(TimeStampType start, TimeStampType end);
+        void add(const Metrics & other);
+        /// Whether there are no problems
+        bool isClean() const;
+        /// Problems in one line, e.g. for Logger; empty if clean
+        QString describe() const;
+    };
+
+    QualityStage(QString name, const Parameters & parameters = Parameters(), QObject *parent = nullptr);
+
+    const Parameters & parameters() const { return params; }
+
+signals:
+    void minuteReady(QualityStage::Metrics metrics);
+    void hourReady(QualityStage::Metrics metrics);
+
+protected:
+    void process(const DataBlock & block) override;
+    void frequencyChanged() override;
+    void reset() override;
+
+private:
+    static const int MINUTE_MSECS = 60*1000;
+    static const int HOUR_MSECS = 60*60*1000;
+
+    void startIntervals(TimeStampType time);
+    void finishIntervals(TimeStampType time);
+    bool isSpike(unsigned ch);
+
+    Parameters params;
+    qint64 clipLevel;
+    qint64 flatlineItems; // Minimal length of flatline
+    double period;        // ms, 0 if frequency is not known
+
+    Metrics minute;
+    Metrics hour;
+    bool started;
+    TimeStampType lastTime;
+
+    DataType lastValue[CHANNELS_NUM];
+    qint64 runLength[CHANNELS_NUM]; // Of equal values, ending with lastValue
+
+    // Spike test: the latest 2*spikeHalfWindow + 1 samples, a ring
+    int windowSize;
+    QVector<DataType> window[CHANNELS_NUM];
+    int windowPos;     // Where the next sample goes
+    qint64 windowFill; // Samples since reset, up to windowSize
+    QVector<DataType> sorted; // Scratch for selection of median
+};
+
+#endif // QUALITYSTAGE_H
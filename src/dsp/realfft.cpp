@@ -0,0 +1,86 @@
+#include "realfft.h"
+#include <qmath.h>
+
+RealFft::RealFft(int size) :
+    n(4)
+{
+    while (n < size) {
+        n *= 2;
+    }
+    const int m = n/2;
+    twiddles.resize(m/2);
+    for (int j = 0; j < m/2; ++j) {
+        twiddles[j] = std::polar(1.0, -2*M_PI*j/m);
+    }
+    split.resize(m + 1);
+    for (int k = 0; k <= m; ++k) {
+        split[k] = std::polar(1.0, -2*M_PI*k/n);
+    }
+    reversed.resize(m);
+    int bits = 0;
+    while ((1 << bits) < m) {
+        ++bits;
+    }
+    for (int j = 0; j < m; ++j) {
+        int r = 0;
+        for (int b = 0; b < bits; ++b) {
+            r |= ((j >> b) & 1) << (bits - 1 - b);
+        }
+        reversed[j] = r;
+    }
+    work.resize(m);
+}
+
+void RealFft::transform(const double * in, Complex * out) const {
+    const int m = n/2;
+    Complex * z = work.data();
+    for (int j = 0; j < m; ++j) {
+        z[reversed[j]] = Complex(in[2*j], in[2*j + 1]);
+    }
+    butterflies(false);
+    // Separate transforms of even and odd samples, and combine them
+    for (int k = 0; k <= m; ++k) {
+        const Complex a = z[k % m];
+        const Complex b = std::conj(z[(m - k) % m]);
+        const Complex even = (a + b) * 0.5;
+        const Complex odd = (a - b) * Complex(0, -0.5);
+        out[k] = even + split[k] * odd;
+    }
+}
+
+void RealFft::inverse(const Complex * in, double * out) const {
+    const int m = n/2;
+    Complex * z = work.data();
+    // Transforms of even and odd samples, from X[k] = E[k] + W^k*O[k] and X[k + N/2] = conj(X[N/2 - k])
+    for (int k = 0; k < m; ++k) {
+        const Complex a = in[k];
+        const Complex b = std::conj(in[m - k]);
+        const Complex even = (a + b) * 0.5;
+        const Complex odd = (a - b) * 0.5 * std::conj(split[k]);
+        z[reversed[k]] = even + Complex(0, 1) * odd;
+    }
+    butterflies(true);
+    const double scale = 1.0 / m;
+    for (int j = 0; j < m; ++j) {
+        out[2*j] = z[j].real() * scale;
+        out[2*j + 1] = z[j].imag() * scale;
+    }
+}
+
+void RealFft::butterflies(bool inverse) const {
+    // Iterative radix-2 transform of size m; the inverse one with conjugate twiddles
+    const int m = n/2;
+    Complex * z = work.data();
+    for (int len = 2; len <= m; len *= 2) {
+        const int half = len/2;
+        const int step = m/len;
+        for (int start = 0; start < m; start += len) {
+            for (int j = 0; j < half; ++j) {
+                const Complex w = inverse ? std::conj(twiddles[j*step]) : twiddles[j*step];
+                const Complex t = w * z[start + j + half];
+                z[start + j + half] = z[start + j] - t;
+                z[start + j] += t;
+            }
+        }
+    }
+}
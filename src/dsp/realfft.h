@@ -0,0 +1,54 @@
+#ifndef REALFFT_H
+#define REALFFT_H
+
+#include <QVector>
+#include <complex>
+
+/*!
+ * \brief Fast Fourier transform of real signal of fixed size (a power of 2)
+ *
+ * All tables (twiddle factors, bit-reversed order) and the work buffer are
+ * computed when the object is created, so that transform does no allocations.
+ * A real signal of size N is transformed as a complex one of size N/2
+ * (even samples as real parts, odd as imaginary), then the halves are separated.
+ *
+ * Not thread-safe: use one object per thread (e.g. per Stage).
+ */
+class RealFft
+{
+public:
+    typedef std::complex<double> Complex;
+
+    /// \a size is rounded up to a power of 2, at least 4
+    explicit RealFft(int size);
+
+    int size() const { return n; }
+    /// Number of output bins: from 0 to Nyquist frequency inclusive
+    int bins() const { return n/2 + 1; }
+
+    /*!
+     * \brief Computes X[k] = sum of in[j]*exp(-2*pi*i*j*k/N) for k in [0, N/2]
+     * \param in - size() samples
+     * \param out - bins() values
+     */
+    void transform(const double * in, Complex * out) const;
+
+    /*!
+     * \brief Inverse of transform: x[j] = sum of in[k]*exp(2*pi*i*j*k/N) over all N bins, divided by N
+     * \param in - bins() values of a real signal: the first and the last ones are real
+     * \param out - size() samples
+     */
+    void inverse(const Complex * in, double * out) const;
+
+private:
+    /// Complex transform of size N/2 of work in bit-reversed order, in place
+    void butterflies(bool inverse) const;
+
+    int n;
+    QVector<Complex> twiddles; // exp(-2*pi*i*j/(N/2)), j < N/4, for complex transform of size N/2
+    QVector<Complex> split;    // exp(-2*pi*i*k/N), k <= N/2, for separating the halves
+    QVector<int> reversed;     // Bit-reversed indices for size N/2
+    mutable QVector<Complex> work;
+};
+
+#endif // REALFFT_H
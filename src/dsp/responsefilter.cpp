@@ -0,0 +1,214 @@
+#include "responsefilter.h"
+#include "../logger.h"
+
+#include <qmath.h>
+#include <algorithm>
+
+namespace {
+    const double ROOT_EPSILON = 1e-9; // rad/s: roots closer to zero, or to real axis, are there
+    const double ADDED_POLES_NYQUISTS = 0.8;
+
+    bool isOrigin(const ResponseFilter::Root & root) {
+        return std::abs(root) < ROOT_EPSILON;
+    }
+
+    bool isReal(const ResponseFilter::Root & root) {
+        return qAbs(root.imag()) < ROOT_EPSILON * qMax(1.0, std::abs(root));
+    }
+
+    /// Whether each complex root has its conjugate
+    bool hasConjugates(const QVector<ResponseFilter::Root> & roots) {
+        int upper = 0, lower = 0;
+        for (const ResponseFilter::Root & root: roots) {
+            if ( ! isReal(root) ) {
+                ++(root.imag() > 0 ? upper : lower);
+            }
+        }
+        return upper == lower;
+    }
+
+    /// Removes the same number of roots at zero from both, returns the number left in \a den
+    int cancelOrigins(QVector<ResponseFilter::Root> & num, QVector<ResponseFilter::Root> & den) {
+        int numOrigins = 0, denOrigins = 0;
+        for (const ResponseFilter::Root & root: num) {
+            numOrigins += isOrigin(root);
+        }
+        for (const ResponseFilter::Root & root: den) {
+            denOrigins += isOrigin(root);
+        }
+        for (int n = qMin(numOrigins, denOrigins); n > 0; --n) {
+            num.erase(std::find_if(num.begin(), num.end(), isOrigin));
+            den.erase(std::find_if(den.begin(), den.end(), isOrigin));
+        }
+        return qMax(0, denOrigins - numOrigins);
+    }
+
+    /// 1 + c1*z^-1 + c2*z^-2
+    struct Quadratic {
+        double c1, c2;
+    };
+
+    /// Joins conjugate roots in z plane, and real ones by two, into quadratic factors
+    QVector<Quadratic> toQuadratics(const QVector<ResponseFilter::Root> & roots) {
+        QVector<Quadratic> res;
+        QVector<double> reals;
+        for (const ResponseFilter::Root & root: roots) {
+            if (isReal(root)) {
+                reals << root.real();
+            } else if (root.imag() > 0) {
+                res << Quadratic{-2*root.real(), std::norm(root)};
+            }
+        }
+        for (int i = 0; i < reals.size(); i += 2) {
+            if (i + 1 < reals.size()) {
+                res << Quadratic{-(reals[i] + reals[i + 1]), reals[i]*reals[i + 1]};
+            } else {
+                res << Quadratic{-reals[i], 0};
+            }
+        }
+        return res;
+    }
+}
+
+const double ResponseFilter::UNITS_PER_METRE = 1e9;
+
+ResponseFilter::Parameters::Parameters() :
+    sensitivity(1e9), referenceFreq(1),
+    sensorQuantity(Velocity), outputQuantity(Velocity), highPassFreq(0.1)
+{
+    const double natural = 2*M_PI * 1.0;
+    const double damping = 0.707;
+    const double imag = natural * qSqrt(1 - damping*damping);
+    poles << Root(-damping*natural, imag) << Root(-damping*natural, -imag);
+    zeros << Root(0, 0) << Root(0, 0);
+}
+
+ResponseFilter::ResponseFilter(const Parameters & parameters) :
+    params(parameters), samplingFreq(0)
+{
+}
+
+QString ResponseFilter::unitName(Quantity quantity) {
+    switch (quantity) {
+    case Displacement: return "nm";
+    case Velocity:     return "nm/s";
+    case Acceleration: return "nm/s^2";
+    }
+    return QString();
+}
+
+bool ResponseFilter::design(int samplingFreq) {
+    this->samplingFreq = samplingFreq;
+    cascade.setSections(QVector<BiquadCascade::Section>());
+    if (samplingFreq <= 0) {
+        return true;
+    }
+    const double nyquist = samplingFreq / 2.0;
+    bool stable = true;
+    for (const Root & root: params.zeros + params.poles) {
+        stable = stable && root.real() <= 0;
+    }
+    if ( ! stable || ! hasConjugates(params.zeros) || ! hasConjugates(params.poles) ) {
+        Logger::warning(tr("Instrument response can't be corrected: its poles and zeros must be "
+                           "in the left half-plane, and in conjugate pairs"));
+        return false;
+    }
+    if ( params.sensitivity <= 0 || params.referenceFreq <= 0 || params.referenceFreq >= nyquist
+         || params.highPassFreq < 0 || params.highPassFreq >= nyquist ) {
+        Logger::warning(tr("Instrument response can't be corrected: sensitivity %1 at %2 Hz, "
+                           "or high-pass at %3 Hz, don't fit sampling frequency %4 Hz")
+                        .arg(params.sensitivity).arg(params.referenceFreq)
+                        .arg(params.highPassFreq).arg(samplingFreq));
+        return false;
+    }
+
+    // Inverse of the sensor: its poles are zeros of the correction and vice versa
+    QVector<Root> num = params.poles;
+    QVector<Root> den = params.zeros;
+    const Root reference(0, 2*M_PI * params.referenceFreq);
+    Root sensorGain = 1;
+    for (const Root & zero: params.zeros) {
+        sensorGain *= reference - zero;
+    }
+    for (const Root & pole: params.poles) {
+        sensorGain /= reference - pole;
+    }
+    double gain = UNITS_PER_METRE * std::abs(sensorGain) / params.sensitivity;
+
+    // Differentiation adds a zero at zero, integration - a pole
+    const int derivatives = int(params.outputQuantity) - int(params.sensorQuantity);
+    for (int i = 0; i < qAbs(derivatives); ++i) {
+        (derivatives > 0 ? num : den) << Root(0, 0);
+    }
+
+    const int integrators = cancelOrigins(num, den);
+    if (integrators > 0 && params.highPassFreq == 0) {
+        Logger::warning(tr("Instrument response can't be corrected to %1 without a high-pass filter")
+                        .arg(unitName()));
+        return false;
+    }
+    if (params.highPassFreq > 0) {
+        // s^n / Butterworth poles: unit gain at high frequencies, prewarped cutoff
+        const int order = integrators + 1;
+        const double cutoff = 2*samplingFreq * qTan(M_PI*params.highPassFreq / samplingFreq);
+        for (int k = 0; k < order; ++k) {
+            num << Root(0, 0);
+            den << std::polar(cutoff, M_PI * (2*k + order + 1) / (2*order));
+        }
+        cancelOrigins(num, den);
+    }
+    if (num.size() > den.size()) {
+        // Low-pass poles with unit gain at zero frequency
+        const double cutoff = 2*samplingFreq * qTan(M_PI*ADDED_POLES_NYQUISTS*nyquist / samplingFreq);
+        while (num.size() > den.size()) {
+            den << Root(-cutoff, 0);
+            gain *= cutoff;
+        }
+    }
+
+    if ( ! makeSections(num, den, gain) ) {
+        Logger::warning(tr("Instrument response can't be corrected: the inverse is unstable "
+                           "at sampling frequency %1 Hz").arg(samplingFreq));
+        return false;
+    }
+    return true;
+}
+
+bool ResponseFilter::makeSections(const QVector<Root> & zeros, const QVector<Root> & poles, double gain) {
+    // Bilinear transform: s - r = (2fs - r) * (1 - zr*z^-1) / (1 + z^-1), zr = (2fs + r) / (2fs - r)
+    const double twoFs = 2.0 * samplingFreq;
+    Root digitalGain = gain;
+    QVector<Root> digitalZeros, digitalPoles;
+    for (const Root & zero: zeros) {
+        digitalGain *= twoFs - zero;
+        digitalZeros << (twoFs + zero) / (twoFs - zero);
+    }
+    for (const Root & pole: poles) {
+        digitalGain /= twoFs - pole;
+        digitalPoles << (twoFs + pole) / (twoFs - pole);
+        if (std::abs(digitalPoles.last()) >= 1) {
+            return false;
+        }
+    }
+    for (int i = zeros.size(); i < poles.size(); ++i) {
+        digitalZeros << Root(-1, 0);
+    }
+
+    const QVector<Quadratic> numQuads = toQuadratics(digitalZeros);
+    const QVector<Quadratic> denQuads = toQuadratics(digitalPoles);
+    QVector<BiquadCascade::Section> sections(qMax(1, qMax(numQuads.size(), denQuads.size())));
+    for (int i = 0; i < sections.size(); ++i) {
+        BiquadCascade::Section & s = sections[i];
+        const Quadratic num = i < numQuads.size() ? numQuads[i] : Quadratic{0, 0};
+        const Quadratic den = i < denQuads.size() ? denQuads[i] : Quadratic{0, 0};
+        // The whole gain goes to the first section
+        const double b0 = (i == 0 ? digitalGain.real() : 1);
+        s.b0 = b0;
+        s.b1 = b0 * num.c1;
+        s.b2 = b0 * num.c2;
+        s.a1 = den.c1;
+        s.a2 = den.c2;
+    }
+    cascade.setSections(sections);
+    return true;
+}
@@ -0,0 +1,97 @@
+#ifndef RESPONSEFILTER_H
+#define RESPONSEFILTER_H
+
+#include "biquadcascade.h"
+
+#include <QVector>
+#include <QCoreApplication>
+#include <complex>
+
+/*!
+ * \brief Correction of instrument response: converts counts to physical units
+ *
+ * The instrument (sensor and digitizer) is described by poles and zeros of the
+ * sensor in rad/s and by the total sensitivity: counts per unit of the sensed
+ * quantity (m/s for a velocity sensor) at referenceFreq, where the poles and zeros
+ * are normalized to gain 1. The correction is the inverse of that response, with
+ * integrations or differentiations to outputQuantity, scaled to nanometres.
+ *
+ * Inversion amplifies low frequencies without bound where the sensor response
+ * falls off (e.g. below the natural frequency of a geophone), and integration
+ * turns any offset into a drift, so a Butterworth high-pass at highPassFreq is
+ * added, of an order one higher than the number of poles at zero left by the
+ * inversion and integrations: output stays flat above highPassFreq and falls
+ * off below it. If the correction has more zeros than poles, poles at 0.8 of
+ * Nyquist frequency are added, for it to be realizable.
+ *
+ * The analog correction is converted by bilinear transform (the high-pass and
+ * the added poles are prewarped) and run as BiquadCascade, so it's as cheap
+ * as a Butterworth filter of the same order.
+ */
+class ResponseFilter
+{
+    Q_DECLARE_TR_FUNCTIONS(ResponseFilter)
+public:
+    typedef std::complex<double> Root;
+
+    /// Physical quantity: each next one is the derivative of the previous one
+    enum Quantity {
+        Displacement,
+        Velocity,
+        Acceleration
+    };
+
+    struct Parameters {
+        QVector<Root> zeros;   // Of the sensor, rad/s
+        QVector<Root> poles;   // Of the sensor, rad/s: conjugate pairs must be complete
+        double sensitivity;    // Counts per m (m/s, m/s^2) of sensorQuantity at referenceFreq
+        double referenceFreq;  // Hz
+        Quantity sensorQuantity;
+        Quantity outputQuantity;
+        double highPassFreq;   // Hz, 0 - none, if there is nothing to stabilize
+        /// 1 Hz geophone with damping 0.707, 1e9 counts per m/s, velocity output above 0.1 Hz
+        Parameters();
+    };
+
+    /// Output units per metre: output is in integer nanometres (per second...)
+    static const double UNITS_PER_METRE;
+
+    explicit ResponseFilter(const Parameters & parameters = Parameters());
+
+    const Parameters & parameters() const { return params; }
+
+    /// Units of output, e.g. "nm/s"
+    QString unitName() const { return unitName(params.outputQuantity); }
+    static QString unitName(Quantity quantity);
+
+    /*!
+     * \brief Computes coefficients for \a samplingFreq (Hz) and resets the state
+     * \return false if the response can't be corrected (reported to Logger):
+     *         then the filter passes data unchanged
+     */
+    bool design(int samplingFreq);
+
+    /// Whether the filter changes data: designed successfully
+    bool isActive() const { return ! cascade.isEmpty(); }
+    int sectionsCount() const { return cascade.sections().size(); }
+
+    /// Starts a new series: the next sample initializes the state
+    void reset() { cascade.reset(); }
+
+    /// Converts \a block in place, continuing from the previous one
+    void filter(DataBlock & block) { cascade.filter(block); }
+
+    /*!
+     * \brief Gain of the correction at \a freq (Hz): output units per count
+     */
+    double gain(double freq) const { return std::abs(cascade.response(freq, samplingFreq)); }
+
+private:
+    bool makeSections(const QVector<Root> & zeros, const QVector<Root> & poles, double gain);
+
+    Parameters params;
+    int samplingFreq;
+    BiquadCascade cascade;
+};
+
+#endif // RESPONSEFILTER_H
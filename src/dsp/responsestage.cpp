@@ -0,0 +1,20 @@
+#include "responsestage.h"
+
+ResponseStage::ResponseStage(QString name, const ResponseFilter::Parameters & parameters, QObject *parent) :
+    Stage(name, parent), filter(parameters)
+{
+}
+
+void ResponseStage::process(const DataBlock & block) {
+    DataBlock out = block;
+    filter.filter(out);
+    output(out);
+}
+
+void ResponseStage::frequencyChanged() {
+    filter.design(samplingFrequency());
+}
+
+void ResponseStage::reset() {
+    filter.reset();
+}
@@ -0,0 +1,33 @@
+#ifndef RESPONSESTAGE_H
+#define RESPONSESTAGE_H
+
+#include "stage.h"
+#include "responsefilter.h"
+
+/*!
+ * \brief Converts data of all channels from counts to physical units by ResponseFilter
+ *
+ * Put it first in StageGraph, before FilterStage and the stages that should see
+ * corrected data. The correction is designed anew when the sampling frequency
+ * changes; until then, and if it cannot be designed, data pass unchanged.
+ */
+class ResponseStage : public Stage
+{
+    Q_OBJECT
+public:
+    ResponseStage(QString name, const ResponseFilter::Parameters & parameters, QObject *parent = nullptr);
+
+    const ResponseFilter::Parameters & parameters() const { return filter.parameters(); }
+    /// Whether data are converted: false until designed, or if design failed
+    bool isActive() const { return filter.isActive(); }
+
+protected:
+    void process(const DataBlock & block) override;
+    void frequencyChanged() override;
+    void reset() override;
+
+private:
+    ResponseFilter filter;
+};
+
+#endif // RESPONSESTAGE_H
@@ -0,0 +1,32 @@
+#ifndef SINKSTAGE_H
+#define SINKSTAGE_H
+
+#include "stage.h"
+
+/*!
+ * \brief The end of a branch of StageGraph: passes its input out of the graph
+ *
+ * Connect blockReady to a receiver, e.g. a plot or a writer, the same way
+ * as Worker::dataUpdated: the signal is queued into the thread of receiver.
+ */
+class SinkStage : public Stage
+{
+    Q_OBJECT
+public:
+    explicit SinkStage(QString name, QObject *parent = nullptr) : Stage(name, parent) {}
+
+signals:
+    void blockReady(TimeStampsVector t, DataVector d);
+    /// Sampling frequency of blocks changed
+    void frequencyReady(int samplingFreq);
+
+protected:
+    void process(const DataBlock & block) override {
+        emit blockReady(block.timestamps, block.data);
+    }
+    void frequencyChanged() override {
+        emit frequencyReady(samplingFrequency());
+    }
+};
+
+#endif // SINKSTAGE_H
@@ -0,0 +1,118 @@
+#include "slidingstats.h"
+
+#include <qmath.h>
+#include <functional>
+
+SlidingStats::SlidingStats(int window) :
+    window_(1), total(0)
+{
+    setWindow(window);
+}
+
+void SlidingStats::setWindow(int items) {
+    window_ = qMax(1, items);
+    ring.resize(window_);
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        for (Queue * queue: {&maxima[ch], &minima[ch]}) {
+            queue->numbers.resize(window_);
+            queue->values.resize(window_);
+        }
+    }
+    reset();
+}
+
+void SlidingStats::reset() {
+    total = 0;
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        resetQueue(maxima[ch]);
+        resetQueue(minima[ch]);
+        mean[ch] = m2[ch] = 0;
+    }
+}
+
+void SlidingStats::resetQueue(Queue & queue) {
+    queue.front = 0;
+    queue.size = 0;
+}
+
+template <class Compare>
+void SlidingStats::push(Queue & queue, qint64 number, DataType value, Compare keeps) {
+    // Values at the back that are superseded by the new one can't be extremes anymore
+    while (queue.size > 0 && ! keeps(queue.values[(queue.front + queue.size - 1) % window_], value)) {
+        --queue.size;
+    }
+    // Numbers grow by one, so at most one item leaves the window
+    if (queue.size > 0 && queue.numbers[queue.front] <= number - window_) {
+        queue.front = (queue.front + 1) % window_;
+        --queue.size;
+    }
+    const int back = (queue.front + queue.size) % window_;
+    queue.numbers[back] = number;
+    queue.values[back] = value;
+    ++queue.size;
+}
+
+void SlidingStats::add(const DataItem * items, int count) {
+    for (int i = 0; i < count; ++i) {
+        const qint64 number = total++;
+        DataItem & slot = ring[int(number % window_)];
+        const DataItem & item = items[i];
+        if (number >= window_) {
+            // The new item replaces the oldest one in the window
+            for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+                const double value = item.byChannel[ch];
+                const double old = slot.byChannel[ch];
+                const double oldMean = mean[ch];
+                mean[ch] += (value - old) / window_;
+                m2[ch] += (value - old) * (value - mean[ch] + old - oldMean);
+            }
+        } else {
+            for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+                const double value = item.byChannel[ch];
+                const double delta = value - mean[ch];
+                mean[ch] += delta / (number + 1);
+                m2[ch] += delta * (value - mean[ch]);
+            }
+        }
+        for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+            push(maxima[ch], number, item.byChannel[ch], std::greater<DataType>());
+            push(minima[ch], number, item.byChannel[ch], std::less<DataType>());
+        }
+        slot = item;
+        if (total % window_ == 0) {
+            recompute();
+        }
+    }
+}
+
+void SlidingStats::recompute() {
+    const int count = size();
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        double sum = 0;
+        for (int i = 0; i < count; ++i) {
+            sum += ring[i].byChannel[ch];
+        }
+        mean[ch] = sum / count;
+        double squares = 0;
+        for (int i = 0; i < count; ++i) {
+            const double deviation = ring[i].byChannel[ch] - mean[ch];
+            squares += deviation * deviation;
+        }
+        m2[ch] = squares;
+    }
+}
+
+SlidingStats::Values SlidingStats::values(unsigned ch) const {
+    Values res;
+    res.count = size();
+    if (res.count == 0) {
+        return res;
+    }
+    res.min = minima[ch].values[minima[ch].front];
+    res.max = maxima[ch].values[maxima[ch].front];
+    res.mean = mean[ch];
+    const double variance = qMax(0.0, m2[ch] / res.count);
+    res.stdDev = qSqrt(variance);
+    res.rms = qSqrt(res.mean * res.mean + variance);
+    return res;
+}
@@ -0,0 +1,80 @@
+#ifndef SLIDINGSTATS_H
+#define SLIDINGSTATS_H
+
+#include "../protocol.h"
+
+#include <QVector>
+
+/*!
+ * \brief Statistics of all channels over a sliding window of the latest items
+ *
+ * Items are added in one pass over all channels, each costs O(1) amortized
+ * regardless of the window:
+ *  - minimum and maximum are at the fronts of monotonic queues: an item is pushed
+ *    to the back after popping items that can never be extremes again (not greater,
+ *    or not less, than it), and popped from the front when it leaves the window;
+ *  - mean and variance (thus RMS and standard deviation) are updated by Welford's
+ *    method: incrementally for the item that enters the window and for the one
+ *    that leaves it. Rounding errors of these updates would accumulate over days
+ *    of data, so once per window length they are recomputed from the window.
+ *
+ * Values of the window are kept in a ring, so memory is O(window), allocated
+ * by setWindow, and nothing is allocated per item.
+ */
+class SlidingStats
+{
+public:
+    /// Statistics of one channel
+    struct Values {
+        DataType min;
+        DataType max;
+        double mean;
+        double rms;
+        double stdDev; // Of population, i.e. divided by count
+        int count;     // Items in window: less than window until it is filled
+        DataType peakToPeak() const { return max - min; }
+        Values() : min(0), max(0), mean(0), rms(0), stdDev(0), count(0) {}
+    };
+
+    explicit SlidingStats(int window = 1);
+
+    int window() const { return window_; }
+
+    /// Sets the number of items in window, and resets
+    void setWindow(int items);
+
+    /// Forgets all items
+    void reset();
+
+    void add(const DataItem * items, int count);
+    void add(const DataVector & items) { add(items.constData(), items.size()); }
+
+    /// Number of items in window
+    int size() const { return int(qMin<qint64>(total, window_)); }
+
+    Values values(unsigned ch) const;
+
+private:
+    // Ring of (number, value) pairs, from the oldest to the newest one
+    struct Queue {
+        QVector<qint64> numbers;
+        QVector<DataType> values;
+        int front;
+        int size;
+    };
+
+    void resetQueue(Queue & queue);
+    template <class Compare>
+    void push(Queue & queue, qint64 number, DataType value, Compare keeps);
+    void recompute();
+
+    int window_;
+    qint64 total;            // Items added since reset: number of the next item
+    QVector<DataItem> ring;  // The last window_ items, item number n at n % window_
+    Queue maxima[CHANNELS_NUM]; // Decreasing values
+    Queue minima[CHANNELS_NUM]; // Increasing values
+    double mean[CHANNELS_NUM];
+    double m2[CHANNELS_NUM];    // Sum of squared deviations from mean
+};
+
+#endif // SLIDINGSTATS_H
@@ -0,0 +1,100 @@
+#include "spectrumstage.h"
+#include <qmath.h>
+
+SpectrumStage::Parameters::Parameters() :
+    windowSize(256), overlapPercent(50), averaging(4)
+{}
+
+SpectrumStage::SpectrumStage(QString name, unsigned channel, const Parameters & parameters, QObject *parent) :
+    Stage(name, parent), channel_(channel), params(parameters), fft(parameters.windowSize), scale(0)
+{
+    params.windowSize = fft.size(); // Rounded to a power of 2
+    params.overlapPercent = qBound(0, params.overlapPercent, 95);
+    params.averaging = qMax(1, params.averaging);
+    hopSize = qMax(1, params.windowSize*(100 - params.overlapPercent)/100);
+
+    const int n = params.windowSize;
+    window.resize(n);
+    double windowPower = 0;
+    for (int i = 0; i < n; ++i) {
+        window[i] = 0.5*(1 - qCos(2*M_PI*i/n)); // Hann (periodic)
+        windowPower += window[i]*window[i];
+    }
+    samples.resize(n);
+    segment.resize(n);
+    bins.resize(fft.bins());
+    sum.resize(fft.bins());
+    periodograms.resize(params.averaging);
+    for (QVector<double> & periodogram: periodograms) {
+        periodogram.resize(fft.bins());
+    }
+    // Scale for sampling frequency 1 Hz: divided by the frequency when it is known
+    scale = 1 / windowPower;
+    reset();
+}
+
+void SpectrumStage::frequencyChanged() {
+    reset();
+}
+
+void SpectrumStage::reset() {
+    samples.fill(0);
+    position = 0;
+    untilSegment = params.windowSize;
+    sum.fill(0);
+    for (QVector<double> & periodogram: periodograms) {
+        periodogram.fill(0);
+    }
+    periodogramsCount = 0;
+    nextPeriodogram = 0;
+}
+
+void SpectrumStage::process(const DataBlock & block) {
+    if (samplingFrequency() <= 0) {
+        return;
+    }
+    const int n = params.windowSize;
+    const DataItem * items = block.data.constData();
+    for (int i = 0; i < block.size(); ++i) {
+        samples[position] = items[i].byChannel[channel_];
+        position = (position + 1) % n;
+        if (--untilSegment == 0) {
+            processSegment(block.timestamps[i]);
+            untilSegment = hopSize;
+        }
+    }
+}
+
+void SpectrumStage::processSegment(TimeStampType time) {
+    const int n = params.windowSize;
+    // Unroll the ring, oldest sample first, and remove the mean
+    double mean = 0;
+    for (int i = 0; i < n; ++i) {
+        segment[i] = samples[(position + i) % n];
+        mean += segment[i];
+    }
+    mean /= n;
+    for (int i = 0; i < n; ++i) {
+        segment[i] = (segment[i] - mean) * window[i];
+    }
+    fft.transform(segment.constData(), bins.data());
+
+    // Replace the oldest periodogram in running sum with the new one
+    QVector<double> & periodogram = periodograms[nextPeriodogram];
+    const double density = scale / samplingFrequency();
+    const int last = bins.size() - 1;
+    for (int k = 0; k <= last; ++k) {
+        // One-sided: double all except DC and Nyquist
+        const double value = std::norm(bins[k]) * density * ((k == 0 || k == last) ? 1 : 2);
+        sum[k] += value - periodogram[k];
+        periodogram[k] = value;
+    }
+    nextPeriodogram = (nextPeriodogram + 1) % params.averaging;
+    periodogramsCount = qMin(periodogramsCount + 1, params.averaging);
+
+    QVector<double> psd(sum.size());
+    for (int k = 0; k < sum.size(); ++k) {
+        psd[k] = qMax(0.0, sum[k]) / periodogramsCount; // Rounding errors of running sum can make it negative
+    }
+    emit spectrumReady(time, double(samplingFrequency()) / n, psd);
+}
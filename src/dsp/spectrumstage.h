@@ -0,0 +1,78 @@
+#ifndef SPECTRUMSTAGE_H
+#define SPECTRUMSTAGE_H
+
+#include "stage.h"
+#include "realfft.h"
+
+/*!
+ * \brief Streaming power spectral density of one channel by Welch's method
+ *
+ * Samples of \a channel are collected into overlapping segments of windowSize
+ * samples, every hop = windowSize*(100 - overlapPercent)/100 samples a new segment
+ * is complete. Each segment is detrended (its mean is removed), multiplied
+ * by Hann window and transformed (\see RealFft), and its periodogram is averaged
+ * with the ones of the previous averaging - 1 segments. The average is kept
+ * as a running sum, so each segment costs one FFT and O(windowSize) more work.
+ *
+ * All buffers are allocated when the sampling frequency is set, not per segment.
+ *
+ * The stage doesn't pass data further: its results are spectrumReady signals.
+ */
+class SpectrumStage : public Stage
+{
+    Q_OBJECT
+public:
+    struct Parameters {
+        int windowSize;     // Samples, a power of 2
+        int overlapPercent;
+        int averaging;      // Number of segments
+        /// 256 samples with half overlap, 4 segments averaged
+        Parameters();
+    };
+
+    SpectrumStage(QString name, unsigned channel, const Parameters & parameters, QObject *parent = nullptr);
+
+    unsigned channel() const { return channel_; }
+    const Parameters & parameters() const { return params; }
+
+    /// Number of samples between spectra
+    int hop() const { return hopSize; }
+
+signals:
+    /*!
+     * \brief New estimate of spectrum is ready
+     * \param time - time of the last sample of the latest segment
+     * \param binWidth - frequency step of \a psd, Hz
+     * \param psd - one-sided power spectral density, (units of data)^2/Hz,
+     *        from 0 to Nyquist frequency (windowSize/2 + 1 values)
+     */
+    void spectrumReady(TimeStampType time, double binWidth, QVector<double> psd);
+
+protected:
+    void process(const DataBlock & block) override;
+    void frequencyChanged() override;
+    void reset() override;
+
+private:
+    void processSegment(TimeStampType time);
+
+    const unsigned channel_;
+    Parameters params;
+    int hopSize;
+    RealFft fft;
+    QVector<double> window;
+    double scale;            // Of periodogram: one-sided density with this window
+
+    QVector<double> samples; // Ring of the latest windowSize samples
+    int position;            // Where the next sample goes
+    int untilSegment;        // Samples until the next segment is complete
+
+    QVector<double> segment;
+    QVector<RealFft::Complex> bins;
+    QVector< QVector<double> > periodograms; // The latest `averaging` ones, a ring
+    int periodogramsCount;
+    int nextPeriodogram;
+    QVector<double> sum;     // Of periodograms in ring
+};
+
+#endif // SPECTRUMSTAGE_H
@@ -0,0 +1,18 @@
+#include "stage.h"
+#include "stagegraph.h"
+
+Stage::Stage(QString name, QObject *parent) :
+    QObject(parent), graph(NULL), samplingFreq(0),
+    perf(tr("Stage %1").arg(name)), dataMsecs(0), threadPriority(QThread::NormalPriority), replaying(false), scheduled(false), queueLimit(0), dropped(0)
+{
+    setObjectName(name);
+}
+
+void Stage::output(const DataBlock & block) {
+    if (block.size() == 0) {
+        return;
+    }
+    for (Stage * stage: next) {
+        graph->post(stage, Message{Message::Data, block, 0, replaying});
+    }
+}
@@ -0,0 +1,128 @@
+#ifndef STAGE_H
+#define STAGE_H
+
+#include "../protocol.h"
+#include "../performancereporter.h"
+
+#include <QObject>
+#include <QMutex>
+#include <QQueue>
+#include <QThread>
+#include <QVector>
+
+class StageGraph;
+
+/*!
+ * \interface Stage
+ * \brief One step of streaming processing of data blocks in StageGraph
+ *
+ * A stage receives blocks of data items (all channels) in order, and passes
+ * its results further with output: to the stages connected after it. Results
+ * that are not data blocks (events, spectra, statistics) are emitted as Qt signals
+ * of the stage, which are queued to receivers in other threads.
+ *
+ * Each stage has its own queue of input blocks and is run on a thread pool by
+ * StageGraph: never in two threads at once, so it needs no locking of its state,
+ * while independent stages run in parallel. Time of each process call is measured
+ * by PerformanceReporter of the stage.
+ *
+ * Changes of sampling frequency and resets (e.g. after a pause in data) come through
+ * the same queue, so they are always applied exactly between blocks, and are passed
+ * to the stages after this one automatically.
+ *
+ * History replayed into the graph (\see StageGraph::replay) is processed as any other
+ * data, but with signals of the stage blocked: its results were reported when the data
+ * came first. Stages that report to Logger or save files should check isReplaying.
+ */
+class Stage : public QObject
+{
+    Q_OBJECT
+public:
+    explicit Stage(QString name, QObject *parent = nullptr);
+
+    QString name() const { return objectName(); }
+
+    /// Sampling frequency of input, Hz (0 if not known yet)
+    int samplingFrequency() const { return samplingFreq; }
+
+    /*!
+     * \brief Sampling frequency of output: differs from input if the stage resamples data
+     */
+    virtual int outputFrequency() const { return samplingFreq; }
+
+    /*!
+     * \brief Limits the number of blocks waiting in the queue: the oldest ones are
+     *        dropped if the stage cannot keep up (0 - no limit, nothing is dropped)
+     */
+    void setQueueLimit(int blocks) { queueLimit = blocks; }
+
+    /*!
+     * \brief Sets priority of thread while it runs this stage: IdlePriority for background
+     *        analysis, so that it never delays acquisition and plots
+     *
+     * On Linux only IdlePriority (SCHED_IDLE) has effect for unprivileged process: the other
+     * priorities map to SCHED_OTHER, which has the single one. Stages of IdlePriority run on
+     * a separate pool of StageGraph.
+     */
+    void setThreadPriority(QThread::Priority priority) { threadPriority = priority; }
+
+    PerformanceReporter & performance() { return perf; }
+
+    /*!
+     * \brief CPU usage of the stage: time spent in process divided by duration
+     *        of processed data (e.g. 0.01 - 1% of one core to keep up in real time)
+     */
+    double load() const { return dataMsecs > 0 ? perf.totalTime() / dataMsecs : 0; }
+
+    /// Whether the block being processed is replayed history, whose results shouldn't be reported again
+    bool isReplaying() const { return replaying; }
+
+protected:
+    /*!
+     * \brief Processes the next block of input
+     */
+    virtual void process(const DataBlock & block) = 0;
+
+    /*!
+     * \brief Called when sampling frequency of input changes, before the next block
+     */
+    virtual void frequencyChanged() {}
+
+    /*!
+     * \brief Called when a new series of data starts: state left from the old one should be cleared
+     */
+    virtual void reset() {}
+
+    /*!
+     * \brief Passes \a block to the stages after this one
+     */
+    void output(const DataBlock & block);
+
+private:
+    friend class StageGraph;
+    friend class StageRunner;
+
+    StageGraph * graph;
+    QVector<Stage*> next;
+    int samplingFreq;
+    PerformanceReporter perf;
+    double dataMsecs; // Duration of processed data
+    QThread::Priority threadPriority;
+    bool replaying;
+
+    // Input queue, guarded by mutex
+    struct Message {
+        enum Type { Data, Frequency, Reset };
+        Type type;
+        DataBlock block;
+        int frequency;
+        bool replayed; // Data from StageGraph::replay
+    };
+    QMutex mutex;
+    QQueue<Message> queue;
+    bool scheduled; // Whether it is being run or waits for a thread
+    int queueLimit;
+    qint64 dropped;
+};
+
+#endif // STAGE_H
@@ -0,0 +1,172 @@
+#include "stagegraph.h"
+#include "../logger.h"
+
+#include <QRunnable>
+
+/*!
+ * Processes queue of a stage on a thread of pool, until the queue is empty
+ */
+class StageRunner : public QRunnable
+{
+public:
+    StageRunner(StageGraph * graph, Stage * stage) : graph(graph), stage(stage) {}
+    void run() override { graph->run(stage); }
+private:
+    StageGraph * graph;
+    Stage * stage;
+};
+
+StageGraph::StageGraph(QObject *parent) :
+    QObject(parent), samplingFreq(0)
+{}
+
+StageGraph::~StageGraph() {
+    waitForDone();
+    qDeleteAll(allStages);
+}
+
+void StageGraph::waitForDone() {
+    // Background stages may feed the others, and the others feed them
+    do {
+        pool.waitForDone();
+        backgroundPool.waitForDone();
+    } while (pool.activeThreadCount() > 0);
+}
+
+void StageGraph::addStage(Stage * stage, Stage * source) {
+    stage->graph = this;
+    allStages << stage;
+    if (source == NULL) {
+        inputs << stage;
+    } else {
+        connectStages(source, stage);
+    }
+    if (samplingFreq > 0) {
+        post(stage, Stage::Message{Stage::Message::Frequency, DataBlock(), source != NULL ? source->outputFrequency() : samplingFreq, false});
+    }
+}
+
+void StageGraph::connectStages(Stage * from, Stage * to) {
+    from->next << to;
+}
+
+void StageGraph::receiveData(TimeStampsVector t, DataVector d) {
+    const DataBlock block(t, d);
+    if (block.size() > 0) {
+        postToInputs(Stage::Message{Stage::Message::Data, block, 0, false});
+    }
+}
+
+void StageGraph::replay(const DataBlock & block) {
+    if (block.size() > 0) {
+        postToInputs(Stage::Message{Stage::Message::Data, block, 0, true});
+    }
+}
+
+void StageGraph::setFrequencies(int samplingFreq, int filterFreq) {
+    Q_UNUSED(filterFreq);
+    if (samplingFreq != this->samplingFreq) {
+        this->samplingFreq = samplingFreq;
+        postToInputs(Stage::Message{Stage::Message::Frequency, DataBlock(), samplingFreq, false});
+    }
+}
+
+void StageGraph::reset() {
+    postToInputs(Stage::Message{Stage::Message::Reset, DataBlock(), 0, false});
+}
+
+void StageGraph::postToInputs(const Stage::Message & message) {
+    for (Stage * stage: inputs) {
+        post(stage, message);
+    }
+}
+
+void StageGraph::post(Stage * stage, const Stage::Message & message) {
+    QMutexLocker locker(&stage->mutex);
+    if (message.type == Stage::Message::Data && ! message.replayed && stage->queueLimit > 0 && stage->queue.size() >= stage->queueLimit) {
+        // Drop the oldest live data block, but never frequency changes, resets and replayed history
+        int live = 0;
+        int oldest = -1;
+        for (int i = 0; i < stage->queue.size(); ++i) {
+            if (stage->queue[i].type == Stage::Message::Data && ! stage->queue[i].replayed) {
+                if (oldest < 0) {
+                    oldest = i;
+                }
+                ++live;
+            }
+        }
+        if (live >= stage->queueLimit) {
+            stage->queue.removeAt(oldest);
+            if (stage->dropped++ == 0) {
+                Logger::warning(tr("Stage %1 cannot keep up with data, blocks are dropped").arg(stage->name()));
+            }
+        }
+    }
+    stage->queue.enqueue(message);
+    if ( ! stage->scheduled ) {
+        stage->scheduled = true;
+        // SCHED_IDLE sticks to the thread (Qt doesn't restore SCHED_OTHER): keep such threads apart
+        QThreadPool & runners = (stage->threadPriority == QThread::IdlePriority) ? backgroundPool : pool;
+        runners.start(new StageRunner(this, stage));
+    }
+}
+
+void StageGraph::run(Stage * stage) {
+    // Threads of pool inherit priority of the thread that started them (e.g. of Worker).
+    // Pools are separate by priority, so it is set once for each thread, not for each run
+    QThread * thread = QThread::currentThread();
+    if (thread->priority() != stage->threadPriority) {
+        thread->setPriority(stage->threadPriority);
+    }
+    forever {
+        Stage::Message message;
+        {
+            QMutexLocker locker(&stage->mutex);
+            if (stage->queue.isEmpty()) {
+                stage->scheduled = false;
+                return;
+            }
+            message = stage->queue.dequeue();
+        }
+        switch (message.type) {
+        case Stage::Message::Data: {
+            // Results of replayed data were reported when the data came first
+            stage->replaying = message.replayed;
+            const bool wasBlocked = stage->blockSignals(message.replayed);
+            stage->perf.start();
+            stage->process(message.block);
+            stage->perf.stop();
+            stage->blockSignals(wasBlocked);
+            stage->replaying = false;
+            if (stage->samplingFreq > 0) {
+                stage->dataMsecs += message.block.size() * 1000.0 / stage->samplingFreq;
+            }
+            break;
+        }
+        case Stage::Message::Frequency:
+            stage->samplingFreq = message.frequency;
+            stage->frequencyChanged();
+            message.frequency = stage->outputFrequency();
+            for (Stage * next: stage->next) {
+                post(next, message);
+            }
+            break;
+        case Stage::Message::Reset:
+            stage->reset();
+            for (Stage * next: stage->next) {
+                post(next, message);
+            }
+            break;
+        }
+    }
+}
+
+void StageGraph::reportResults() {
+    for (Stage * stage: allStages) {
+        stage->perf.reportResults();
+        Logger::info(tr("Stage %1 used %2% of one core").arg(stage->name()).arg(stage->load()*100, 0, 'f', 2));
+        if (stage->dropped > 0) {
+            Logger::warning(tr("Stage %1 dropped %2 blocks").arg(stage->name()).arg(stage->dropped));
+        }
+    }
+}
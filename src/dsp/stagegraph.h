@@ -0,0 +1,101 @@
+#ifndef STAGEGRAPH_H
+#define STAGEGRAPH_H
+
+#include "stage.h"
+
+#include <QObject>
+#include <QList>
+#include <QThreadPool>
+
+/*!
+ * \brief Graph of processing stages between Worker and sinks of data
+ *
+ * Data received by the graph (receiveData, e.g. connected to Worker::dataUpdated)
+ * go to the stages added without source, and from each stage to the stages added
+ * after it, so the topology is any tree (or DAG) of stages:
+ *
+ *     StageGraph graph;
+ *     Stage * filter = graph.add(new FilterStage(...));
+ *     graph.add(new DetectorStage(...), filter);
+ *     graph.add(new SinkStage("plot"), filter);
+ *     connect(worker, &Worker::dataUpdated, &graph, &StageGraph::receiveData);
+ *
+ * Stages are run on the thread pool of the graph, each one processing its own queue
+ * (\see Stage). So receiveData only puts data into queues and returns at once,
+ * and independent branches of the graph are processed in parallel on all cores.
+ * Stages of IdlePriority (background analysis) run on a separate pool, whose
+ * threads are never used for the other stages (\see Stage::setThreadPriority).
+ *
+ * The topology should be built before data come: stages are not synchronized
+ * with changes of it.
+ *
+ * Data that were already processed (e.g. by the previous run of the program) can be
+ * replayed, so that stages continue from them as if acquisition wasn't stopped, without
+ * reporting their results again (\see Stage::isReplaying).
+ */
+class StageGraph : public QObject
+{
+    Q_OBJECT
+public:
+    explicit StageGraph(QObject *parent = nullptr);
+    /// Waits for the stages to process what they have
+    ~StageGraph();
+
+    /*!
+     * \brief Adds \a stage (the graph takes ownership of it), fed by \a source
+     * \param source - stage of this graph, or NULL to feed the stage by input of graph
+     * \return \a stage, for convenience of building chains
+     */
+    template <class S>
+    S * add(S * stage, Stage * source = NULL) {
+        addStage(stage, source);
+        return stage;
+    }
+
+    /// Feeds \a to with output of \a from as well (both must be in the graph)
+    void connectStages(Stage * from, Stage * to);
+
+    QList<Stage*> stages() const { return allStages; }
+
+    /// Number of threads that run stages (the number of cores by default)
+    void setThreadCount(int count) { pool.setMaxThreadCount(count); }
+
+    /// Blocks until all queued data are processed
+    void waitForDone();
+
+    /// Reports timing of each stage to Logger
+    void reportResults();
+
+    /*!
+     * \brief Feeds the graph with data that were processed before, e.g. history kept
+     *        between runs (\see HistoryRing). Nothing leaves the graph: signals of stages
+     *        are blocked while they process replayed blocks.
+     *
+     * Replayed blocks are never dropped by queue limits, so the history should be replayed
+     * before live data come, at once.
+     */
+    void replay(const DataBlock & block);
+
+public slots:
+    void receiveData(TimeStampsVector t, DataVector d);
+    void setFrequencies(int samplingFreq, int filterFreq);
+    /// Starts a new series of data: stages clear their state (\see Stage::reset)
+    void reset();
+
+private:
+    friend class Stage;
+    friend class StageRunner;
+
+    void addStage(Stage * stage, Stage * source);
+    void postToInputs(const Stage::Message & message);
+    void post(Stage * stage, const Stage::Message & message);
+    void run(Stage * stage);
+
+    QThreadPool pool;
+    QThreadPool backgroundPool; // For stages of IdlePriority
+    QList<Stage*> allStages;
+    QVector<Stage*> inputs; // Fed by input of graph
+    int samplingFreq;
+};
+
+#endif // STAGEGRAPH_H
@@ -0,0 +1,125 @@
+#include "staltatrigger.h"
+#include "../logger.h"
+
+#include <QDateTime>
+
+namespace {
+    QString timeToString(TimeStampType time) {
+        return QDateTime::fromMSecsSinceEpoch(qint64(time)).toString("yyyy-MM-dd hh:mm:ss.zzz");
+    }
+
+    QString channelsToString(int channels) {
+        QStringList names;
+        for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+            if (channels & (1 << ch)) {
+                names << QString::number(ch + 1);
+            }
+        }
+        return names.join(", ");
+    }
+}
+
+StaLtaTrigger::Parameters::Parameters() :
+    staSecs(1), ltaSecs(30), coincidence(2)
+{
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        onRatio[ch] = 4;
+        offRatio[ch] = 1.5;
+    }
+}
+
+StaLtaTrigger::StaLtaTrigger(QString name, const Parameters & parameters, QObject *parent) :
+    Stage(name, parent), params(parameters), staCoef(0), ltaCoef(0), meanCoef(0), triggered(false)
+{
+    params.coincidence = qBound(1, params.coincidence, int(CHANNELS_NUM));
+    reset();
+}
+
+void StaLtaTrigger::frequencyChanged() {
+    const double freq = samplingFrequency();
+    if (freq > 0) {
+        staCoef = 1 / qMax(1.0, params.staSecs * freq);
+        ltaCoef = 1 / qMax(1.0, params.ltaSecs * freq);
+        meanCoef = ltaCoef; // Offset drifts slowly: remove it over LTA window
+    }
+    reset();
+}
+
+void StaLtaTrigger::reset() {
+    started = false;
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        mean[ch] = sta[ch] = lta[ch] = 0;
+        active[ch] = false;
+    }
+    warmup = qint64(params.ltaSecs * samplingFrequency());
+    if (triggered) {
+        Logger::info(tr("Event is interrupted by reset of %1").arg(name()));
+    }
+    triggered = false;
+    onTime = 0;
+    peakRatio = 0;
+}
+
+void StaLtaTrigger::process(const DataBlock & block) {
+    if (samplingFrequency() <= 0) {
+        return;
+    }
+    const int size = block.size();
+    const DataItem * items = block.data.constData();
+    if ( ! started && size > 0 ) {
+        for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+            mean[ch] = items[0].byChannel[ch];
+        }
+        started = true;
+    }
+    for (int i = 0; i < size; ++i) {
+        // Fixed number of channels and no branches: the loop is vectorized
+        for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+            const double x = items[i].byChannel[ch];
+            mean[ch] += meanCoef * (x - mean[ch]);
+            const double y = x - mean[ch];
+            sta[ch] += staCoef * (y*y - sta[ch]);
+            lta[ch] += ltaCoef * (y*y - lta[ch]);
+        }
+        if (warmup > 0) {
+            --warmup;
+            continue;
+        }
+        int count = 0;
+        for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+            // Hysteresis: once triggered, the channel holds until the lower threshold
+            const double threshold = active[ch] ? params.offRatio[ch] : params.onRatio[ch];
+            active[ch] = sta[ch] >= threshold * lta[ch] && lta[ch] > 0;
+            count += active[ch];
+        }
+        if (triggered) {
+            for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+                if (lta[ch] > 0) {
+                    peakRatio = qMax(peakRatio, sta[ch] / lta[ch]);
+                }
+            }
+        }
+        if (triggered != (count >= params.coincidence)) {
+            triggered = ! triggered;
+            const TimeStampType time = block.timestamps[i];
+            if (triggered) {
+                int channels = 0;
+                for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+                    channels |= int(active[ch]) << ch;
+                }
+                onTime = time;
+                peakRatio = 0;
+                if ( ! isReplaying() ) { // Events of history were reported by the run that received them
+                    Logger::info(tr("Event triggered at %1 on channels %2").arg(timeToString(time), channelsToString(channels)));
+                    emit triggerOn(time, channels);
+                }
+            } else if ( ! isReplaying() ) {
+                Logger::info(tr("Event ended at %1, lasted %2 s, peak STA/LTA %3")
+                             .arg(timeToString(time))
+                             .arg((time - onTime) / 1000, 0, 'f', 1)
+                             .arg(peakRatio, 0, 'f', 1));
+                emit triggerOff(onTime, time, peakRatio);
+            }
+        }
+    }
+}
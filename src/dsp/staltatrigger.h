@@ -0,0 +1,86 @@
+#ifndef STALTATRIGGER_H
+#define STALTATRIGGER_H
+
+#include "stage.h"
+
+/*!
+ * \brief Detects seismic events by recursive STA/LTA with coincidence of channels
+ *
+ * For each channel, the short-term and the long-term averages (STA and LTA) of
+ * squared amplitude (with offset removed) are updated for each sample by the
+ * recursive formula avg += (x^2 - avg) / N, so each sample costs the same
+ * small work, without windows of past samples. Updates of all channels go in
+ * one loop over arrays, which is vectorized by compiler.
+ *
+ * A channel is triggered when STA/LTA rises to its onRatio, and released when
+ * it falls below its offRatio. An event starts when at least \a coincidence
+ * channels are triggered at once, and ends when fewer are. Triggering is
+ * disabled for the first LTA window after start (or reset), while LTA is not
+ * established yet.
+ *
+ * Events are reported with triggerOn and triggerOff signals (and to Logger)
+ * right in the block where they happen, so their latency is less than a block.
+ */
+class StaLtaTrigger : public Stage
+{
+    Q_OBJECT
+public:
+    struct Parameters {
+        double staSecs;
+        double ltaSecs;
+        double onRatio[CHANNELS_NUM];
+        double offRatio[CHANNELS_NUM];
+        int coincidence; // Number of channels, from 1 to CHANNELS_NUM
+        /// Typical values for local events
+        Parameters();
+    };
+
+    StaLtaTrigger(QString name, const Parameters & parameters, QObject *parent = nullptr);
+
+    const Parameters & parameters() const { return params; }
+
+    /// Whether an event is going on now
+    bool isTriggered() const { return triggered; }
+
+signals:
+    /*!
+     * \brief Event started
+     * \param time - time of the sample where coincidence was reached
+     * \param channels - bit mask of triggered channels (bit 0 - the first channel)
+     */
+    void triggerOn(TimeStampType time, int channels);
+    /*!
+     * \brief Event ended
+     * \param onTime - when it started, \see triggerOn
+     * \param offTime - time of the sample where coincidence was lost
+     * \param peakRatio - maximum STA/LTA of channels during the event
+     */
+    void triggerOff(TimeStampType onTime, TimeStampType offTime, double peakRatio);
+
+protected:
+    void process(const DataBlock & block) override;
+    void frequencyChanged() override;
+    void reset() override;
+
+private:
+    Parameters params;
+    // Coefficients 1/N of recursive averages
+    double staCoef;
+    double ltaCoef;
+    double meanCoef;
+
+    // State of each channel
+    bool started; // Whether mean is initialized with the first sample
+    double mean[CHANNELS_NUM];
+    double sta[CHANNELS_NUM];
+    double lta[CHANNELS_NUM];
+    bool active[CHANNELS_NUM];
+    qint64 warmup; // Samples left before triggering is allowed
+
+    // State of event
+    bool triggered;
+    TimeStampType onTime;
+    double peakRatio;
+};
+
+#endif // STALTATRIGGER_H
@@ -0,0 +1,26 @@
+#include "statsstage.h"
+
+StatsStage::StatsStage(QString name, int windowSecs, QObject *parent) :
+    Stage(name, parent), windowSecs_(qMax(1, windowSecs))
+{
+}
+
+void StatsStage::process(const DataBlock & block) {
+    if (block.size() == 0) {
+        return;
+    }
+    stats.add(block.data);
+    QVector<SlidingStats::Values> values(CHANNELS_NUM);
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        values[int(ch)] = stats.values(ch);
+    }
+    emit statsReady(block.timestamps.last(), values);
+}
+
+void StatsStage::frequencyChanged() {
+    stats.setWindow(windowSecs_ * qMax(1, samplingFrequency()));
+}
+
+void StatsStage::reset() {
+    stats.reset();
+}
@@ -0,0 +1,42 @@
+#ifndef STATSSTAGE_H
+#define STATSSTAGE_H
+
+#include "stage.h"
+#include "slidingstats.h"
+
+/*!
+ * \brief Statistics of all channels over a sliding window of time, \see SlidingStats
+ *
+ * Emits statsReady after each block, so receivers (stats boxes, FileWriter for
+ * headers of files) always have the statistics of the latest \a windowSecs seconds.
+ * The window is sized when the sampling frequency is set, and emptied on reset.
+ */
+class StatsStage : public Stage
+{
+    Q_OBJECT
+public:
+    static const int DEFAULT_WINDOW_SECS = 10;
+
+    StatsStage(QString name, int windowSecs = DEFAULT_WINDOW_SECS, QObject *parent = nullptr);
+
+    int windowSecs() const { return windowSecs_; }
+
+signals:
+    /*!
+     * \brief Statistics after a block
+     * \param time - time of the last item of block
+     * \param stats - statistics of each channel
+     */
+    void statsReady(TimeStampType time, QVector<SlidingStats::Values> stats);
+
+protected:
+    void process(const DataBlock & block) override;
+    void frequencyChanged() override;
+    void reset() override;
+
+private:
+    const int windowSecs_;
+    SlidingStats stats;
+};
+
+#endif // STATSSTAGE_H
@@ -0,0 +1,261 @@
+#include "templatematcher.h"
+#include "../logger.h"
+
+#include <qmath.h>
+#include <algorithm>
+
+TemplateMatcher::Parameters::Parameters() :
+    thresholdMads(9), madSecs(120)
+{
+}
+
+TemplateMatcher::Group::Group(int fftSize) :
+    fft(fftSize), product(fft.bins()), correlation(fft.size())
+{
+}
+
+TemplateMatcher::TemplateMatcher(const Parameters & parameters) :
+    params(parameters), fft(4), designed(false), maxLength(0), step(0), historySize(1), fill(0), firstItem(0)
+{
+}
+
+void TemplateMatcher::setTemplates(const QVector<Template> & templates) {
+    this->templates = templates;
+    prepared.clear();
+    groups.clear();
+    designed = false;
+}
+
+int TemplateMatcher::design(int samplingFreq, int groupsNum) {
+    prepared.clear();
+    groups.clear();
+    designed = false;
+    maxLength = 0;
+    QVector<int> usable;
+    for (int i = 0; i < templates.size(); ++i) {
+        const Template & t = templates[i];
+        if (t.samplingFreq != samplingFreq || t.data.size() < 2) {
+            Logger::warning(tr("Template %1 is skipped: %2 items at %3 Hz, data are at %4 Hz")
+                            .arg(t.name).arg(t.data.size()).arg(t.samplingFreq).arg(samplingFreq));
+            continue;
+        }
+        usable << i;
+        maxLength = qMax(maxLength, t.data.size());
+    }
+    if (usable.isEmpty()) {
+        return 0;
+    }
+
+    // Twice the longest template at least: half of each segment is new
+    fft = RealFft(2*maxLength);
+    const int n = fft.size();
+    step = n - maxLength + 1;
+    historySize = qMax(step, qRound(params.madSecs * samplingFreq));
+    QVector<double> padded(n);
+    for (int i: usable) {
+        const Template & t = templates[i];
+        Prepared p;
+        p.index = i;
+        p.length = t.data.size();
+        double energy = 0;
+        for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+            double mean = 0;
+            for (const DataItem & item: t.data) {
+                mean += item.byChannel[ch];
+            }
+            mean /= p.length;
+            padded.fill(0);
+            for (int j = 0; j < p.length; ++j) {
+                padded[j] = t.data[j].byChannel[ch] - mean;
+                energy += padded[j]*padded[j];
+            }
+            p.spectra[ch].resize(fft.bins());
+            fft.transform(padded.constData(), p.spectra[ch].data());
+            // Correlation is convolution with the reversed template: conjugate spectrum
+            for (RealFft::Complex & bin: p.spectra[ch]) {
+                bin = std::conj(bin);
+            }
+        }
+        if (energy == 0) {
+            Logger::warning(tr("Template %1 is skipped: it is flat").arg(t.name));
+            continue;
+        }
+        p.norm = qSqrt(energy);
+        p.history.resize(historySize);
+        prepared << p;
+    }
+
+    // Templates by turns, so that groups are loaded evenly
+    const int count = qBound(1, groupsNum, qMax(1, prepared.size()));
+    for (int g = 0; g < count; ++g) {
+        groups << Group(n);
+    }
+    for (int i = 0; i < prepared.size(); ++i) {
+        groups[i % count].prepared << i;
+    }
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        segment[ch].resize(n);
+        spectra[ch].resize(fft.bins());
+        sums[ch].resize(n + 1);
+        squares[ch].resize(n + 1);
+    }
+    times.resize(n);
+    designed = ! prepared.isEmpty();
+    reset();
+    return prepared.size();
+}
+
+void TemplateMatcher::reset() {
+    fill = 0;
+    firstItem = 0;
+    for (Prepared & p: prepared) {
+        p.historyPos = 0;
+        p.historyFill = 0;
+        p.candidateItem = -1;
+    }
+    for (Group & group: groups) {
+        group.detections.clear();
+    }
+}
+
+int TemplateMatcher::append(const DataBlock & block, int from) {
+    if ( ! designed ) {
+        return block.size() - from;
+    }
+    const int count = qMin(block.size() - from, fft.size() - fill);
+    for (int i = 0; i < count; ++i) {
+        const DataItem & item = block.data[from + i];
+        for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+            segment[ch][fill + i] = item.byChannel[ch];
+        }
+        times[fill + i] = block.timestamps[from + i];
+    }
+    fill += count;
+    return count;
+}
+
+void TemplateMatcher::transformSegment() {
+    const int n = fft.size();
+    QVector<double> centered(n);
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        const double * x = segment[ch].constData();
+        double mean = 0;
+        for (int k = 0; k < n; ++k) {
+            mean += x[k];
+        }
+        mean /= n;
+        double * s = sums[ch].data();
+        double * q = squares[ch].data();
+        s[0] = q[0] = 0;
+        for (int k = 0; k < n; ++k) {
+            centered[k] = x[k] - mean;
+            s[k + 1] = s[k] + centered[k];
+            q[k + 1] = q[k] + centered[k]*centered[k];
+        }
+        fft.transform(centered.constData(), spectra[ch].data());
+    }
+}
+
+void TemplateMatcher::matchGroup(int g) {
+    Group & group = groups[g];
+    const int bins = fft.bins();
+    for (int index: group.prepared) {
+        Prepared & p = prepared[index];
+        RealFft::Complex * product = group.product.data();
+        for (int b = 0; b < bins; ++b) {
+            product[b] = 0;
+        }
+        for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+            const RealFft::Complex * x = spectra[ch].constData();
+            const RealFft::Complex * t = p.spectra[ch].constData();
+            for (int b = 0; b < bins; ++b) {
+                product[b] += x[b] * t[b];
+            }
+        }
+        group.fft.inverse(product, group.correlation.data());
+
+        // Circular correlation is valid where the template doesn't wrap around: at the first step items
+        double * cc = group.correlation.data();
+        const double length = p.length;
+        for (int t = 0; t < step; ++t) {
+            double energy = 0;
+            for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+                const double sum = sums[ch][t + p.length] - sums[ch][t];
+                energy += squares[ch][t + p.length] - squares[ch][t] - sum*sum / length;
+            }
+            cc[t] = energy > 0 ? cc[t] / (p.norm * qSqrt(energy)) : 0;
+            p.history[p.historyPos] = float(cc[t]);
+            p.historyPos = (p.historyPos + 1) % p.history.size();
+            p.historyFill = qMin(p.historyFill + 1, p.history.size());
+        }
+        const double threshold = params.thresholdMads * mad(p, group);
+        for (int t = 0; t < step; ++t) {
+            detect(p, firstItem + t, times[t], cc[t], threshold, group.detections);
+        }
+        // The next segment may have stronger detections only within the length of template
+        if (p.candidateItem >= 0 && p.candidateItem + p.length <= firstItem + step) {
+            group.detections << p.candidate;
+            p.candidateItem = -1;
+        }
+    }
+}
+
+double TemplateMatcher::mad(Prepared & p, Group & group) const {
+    group.scratch.resize(p.historyFill);
+    std::copy(p.history.constBegin(), p.history.constBegin() + p.historyFill, group.scratch.begin());
+    float * begin = group.scratch.data();
+    float * middle = begin + p.historyFill/2;
+    float * end = begin + p.historyFill;
+    std::nth_element(begin, middle, end);
+    const float median = *middle;
+    for (float * v = begin; v != end; ++v) {
+        *v = qAbs(*v - median);
+    }
+    std::nth_element(begin, middle, end);
+    return *middle;
+}
+
+void TemplateMatcher::detect(Prepared & p, qint64 item, TimeStampType time, double correlation,
+                             double threshold, QVector<Detection> & detections) const {
+    if (correlation <= threshold || threshold <= 0) {
+        return;
+    }
+    if (p.candidateItem >= 0 && item - p.candidateItem < p.length) {
+        // The same event: keep the strongest match
+        if (correlation > p.candidate.correlation) {
+            p.candidate.time = time;
+            p.candidate.correlation = correlation;
+            p.candidate.threshold = threshold;
+            p.candidateItem = item;
+        }
+        return;
+    }
+    if (p.candidateItem >= 0) {
+        detections << p.candidate;
+    }
+    p.candidate.templateName = templates[p.index].name;
+    p.candidate.templateIndex = p.index;
+    p.candidate.time = time;
+    p.candidate.correlation = correlation;
+    p.candidate.threshold = threshold;
+    p.candidateItem = item;
+}
+
+QVector<TemplateMatcher::Detection> TemplateMatcher::finishSegment() {
+    QVector<Detection> res;
+    for (Group & group: groups) {
+        res += group.detections;
+        group.detections.clear();
+    }
+    std::sort(res.begin(), res.end(), [](const Detection & a, const Detection & b) { return a.time < b.time; });
+
+    // The last maxLength - 1 items start the next segment
+    const int overlap = fft.size() - step;
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        std::copy(segment[ch].constBegin() + step, segment[ch].constEnd(), segment[ch].begin());
+    }
+    std::copy(times.constBegin() + step, times.constEnd(), times.begin());
+    fill = overlap;
+    firstItem += step;
+    return res;
+}
@@ -0,0 +1,145 @@
+#ifndef TEMPLATEMATCHER_H
+#define TEMPLATEMATCHER_H
+
+#include "../protocol.h"
+#include "realfft.h"
+
+#include <QVector>
+#include <QCoreApplication>
+
+/*!
+ * \brief Detects repeating events by normalized cross-correlation with waveform templates
+ *
+ * Correlation of a template (all channels, each less its mean) with the window
+ * of data of the same length starting at each item is
+ *
+ *     cc(t) = sum of T[c][j]*x[c][t + j] / sqrt(sum of T^2 * sum of (x[c][t + j] - mean[c](t))^2)
+ *
+ * over channels c and items j of the template: the normalized correlation of the
+ * 3-component waveforms, from -1 to 1.
+ *
+ * Numerators are computed by overlap-save: data are taken in segments of the size
+ * of FFT (at least twice the longest template), overlapping by the length of the
+ * longest template less one, so each segment gives correlations at its first
+ * segmentStep() items. Spectra of templates are computed once; spectra of each
+ * segment (one FFT per channel) are shared by all templates, so a template costs
+ * a product of spectra per channel and one inverse FFT per segment. Denominators
+ * come from running sums of x and x^2 over the segment (prefix sums, less a mean
+ * for precision), O(1) per item and template.
+ *
+ * A template detects an event where its correlation exceeds thresholdMads times the
+ * median absolute deviation of its correlations over the latest madSecs; of detections
+ * closer than the length of the template, the strongest one is kept. Detections are
+ * delayed by one segment at most, and by the length of the template.
+ *
+ * Templates are split into groups, each with its own buffers and FFT: matchGroup
+ * can run for all groups of a segment at once, on different threads.
+ */
+class TemplateMatcher
+{
+    Q_DECLARE_TR_FUNCTIONS(TemplateMatcher)
+public:
+    struct Parameters {
+        double thresholdMads;
+        double madSecs;
+        /// 9 MADs over 2 minutes
+        Parameters();
+    };
+
+    struct Template {
+        QString name;
+        int samplingFreq; // Hz
+        DataVector data;
+        Template() : samplingFreq(0) {}
+    };
+
+    struct Detection {
+        QString templateName;
+        int templateIndex;
+        TimeStampType time;  // Of the item matching the first one of template
+        double correlation;
+        double threshold;    // At the time
+        Detection() : templateIndex(-1), time(0), correlation(0), threshold(0) {}
+    };
+
+    explicit TemplateMatcher(const Parameters & parameters = Parameters());
+
+    const Parameters & parameters() const { return params; }
+
+    /// Sets templates: they are prepared by design
+    void setTemplates(const QVector<Template> & templates);
+    int templatesCount() const { return templates.size(); }
+
+    /*!
+     * \brief Prepares templates of \a samplingFreq (others are skipped), FFT and \a groups groups, and resets
+     * \return number of templates in use (skipped ones are reported to Logger)
+     */
+    int design(int samplingFreq, int groups);
+
+    int groupsCount() const { return groups.size(); }
+    int fftSize() const { return fft.size(); }
+    /// New items per segment
+    int segmentStep() const { return step; }
+
+    /// Starts a new series: forgets data, correlations and pending detections
+    void reset();
+
+    /// Takes items of \a block from \a from up to the end of segment, returns their number
+    int append(const DataBlock & block, int from);
+    bool isSegmentFull() const { return designed && fill == fft.size(); }
+
+    /// Spectra and sums of the full segment, shared by groups
+    void transformSegment();
+    /// Correlations and detections of templates of \a group; groups may run in parallel
+    void matchGroup(int group);
+    /// Detections of all groups in the segment, ordered by time; moves on to the next segment
+    QVector<Detection> finishSegment();
+
+private:
+    struct Prepared {
+        int index;     // In templates
+        int length;
+        double norm;   // Sqrt of sum of squares of all channels
+        QVector<RealFft::Complex> spectra[CHANNELS_NUM]; // Of the template less its mean
+        QVector<float> history; // Ring of the latest correlations, for MAD
+        int historyPos;
+        int historyFill;
+        Detection candidate;    // The strongest detection of the latest ones, not reported yet
+        qint64 candidateItem;   // Its number, -1 if none
+    };
+
+    struct Group {
+        QVector<int> prepared;  // Indices of templates in prepared
+        RealFft fft;
+        QVector<RealFft::Complex> product;
+        QVector<double> correlation;
+        QVector<float> scratch; // For medians
+        QVector<Detection> detections;
+        explicit Group(int fftSize = 4);
+    };
+
+    double mad(Prepared & prepared, Group & group) const;
+    void detect(Prepared & prepared, qint64 item, TimeStampType time, double correlation,
+                double threshold, QVector<Detection> & detections) const;
+
+    Parameters params;
+    QVector<Template> templates;
+    QVector<Prepared> prepared;
+    QVector<Group> groups;
+    RealFft fft;
+    bool designed;
+    int maxLength; // Of prepared templates
+    int step;      // fft.size() - maxLength + 1
+    int historySize;
+
+    // Segment: fft.size() items
+    QVector<double> segment[CHANNELS_NUM];
+    QVector<TimeStampType> times;
+    int fill;
+    qint64 firstItem; // Number of the first item of segment since reset
+    QVector<RealFft::Complex> spectra[CHANNELS_NUM];
+    QVector<double> sums[CHANNELS_NUM];    // Prefix sums of segment less its mean: sums[c][k] of k items
+    QVector<double> squares[CHANNELS_NUM]; // ... and of squares
+};
+
+#endif // TEMPLATEMATCHER_H
@@ -0,0 +1,104 @@
+#include "templatestage.h"
+#include "../logger.h"
+#include "../readers/datareader.h"
+#include "../writers/fileindex.h"
+#include "../writers/journal.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QRunnable>
+
+const QString TemplateStage::DEFAULT_DIR = "templates";
+
+namespace {
+    QString timeToString(TimeStampType time) {
+        return QDateTime::fromMSecsSinceEpoch(qint64(time)).toString("yyyy-MM-dd hh:mm:ss.zzz");
+    }
+
+    /// Matches one group of templates in a thread of the pool
+    class MatchTask : public QRunnable
+    {
+    public:
+        MatchTask(TemplateMatcher * matcher, int group) : matcher(matcher), group(group) {}
+        void run() override { matcher->matchGroup(group); }
+
+    private:
+        TemplateMatcher * matcher;
+        const int group;
+    };
+}
+
+TemplateStage::TemplateStage(QString name, const QVector<TemplateMatcher::Template> & templates,
+                             const TemplateMatcher::Parameters & parameters, QObject *parent) :
+    Stage(name, parent), matcher_(parameters)
+{
+    matcher_.setTemplates(templates);
+}
+
+TemplateStage::~TemplateStage() {
+    pool.waitForDone();
+}
+
+QVector<TemplateMatcher::Template> TemplateStage::loadTemplates(const QString & directory) {
+    QVector<TemplateMatcher::Template> res;
+    const QDir dir(directory);
+    for (const QString & fileName: dir.entryList(QDir::Files, QDir::Name)) {
+        if (fileName.endsWith(FileIndex::FILE_SUFFIX) || fileName.endsWith(Journal::FILE_SUFFIX)) {
+            continue;
+        }
+        QScopedPointer<DataReader> reader(DataReader::open(dir.filePath(fileName)));
+        if (reader.isNull()) {
+            continue; // Reported by DataReader
+        }
+        TemplateMatcher::Template t;
+        t.name = fileName;
+        t.samplingFreq = reader->info().samplingFreq;
+        DataBlock block;
+        while (reader->readBlock(block)) {
+            t.data += block.data;
+        }
+        res << t;
+    }
+    Logger::info(tr("%1 templates are loaded from %2").arg(res.size()).arg(directory));
+    return res;
+}
+
+void TemplateStage::frequencyChanged() {
+    pool.waitForDone();
+    const int freq = samplingFrequency();
+    if (freq <= 0) {
+        return;
+    }
+    const int used = matcher_.design(freq, pool.maxThreadCount());
+    Logger::info(tr("Template matching: %1 of %2 templates in %3 groups, segments of %4 items")
+                 .arg(used).arg(matcher_.templatesCount()).arg(matcher_.groupsCount()).arg(matcher_.fftSize()));
+}
+
+void TemplateStage::reset() {
+    matcher_.reset();
+}
+
+void TemplateStage::process(const DataBlock & block) {
+    int from = 0;
+    while (from < block.size()) {
+        from += matcher_.append(block, from);
+        if ( ! matcher_.isSegmentFull() ) {
+            continue;
+        }
+        matcher_.transformSegment();
+        for (int g = 1; g < matcher_.groupsCount(); ++g) {
+            pool.start(new MatchTask(&matcher_, g));
+        }
+        matcher_.matchGroup(0);
+        pool.waitForDone();
+        for (const TemplateMatcher::Detection & detection: matcher_.finishSegment()) {
+            if (isReplaying()) {
+                continue; // Reported by the run that received the data
+            }
+            Logger::info(tr("Template %1 matches at %2: correlation %3 (threshold %4)")
+                         .arg(detection.templateName).arg(timeToString(detection.time))
+                         .arg(detection.correlation, 0, 'f', 2).arg(detection.threshold, 0, 'f', 2));
+            emit detected(detection);
+        }
+    }
+}
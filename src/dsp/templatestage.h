@@ -0,0 +1,56 @@
+#ifndef TEMPLATESTAGE_H
+#define TEMPLATESTAGE_H
+
+#include "stage.h"
+#include "templatematcher.h"
+
+#include <QThreadPool>
+
+/*!
+ * \brief Detects repeating events by matching a library of waveform templates
+ *
+ * \see TemplateMatcher. Groups of templates of each segment are matched on the own
+ * thread pool of the stage, one group per thread (the number of cores by default),
+ * while the thread of the stage matches one of them too and waits for the others:
+ * the segment, and so the stream, is done as fast as all cores can do it.
+ *
+ * Templates are data files written by FileWriter (e.g. cut out of recorded events
+ * by the extract tool), \see loadTemplates. Put the stage after the same filter
+ * as the templates were recorded with. Detections are emitted by detected and
+ * reported to Logger.
+ */
+class TemplateStage : public Stage
+{
+    Q_OBJECT
+public:
+    TemplateStage(QString name, const QVector<TemplateMatcher::Template> & templates,
+                  const TemplateMatcher::Parameters & parameters, QObject *parent = nullptr);
+    ~TemplateStage();
+
+    static const QString DEFAULT_DIR;
+
+    const TemplateMatcher & matcher() const { return matcher_; }
+
+    /// Number of groups of templates matched at once (the number of cores by default), applied with sampling frequency
+    void setThreadCount(int count) { pool.setMaxThreadCount(count); }
+
+    /*!
+     * \brief Reads templates from all data files in \a directory (except indexes and journals)
+     * \return templates named by their files; failures are reported to Logger
+     */
+    static QVector<TemplateMatcher::Template> loadTemplates(const QString & directory);
+
+signals:
+    void detected(TemplateMatcher::Detection detection);
+
+protected:
+    void process(const DataBlock & block) override;
+    void frequencyChanged() override;
+    void reset() override;
+
+private:
+    TemplateMatcher matcher_;
+    QThreadPool pool;
+};
+
+#endif // TEMPLATESTAGE_H
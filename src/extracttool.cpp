@@ -0,0 +1,139 @@
+#include "extracttool.h"
+#include "logger.h"
+#include "readers/datareader.h"
+#include "writers/fileindex.h"
+#include "writers/outputformat.h"
+
+#include <QFile>
+#include <QElapsedTimer>
+#include <QScopedPointer>
+#include <algorithm>
+
+const QString ExtractTool::ARGUMENT = "--extract";
+
+namespace {
+    // Full date and time, or time of day on given date
+    TimeStampType parseTime(const QString & text, const QDate & date, bool * ok) {
+        QDateTime time = QDateTime::fromString(text, Qt::ISODate);
+        if ( ! time.isValid() ) {
+            QTime timeOfDay = QTime::fromString(text, "hh:mm:ss.zzz");
+            if ( ! timeOfDay.isValid() ) {
+                timeOfDay = QTime::fromString(text, "hh:mm:ss");
+            }
+            time = QDateTime(date, timeOfDay);
+        }
+        *ok = time.isValid();
+        return *ok ? time.toMSecsSinceEpoch() : 0;
+    }
+
+    QString timeText(TimeStampType time) {
+        return QDateTime::fromMSecsSinceEpoch(qint64(time)).toString("hhmmss");
+    }
+}
+
+int ExtractTool::run(QStringList arguments) {
+    const QStringList args = arguments.mid(arguments.indexOf(ARGUMENT) + 1);
+    if (args.size() < 3) {
+        Logger::error(tr("Usage: %1 <data file> <from> <to> [<output file>]\n"
+                         "Times are either full (2017-07-14T14:32:05.250) or time of day (14:32:05)").arg(ARGUMENT));
+        return 1;
+    }
+    const QString dataFile = args[0];
+    QScopedPointer<DataReader> reader(DataReader::open(dataFile));
+    if (reader.isNull()) {
+        return 1;
+    }
+    const QDate date = reader->info().startTime.date();
+    bool fromOk, toOk;
+    const TimeStampType from = parseTime(args[1], date, &fromOk);
+    TimeStampType to = parseTime(args[2], date, &toOk);
+    if ( ! fromOk || ! toOk ) {
+        Logger::error(tr("Invalid time: %1").arg(fromOk ? args[2] : args[1]));
+        return 1;
+    }
+    if (to <= from && ! args[2].contains('T')) {
+        to += 24*60*60*1000.0; // Times of day around midnight
+    }
+
+    QString outputFile = args.value(3);
+    if (outputFile.isEmpty()) {
+        const QScopedPointer<OutputFormat> format(OutputFormat::create(reader->type()));
+        const QString suffix = format->fileSuffix();
+        QString base = dataFile;
+        if ( ! suffix.isEmpty() && base.endsWith(suffix) ) {
+            base.chop(suffix.size());
+        }
+        outputFile = QString("%1_%2-%3%4").arg(base, timeText(from), timeText(to), suffix);
+    }
+
+    FileIndex index;
+    const bool indexed = ! reader->isCompressed() && index.load(FileIndex::fileNameFor(dataFile));
+    if ( ! indexed ) {
+        Logger::info(tr("No index for %1, it is read from the beginning").arg(dataFile));
+    }
+    return extract(reader.data(), indexed ? &index : NULL, from, to, outputFile) >= 0 ? 0 : 1;
+}
+
+qint64 ExtractTool::extract(const QString & dataFile, TimeStampType from, TimeStampType to, const QString & outputFile) {
+    QScopedPointer<DataReader> reader(DataReader::open(dataFile));
+    if (reader.isNull()) {
+        return -1;
+    }
+    FileIndex index;
+    const bool indexed = ! reader->isCompressed() && index.load(FileIndex::fileNameFor(dataFile));
+    return extract(reader.data(), indexed ? &index : NULL, from, to, outputFile);
+}
+
+qint64 ExtractTool::extract(DataReader * reader, const FileIndex * index,
+                            TimeStampType from, TimeStampType to, const QString & outputFile) {
+    QElapsedTimer timer;
+    timer.start();
+    if ( ! reader->seekTime(from, index) ) {
+        Logger::warning(tr("No data after %1").arg(QDateTime::fromMSecsSinceEpoch(qint64(from)).toString(Qt::ISODate)));
+        return 0;
+    }
+    QFile out(outputFile);
+    if ( ! out.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+        Logger::error(tr("Failed to create file %1: %2").arg(outputFile, out.errorString()));
+        return -1;
+    }
+    QScopedPointer<OutputFormat> format(OutputFormat::create(reader->type()));
+    OutputFormat::FileInfo info = reader->info();
+    qint64 items = 0;
+    DataBlock block;
+    while (reader->readBlock(block)) {
+        const TimeStampType * begin = block.timestamps.constData();
+        const int count = int(std::lower_bound(begin, begin + block.size(), to) - begin);
+        if (count > 0) {
+            const DataBlock part = (count == block.size()) ? block : block.mid(0, count);
+            if (items == 0) {
+                info.startTime = QDateTime::fromMSecsSinceEpoch(qint64(part.timestamps.first()));
+                format->open(info);
+                out.write(format->header(info));
+            }
+            out.write(format->appendBlock(part));
+            items += count;
+        }
+        if (count < block.size()) {
+            break; // Reached the end of window
+        }
+    }
+    if (items > 0) {
+        out.write(format->flush());
+        format->close();
+    }
+    out.close();
+    if (out.error() != QFile::NoError) {
+        Logger::error(tr("Failed to write file %1: %2").arg(outputFile, out.errorString()));
+        return -1;
+    }
+    if (items == 0) {
+        out.remove();
+        Logger::warning(tr("No data in the window, nothing is extracted"));
+        return 0;
+    }
+    Logger::info(tr("Extracted %1 items into %2 in %3 ms%4")
+                 .arg(items).arg(outputFile).arg(timer.elapsed())
+                 .arg(index != NULL ? tr(" using index") : QString()));
+    return items;
+}
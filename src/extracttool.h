@@ -0,0 +1,46 @@
+#ifndef EXTRACTTOOL_H
+#define EXTRACTTOOL_H
+
+#include "protocol.h"
+#include <QObject>
+#include <QStringList>
+
+class DataReader;
+class FileIndex;
+
+/**
+ * @brief Extracts a time window from a data file into a new file of the same format
+ *
+ * Uses the index of data file (\see FileIndex), if there is one, to start reading
+ * right before the window instead of reading the file from the beginning.
+ * Run the program with --extract argument to use it from command line:
+ *
+ *     seismoreg --extract <data file> <from> <to> [<output file>]
+ *
+ * where times are either full ("2017-07-14T14:32:05.250") or time of day ("14:32:05"),
+ * the latter being on the date the file starts.
+ */
+class ExtractTool : public QObject
+{
+    Q_OBJECT
+public:
+    static const QString ARGUMENT;
+
+    /**
+     * @brief Runs the tool with command line arguments of the program
+     * @return exit code
+     */
+    static int run(QStringList arguments);
+
+    /**
+     * @brief Extracts items with times in [from, to) from dataFile into outputFile
+     * @return number of items extracted, -1 if failed (reported to Logger)
+     */
+    static qint64 extract(const QString & dataFile, TimeStampType from, TimeStampType to, const QString & outputFile);
+
+private:
+    static qint64 extract(DataReader * reader, const FileIndex * index,
+                          TimeStampType from, TimeStampType to, const QString & outputFile);
+};
+
+#endif // EXTRACTTOOL_H
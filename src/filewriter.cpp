@@ -3,19 +3,42 @@
 #include "logger.h"
 
 #include <QFile>
-#include <QTextStream>
+#include <QFileInfo>
 #include <QDateTime>
+#include <QtConcurrent>
+#include <cmath>
+#include <algorithm>
 
 const QString FileWriter::DEFAULT_OUTPUT_DIR = ".";
 const QString FileWriter::DEFAULT_FILENAME_FORMAT = "%D%M%Y-%h%m%s-%f.w%i";
+const QString FileWriter::PICKS_FILE_NAME = "picks.txt";
+const QString FileWriter::MAGNITUDES_FILE_NAME = "magnitudes.txt";
+const QString FileWriter::POLARIZATION_FILE_NAME = "polarization.txt";
+const QString FileWriter::DETECTIONS_FILE_NAME = "detections.txt";
 PerformanceReporter  FileWriter::perfReporter("FileWriter");
 
+namespace {
+    const double PREPARE_NEXT_AT = 0.95; // Start preparing next files when rotation is this close
+    const QString RESULT_TIME_FORMAT = "ddMMyyyy-hhmmss.zzz"; // Times in logs of results, as in names of files
+    const int JOURNAL_CHECKPOINT_SECS = 60; // Not too often: partial records of MiniSEED are written at checkpoint
+    const QString QUEUE_JOURNAL_NAME = "seismoreg-queue"; // In output directory, with Journal::FILE_SUFFIX
+
+    QString resultTime(TimeStampType time) {
+        return QDateTime::fromMSecsSinceEpoch(qint64(time)).toString(RESULT_TIME_FORMAT);
+    }
+}
+
 FileWriter::FileWriter(QString outputDirectory, QString fileNameFormat, QObject *parent) :
-    QObject(parent), file(NULL), autoWrite(false),
+    QObject(parent), compressionLevel(AsyncFileSink::NO_COMPRESSION), autoWrite(false), formats(OutputFormat::Text),
+    rotationSecs(DEFAULT_ROTATION_SECS), rotationBytes(qint64(DEFAULT_ROTATION_MB) << 20),
+    fileStart(-1), lastTimestamp(0), nextPreparing(false), indexInterval(FileIndex::DEFAULT_INTERVAL), journalEnabled(true),
     deviceID("00"), samplingFreq(0), filterFreq(0),
-    latitude("???"), longitude("???"), itemsInQueue(0)
+    latitude("???"), longitude("???"), itemsInQueue(0),
+    queueBytes(0), maxQueueBytes(qint64(DEFAULT_QUEUE_LIMIT_MB) << 20), spill(NULL),
+    eventRecording(false), preEventMsecs(DEFAULT_PRE_EVENT_SECS*1000.0), postEventMsecs(DEFAULT_POST_EVENT_SECS*1000.0),
+    eventActive(false), recordUntil(-1)
 {
-    setFileName(outputDirectory, fileNameFormat); // will also init `file` instance variable
+    setFileName(outputDirectory, fileNameFormat);
 }
 
 inline QString twoDigitStr(int value) {
@@ -23,7 +46,10 @@ inline QString twoDigitStr(int value) {
 }
 
 QString FileWriter::buildFileName() const {
-    const QDateTime &time = (startTime.isValid() ? startTime : QDateTime::currentDateTime());
+    return buildFileName(startTime.isValid() ? startTime : QDateTime::currentDateTime());
+}
+
+QString FileWriter::buildFileName(const QDateTime & time) const {
     QString fileName = fileNameFormat();
     fileName.replace("%Y", QString::number(time.date().year()));
     fileName.replace("%M", twoDigitStr(time.date().month()));
@@ -37,6 +63,14 @@ QString FileWriter::buildFileName() const {
     return outputDir + "/" + fileName;
 }
 
+QString FileWriter::outputFileName(const QString & baseName, const OutputFormat * format) const {
+    QString fileName = baseName + format->fileSuffix();
+    if (compressionLevel != AsyncFileSink::NO_COMPRESSION) {
+        fileName += GzipCompressor::FILE_SUFFIX;
+    }
+    return fileName;
+}
+
 QString FileWriter::fileNameFormatHelp() {
     return tr("%Y - year\n"
               "%M - month\n"
@@ -63,31 +97,174 @@ void FileWriter::receiveData(TimeStampsVector t, DataVector d) {
     int count = qMin(t.size(), d.size()); // TODO: warn if different or empty
     if (count == 0) { return; }
 
+    if (eventRecording) {
+        receiveEventData(DataBlock(t, d));
+        perfReporter.stop();
+        return;
+    }
+
     if (startTime.isNull()) { // Not set yet
         startTime = QDateTime::fromMSecsSinceEpoch(t.first());
     }
 
-    QByteArray allData;
-    QByteArray number;
-    foreach(const DataItem & item, d) {
-        for(unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
-            number.setNum(item.byChannel[ch]);
-            allData += number;
-            if (ch < CHANNELS_NUM-1) {
-                allData += "    "; // 4 spaces except the last column
-            }
-        }
-        allData += '\n';
+    enqueue(DataBlock(t, d));
+
+    if (autoWrite) {
+        writeNow();
     }
-    waitingQueue.enqueue(allData);
-    itemsInQueue += d.size()*CHANNELS_NUM;
+    perfReporter.stop();
+}
 
-    emit queueSizeChanged(itemsInQueue);
+void FileWriter::receiveEventData(const DataBlock & block) {
+    DataBlock rest = block;
+    if (isRecordingEvent()) {
+        int count = rest.size();
+        if ( ! eventActive ) {
+            const TimeStampType * begin = rest.timestamps.constData();
+            count = int(std::lower_bound(begin, begin + rest.size(), recordUntil) - begin);
+        }
+        if (count > 0) {
+            recordEventData(rest.mid(0, count));
+            rest = rest.mid(count);
+        }
+        if (rest.size() > 0) {
+            finishEvent(); // Post-event time is over
+        }
+    }
+    if (rest.size() > 0) {
+        keepPreEvent(rest);
+    }
+}
 
+void FileWriter::recordEventData(const DataBlock & block) {
+    if (startTime.isNull()) {
+        startTime = QDateTime::fromMSecsSinceEpoch(qint64(block.timestamps.first()));
+    }
+    enqueue(block);
     if (autoWrite) {
         writeNow();
     }
-    perfReporter.stop();
+}
+
+void FileWriter::keepPreEvent(const DataBlock & block) {
+    preEvent.enqueue(block);
+    const TimeStampType oldest = block.timestamps.last() - preEventMsecs;
+    while (preEvent.head().timestamps.last() < oldest) {
+        preEvent.dequeue();
+    }
+}
+
+void FileWriter::setEventRecording(bool enabled, int preEventSecs, int postEventSecs) {
+    closeIfOpened();
+    resetEvent();
+    eventRecording = enabled;
+    preEventMsecs = qMax(0, preEventSecs)*1000.0;
+    postEventMsecs = qMax(0, postEventSecs)*1000.0;
+    if (enabled) {
+        Logger::info(tr("Only events are recorded, with %1 s before and %2 s after them").arg(preEventSecs).arg(postEventSecs));
+    }
+}
+
+void FileWriter::startEvent(TimeStampType time) {
+    if ( ! eventRecording ) {
+        return;
+    }
+    const bool continuing = isRecordingEvent(); // New event in post-event time of the previous one
+    eventActive = true;
+    recordUntil = -1;
+    if (continuing) {
+        return;
+    }
+    // Data of the event that came before the trigger are in preEvent as well
+    const TimeStampType from = time - preEventMsecs;
+    while ( ! preEvent.isEmpty() ) {
+        const DataBlock block = preEvent.dequeue();
+        const TimeStampType * begin = block.timestamps.constData();
+        const int index = int(std::lower_bound(begin, begin + block.size(), from) - begin);
+        if (index < block.size()) {
+            recordEventData(block.mid(index));
+        }
+    }
+}
+
+void FileWriter::endEvent(TimeStampType onTime, TimeStampType offTime) {
+    Q_UNUSED(onTime);
+    if ( ! eventRecording || ! eventActive ) {
+        return;
+    }
+    eventActive = false;
+    recordUntil = offTime + postEventMsecs;
+}
+
+void FileWriter::appendToLog(const QString & fileName, const QString & lines) {
+    QFile file(outputDir + "/" + fileName);
+    if ( ! file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text) ) {
+        Logger::error(tr("Failed to write to %1: %2").arg(file.fileName(), file.errorString()));
+        return;
+    }
+    file.write(lines.toUtf8());
+}
+
+void FileWriter::addPicks(AicPicker::Result result) {
+    const QString trigger = resultTime(result.triggerTime);
+    QString lines;
+    for (const AicPicker::Pick & pick: result.picks) {
+        lines += QString("%1\t%2\t%3\t%4\t%5\n").arg(trigger)
+                 .arg(pick.phase == AicPicker::P ? "P" : "S").arg(CHANNEL_COMPONENTS[pick.channel])
+                 .arg(resultTime(pick.time)).arg(pick.snr, 0, 'f', 1);
+    }
+    if (result.picks.isEmpty()) {
+        lines = QString("%1\t-\n").arg(trigger);
+    }
+    appendToLog(PICKS_FILE_NAME, lines);
+}
+
+void FileWriter::addMagnitude(MagnitudeStage::Result result) {
+    QString line = QString("%1\t%2").arg(resultTime(result.onTime), resultTime(result.offTime));
+    if (result.valid) {
+        line += QString("\t%1").arg(result.magnitude, 0, 'f', 2);
+        for (unsigned ch = 1; ch < CHANNELS_NUM; ++ch) {
+            line += QString("\t%1").arg(result.amplitude[ch], 0, 'g', 4);
+        }
+    } else {
+        line += "\t-";
+    }
+    appendToLog(MAGNITUDES_FILE_NAME, line + "\n");
+}
+
+void FileWriter::addPolarization(PolarizationStage::Event event) {
+    const QString trigger = resultTime(event.onTime);
+    QString lines;
+    for (const Polarization::Values & values: event.series) {
+        lines += QString("%1\t%2\t%3\t%4\t%5\t%6\n").arg(trigger, resultTime(values.time))
+                 .arg(values.rectilinearity, 0, 'f', 3).arg(values.backAzimuth, 0, 'f', 1)
+                 .arg(values.incidence, 0, 'f', 1).arg(values.amplitude, 0, 'g', 4);
+    }
+    appendToLog(POLARIZATION_FILE_NAME, lines);
+}
+
+void FileWriter::addDetection(TemplateMatcher::Detection detection) {
+    appendToLog(DETECTIONS_FILE_NAME, QString("%1\t%2\t%3\t%4\n").arg(detection.templateName, resultTime(detection.time))
+                                      .arg(detection.correlation, 0, 'f', 3).arg(detection.threshold, 0, 'f', 3));
+}
+
+void FileWriter::finishEvent() {
+    resetEvent();
+    if (autoWrite) {
+        closeIfOpened(); // The next event goes to new files
+    }
+}
+
+void FileWriter::resetEvent() {
+    preEvent.clear();
+    eventActive = false;
+    recordUntil = -1;
+}
+
+void FileWriter::finishFile() {
+    closeIfOpened();
+    resetEvent(); // Trigger is reset after a pause in data as well
+    latestStats.clear(); // Statistics are reset too, and they would be of old data
 }
 
 void FileWriter::setAutoWriteEnabled(bool enabled) {
@@ -106,7 +283,7 @@ void FileWriter::setAutoWriteEnabled(bool enabled) {
 
 
 
-        if (! waitingQueue.isEmpty()) {
+        if (! isQueueEmpty()) {
             writeNow();
         }
     } else {
@@ -114,6 +291,14 @@ void FileWriter::setAutoWriteEnabled(bool enabled) {
     }
 }
 
+void FileWriter::setOutputFormats(OutputFormat::Types newFormats) {
+    if (formats == newFormats) {
+        return; // Nothing changed
+    }
+    formats = newFormats;
+    closeIfOpened();
+}
+
 void FileWriter::writeOnce() {
     writeNow();
     closeIfOpened();
@@ -126,8 +311,74 @@ void FileWriter::setDeviceID(QString id)
     Logger::info(tr("Device id: %1").arg(id));
 }
 
+namespace {
+    // Approximate memory taken by block in queue
+    inline qint64 blockBytes(const DataBlock & block) {
+        return qint64(sizeof(DataBlock))
+             + qint64(sizeof(TimeStampType))*block.timestamps.size()
+             + qint64(sizeof(DataItem))*block.data.size();
+    }
+}
+
+void FileWriter::enqueue(const DataBlock & block) {
+    if ( ! autoWrite ) {
+        journalQueued(block); // Else written right away, and journaled with files
+    }
+    qint64 bytes = blockBytes(block);
+    bool mustSpill = (spill != NULL && ! spill->isEmpty()) // Keep order: once spilled, all newer data are spilled too
+                  || (queueBytes + bytes > maxQueueBytes);
+    if ( ! autoWrite && mustSpill ) {
+        if (spill == NULL) {
+            spill = new SpillFile(outputDir);
+            Logger::info(tr("Queue exceeded %1 MB, further data are kept in temporary file").arg(maxQueueBytes >> 20));
+        }
+        if (spill->append(block)) {
+            itemsInQueue += block.size()*CHANNELS_NUM;
+            emitQueueSize();
+            return;
+        }
+        // Else failed (already reported): keep data in memory, this is better than losing them
+    }
+    waitingQueue.enqueue(block);
+    queueBytes += bytes;
+    itemsInQueue += block.size()*CHANNELS_NUM;
+    emitQueueSize();
+}
+
+void FileWriter::clearQueue() {
+    waitingQueue.clear();
+    queueBytes = 0;
+    itemsInQueue = 0;
+    delete spill; // Also removes temporary file
+    spill = NULL;
+    queueJournal.clear(); // Removes it: data are dropped
+    emitQueueSize();
+}
+
+void FileWriter::journalQueued(const DataBlock & block) {
+    if ( ! journalEnabled ) {
+        return;
+    }
+    if ( ! queueJournal ) {
+        Journal::Header header; // Without files: blocks are restored into queue
+        header.info = fileInfo();
+        queueJournal = QSharedPointer<Journal>(new Journal(Journal::fileNameFor(outputDir + "/" + QUEUE_JOURNAL_NAME), journalPolicy));
+        queueJournal->open(header); // If failed (reported), appends fail silently until the queue is written
+    }
+    queueJournal->append(block);
+}
+
+void FileWriter::emitQueueSize() {
+    emit queueSizeChanged(itemsInQueue);
+    emit queueBytesChanged(queueBytes, (spill != NULL) ? spill->bytes() : 0);
+}
+
+bool FileWriter::isQueueEmpty() const {
+    return waitingQueue.isEmpty() && (spill == NULL || spill->isEmpty());
+}
+
 void FileWriter::writeNow() {
-    if(waitingQueue.isEmpty()) {
+    if(isQueueEmpty()) {
         Logger::warning(tr("Nothing to write to file"));
         return; // Nothing to write
     }
@@ -135,71 +386,547 @@ void FileWriter::writeNow() {
     if ( openIfClosed() == false ) { return; } // Failed to open
 
     // Swap existing queue with empty one to quickly move all from waiting queue to writeQueue and clear writeQueue
-    QQueue<QString> writeQueue;
+    QQueue<DataBlock> writeQueue;
     writeQueue.swap(waitingQueue);
     int itemsWritten = itemsInQueue;
     itemsInQueue = 0;
-    emit queueSizeChanged(itemsInQueue);
+    queueBytes = 0;
 
-    // And write everything from writeQueue
-    QTextStream out(file);
-    foreach (auto str, writeQueue) {
-        out << str;
+    // And write everything from writeQueue in every format
+    foreach (const DataBlock & block, writeQueue) {
+        writeBlock(block);
+    }
+    // Then newer data from spill file, block by block, so that they never take much memory
+    if (spill != NULL && ! spill->isEmpty()) {
+        Logger::info(tr("Writing %1 MB of queue from temporary file").arg(spill->bytes() / 1e6, 0, 'f', 1));
+        DataBlock block;
+        if (spill->startReading()) {
+            while (spill->readBlock(block)) {
+                writeBlock(block);
+            }
+        }
+        spill->clear();
+    }
+    if (queueJournal) {
+        retireJournal(queueJournal); // Data are journaled with files now
+        queueJournal.clear();
     }
-    Logger::trace(tr("Written %1 items to file %2").arg(itemsWritten).arg(file->fileName()));
+    emitQueueSize();
+    Logger::trace(tr("Written %1 items to %2 file(s)").arg(itemsWritten).arg(outputs.size()));
+}
+
+OutputFormat::FileInfo FileWriter::fileInfo() const {
+    OutputFormat::FileInfo info;
+    info.deviceID = deviceID;
+    info.samplingFreq = samplingFreq;
+    info.filterFreq = filterFreq;
+    info.latitude = latitude;
+    info.longitude = longitude;
+    info.startTime = startTime;
+    info.stats = latestStats;
+    info.units = units;
+    return info;
 }
 
 bool FileWriter::openIfClosed() {
-    if (file == NULL) {
-        file = new QFile(buildFileName());
-    }
-    if ( ! file->isOpen()) {
-        bool newFile = ! file->exists();
-        bool success = file->open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text);
-        if ( ! success ) {
-            Logger::error(tr("Failed to open file %1: %2").arg(file->fileName()).arg(file->errorString()));
-            return false;
-        } else {
-            Logger::info(tr("Opened file %1").arg(file->fileName()));
+    if ( ! outputs.isEmpty() ) {
+        return true; // Already opened
+    }
+    QVector<PreparedFile> prepared = takePrepared();
+    if (formats == 0) {
+        Logger::warning(tr("No output format is selected"));
+        return false;
+    }
 
-            if (newFile) {
-                writeHeader();
-            }// TODO: else: do what? Append - incorrect, rewrite - should ask
-            return true;
+    const OutputFormat::FileInfo info = fileInfo();
+    const QString baseName = buildFileName();
+    journalHeader = Journal::Header();
+    journalHeader.info = info;
+    journalHeader.formatOptions = formatOptions;
+    journalHeader.compressionLevel = compressionLevel;
+    for (OutputFormat::Type type: OutputFormat::ALL_TYPES) {
+        if ( ! formats.testFlag(type) ) {
+            continue;
         }
+        Output output;
+        output.format = OutputFormat::create(type, formatOptions);
+        output.index = NULL;
+        const QString fileName = outputFileName(baseName, output.format);
+
+        PreparedFile file = prepared.isEmpty() ? PreparedFile() : prepared.takeFirst();
+        if (file.sink != NULL && file.sink->fileName() != fileName && ! file.sink->rename(fileName)) {
+            // Time of the first item is not as expected, and the file cannot be renamed (e.g. already exists)
+            discardFile(file);
+            file = PreparedFile();
+        }
+        if (file.sink == NULL) {
+            file.sink = new AsyncFileSink(fileName, syncPolicy, compressionLevel);
+            file.newFile = ! QFile::exists(fileName);
+            if ( ! file.sink->open() ) {
+                // Error is already reported by sink. Forget all files to try again with the next data
+                delete file.sink;
+                delete output.format;
+                for (const PreparedFile & rest: prepared) {
+                    discardFile(rest);
+                }
+                closeOutputs();
+                return false;
+            }
+        }
+        output.sink = file.sink;
+        output.sink->setParent(this);
+        Logger::info(tr("Opened file %1").arg(output.sink->fileName()));
+
+        journalHeader.types << type;
+        journalHeader.fileNames << output.sink->fileName();
+        journalHeader.initialSizes << QFileInfo(output.sink->fileName()).size();
+
+        output.format->open(info);
+        if (file.newFile) {
+            output.sink->write(output.format->header(info));
+            output.index = createIndex(output, indexInterval, compressionLevel); // Offsets are known only in a new file
+        }// TODO: else: do what? Append - incorrect, rewrite - should ask
+        outputs << output;
+    }
+    for (const PreparedFile & rest: prepared) {
+        discardFile(rest); // Formats changed since preparing: should not happen
+    }
+    if (journalEnabled) {
+        journalBaseName = baseName;
+        journal = QSharedPointer<Journal>(new Journal(Journal::fileNameFor(baseName), journalPolicy));
+        if ( ! journal->open(journalHeader) ) {
+            journal.clear(); // Error is reported, write without journal
+        }
+        sinceCheckpoint.start();
     }
     return true;
 }
 
-void FileWriter::writeHeader() {
-    QTextStream out(file);
-    out << QStringLiteral("[Description]\n");
-    out << tr("Device ID=%1").arg(deviceID);
-    out << QStringLiteral("\n[Frequency]\n");
-    out << tr("%1 Hz").arg(filterFreq);
-    out << QStringLiteral("\n[Sample rate]\n");
-    out << tr("%1 Hz").arg(samplingFreq);
-    out << QStringLiteral("\n[Time]\n%1\n").arg(startTime.toString("hh:mm:ss"));
-    out << QStringLiteral("[Coordinates]\n");
-    out << tr("%1 deg. - latitude\n").arg(latitude);
-    out << tr("%1 deg. - longitude\n").arg(longitude);
-    out << QStringLiteral("[Date]\n%1\n").arg(startTime.toString("dd.MM.yyyy"));
-    out << QStringLiteral("[Values]\n");
+void FileWriter::writeBlock(const DataBlock & block) {
+    DataBlock rest = block;
+    if (fileStart < 0) {
+        fileStart = rest.timestamps.first();
+    }
+    int index;
+    while ((index = rotationIndex(rest)) >= 0) {
+        if (index > 0) {
+            writeToOutputs(rest.mid(0, index));
+            rest = rest.mid(index);
+        }
+        rotate(rest.timestamps.first());
+        if (outputs.isEmpty()) {
+            Logger::error(tr("Failed to open new files after rotation, %1 items are lost").arg(rest.size()*CHANNELS_NUM));
+            return;
+        }
+    }
+    writeToOutputs(rest);
+}
+
+void FileWriter::writeToOutputs(const DataBlock & block) {
+    if (journal) {
+        journal->append(block); // Before data go to buffers that can be lost
+    }
+    for (const Output & output: outputs) {
+        if (output.index != NULL) {
+            output.index->addBlock(block, output.sink->bytesWritten());
+        }
+        output.sink->write(output.format->appendBlock(block));
+    }
+    lastTimestamp = block.timestamps.last();
+    dropDurableJournals();
+    if (journal && journalHeader.compressionLevel == AsyncFileSink::NO_COMPRESSION
+     && sinceCheckpoint.hasExpired(qMax(JOURNAL_CHECKPOINT_SECS, syncPolicy.intervalSecs)*1000)) {
+        checkpointJournal();
+    }
+    prepareNextIfNeeded();
+}
+
+QVector<qint64> FileWriter::flushOutputs() {
+    QVector<qint64> marks;
+    for (const Output & output: outputs) {
+        output.sink->write(output.format->flush()); // Records being filled: the rest is at clean state
+        marks << output.sink->bytesWritten();
+    }
+    return marks;
+}
+
+void FileWriter::checkpointJournal() {
+    sinceCheckpoint.start(); // Even if failed: try again later
+    const QVector<qint64> marks = flushOutputs();
+    // The new journal replays files from this point: they are not compressed, so their sizes are known
+    Journal::Header header = journalHeader;
+    for (int i = 0; i < marks.size(); ++i) {
+        header.initialSizes[i] += marks[i];
+    }
+    QSharedPointer<Journal> next(new Journal(Journal::fileNameFor(journalBaseName), journalPolicy));
+    if ( ! next->open(header) ) {
+        return; // Reported, the current journal goes on
+    }
+    journal->finish();
+    retiredJournals << RetiredJournal{journal, marks};
+    journal = next;
+}
+
+void FileWriter::retireJournal(QSharedPointer<Journal> retired) {
+    retired->finish();
+    retiredJournals << RetiredJournal{retired, flushOutputs()};
+}
+
+void FileWriter::dropDurableJournals() {
+    // Retired in order of marks: the oldest become durable first
+    while ( ! retiredJournals.isEmpty() ) {
+        const QVector<qint64> & marks = retiredJournals.first().marks;
+        for (int i = 0; i < marks.size() && i < outputs.size(); ++i) {
+            if (outputs[i].sink->durableBytes() < marks[i]) {
+                return;
+            }
+        }
+        retiredJournals.removeFirst(); // Removes the file
+    }
+}
+
+int FileWriter::rotationIndex(const DataBlock & block) const {
+    if (outputs.isEmpty() || block.size() == 0) {
+        return -1;
+    }
+    if (rotationSecs > 0) {
+        const TimeStampType boundary = rotationBoundary();
+        const TimeStampType * begin = block.timestamps.constData();
+        const TimeStampType * end = begin + block.size();
+        if (*(end - 1) >= boundary) {
+            // The first item that doesn't fit starts the next file
+            return int(std::lower_bound(begin, end, boundary) - begin);
+        }
+    }
+    if (rotationBytes > 0 && outputBytes() >= rotationBytes) {
+        return 0;
+    }
+    return -1;
+}
+
+TimeStampType FileWriter::rotationBoundary() const {
+    // Aligned to the clock, not to the first item: it may come at any time after an event or a restart
+    const double period = rotationSecs*1000.0;
+    return (std::floor(fileStart / period) + 1) * period;
+}
+
+qint64 FileWriter::outputBytes() const {
+    qint64 res = 0;
+    for (const Output & output: outputs) {
+        res = qMax(res, output.sink->bytesWritten());
+    }
+    return res;
+}
+
+void FileWriter::rotate(TimeStampType nextStart) {
+    closeOutputs();
+    startTime = QDateTime::fromMSecsSinceEpoch(qint64(nextStart));
+    fileStart = nextStart;
+    if (openIfClosed()) {
+        emit fileRotated();
+    }
+}
+
+void FileWriter::prepareNextIfNeeded() {
+    if (nextPreparing || outputs.isEmpty() || ! autoWrite) {
+        return; // Already preparing, or files are not written continuously
+    }
+    // How close the rotation is, when the next file is expected to start, and how large it is relative to this one
+    double progress = 0;
+    TimeStampType nextStart = 0;
+    double nextScale = 1;
+    const double elapsed = lastTimestamp - fileStart;
+    if (rotationSecs > 0) {
+        // The first file may be shorter than the period: the next one is full
+        const double period = rotationSecs*1000.0;
+        nextStart = rotationBoundary();
+        progress = 1 - (nextStart - lastTimestamp) / period;
+        nextScale = elapsed > 0 ? period / elapsed : 1;
+    }
+    const qint64 bytes = outputBytes();
+    if (rotationBytes > 0 && double(bytes)/rotationBytes > progress && bytes > 0) {
+        progress = double(bytes)/rotationBytes;
+        nextStart = lastTimestamp + elapsed*(rotationBytes - bytes)/bytes;
+        nextScale = 1 / progress;
+    }
+    if (progress < PREPARE_NEXT_AT) {
+        return;
+    }
+
+    const QString baseName = buildFileName(QDateTime::fromMSecsSinceEpoch(qint64(nextStart)));
+    if (baseName == buildFileName()) {
+        return; // Next files would have the same names: they will be opened when needed
+    }
+    QStringList fileNames;
+    QVector<qint64> sizes;
+    for (const Output & output: outputs) {
+        fileNames << outputFileName(baseName, output.format);
+        sizes << qint64(output.sink->bytesWritten() * nextScale); // Expected size of the next file
+    }
+    nextFiles = QtConcurrent::run(&FileWriter::prepareFiles, fileNames, sizes, syncPolicy, compressionLevel, thread());
+    nextPreparing = true;
+}
+
+QVector<FileWriter::PreparedFile> FileWriter::prepareFiles(QStringList fileNames, QVector<qint64> sizes,
+                                                           AsyncFileSink::SyncPolicy policy, int compressionLevel,
+                                                           QThread * thread) {
+    // Runs in thread pool: opening file and reserving space can take a while
+    QVector<PreparedFile> res;
+    for (int i = 0; i < fileNames.size(); ++i) {
+        PreparedFile file;
+        file.newFile = ! QFile::exists(fileNames[i]);
+        file.sink = new AsyncFileSink(fileNames[i], policy, compressionLevel);
+        if (file.sink->open()) {
+            file.sink->preallocate(sizes[i]);
+            file.sink->moveToThread(thread); // To be used by FileWriter
+        } else {
+            delete file.sink;
+            file.sink = NULL;
+        }
+        res << file;
+    }
+    return res;
+}
+
+QVector<FileWriter::PreparedFile> FileWriter::takePrepared() {
+    if ( ! nextPreparing ) {
+        return QVector<PreparedFile>();
+    }
+    nextPreparing = false;
+    nextFiles.waitForFinished(); // Usually already finished long ago
+    return nextFiles.result();
+}
+
+void FileWriter::discardPrepared() {
+    for (const PreparedFile & file: takePrepared()) {
+        discardFile(file);
+    }
+}
+
+void FileWriter::discardFile(PreparedFile file) {
+    if (file.sink == NULL) {
+        return;
+    }
+    file.sink->close();
+    file.sink->wait();
+    if (file.newFile) {
+        QFile::remove(file.sink->fileName()); // Nothing was written to it
+    }
+    delete file.sink;
 }
 
 void FileWriter::closeIfOpened() {
-    waitingQueue.clear();
-    itemsInQueue = 0;
-    emit queueSizeChanged(itemsInQueue);
+    clearQueue();
     startTime = QDateTime(); // set null datetime so that it will be reset next time
-    if(file != NULL && file->isOpen()) {
-        file->close();
-        Logger::info(tr("Closed file %1").arg(file->fileName()));
+    closeOutputs();
+    discardPrepared();
+}
+
+void FileWriter::closeOutputs() {
+    if (journal) {
+        journal->finish(); // Reported when released with the last of its files
     }
-    delete file;
-    file = NULL;
+    for (const Output & output: outputs) {
+        // Write the rest of data, even if records are not full
+        output.sink->write(output.format->flush());
+        output.format->close();
+        delete output.format;
+        if (output.index != NULL) {
+            output.index->close();
+            delete output.index;
+        }
+
+        // Don't wait for I/O thread to write the rest: it will report and delete itself when finished
+        AsyncFileSink * closingSink = output.sink;
+        closingJournals.insert(closingSink, journal);
+        for (const RetiredJournal & retired: retiredJournals) {
+            closingJournals.insert(closingSink, retired.journal);
+        }
+        connect(closingSink, &QThread::finished, this, [this, closingSink](){
+            closingSink->reportResults();
+            releaseJournal(closingSink);
+            closingSink->deleteLater();
+        });
+        closingSink->close();
+        Logger::info(tr("Closed file %1").arg(closingSink->fileName()));
+    }
+    outputs.clear();
+    journal.clear();
+    retiredJournals.clear();
+    fileStart = -1;
+}
+
+FileIndex * FileWriter::createIndex(const Output & output, int interval, int compressionLevel) {
+    // Offsets in compressed files don't allow seeking
+    if (interval <= 0 || ! output.format->isIndexable() || compressionLevel != AsyncFileSink::NO_COMPRESSION) {
+        return NULL;
+    }
+    FileIndex * index = new FileIndex(interval);
+    if ( ! index->create(FileIndex::fileNameFor(output.sink->fileName())) ) {
+        delete index; // Reported, write without index
+        return NULL;
+    }
+    return index;
+}
+
+void FileWriter::releaseJournal(AsyncFileSink * closedSink) {
+    // A journal is removed when the last of its files is released
+    for (const QSharedPointer<Journal> & closedJournal: closingJournals.values(closedSink)) {
+        if (closedJournal && ! closedSink->isDurable()) {
+            Logger::warning(tr("File %1 may be incomplete on disk, journal %2 is kept to recover it on the next start")
+                            .arg(closedSink->fileName(), closedJournal->fileName()));
+            closedJournal->keep();
+        }
+    }
+    closingJournals.remove(closedSink);
+}
+
+void FileWriter::recoverJournals() {
+    struct Found {
+        QString name;
+        Journal::Header header;
+    };
+    QList<Found> found;
+    for (const QString & journalName: Journal::findAll(outputDir)) {
+        Journal::Reader reader(journalName);
+        Found journal{journalName, Journal::Header()};
+        if (reader.open(journal.header)) { // Else reported, the file is left for investigation
+            found << journal;
+        }
+    }
+    // Journals of the same files (after checkpoints) are replayed in order, each one starts where
+    // the previous one ends. Journals of queue go last: their data can be written to files already
+    std::stable_sort(found.begin(), found.end(), [](const Found & a, const Found & b) {
+        if (a.header.fileNames.isEmpty() || b.header.fileNames.isEmpty()) {
+            return b.header.fileNames.isEmpty() && ! a.header.fileNames.isEmpty();
+        }
+        if (a.header.fileNames.first() != b.header.fileNames.first()) {
+            return a.header.fileNames.first() < b.header.fileNames.first();
+        }
+        return a.header.initialSizes.first() < b.header.initialSizes.first();
+    });
+    TimeStampType recoveredUntil = 0;
+    for (const Found & journal: found) {
+        if (journal.header.fileNames.isEmpty()) {
+            restoreQueue(journal.name, recoveredUntil);
+        } else {
+            recoverJournal(journal.name, recoveredUntil);
+        }
+    }
+}
+
+bool FileWriter::restoreQueue(const QString & journalName, TimeStampType recoveredUntil) {
+    Journal::Reader reader(journalName);
+    Journal::Header header;
+    if ( ! reader.open(header) ) {
+        return false;
+    }
+    qint64 itemsRestored = 0;
+    DataBlock block;
+    while (reader.readBlock(block)) {
+        if (block.size() == 0 || block.timestamps.last() <= recoveredUntil) {
+            continue; // Written to files before the crash, and recovered from their journal
+        }
+        if (startTime.isNull()) {
+            startTime = QDateTime::fromMSecsSinceEpoch(qint64(block.timestamps.first()));
+        }
+        enqueue(block); // Journaled again
+        itemsRestored += block.size()*CHANNELS_NUM;
+    }
+    if (reader.isTruncated()) {
+        Logger::warning(tr("Journal %1 ends with incomplete record: data after its last commit are lost").arg(journalName));
+    }
+    reader.close();
+    QFile::remove(journalName);
+    Logger::info(tr("Restored %1 items into queue from journal %2").arg(itemsRestored).arg(journalName));
+    if (autoWrite && ! isQueueEmpty()) {
+        writeNow();
+    }
+    return true;
+}
+
+bool FileWriter::recoverJournal(const QString & journalName, TimeStampType & recoveredUntil) {
+    Journal::Reader reader(journalName);
+    Journal::Header header;
+    if ( ! reader.open(header) ) {
+        return false; // Reported by reader, the file is left for investigation
+    }
+    Logger::info(tr("Recovering files from journal %1 left after crash").arg(journalName));
+
+    bool ok = true;
+    QVector<Output> recovered;
+    for (int i = 0; i < header.fileNames.size() && ok; ++i) {
+        // Data written after journal was started are dropped: they are written again from the journal
+        const QString & fileName = header.fileNames[i];
+        const bool existed = QFile::exists(fileName);
+        if (existed && ! QFile::resize(fileName, header.initialSizes[i])) {
+            Logger::error(tr("Failed to truncate file %1 for recovery").arg(fileName));
+            ok = false;
+            break;
+        }
+        Output output;
+        output.format = OutputFormat::create(header.types[i], header.formatOptions);
+        output.index = NULL;
+        output.sink = new AsyncFileSink(fileName, AsyncFileSink::SyncPolicy(0, 0), header.compressionLevel);
+        if (output.format == NULL || ! output.sink->open()) {
+            delete output.format;
+            delete output.sink;
+            ok = false;
+            break;
+        }
+        output.format->open(header.info);
+        if ( ! existed || header.initialSizes[i] == 0 ) {
+            output.sink->write(output.format->header(header.info));
+            output.index = createIndex(output, indexInterval, header.compressionLevel); // Old one is incomplete
+        }
+        recovered << output;
+    }
+
+    qint64 itemsRecovered = 0;
+    DataBlock block;
+    while (ok && reader.readBlock(block)) {
+        for (const Output & output: recovered) {
+            if (output.index != NULL) {
+                output.index->addBlock(block, output.sink->bytesWritten());
+            }
+            output.sink->write(output.format->appendBlock(block));
+        }
+        itemsRecovered += block.size()*CHANNELS_NUM;
+        if (block.size() > 0) {
+            recoveredUntil = qMax(recoveredUntil, block.timestamps.last());
+        }
+    }
+    if (reader.isTruncated()) {
+        Logger::warning(tr("Journal %1 ends with incomplete record: data after its last commit are lost").arg(journalName));
+    }
+    reader.close();
+
+    for (const Output & output: recovered) {
+        output.sink->write(output.format->flush());
+        output.format->close();
+        delete output.format;
+        delete output.index; // Closes it
+        output.sink->close();
+        output.sink->wait(); // File is synced when I/O thread finishes
+        ok = ok && output.sink->isDurable();
+        delete output.sink;
+    }
+    if ( ! ok ) {
+        Logger::error(tr("Failed to recover files from journal %1, it is kept").arg(journalName));
+        return false;
+    }
+    QFile::remove(journalName);
+    Logger::info(tr("Recovered %1 items into %2 file(s) from journal %3").arg(itemsRecovered).arg(recovered.size()).arg(journalName));
+    return true;
 }
 
 FileWriter::~FileWriter() {
     closeIfOpened();
+    // Here the event loop is already stopped, so wait for I/O threads that are still writing
+    for (AsyncFileSink * closingSink: findChildren<AsyncFileSink*>()) {
+        closingSink->wait();
+        closingSink->reportResults();
+        releaseJournal(closingSink);
+        delete closingSink;
+    }
 }
@@ -3,12 +3,24 @@
 
 #include "protocol.h"
 #include "performancereporter.h"
+#include "writers/asyncfilesink.h"
+#include "writers/outputformat.h"
+#include "writers/spillfile.h"
+#include "writers/journal.h"
+#include "writers/fileindex.h"
+#include "dsp/aicpicker.h"
+#include "dsp/magnitudestage.h"
+#include "dsp/polarizationstage.h"
+#include "dsp/templatematcher.h"
 
 #include <QObject>
 #include <QQueue>
 #include <QDateTime>
-
-class QFile;
+#include <QFuture>
+#include <QStringList>
+#include <QSharedPointer>
+#include <QHash>
+#include <QElapsedTimer>
 
 /*!
  * \brief FileWriter maintains queue of data that should be written to file
@@ -31,6 +43,48 @@ class QFile;
  *     as soon as they are received.
  *   - If autowrite is disabled, the data that is already in queue
  *     will be written when calling FileWriter::writeOnce
+ *
+ * While autowrite is disabled, the queue can grow for a long time, so it is limited
+ * in memory (\see FileWriter::setQueueLimit). Data beyond the limit are spilled to
+ * a temporary binary file in output directory (\see SpillFile) and are written
+ * from it after the data in memory.
+ *
+ * Data are written in each of selected formats (\see FileWriter::setOutputFormats)
+ * into its own file, all files having the same name except for suffix
+ * (\see OutputFormat::fileSuffix).
+ *
+ * Files are rotated by FileWriter itself according to rotation policy
+ * (\see FileWriter::setRotationPolicy): when a file reaches a boundary of rotation
+ * period by the clock (e.g. on the hour) or is large enough, it is closed exactly
+ * before the first data item that doesn't fit, and this item starts a new file. To make the switch cheap, the next files are created
+ * (and their disk space is reserved) in background shortly before the rotation.
+ *
+ * "Written" here means passed to AsyncFileSink, which actually writes data on
+ * its own I/O thread and syncs them to disk according to its SyncPolicy
+ * (\see FileWriter::setSyncPolicy), so that slow disk never blocks FileWriter.
+ *
+ * To survive a crash or a power loss, data written to files are also appended
+ * to a journal (\see Journal), one per set of opened files, which is group-committed
+ * (\see FileWriter::setJournalPolicy). The journal only has to hold data that are not
+ * synced to files yet, so about once a minute a new journal is started: records being
+ * filled by formats are written out, and the new journal replays the files from their
+ * sizes at this point. The previous journal is removed as soon as the files are synced
+ * beyond that point. Compressed files cannot be truncated at such a point, so their
+ * journal covers the whole files until they are closed and synced.
+ *
+ * While autowrite is disabled, queued data are journaled too, until they are written
+ * to files. Journals left after a crash are replayed by FileWriter::recoverJournals.
+ *
+ * Next to each new uncompressed file of indexable format, an index of sample times and
+ * byte offsets is written (\see FileIndex, FileWriter::setIndexInterval), so that
+ * a time window can be read without scanning the whole file (\see ExtractTool).
+ *
+ * In event recording mode (\see FileWriter::setEventRecording) only events are
+ * written: while there is no event, the latest data (pre-event time) are only kept
+ * in memory. When a trigger fires (\see FileWriter::startEvent), they are written
+ * followed by data of the event, until post-event time after its end passes
+ * (\see FileWriter::endEvent). Each event goes to its own files, named by the
+ * time of their first item, as usual.
  */
 class FileWriter : public QObject
 {
@@ -58,22 +112,39 @@ public:
      *
      * Default is %D%M%Y-%h%m%s-%f.w%i
      *
+     * Suffix of output format is appended to the name (\see OutputFormat::fileSuffix),
+     * and also GzipCompressor::FILE_SUFFIX if files are compressed.
+     *
      * \see fileNameFormatHelp() to show same help text in application
      * \return current filename format
      */
     QString fileNameFormat() const { return fileFormat; }
     static const QString DEFAULT_OUTPUT_DIR;
     static const QString DEFAULT_FILENAME_FORMAT;
+    static const int DEFAULT_QUEUE_LIMIT_MB = 64;
+    static const int DEFAULT_ROTATION_SECS = 60*60; // New file every hour
+    static const int DEFAULT_ROTATION_MB = 0;       // No limit of file size
+    static const int DEFAULT_PRE_EVENT_SECS = 60;
+    static const int DEFAULT_POST_EVENT_SECS = 60;
+    static const QString PICKS_FILE_NAME;
+    static const QString MAGNITUDES_FILE_NAME;
+    static const QString POLARIZATION_FILE_NAME;
+    static const QString DETECTIONS_FILE_NAME;
 
     static QString fileNameFormatHelp();
 
     bool autoWriteEnabled() { return autoWrite; }
 
+    OutputFormat::Types outputFormats() const { return formats; }
+
     QString buildFileName() const;
 
     ~FileWriter();
 signals:
     void queueSizeChanged(unsigned newSize);
+    void queueBytesChanged(qint64 memoryBytes, qint64 spilledBytes);
+    /// Emitted when files are rotated: the new ones are opened
+    void fileRotated();
     
 public slots:
     /*!
@@ -104,6 +175,22 @@ public slots:
      */
     void setAutoWriteEnabled(bool enabled);
 
+    /*!
+     * \brief Sets formats of output files: data will be written to one file per format.
+     *        Closes previously opened files, so that the next ones will be opened in new formats.
+     */
+    void setOutputFormats(OutputFormat::Types newFormats);
+
+    /*!
+     * \brief Sets parameters of MiniSEED format for files opened after this call
+     * \param network - SEED network code (2 characters)
+     * \param recordLength - length of records, either 512 or 4096
+     */
+    void setMiniSeedParameters(QString network, int recordLength) {
+        formatOptions.miniSeedNetwork = network;
+        formatOptions.miniSeedRecordLength = recordLength;
+    }
+
     /*!
      * \brief Opens file, writes all data currently in queue, closes file
      */
@@ -112,10 +199,10 @@ public slots:
     /*!
      * \brief Finishes and closes file: newly received data will cause a new file to be opened.
      *
-     * Useful after closing protocol before opening it with another settings,
-     * or when the size of file exceeds some limit
+     * Useful after closing protocol before opening it with another settings.
+     * Rotation of files by time or size doesn't need this: \see setRotationPolicy
      */
-    void finishFile() { closeIfOpened(); }
+    void finishFile();
 
     // Settings for header:
     // TODO: (?) should we check that data are already being received,
@@ -126,38 +213,266 @@ public slots:
         this->latitude  = QString::number(latitude, 'f', 6);
         this->longitude = QString::number(longitude, 'f', 6);
     }
+    /// Units of recorded values, empty - counts of ADC (\see ResponseStage)
+    void setUnits(QString units) {
+        this->units = units;
+    }
     void setFrequencies(int samplingFreq, int filterFreq) {
         this->samplingFreq = samplingFreq;
         this->filterFreq   = filterFreq;
     }
+    /// The latest statistics of data, written to text headers of files opened after this (\see StatsStage).
+    /// Optional: without them, headers are the same as before statistics were added
+    void setStats(TimeStampType time, QVector<SlidingStats::Values> stats) {
+        Q_UNUSED(time);
+        latestStats = stats;
+    }
+
+    /*!
+     * \brief Sets when a new file is started: whatever happens first
+     * \param periodSecs - at multiples of this number of seconds since the epoch (UTC), e.g. on the hour
+     *        for 3600, so that boundaries of files don't drift after events and restarts (0 - never by time)
+     * \param sizeMegabytes - ...or when the file is larger than this (0 - never by size)
+     */
+    void setRotationPolicy(int periodSecs, int sizeMegabytes) {
+        rotationSecs  = periodSecs;
+        rotationBytes = qint64(sizeMegabytes) << 20;
+    }
+
+    /*!
+     * \brief Enables gzip compression of files opened after this call
+     * \param level - compression level from 0 to 9, or AsyncFileSink::NO_COMPRESSION
+     */
+    void setCompressionLevel(int level) {
+        compressionLevel = level;
+        discardPrepared(); // They are prepared with another compression
+    }
+
+    /*!
+     * \brief Sets how much memory the queue can take while autowrite is disabled.
+     *        Data beyond this limit are kept in temporary file.
+     */
+    void setQueueLimit(int megabytes) {
+        maxQueueBytes = qint64(megabytes) << 20;
+    }
+
+    /*!
+     * \brief Sets durability policy for files opened after this call
+     * \param intervalSecs - sync written data to disk at least once in this number of seconds (0 - never by time)
+     * \param intervalMegabytes - ...or after this number of megabytes is written (0 - never by size)
+     */
+    void setSyncPolicy(int intervalSecs, int intervalMegabytes) {
+        syncPolicy = AsyncFileSink::SyncPolicy(intervalSecs, qint64(intervalMegabytes) << 20);
+    }
+
+    /*!
+     * \brief Sets journaling of files opened after this call
+     * \param enabled - whether to keep journal of written data at all
+     * \param commitBlocks - commit journal after this number of data blocks (0 - never by count)
+     * \param commitMsecs - ...or when this time passed since the last commit (0 - never by time)
+     */
+    void setJournalPolicy(bool enabled, int commitBlocks, int commitMsecs) {
+        journalEnabled = enabled;
+        journalPolicy = Journal::CommitPolicy(commitBlocks, commitMsecs);
+    }
+
+    /*!
+     * \brief Sets how often an index entry is written for files opened after this call
+     * \param samples - number of data items between entries, 0 - don't write index
+     */
+    void setIndexInterval(int samples) {
+        indexInterval = samples;
+    }
+
+    /*!
+     * \brief Enables recording of events only, instead of continuous recording.
+     *        Closes previously opened files.
+     * \param preEventSecs - data for this number of seconds before the start of event are written too
+     * \param postEventSecs - ...and after its end
+     */
+    void setEventRecording(bool enabled, int preEventSecs, int postEventSecs);
+
+    /*!
+     * \brief Starts recording of event (if event recording is enabled), \see StaLtaTrigger::triggerOn
+     * \param time - when the event started: data from pre-event time before it are written
+     */
+    void startEvent(TimeStampType time);
+
+    /*!
+     * \brief Lets recording of event finish after post-event time, \see StaLtaTrigger::triggerOff
+     * \param onTime - when the event started
+     * \param offTime - when it ended
+     */
+    void endEvent(TimeStampType onTime, TimeStampType offTime);
+
+    /*!
+     * \brief Appends picks of an event (\see PickerStage) to PICKS_FILE_NAME in output directory
+     *
+     * One line per pick: time of trigger, phase, component, time of onset and its SNR
+     * (times as in names of files, with milliseconds), so that picks can be matched with
+     * files of the event. An event without picks is written with "-" instead of them.
+     */
+    void addPicks(AicPicker::Result result);
+
+    /*!
+     * \brief Appends magnitude of an event (\see MagnitudeStage) to MAGNITUDES_FILE_NAME in output directory
+     *
+     * One line per event: times of trigger on and off (as in names of files), ML and peak
+     * Wood-Anderson amplitudes of horizontal channels in mm. An event without data is
+     * written with "-" instead of them.
+     */
+    void addMagnitude(MagnitudeStage::Result result);
+
+    /*!
+     * \brief Appends polarization series of an event (\see PolarizationStage) to
+     *        POLARIZATION_FILE_NAME in output directory
+     *
+     * One line per value: time of trigger, time of value (as in names of files),
+     * rectilinearity, back-azimuth and incidence in degrees, and amplitude.
+     */
+    void addPolarization(PolarizationStage::Event event);
+
+    /*!
+     * \brief Appends a detection of template matching (\see TemplateStage) to
+     *        DETECTIONS_FILE_NAME in output directory
+     *
+     * One line per detection: name of template, time (as in names of files),
+     * correlation and threshold at the time.
+     */
+    void addDetection(TemplateMatcher::Detection detection);
+
+    /*!
+     * \brief Rewrites output files from journals left in output directory after a crash
+     *
+     * Should be called on start, before any data are written. Files are truncated
+     * to their sizes before journaled writes and all journaled data are written again
+     * in the formats they were written. Journals of queue are restored into the queue,
+     * except for data that are already recovered into files. Successfully replayed
+     * journals are removed.
+     */
+    void recoverJournals();
 
 private:
 
     void writeNow();
-    void writeHeader();
+    void receiveEventData(const DataBlock & block);
+    void recordEventData(const DataBlock & block);
+    void keepPreEvent(const DataBlock & block);
+    void finishEvent();
+    void resetEvent();
+    bool isRecordingEvent() const { return eventActive || recordUntil >= 0; }
+    void writeBlock(const DataBlock & block);
+    void writeToOutputs(const DataBlock & block);
+    void enqueue(const DataBlock & block);
+    void clearQueue();
+    void emitQueueSize();
+    bool isQueueEmpty() const;
+    OutputFormat::FileInfo fileInfo() const;
+    /// Appends \a lines to log of results \a fileName in output directory (failure is reported to Logger)
+    void appendToLog(const QString & fileName, const QString & lines);
 
     /**
-     * @brief Opens file if it is not opened yet
+     * @brief Opens files (one per output format) if they are not opened yet
      * @return true if succesfully opened (or already opened) and ready to write,
-     *         false if failed to open and cannot write
+     *         false if failed to open any of them and cannot write
      */
     bool openIfClosed();
     void closeIfOpened();
+    void closeOutputs(); // Closes files, but keeps data in queue
+    void releaseJournal(AsyncFileSink * closedSink);
+    QVector<qint64> flushOutputs();
+    void checkpointJournal();
+    void retireJournal(QSharedPointer<Journal> retired);
+    void dropDurableJournals();
+    void journalQueued(const DataBlock & block);
+    bool recoverJournal(const QString & journalName, TimeStampType & recoveredUntil);
+    bool restoreQueue(const QString & journalName, TimeStampType recoveredUntil);
+    QString buildFileName(const QDateTime & time) const;
+    QString outputFileName(const QString & baseName, const OutputFormat * format) const;
+
+    // Rotation
+    int rotationIndex(const DataBlock & block) const;
+    TimeStampType rotationBoundary() const; // The end of opened files by time
+    void rotate(TimeStampType nextStart);
+    qint64 outputBytes() const;
+
+    // Preparing of next files in background
+    struct PreparedFile {
+        AsyncFileSink * sink; // NULL if failed to open
+        bool newFile;
+        PreparedFile() : sink(NULL), newFile(false) {}
+    };
+    static QVector<PreparedFile> prepareFiles(QStringList fileNames, QVector<qint64> sizes,
+                                              AsyncFileSink::SyncPolicy policy, int compressionLevel, QThread * thread);
+    void prepareNextIfNeeded();
+    QVector<PreparedFile> takePrepared();
+    void discardPrepared();
+    static void discardFile(PreparedFile file);
 
     QString outputDir;
     QString fileFormat;
-    QFile * file;
+    AsyncFileSink::SyncPolicy syncPolicy;
+    int compressionLevel;
     bool autoWrite;
 
+    OutputFormat::Types formats;
+    OutputFormat::Options formatOptions;
+
+    int rotationSecs;
+    qint64 rotationBytes;
+    TimeStampType fileStart;     // Timestamp of the first item in opened files (negative if closed)
+    TimeStampType lastTimestamp; // Timestamp of the last item written to opened files
+    bool nextPreparing;          // Whether next files are being prepared
+    QFuture< QVector<PreparedFile> > nextFiles; // One per output format, in the same order as `outputs`
+
+    // Opened file of one output format
+    struct Output {
+        OutputFormat * format;
+        AsyncFileSink * sink;
+        FileIndex * index; // NULL if not indexed
+    };
+    static FileIndex * createIndex(const Output & output, int interval, int compressionLevel);
+    QVector<Output> outputs; // Empty when files are closed
+
+    int indexInterval;
+    bool journalEnabled;
+    Journal::CommitPolicy journalPolicy;
+    QSharedPointer<Journal> journal; // Of opened files, NULL if disabled or failed
+    Journal::Header journalHeader;   // Of opened files: a new journal starts from it at checkpoint
+    QString journalBaseName;
+    QElapsedTimer sinceCheckpoint;
+    // Journal that is replaced (by checkpoint) or whose data are written (of queue) is removed
+    // when opened files are synced up to marks: their bytesWritten when it was retired
+    struct RetiredJournal {
+        QSharedPointer<Journal> journal;
+        QVector<qint64> marks; // One per output
+    };
+    QList<RetiredJournal> retiredJournals; // The oldest first
+    QMultiHash< AsyncFileSink*, QSharedPointer<Journal> > closingJournals; // Removed when all their files are closed
+    QSharedPointer<Journal> queueJournal; // Of data in waitingQueue and spill, NULL if queue is empty or journal is disabled
+
     QString deviceID;
     int samplingFreq;
     int filterFreq;
     QString latitude;
     QString longitude;
     QDateTime startTime;
+    QVector<SlidingStats::Values> latestStats; // Empty if not known since the last finishFile
+    QString units;
 
-    QQueue<QString> waitingQueue;
+    QQueue<DataBlock> waitingQueue; // Blocks of data are formatted when written to file
     int itemsInQueue; // Since multiple date items are in one waitingQueue item, a separate count is needed
+    qint64 queueBytes; // Memory taken by waitingQueue
+    qint64 maxQueueBytes;
+    SpillFile * spill; // Data that didn't fit into waitingQueue: always newer than data in it. Created on demand
+
+    // Event recording
+    bool eventRecording;
+    TimeStampType preEventMsecs;
+    TimeStampType postEventMsecs;
+    QQueue<DataBlock> preEvent; // The latest data while event is not recorded
+    bool eventActive;           // Trigger is on
+    TimeStampType recordUntil;  // End of post-event time after trigger is off (negative if not recording)
 };
 
 #endif // FILEWRITER_H
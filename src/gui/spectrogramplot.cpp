@@ -0,0 +1,162 @@
+#include "spectrogramplot.h"
+#include "timeplot.h"
+#include "qwt_plot_spectrogram.h"
+#include "qwt_raster_data.h"
+#include "qwt_color_map.h"
+#include "qwt_date.h"
+#include "qwt_date_scale_draw.h"
+#include "qwt_date_scale_engine.h"
+#include <qmath.h>
+#include <limits>
+#include <algorithm>
+
+namespace {
+    const QColor BG_COLOR = Qt::white;
+    const double MIN_DENSITY = 1e-30; // To take logarithm of zero
+
+    class TimeScaleDraw : public QwtDateScaleDraw {
+    protected:
+        QString dateFormatOfDate(const QDateTime &, QwtDate::IntervalType) const override {
+            return "hh:mm:ss";
+        }
+    };
+}
+
+/**
+ * Ring of spectra in dB. Column i covers times (times[i-1], times[i]],
+ * and bin k covers frequencies around k*binWidth.
+ */
+class SpectrogramData : public QwtRasterData {
+public:
+    SpectrogramData() : bins(0), binWidth(0), first(0), count(0) {}
+
+    bool isEmpty() const { return count == 0; }
+    TimeStampType lastTime() const { return times[(first + count - 1) % times.size()]; }
+    double maxFrequency() const { return (bins - 1) * binWidth; }
+
+    void clear() {
+        count = 0;
+        first = 0;
+    }
+
+    void append(TimeStampType time, double newBinWidth, const QVector<double> & psd) {
+        if (psd.size() != bins || newBinWidth != binWidth) {
+            bins = psd.size();
+            binWidth = newBinWidth;
+            times.resize(SpectrogramPlot::MAX_COLUMNS);
+            values.resize(SpectrogramPlot::MAX_COLUMNS * bins);
+            maxima.resize(SpectrogramPlot::MAX_COLUMNS);
+            clear();
+            setInterval(Qt::YAxis, QwtInterval(0, maxFrequency()));
+        }
+        if ( ! isEmpty() && time <= lastTime() ) {
+            clear(); // Time went back: a new series of data
+        }
+        int column;
+        if (count < times.size()) {
+            column = (first + count) % times.size();
+            ++count;
+        } else {
+            column = first; // Replaces the oldest one
+            first = (first + 1) % times.size();
+        }
+        times[column] = time;
+        float * dst = values.data() + column*bins;
+        float maximum = -std::numeric_limits<float>::max();
+        for (int k = 0; k < bins; ++k) {
+            dst[k] = float(10*log10(qMax(psd[k], MIN_DENSITY)));
+            maximum = qMax(maximum, dst[k]);
+        }
+        maxima[column] = maximum;
+        updateRange();
+    }
+
+    double value(double x, double y) const override {
+        if (count == 0 || binWidth <= 0) {
+            return qQNaN();
+        }
+        // The first column with time not earlier than x
+        int lo = 0, hi = count;
+        while (lo < hi) {
+            const int mid = (lo + hi) / 2;
+            if (times[(first + mid) % times.size()] < x) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        if (lo == count || (lo == 0 && count > 1 && x < 2*times[first] - times[(first + 1) % times.size()])) {
+            return qQNaN(); // After the last column or well before the first one
+        }
+        const int bin = qRound(y / binWidth);
+        if (bin < 0 || bin >= bins) {
+            return qQNaN();
+        }
+        return values[((first + lo) % times.size())*bins + bin];
+    }
+
+private:
+    void updateRange() {
+        // Maximum of visible columns, so that colors adapt to signal
+        float maximum = maxima[first];
+        for (int i = 1; i < count; ++i) {
+            maximum = qMax(maximum, maxima[(first + i) % times.size()]);
+        }
+        setInterval(Qt::ZAxis, QwtInterval(maximum - SpectrogramPlot::DYNAMIC_RANGE, maximum));
+    }
+
+    int bins;
+    double binWidth;
+    QVector<TimeStampType> times;
+    QVector<float> values; // Column after column
+    QVector<float> maxima; // Of each column
+    int first;
+    int count;
+};
+
+SpectrogramPlot::SpectrogramPlot(QWidget *parent) :
+    QwtPlot(parent), historySeconds(TimePlot::HISTORY_SECONDS_DEFAULT)
+{
+    setMinimumHeight(75);
+    setMinimumWidth(200);
+    setAxisScaleDraw(xBottom, new TimeScaleDraw);
+    setAxisScaleEngine(xBottom, new QwtDateScaleEngine);
+    setCanvasBackground(BG_COLOR);
+
+    spectrogram = new QwtPlotSpectrogram;
+    QwtLinearColorMap * colorMap = new QwtLinearColorMap(Qt::darkBlue, Qt::darkRed);
+    colorMap->addColorStop(0.3, Qt::cyan);
+    colorMap->addColorStop(0.6, Qt::green);
+    colorMap->addColorStop(0.85, Qt::yellow);
+    spectrogram->setColorMap(colorMap);
+    data = new SpectrogramData;
+    spectrogram->setData(data);
+    spectrogram->attach(this);
+    setTimeRange(QwtDate::toDouble(QDateTime::currentDateTime()));
+}
+
+void SpectrogramPlot::receiveSpectrum(TimeStampType time, double binWidth, QVector<double> psd) {
+    if (psd.isEmpty()) {
+        return;
+    }
+    data->append(time, binWidth, psd);
+    setAxisScale(yLeft, 0, data->maxFrequency());
+    setTimeRange(time);
+    replot();
+}
+
+void SpectrogramPlot::clearHistory() {
+    data->clear();
+    replot();
+}
+
+void SpectrogramPlot::setHistorySecs(double secs) {
+    historySeconds = secs;
+    setTimeRange(data->isEmpty() ? QwtDate::toDouble(QDateTime::currentDateTime()) : data->lastTime());
+}
+
+void SpectrogramPlot::setTimeRange(TimeStampType last) {
+    const double first = last - historySeconds*1000;
+    data->setInterval(Qt::XAxis, QwtInterval(first, last));
+    setAxisScale(xBottom, first, last);
+}
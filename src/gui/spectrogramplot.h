@@ -0,0 +1,49 @@
+#ifndef SPECTROGRAMPLOT_H
+#define SPECTROGRAMPLOT_H
+
+#include "qwt_plot.h"
+#include "../protocol.h"
+
+class QwtPlotSpectrogram;
+class SpectrogramData;
+
+/**
+ * @brief Spectrogram of one channel: power spectral density versus time and frequency
+ *
+ * Receives spectra one by one (e.g. from SpectrumStage::spectrumReady) and shows
+ * the latest ones that fit into history time, with the same time axis as TimePlot.
+ * Spectra are kept in a ring of columns, so that a new spectrum only replaces
+ * the oldest column, and the raster is not rebuilt.
+ */
+class SpectrogramPlot : public QwtPlot
+{
+    Q_OBJECT
+public:
+    explicit SpectrogramPlot(QWidget *parent = nullptr);
+
+public slots:
+    /**
+     * @brief Adds a new column to the end of spectrogram and replots
+     * @param time - time of the column (of the last sample of its segment)
+     * @param binWidth - frequency step of @a psd, Hz
+     * @param psd - power spectral density from 0 Hz
+     */
+    void receiveSpectrum(TimeStampType time, double binWidth, QVector<double> psd);
+
+    void clearHistory();
+
+    void setHistorySecs(double secs);
+
+public:
+    constexpr static const int    MAX_COLUMNS   = 1024;
+    constexpr static const double DYNAMIC_RANGE = 60; // dB of colors below the maximum
+
+private:
+    void setTimeRange(TimeStampType last);
+
+    QwtPlotSpectrogram * spectrogram;
+    SpectrogramData * data; // Owned by spectrogram
+    double historySeconds;
+};
+
+#endif // SPECTROGRAMPLOT_H
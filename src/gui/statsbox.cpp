@@ -1,6 +1,5 @@
 #include "statsbox.h"
 #include "ui_statsbox.h"
-#include "../logger.h"
 
 StatsBox::StatsBox(QWidget *parent) :
     QFrame(parent),
@@ -9,52 +8,23 @@ StatsBox::StatsBox(QWidget *parent) :
     ui->setupUi(this);
 }
 
-void StatsBox::setStats(DataType min, DataType max, DataType avg) {
-    prevStats = curStats;
-    curStats.min = min;
-    curStats.max = max;
-    curStats.avg = avg;
-
-    updateWidgets();
-}
-
-void StatsBox::setStats(DataVector items, int ch) {
-    if (items.isEmpty()) {
-        Logger::warning(tr("Cannot calculate stats for empty data"));
-        return;
-    }
-
-    DataType min, max;
-    min = max = items[0].byChannel[ch];
-    double avg = 0;
-    foreach (DataItem item, items) {
-        DataType val  = item.byChannel[ch];
-        if (val < min) {
-            min = val;
-        }
-        if (val > max) {
-            max = val;
-        }
-        avg += val;
-    }
-    avg /= items.count();
-
-    setStats(min, max, avg);
+void StatsBox::setStats(const SlidingStats::Values & stats) {
+    updateWidget(ui->min,        stats.min);
+    updateWidget(ui->max,        stats.max);
+    updateWidget(ui->peakToPeak, stats.peakToPeak());
+    updateWidget(ui->mean,       stats.mean);
+    updateWidget(ui->rms,        stats.rms);
+    updateWidget(ui->stdDev,     stats.stdDev);
 }
 
 StatsBox::~StatsBox() {
     delete ui;
 }
 
-void StatsBox::updateWidgets() {
-    updateWidget(ui->prevMin, prevStats.min);
-    updateWidget(ui->prevMax, prevStats.max);
-    updateWidget(ui->prevAvg, prevStats.avg);
-    updateWidget(ui->curMin,  curStats.min);
-    updateWidget(ui->curMax,  curStats.max);
-    updateWidget(ui->curAvg,  curStats.avg);
-}
-
 void StatsBox::updateWidget(QLineEdit *w, DataType val) {
     w->setText(QString::number(val));
 }
+
+void StatsBox::updateWidget(QLineEdit *w, double val) {
+    w->setText(QString::number(val, 'f', 1));
+}
@@ -2,6 +2,7 @@
 #define STATSBOX_H
 
 #include "../protocol.h"
+#include "../dsp/slidingstats.h"
 #include <QFrame>
 #include <QLineEdit>
 
@@ -17,38 +18,18 @@ public:
     explicit StatsBox(QWidget *parent = nullptr);
 
     /**
-     * @brief Sets current stats:
-     * @param min - minimum
-     * @param max - maximum
-     * @param avg - average
+     * @brief Sets current stats of one channel over the sliding window
+     *        (\see StatsStage): min, max, peak-to-peak, mean, RMS and standard deviation
      */
-    void setStats(DataType min, DataType max, DataType avg);
-
-    /**
-     * @brief Calculates and sets current stats.
-     *
-     * Overloaded version for ease of use:
-     * takes an array of items and calculates the stats
-     * @param items - data vector
-     * @param ch - number of channel to calculate stats for
-     */
-    void setStats(DataVector items, int ch);
+    void setStats(const SlidingStats::Values & stats);
 
     virtual ~StatsBox();
     
 private:
     Ui::StatsBox *ui;
 
-    void updateWidgets();
     void updateWidget(QLineEdit * w, DataType val);
-
-    struct Stats {
-        DataType min;
-        DataType max;
-        DataType avg;
-        // Default constructor to avoid uninitialized values
-        Stats() : min(0), max(0), avg(0) {}
-    } prevStats, curStats;
+    void updateWidget(QLineEdit * w, double val);
 };
 
 #endif // STATSBOX_H
@@ -1,4 +1,6 @@
 #include "mainwindow.h"
+#include "benchmark.h"
+#include "extracttool.h"
 #include <QApplication>
 #include <QTranslator>
 #include <QDebug>
@@ -9,10 +11,24 @@
 #include "protocol.h"
 #include "logger.h"
 #include "worker.h"
+#include "filewriter.h"
+#include "dsp/qualitystage.h"
+#include "dsp/aicpicker.h"
+#include "dsp/magnitudestage.h"
+#include "dsp/polarizationstage.h"
+#include "dsp/templatestage.h"
 Q_DECLARE_METATYPE(TimeStampsVector)
 Q_DECLARE_METATYPE(DataVector)
 Q_DECLARE_METATYPE(Logger::Level)
 Q_DECLARE_METATYPE(Worker::PrepareResult)
+Q_DECLARE_METATYPE(OutputFormat::Types)
+Q_DECLARE_METATYPE(SlidingStats::Values)
+Q_DECLARE_METATYPE(QualityStage::Metrics)
+Q_DECLARE_METATYPE(AicPicker::Result)
+Q_DECLARE_METATYPE(MagnitudeStage::Result)
+Q_DECLARE_METATYPE(Polarization::Values)
+Q_DECLARE_METATYPE(PolarizationStage::Event)
+Q_DECLARE_METATYPE(TemplateMatcher::Detection)
 
 int main(int argc, char *argv[])
 {
@@ -21,9 +37,28 @@ int main(int argc, char *argv[])
 
     qRegisterMetaType<TimeStampsVector>("TimeStampsVector");
     qRegisterMetaType<DataVector>("DataVector");
+    qRegisterMetaType<TimeStampType>("TimeStampType");
+    qRegisterMetaType< QVector<double> >("QVector<double>");
+    qRegisterMetaType< QVector<SlidingStats::Values> >("QVector<SlidingStats::Values>");
+    qRegisterMetaType<QualityStage::Metrics>("QualityStage::Metrics");
+    qRegisterMetaType<AicPicker::Result>("AicPicker::Result");
+    qRegisterMetaType<MagnitudeStage::Result>("MagnitudeStage::Result");
+    qRegisterMetaType< QVector<Polarization::Values> >("QVector<Polarization::Values>");
+    qRegisterMetaType<PolarizationStage::Event>("PolarizationStage::Event");
+    qRegisterMetaType<TemplateMatcher::Detection>("TemplateMatcher::Detection");
     // TODO: should do something to correctly pass log messages between threads
     qRegisterMetaType<Logger::Level>("Level");
     qRegisterMetaType<Worker::PrepareResult>("PrepareResult");
+    qRegisterMetaType<OutputFormat::Types>("OutputFormat::Types");
+
+    if (a.arguments().contains(Benchmark::ARGUMENT)) {
+        // Run benchmarks instead of GUI
+        return Benchmark::runAll() ? 0 : 1;
+    }
+    if (a.arguments().contains(ExtractTool::ARGUMENT)) {
+        // Extract time window from data file instead of GUI
+        return ExtractTool::run(a.arguments());
+    }
 
     QTranslator translator, qtTranslator;
     translator.load("seismoreg_" + QLocale::system().name());
@@ -6,6 +6,7 @@
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QThread>
+#include <QLabel>
 #include <qwt_scale_div.h>
 
 #include "protocols/testprotocol.h"
@@ -15,7 +16,21 @@
 #include "system.h"
 #include "gui/statsbox.h"
 #include "gui/timeplot.h"
+#include "gui/spectrogramplot.h"
 #include "gui/portsettingsdialog.h"
+#include "dsp/stagegraph.h"
+#include "dsp/staltatrigger.h"
+#include "dsp/spectrumstage.h"
+#include "dsp/ppsdstage.h"
+#include "dsp/filterstage.h"
+#include "dsp/responsestage.h"
+#include "dsp/pickerstage.h"
+#include "dsp/magnitudestage.h"
+#include "dsp/polarizationstage.h"
+#include "dsp/templatestage.h"
+#include "dsp/sinkstage.h"
+#include "dsp/statsstage.h"
+#include "dsp/qualitystage.h"
 
 namespace {
     const QString TEST_PROTOCOL = "TEST";
@@ -25,8 +40,11 @@ namespace {
     const int FREQ_1   = 1;
 
     const int TIME_SYNC_PERIOD_SECS = 60; // sync time every minute
-    const int NEW_FILE_PERIOD_SECS  = 60*60; // reset file every hour
     const int MAX_WAIT = 5000; // Wait background threads no more than 5 secs
+    const int REPLAY_BLOCK_SECS = 60; // History is replayed into processing by blocks of a minute
+    // Blocks of Worker are a second of data: a stage drops the oldest ones when it falls behind by so many
+    const int STAGE_QUEUE_LIMIT = 60;
+    const int BACKGROUND_QUEUE_LIMIT = 10*60; // Idle stages get only CPU time left by the others
 
     void initPortChooser(QComboBox * chooser, QString initialValue) {
         chooser->addItem(TEST_PROTOCOL);
@@ -95,16 +113,30 @@ MainWindow::MainWindow(QWidget *parent) :
      *  - some data may be lost (not written to file) when thread is finished
      *  - ...
      */
+    archiveWriter = new ArchiveWriter;
     threadFileWriter = new QThread;
     fileWriter->moveToThread(threadFileWriter);
+    archiveWriter->moveToThread(threadFileWriter); // Both sinks are disk-bound
     threadFileWriter->start();
     worker = new Worker;
     threadWorker = new QThread;
     worker->moveToThread(threadWorker);
     threadWorker->start(QThread::HighestPriority);
+    processing = new StageGraph;
+    trigger = NULL;
+    picker = NULL;
+    magnitude = NULL;
+    polarization = NULL;
+    templates = NULL;
+    recorded = NULL;
+    plotsCorrected = false;
+    statistics = NULL;
+    qualityLabel = NULL;
+    polarizationLabel = NULL;
 
     initWidgetsArray(plots, ui->plotArea, ui->plotArea2, ui->plotArea3);
     initWidgetsArray(stats, ui->stats, ui->stats2, ui->stats3);
+    initSpectrograms();
 
     setup();
 }
@@ -113,6 +145,7 @@ void MainWindow::setup() {
     Settings settings;
     // Init connections
     initWorkerHandlers();
+    initProcessing(); // Before file handlers: they are connected to trigger
     initFileHandlers();
     // Configure toolbar and status bar
     ui->mainToolBar->setContextMenuPolicy(Qt::PreventContextMenu);
@@ -239,6 +272,8 @@ void MainWindow::setup() {
         }
         // Calls Worker::setFrequencies and FileWriter::setFrequencies
         emit frequenciesSet(samplingFrequency, filterFrequency);
+        // Before Worker starts: live data are queued after the history
+        restartProcessing();
         // Calls Worker::start, this will also trigger setFileControlsState
         emit starting();
     });
@@ -271,6 +306,15 @@ void MainWindow::setup() {
         ui->ledWorking->setValue(false);
     });
     checkOutputDirectory();
+
+    // Show data received before the program was started
+    if (settings.historyRingHours() > 0) {
+        history.reset(new HistoryRing(settings.historyRingFile()));
+        if ( ! history->open(HistoryRing::capacityFor(settings.historyRingHours(), FREQ_200)) ) {
+            history.reset();
+        }
+    }
+    restoreHistory();
 }
 
 void MainWindow::initWorkerHandlers() {
@@ -282,7 +326,7 @@ void MainWindow::initWorkerHandlers() {
     connect(worker, &Worker::prepareFinished,   this, &MainWindow::onPrepareFinished);
     connect(worker, &Worker::dataUpdated,       this, &MainWindow::onDataReceived);
     connect(worker, &Worker::positionAvailable, fileWriter, &FileWriter::setCoordinates);
-    connect(worker, &Worker::dataUpdated,       fileWriter, &FileWriter::receiveData);
+    connect(worker, &Worker::dataUpdated,       archiveWriter, &ArchiveWriter::receiveData);
     connect(worker, &Worker::startedOrStopped,  this, &MainWindow::onStartedOrStopped);
 
     // Outcoming
@@ -294,20 +338,193 @@ void MainWindow::initWorkerHandlers() {
     connect(this, &MainWindow::frequenciesSet,     worker, &Worker::setFrequencies);
 }
 
+void MainWindow::initProcessing() {
+    Settings settings;
+    QList<Stage*> background; // Stages of idle priority
+    // Of raw data: offset and range of the sensor matter
+    statistics = processing->add(new StatsStage(tr("Stats"), settings.statsWindowSecs()));
+    connect(statistics, &StatsStage::statsReady, this, &MainWindow::onStatsReceived);
+    if (settings.isQualityEnabled()) {
+        // Of raw data too; reports minutes with problems and hourly summaries to Logger itself
+        QualityStage * quality = processing->add(new QualityStage(tr("Quality"), settings.qualityParameters()));
+        qualityLabel = new QLabel(tr("Quality: no data"), this);
+        ui->statusBar->addPermanentWidget(qualityLabel);
+        connect(quality, &QualityStage::minuteReady, this, &MainWindow::onQualityReceived);
+    }
+    Stage * filter = NULL; // Source of processed data for display, trigger and recording, NULL - raw data
+    Stage * corrected = NULL; // Data in physical units, NULL if not corrected
+    if (settings.isResponseCorrected()) {
+        corrected = processing->add(new ResponseStage(tr("Response"), settings.responseParameters()));
+        filter = corrected;
+        plotsResponse = settings.responseParameters();
+        plotsCorrected = true;
+    }
+    if (settings.filterParameters().type != ButterworthFilter::None) {
+        filter = processing->add(new FilterStage(tr("Filter"), settings.filterParameters()), filter);
+        plotsFilter = settings.filterParameters();
+    }
+    if (filter != NULL) {
+        // Plots are fed from here instead of onDataReceived
+        SinkStage * display = processing->add(new SinkStage(tr("Display")), filter);
+        for (TimePlot * plot: plots) {
+            connect(display, &SinkStage::blockReady, plot, &TimePlot::receiveData);
+        }
+        if (settings.isFilteredRecording()) {
+            recorded = processing->add(new SinkStage(tr("Recording")), filter);
+        }
+    }
+    if (settings.isTriggerEnabled()) {
+        // Reports events to Logger itself
+        trigger = processing->add(new StaLtaTrigger(tr("STA/LTA trigger"), settings.triggerParameters()), filter);
+    }
+    if (settings.isPickerEnabled()) {
+        if (trigger == NULL) {
+            Logger::warning(tr("Phase picker needs the trigger to be enabled, events are not picked"));
+        } else {
+            // Reports picks to Logger itself; picking is on its own threads
+            picker = processing->add(new PickerStage(tr("Picker"), settings.pickerParameters()), filter);
+            connect(trigger, &StaLtaTrigger::triggerOn, picker, &PickerStage::addEvent, Qt::DirectConnection);
+        }
+    }
+    if (settings.isMagnitudeEnabled()) {
+        if (trigger == NULL || corrected == NULL) {
+            Logger::warning(tr("Magnitude estimation needs the trigger and response correction to be enabled, "
+                               "magnitudes are not estimated"));
+        } else {
+            // Of unfiltered data: the Wood-Anderson response is the filter; reports magnitudes to Logger itself
+            magnitude = processing->add(new MagnitudeStage(tr("Magnitude"), settings.magnitudeParameters()), corrected);
+            connect(trigger, &StaLtaTrigger::triggerOn,  magnitude, &MagnitudeStage::startEvent, Qt::DirectConnection);
+            connect(trigger, &StaLtaTrigger::triggerOff, magnitude, &MagnitudeStage::endEvent, Qt::DirectConnection);
+        }
+    }
+    if (settings.isPolarizationEnabled()) {
+        // Of processed data, as the plots; reports events to Logger itself
+        polarization = processing->add(new PolarizationStage(tr("Polarization"), settings.polarizationParameters()), filter);
+        polarizationLabel = new QLabel(tr("Polarization: no data"), this);
+        polarizationLabel->setToolTip(tr("Rectilinearity, back-azimuth and incidence of the latest %1 s")
+                                      .arg(settings.polarizationParameters().windowSecs));
+        ui->statusBar->addPermanentWidget(polarizationLabel);
+        connect(polarization, &PolarizationStage::valuesReady, this, &MainWindow::onPolarizationReceived);
+        if (trigger != NULL) {
+            connect(trigger, &StaLtaTrigger::triggerOn,  polarization, &PolarizationStage::startEvent, Qt::DirectConnection);
+            connect(trigger, &StaLtaTrigger::triggerOff, polarization, &PolarizationStage::endEvent, Qt::DirectConnection);
+        }
+    }
+    if (settings.isTemplateMatchingEnabled()) {
+        const QString dir = settings.templatesDirectory();
+        const QVector<TemplateMatcher::Template> library = TemplateStage::loadTemplates(dir);
+        if (library.isEmpty()) {
+            Logger::warning(tr("Template matching is disabled: no templates in %1").arg(dir));
+        } else {
+            // Of processed data: templates are cut out of files written after the same filter
+            templates = processing->add(new TemplateStage(tr("Templates"), library, settings.templateParameters()), filter);
+        }
+    }
+    if (spectrograms[0] != NULL) {
+        // One stage per channel: they run in parallel
+        for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+            SpectrumStage * spectrum = processing->add(new SpectrumStage(tr("Spectrum %1").arg(ch + 1), ch, settings.spectrumParameters()));
+            connect(spectrum, &SpectrumStage::spectrumReady, spectrograms[ch], &SpectrogramPlot::receiveSpectrum);
+        }
+    }
+    if (settings.isPpsdEnabled()) {
+        for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+            PpsdStage * ppsd = processing->add(new PpsdStage(tr("PPSD %1").arg(ch + 1), ch,
+                                                             settings.ppsdDirectory(), settings.ppsdSegmentSecs()));
+            ppsd->setThreadPriority(QThread::IdlePriority); // Background analysis
+            background << ppsd;
+        }
+    }
+    // Memory stays bounded if a stage cannot keep up (\see Stage::setQueueLimit)
+    for (Stage * stage: processing->stages()) {
+        stage->setQueueLimit(background.contains(stage) ? BACKGROUND_QUEUE_LIMIT : STAGE_QUEUE_LIMIT);
+    }
+    // The graph only queues data for its thread pool, so it is fed directly in the thread of Worker
+    connect(worker, &Worker::dataUpdated,       processing, &StageGraph::receiveData, Qt::DirectConnection);
+    connect(this,   &MainWindow::frequenciesSet, processing, &StageGraph::setFrequencies);
+    // Reset by restartProcessing when acquisition starts
+}
+
+void MainWindow::initSpectrograms() {
+    Settings settings;
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        spectrograms[ch] = NULL;
+    }
+    if ( ! settings.isSpectrogramShown() ) {
+        return;
+    }
+    // Next to each plot, between it and stats
+    void (QSpinBox:: *valueChangedSignal)(int) = &QSpinBox::valueChanged; // resolve overloaded function
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        spectrograms[ch] = new SpectrogramPlot(this);
+        spectrograms[ch]->setHistorySecs(settings.plotHistorySecs());
+        connect(ui->timeInterval, valueChangedSignal, spectrograms[ch], &SpectrogramPlot::setHistorySecs);
+        ui->gridLayout_5->removeWidget(stats[ch]);
+        ui->gridLayout_5->addWidget(spectrograms[ch], int(ch), 1);
+        ui->gridLayout_5->addWidget(stats[ch], int(ch), 2);
+    }
+    ui->gridLayout_5->setColumnStretch(0, 2);
+    ui->gridLayout_5->setColumnStretch(1, 1);
+    ui->gridLayout_5->setColumnStretch(2, 0);
+}
+
 void MainWindow::initFileHandlers() {
 
     connect(this,               &MainWindow::autoWriteChanged, fileWriter, &FileWriter::setAutoWriteEnabled);
     connect(this,               &MainWindow::frequenciesSet,   fileWriter, &FileWriter::setFrequencies);
     connect(this,               &MainWindow::deviceIdSet,      fileWriter, &FileWriter::setDeviceID);
+    connect(this,               &MainWindow::unitsSet,         fileWriter, &FileWriter::setUnits);
+    connect(this,               &MainWindow::syncPolicySet,    fileWriter, &FileWriter::setSyncPolicy);
+    connect(this,               &MainWindow::queueLimitSet,    fileWriter, &FileWriter::setQueueLimit);
+    connect(this,               &MainWindow::miniSeedParametersSet, fileWriter, &FileWriter::setMiniSeedParameters);
+    connect(this,               &MainWindow::outputFormatsChanged,  fileWriter, &FileWriter::setOutputFormats);
     connect(this,               &MainWindow::stopping,         fileWriter, &FileWriter::finishFile);
     connect(this,               &MainWindow::finishing,        fileWriter, &FileWriter::finishFile);
-    connect(this,               &MainWindow::finishingFile,    fileWriter, &FileWriter::finishFile);
+    connect(this,               &MainWindow::rotationPolicySet, fileWriter, &FileWriter::setRotationPolicy);
+    connect(this,               &MainWindow::compressionLevelSet, fileWriter, &FileWriter::setCompressionLevel);
+    connect(this,               &MainWindow::journalPolicySet, fileWriter, &FileWriter::setJournalPolicy);
+    connect(this,               &MainWindow::indexIntervalSet, fileWriter, &FileWriter::setIndexInterval);
+    connect(this,               &MainWindow::eventRecordingSet, fileWriter, &FileWriter::setEventRecording);
+    if (Settings().isStatsInHeaderEnabled()) {
+        // Otherwise FileWriter has no statistics, and headers have no section of them
+        connect(statistics,     &StatsStage::statsReady,       fileWriter, &FileWriter::setStats);
+    }
+    if (recorded != NULL) {
+        connect(recorded,       &SinkStage::blockReady,        fileWriter, &FileWriter::receiveData);
+    } else {
+        connect(worker,         &Worker::dataUpdated,          fileWriter, &FileWriter::receiveData);
+    }
+    if (trigger != NULL) {
+        connect(trigger,        &StaLtaTrigger::triggerOn,     fileWriter, &FileWriter::startEvent);
+        connect(trigger,        &StaLtaTrigger::triggerOff,    fileWriter, &FileWriter::endEvent);
+    }
+    if (picker != NULL) {
+        connect(picker,         &PickerStage::picked,          fileWriter, &FileWriter::addPicks);
+    }
+    if (magnitude != NULL) {
+        connect(magnitude,      &MagnitudeStage::magnitudeReady, fileWriter, &FileWriter::addMagnitude);
+    }
+    if (polarization != NULL) {
+        connect(polarization,   &PolarizationStage::eventReady, fileWriter, &FileWriter::addPolarization);
+    }
+    if (templates != NULL) {
+        connect(templates,      &TemplateStage::detected, fileWriter, &FileWriter::addDetection);
+    }
+    connect(this,               &MainWindow::recoveringJournals, fileWriter, &FileWriter::recoverJournals);
+    connect(this,               &MainWindow::archivePolicySet, archiveWriter, &ArchiveWriter::setArchivePolicy);
+    connect(this,               &MainWindow::frequenciesSet,   archiveWriter, &ArchiveWriter::setFrequencies);
+    connect(this,               &MainWindow::deviceIdSet,      archiveWriter, &ArchiveWriter::setDeviceID);
+    connect(this,               &MainWindow::stopping,         archiveWriter, &ArchiveWriter::finish);
+    connect(this,               &MainWindow::finishing,        archiveWriter, &ArchiveWriter::finish);
     connect(ui->outputDir,      &QLineEdit::editingFinished,   this,       &MainWindow::onFileNameChanged);
     connect(ui->saveFileFormat, &QLineEdit::editingFinished,   this,       &MainWindow::onFileNameChanged);
     connect(this,               &MainWindow::fileNameChanged,  fileWriter, &FileWriter::setFileName);
     connect(ui->writeNowBtn,    &QPushButton::clicked,         fileWriter, &FileWriter::writeOnce);
-    // connecting to Worker::dataUpdated is made in initWorkerHandlers
+    // connecting of Worker::dataUpdated to other receivers is made in initWorkerHandlers
     connect(fileWriter, &FileWriter::queueSizeChanged, this, &MainWindow::onQueueSizeChanged);
+    connect(fileWriter, &FileWriter::queueBytesChanged, this, &MainWindow::onQueueBytesChanged);
+    // New file started: count items since its start
+    connect(fileWriter, &FileWriter::fileRotated, this, &MainWindow::resetHistory);
 
     // TODO: if auto-write fails, worker should notify GUI (show warning, uncheck checkbox)
     connect(ui->writeToFileEnabled, &QCheckBox::stateChanged, [=](int state){
@@ -328,12 +545,45 @@ void MainWindow::initFileHandlers() {
         QMessageBox::information(this, tr("Filename format help"), FileWriter::fileNameFormatHelp());
     });
 
+    connect(ui->compressFiles, &QCheckBox::toggled, [=](bool enabled){
+        emit compressionLevelSet(enabled ? Settings().compressionLevel() : AsyncFileSink::NO_COMPRESSION);
+    });
+    for (QCheckBox * formatCheckBox: {ui->formatText, ui->formatMiniSeed, ui->formatBinary}) {
+        connect(formatCheckBox, &QCheckBox::toggled, [=](){
+            emit outputFormatsChanged(selectedOutputFormats());
+        });
+    }
+
     // Set initial values
     Settings settings;
     ui->outputDir->setText(settings.outputDirectory());
     ui->saveFileFormat->setText(settings.fileNameFormat());
     emit fileNameChanged(settings.outputDirectory(), settings.fileNameFormat());
     emit deviceIdSet(settings.deviceId());
+    if (recorded != NULL && plotsCorrected) {
+        emit unitsSet(ResponseFilter::unitName(plotsResponse.outputQuantity));
+    }
+    emit syncPolicySet(settings.syncIntervalSecs(), settings.syncIntervalMegabytes());
+    emit queueLimitSet(settings.queueLimitMegabytes());
+    emit rotationPolicySet(settings.rotationPeriodSecs(), settings.rotationSizeMegabytes());
+    emit miniSeedParametersSet(settings.miniSeedNetwork(), settings.miniSeedRecordLength());
+    OutputFormat::Types formats = settings.outputFormats();
+    ui->formatText->setChecked(formats.testFlag(OutputFormat::Text));
+    ui->formatMiniSeed->setChecked(formats.testFlag(OutputFormat::MiniSeed));
+    ui->formatBinary->setChecked(formats.testFlag(OutputFormat::Binary));
+    emit outputFormatsChanged(formats);
+    ui->compressFiles->setChecked(settings.isCompressionEnabled());
+    emit compressionLevelSet(settings.isCompressionEnabled() ? settings.compressionLevel() : AsyncFileSink::NO_COMPRESSION);
+    emit journalPolicySet(settings.isJournalEnabled(), settings.journalCommitBlocks(), settings.journalCommitMsecs());
+    emit indexIntervalSet(settings.indexInterval());
+    if (settings.isEventRecordingEnabled() && trigger == NULL) {
+        Logger::warning(tr("Event recording needs the trigger to be enabled, recording continuously"));
+    }
+    emit eventRecordingSet(settings.isEventRecordingEnabled() && trigger != NULL,
+                           settings.preEventSecs(), settings.postEventSecs());
+    emit recoveringJournals(); // Before any data are written
+    emit archivePolicySet(settings.isArchiveEnabled(), settings.archiveDirectory(),
+                          settings.archiveChunkSecs(), settings.archiveRetentionDays());
     emit autoWriteChanged(ui->writeToFileEnabled->isChecked());
     setFileControlsState();
 }
@@ -397,10 +647,8 @@ void MainWindow::onDataReceived(TimeStampsVector t, DataVector d) {
 
     Logger::trace(tr("Received %1 data items").arg(d.size()*CHANNELS_NUM));
 
-    if (startedAt.secsTo(QDateTime::fromMSecsSinceEpoch(t.last())) >= NEW_FILE_PERIOD_SECS) {
-        // Maximum time for file elapsed, close file and open new one then
-        emit finishingFile();
-        resetHistory();
+    if ( ! history.isNull() ) {
+        history->append(DataBlock(t, d));
     }
 
     setReceivedItems(receivedItems + d.size()*CHANNELS_NUM);
@@ -424,25 +672,48 @@ void MainWindow::onDataReceived(TimeStampsVector t, DataVector d) {
         perfDataView.stop();
     }
 
-    perfStats.start();
-    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
-        // Update stats
-        stats[ch]->setStats(d, ch);
-    }
-    perfStats.stop();
-
     // TODO: don't call these slots (TimePlot::receiveData), connect them separately.
-    perfPlotting.start();
-    for(TimePlot * plot: plots) {
-        plot->receiveData(t, d);
+    if (plotsFilter.type == ButterworthFilter::None && ! plotsCorrected) { // Otherwise fed by processing, see initProcessing
+        perfPlotting.start();
+        for(TimePlot * plot: plots) {
+            plot->receiveData(t, d);
+        }
+        perfPlotting.stop();
     }
-    perfPlotting.stop();
 
     ui->ledADC->blinkOnce();
 
     perfTotal.stop();
 }
 
+void MainWindow::onStatsReceived(TimeStampType time, QVector<SlidingStats::Values> values) {
+    Q_UNUSED(time);
+    perfStats.start();
+    for (unsigned ch = 0; ch < CHANNELS_NUM && int(ch) < values.size(); ++ch) {
+        stats[ch]->setStats(values[int(ch)]);
+    }
+    perfStats.stop();
+}
+
+void MainWindow::onQualityReceived(QualityStage::Metrics metrics) {
+    if (metrics.isClean()) {
+        qualityLabel->setText(tr("Quality: OK"));
+        qualityLabel->setStyleSheet(QString());
+        qualityLabel->setToolTip(tr("No problems in the last minute"));
+    } else {
+        qualityLabel->setText(tr("Quality: problems"));
+        qualityLabel->setStyleSheet("color: red");
+        qualityLabel->setToolTip(tr("In the last minute: %1").arg(metrics.describe()));
+    }
+}
+
+void MainWindow::onPolarizationReceived(QVector<Polarization::Values> values) {
+    const Polarization::Values & latest = values.last();
+    polarizationLabel->setText(tr("Polarization: %1, back-azimuth %2, incidence %3 deg")
+                               .arg(latest.rectilinearity, 0, 'f', 2).arg(latest.backAzimuth, 0, 'f', 0)
+                               .arg(latest.incidence, 0, 'f', 0));
+}
+
 void MainWindow::onLogMessage(Logger::Level level, QString message) {
     if (level >= Logger::Info) {
         ui->statusBar->showMessage(message);
@@ -453,21 +724,91 @@ void MainWindow::onQueueSizeChanged(unsigned size) {
     ui->samplesInQueue->setText(QString::number(size));
 }
 
+void MainWindow::onQueueBytesChanged(qint64 memoryBytes, qint64 spilledBytes) {
+    ui->samplesInQueue->setToolTip(tr("%1 MB in memory, %2 MB in temporary file")
+                                   .arg(memoryBytes / 1e6, 0, 'f', 1)
+                                   .arg(spilledBytes / 1e6, 0, 'f', 1));
+}
+
 void MainWindow::setReceivedItems(int received) {
     receivedItems = received;
     ui->samplesRcvd->setText(QString::number(receivedItems));
 }
 
 void MainWindow::resetHistory() {
-    for(TimePlot * plot: plots) {
-        plot->clearHistory();
-    }
+    restoreHistory();
     setReceivedItems(0);
     startedAt = QDateTime::currentDateTime();
     ui->timeStart->setDateTime(startedAt);
     ui->timeElapsed->setTime(QTime(0,0,0));
 }
 
+void MainWindow::restoreHistory() {
+    for(TimePlot * plot: plots) {
+        plot->clearHistory();
+    }
+    for (SpectrogramPlot * spectrogram: spectrograms) {
+        if (spectrogram != NULL) {
+            spectrogram->clearHistory();
+        }
+    }
+    TimeStampType first, last;
+    if (history.isNull() || ! history->timeRange(&first, &last)) {
+        return;
+    }
+    // As much as plots show, as if they were just received
+    DataBlock recent = history->read(last - (ui->timeInterval->value() + 1)*1000.0, last + 1);
+    if (recent.size() == 0) {
+        return;
+    }
+    const int samplingFreq = ui->samplingFreq->currentText().toInt();
+    if (spectrograms[0] != NULL) {
+        // Of raw data by the same stages as in processing, but apart from its state
+        StageGraph spectra;
+        const SpectrumStage::Parameters params = Settings().spectrumParameters();
+        for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+            SpectrumStage * spectrum = spectra.add(new SpectrumStage(tr("Spectrum %1").arg(ch + 1), ch, params));
+            connect(spectrum, &SpectrumStage::spectrumReady, spectrograms[ch], &SpectrogramPlot::receiveSpectrum);
+        }
+        spectra.setFrequencies(samplingFreq, 0);
+        spectra.receiveData(recent.timestamps, recent.data);
+    } // Waits for the stages, spectra are queued to plots
+    // The same correction and filter as of live data, starting anew
+    if (plotsCorrected) {
+        ResponseFilter response(plotsResponse);
+        response.design(samplingFreq);
+        response.filter(recent);
+    }
+    if (plotsFilter.type != ButterworthFilter::None) {
+        ButterworthFilter filter(plotsFilter);
+        filter.design(samplingFreq);
+        filter.filter(recent);
+    }
+    for(TimePlot * plot: plots) {
+        plot->receiveData(recent.timestamps, recent.data);
+    }
+    // Stats of raw data over their window, as StatsStage would have them
+    const DataBlock window = history->read(last - statistics->windowSecs()*1000.0, last + 1);
+    SlidingStats windowStats(window.size());
+    windowStats.add(window.data);
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        stats[ch]->setStats(windowStats.values(ch));
+    }
+}
+
+void MainWindow::restartProcessing() {
+    processing->reset();
+    TimeStampType first, last;
+    if (history.isNull() || ! history->timeRange(&first, &last)) {
+        return;
+    }
+    // Stages continue from the history, as if acquisition wasn't stopped:
+    // trigger, spectra, PPSD and quality don't have to warm up on live data
+    for (TimeStampType from = first; from <= last; from += REPLAY_BLOCK_SECS*1000.0) {
+        processing->replay(history->read(from, from + REPLAY_BLOCK_SECS*1000.0));
+    }
+}
+
 void MainWindow::onFileNameChanged() {
     checkOutputDirectory();
     // Propagate the change to FileWriter
@@ -544,12 +885,30 @@ void MainWindow::setFileControlsState() {
     ui->outputDir->setDisabled(disableChangingFile);
     ui->saveFileFormat->setDisabled(disableChangingFile);
     ui->browseBtn->setDisabled(disableChangingFile);
+    ui->formatText->setDisabled(disableChangingFile);
+    ui->formatMiniSeed->setDisabled(disableChangingFile);
+    ui->formatBinary->setDisabled(disableChangingFile);
+    ui->compressFiles->setDisabled(disableChangingFile);
 
     bool disableWriteNow = (ui->writeToFileEnabled->isChecked());
     // If auto-saving => cannot write now
     ui->writeNowBtn->setDisabled(disableWriteNow);
 }
 
+OutputFormat::Types MainWindow::selectedOutputFormats() const {
+    OutputFormat::Types res;
+    if (ui->formatText->isChecked()) {
+        res |= OutputFormat::Text;
+    }
+    if (ui->formatMiniSeed->isChecked()) {
+        res |= OutputFormat::MiniSeed;
+    }
+    if (ui->formatBinary->isChecked()) {
+        res |= OutputFormat::Binary;
+    }
+    return res;
+}
+
 void MainWindow::setCurrentTime() {
     QDateTime now = QDateTime::currentDateTime();
     ui->currentDate->setText(now.date().toString(Qt::DefaultLocaleShortDate));
@@ -567,6 +926,8 @@ void MainWindow::saveSettings() {
     settings.setFilterFrequency(ui->filterFreqSlider->value());
     settings.setOutputDirectry(ui->outputDir->text());
     settings.setFileNameFormat(ui->saveFileFormat->text());
+    settings.setOutputFormats(selectedOutputFormats());
+    settings.setCompressionEnabled(ui->compressFiles->isChecked());
 
     settings.setPortName(Settings::PortADC, ui->portChooser->currentText());
     settings.setPortSettings(Settings::PortADC, portSettingsADC);
@@ -614,11 +975,16 @@ MainWindow::~MainWindow()
         Logger::error(tr("Worker thread hangs"));
     } else {
         delete worker;
+        // No more data come to stages: let them process the rest
+        processing->waitForDone();
+        processing->reportResults();
+        delete processing;
     }
     if (false == threadFileWriter->wait(MAX_WAIT)) {
         Logger::error(tr("FileWriter thread hangs"));
     } else {
         delete fileWriter;
+        delete archiveWriter;
     }
 
     perfPlotting.reportResults();
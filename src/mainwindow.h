@@ -8,15 +8,32 @@
 #include "protocols/serialprotocol.h"
 #include "worker.h"
 #include "filewriter.h"
+#include "archivewriter.h"
+#include "archive/historyring.h"
 #include "performancereporter.h"
+#include "dsp/butterworthfilter.h"
+#include "dsp/responsefilter.h"
+#include "dsp/slidingstats.h"
+#include "dsp/qualitystage.h"
+#include "dsp/polarization.h"
 
 namespace Ui {
 class MainWindow;
 }
 class StatsBox;
 class TimePlot;
+class SpectrogramPlot;
 class QToolButton;
 class QThread;
+class StageGraph;
+class StaLtaTrigger;
+class SinkStage;
+class StatsStage;
+class PickerStage;
+class MagnitudeStage;
+class PolarizationStage;
+class TemplateStage;
+class QLabel;
 
 class MainWindow : public QMainWindow
 {
@@ -35,9 +52,20 @@ signals:
     void finishing();
     void fileNameChanged(QString outputDir, QString saveFileFormat);
     void autoWriteChanged(bool enabled);
-    void finishingFile();
     void frequenciesSet(int samplingFreq, int filterFreq);
     void deviceIdSet(QString id);
+    void unitsSet(QString units);
+    void syncPolicySet(int intervalSecs, int intervalMegabytes);
+    void queueLimitSet(int megabytes);
+    void rotationPolicySet(int periodSecs, int sizeMegabytes);
+    void compressionLevelSet(int level);
+    void journalPolicySet(bool enabled, int commitBlocks, int commitMsecs);
+    void indexIntervalSet(int samples);
+    void eventRecordingSet(bool enabled, int preEventSecs, int postEventSecs);
+    void recoveringJournals();
+    void archivePolicySet(bool enabled, QString directory, int chunkSecs, int retentionDays);
+    void outputFormatsChanged(OutputFormat::Types formats);
+    void miniSeedParametersSet(QString network, int recordLength);
 
 private slots:
     void onCheckedADC(bool success);
@@ -46,11 +74,15 @@ private slots:
     void onTimeAvailable(QDateTime timeGPS);
     void onPositionAvailable(double latitiude, double longitude, double altitude);
     void onDataReceived(TimeStampsVector t, DataVector d);
+    void onStatsReceived(TimeStampType time, QVector<SlidingStats::Values> values);
+    void onQualityReceived(QualityStage::Metrics metrics);
+    void onPolarizationReceived(QVector<Polarization::Values> values);
     void onFileNameChanged();
     void setFixedScale();
     void onZoomChanged(double newMin, double newMax);
     void onLogMessage(Logger::Level level, QString message);
     void onQueueSizeChanged(unsigned size);
+    void onQueueBytesChanged(qint64 memoryBytes, qint64 spilledBytes);
     void onStartedOrStopped(bool workerStarted);
 
 protected:
@@ -59,14 +91,19 @@ private:
     void setup();
     void initWorkerHandlers();
     void initFileHandlers();
+    void initProcessing();
+    void initSpectrograms();
     void initPortSettingsAction(QAction * action, QString title, PortSettingsEx & portSettings, QToolButton *btn);
     void initZoomAction(QAction * action, QToolButton *btn);
     void setFileControlsState();
+    OutputFormat::Types selectedOutputFormats() const;
     bool checkOutputDirectory();
     void setCurrentTime();
     void log(QString text);
     void setReceivedItems(int received);
     void resetHistory();
+    void restoreHistory();
+    void restartProcessing();
 
     bool askForClosing();
     void saveSettings();
@@ -76,9 +113,23 @@ private:
     PortSettingsEx portSettingsGPS;
     Worker * worker;
     FileWriter * fileWriter;
+    ArchiveWriter * archiveWriter;
+    StageGraph * processing; // Stages between Worker and sinks, runs on its own thread pool
+    StaLtaTrigger * trigger; // Stage of processing, NULL if disabled
+    PickerStage * picker;    // Stage of processing, picks events of trigger, NULL if disabled
+    MagnitudeStage * magnitude; // Stage of processing, ML of events of trigger, NULL if disabled
+    PolarizationStage * polarization; // Stage of processing, NULL if disabled
+    TemplateStage * templates; // Stage of processing, NULL if disabled or no templates
+    SinkStage * recorded;    // Stage of processing that feeds FileWriter, NULL - raw data from Worker
+    StatsStage * statistics; // Stage of processing for stats boxes and headers of files
+    QLabel * qualityLabel;   // In status bar, NULL if quality is not monitored
+    QLabel * polarizationLabel; // In status bar, NULL if polarization is not computed
+    ButterworthFilter::Parameters plotsFilter; // Of data in plots: type None - not filtered
+    bool plotsCorrected;                       // Whether data in plots are in physical units
+    ResponseFilter::Parameters plotsResponse;  // Of data in plots, if corrected
     bool workerStarted;
 
-    // Threads where FileWriter and Worker work
+    // Threads where FileWriter (with ArchiveWriter) and Worker work
     QThread * threadFileWriter;
     QThread * threadWorker;
 
@@ -87,8 +138,11 @@ private:
     QDateTime synchronizedAt;
     int receivedItems;
 
+    QSharedPointer<HistoryRing> history; // Recent data, kept between runs. NULL if disabled
+
     TimePlot * plots[CHANNELS_NUM];
     StatsBox * stats[CHANNELS_NUM];
+    SpectrogramPlot * spectrograms[CHANNELS_NUM]; // NULL if not shown
 
     QVector<QWidget*> disableOnConnect;
     QVector<QWidget*> disableOnStart;
@@ -1,5 +1,6 @@
 #include "performancereporter.h"
 #include <qglobal.h>
+#include <qmath.h>
 
 #include <QDebug>  // for flushDebug
 #include <QThread> // for flushDebug
@@ -19,16 +20,25 @@ namespace
         return PerformanceReporter::tr("Release");
 #endif
     }
+
+    const double HISTOGRAM_MIN_TIME = 0.001; // 1 microsecond
 }
 
 PerformanceReporter::PerformanceReporter(QString description, Logger::Level level, QObject *parent) :
     QObject(parent), description(description), logLevel(level), mode(releaseOrDebug()),
     paused(false), beforePause(0),
-    measurementsCount(0), minTime(0), maxTime(0), avgTime(0)
+    measurementsCount(0), minTime(0), maxTime(0), avgTime(0), totalTime_(0)
 {
+    for (int & bucket: histogram) {
+        bucket = 0;
+    }
 }
 
 void PerformanceReporter::addMeasurement(double time) {
+    int bucket = (time > HISTOGRAM_MIN_TIME) ? int(HISTOGRAM_STEPS*qLn(time/HISTOGRAM_MIN_TIME)/M_LN2) : 0;
+    ++histogram[qBound(0, bucket, HISTOGRAM_SIZE - 1)];
+    totalTime_ += time;
+
     if (measurementsCount <= 0) {
         minTime = maxTime = avgTime = time;
         measurementsCount = 1;
@@ -47,12 +57,31 @@ void PerformanceReporter::addMeasurement(double time) {
     }
 }
 
+double PerformanceReporter::percentile(double p) const {
+    if (measurementsCount <= 0) {
+        return 0;
+    }
+    int needed = qCeil(measurementsCount * p / 100);
+    int counted = 0;
+    for (int i = 0; i < HISTOGRAM_SIZE; ++i) {
+        counted += histogram[i];
+        if (counted >= needed) {
+            // Upper bound of the bucket, but not more than actual maximum
+            return qMin(maxTime, HISTOGRAM_MIN_TIME*qPow(2, double(i + 1)/HISTOGRAM_STEPS));
+        }
+    }
+    return maxTime;
+}
+
 void PerformanceReporter::reportResults() {
     if (measurementsCount > 0) {
         Logger::message(logLevel, tr("Performance for %1 in %2").arg(description).arg(mode));
         reportTime(tr("AVG"), avgTime);
         reportTime(tr("MAX"), maxTime);
         reportTime(tr("MIN"), minTime);
+        reportTime(tr("P50"), percentile(50));
+        reportTime(tr("P90"), percentile(90));
+        reportTime(tr("P99"), percentile(99));
     }
 }
 
@@ -64,6 +64,16 @@ public:
         description = newDescription;
     }
 
+    /**
+     * @brief Estimates percentile of measurements, with precision of about 20%
+     * @param p - percentile in range (0, 100)
+     * @return approximate value in milliseconds, 0 if there are no measurements
+     */
+    double percentile(double p) const;
+
+    int count() const { return measurementsCount; }
+    double totalTime() const { return totalTime_; }
+
     /**
      * @brief Reports current statistics to log
      */
@@ -90,6 +100,12 @@ private:
     double minTime;
     double maxTime;
     double avgTime;
+    double totalTime_;
+
+    // Histogram of measurements for percentiles: logarithmic buckets, HISTOGRAM_STEPS per octave.
+    static const int HISTOGRAM_STEPS = 4;
+    static const int HISTOGRAM_SIZE = 30*HISTOGRAM_STEPS; // from 1 microsecond up to about 18 minutes
+    int histogram[HISTOGRAM_SIZE];
 
     void reportTime(QString prefix, double time);
     
@@ -15,6 +15,20 @@ typedef QVector<DataItem> DataVector;
 typedef double TimeStampType; // Now use milliseconds from Epoch as TimeStampType for performance reasons
 typedef QVector<TimeStampType> TimeStampsVector;
 
+/// Orientation of sensor components in channels: vertical, north-south, east-west
+const char CHANNEL_COMPONENTS[CHANNELS_NUM + 1] = "ZNE";
+
+/// A portion of data items together with their timestamps
+struct DataBlock {
+    TimeStampsVector timestamps;
+    DataVector data;
+    DataBlock() {}
+    DataBlock(TimeStampsVector t, DataVector d) : timestamps(t), data(d) {}
+    int size() const { return qMin(timestamps.size(), data.size()); }
+    /// Items from \a pos, \a length of them (or all to the end if -1)
+    DataBlock mid(int pos, int length = -1) const { return DataBlock(timestamps.mid(pos, length), data.mid(pos, length)); }
+};
+
 /*!
  * \interface Protocol
  * \brief The common Protocol interface (abstract class, to be precise - \see Protocol::state)
@@ -0,0 +1,94 @@
+#include "archivereader.h"
+#include "../logger.h"
+
+#include <QDir>
+#include <algorithm>
+#include <cmath>
+
+bool ArchiveReader::readHeader() {
+    archive.reset(new Archive(fileName));
+    if ( ! archive->open(true) ) {
+        return false; // Reported
+    }
+    TimeStampType first;
+    if ( ! archive->timeRange(&first, &end) ) {
+        Logger::error(tr("Archive %1 is empty").arg(fileName));
+        return false;
+    }
+    const QList<Archive::Series> head = archive->query(QList<int>() << 0, first, qMin(end, first + SLICE_SECS*1000.0));
+    if (head.isEmpty()) {
+        Logger::error(tr("Archive %1 is empty").arg(fileName));
+        return false;
+    }
+    info_.samplingFreq = qRound(1000.0 / head.first().period);
+    info_.startTime = QDateTime::fromMSecsSinceEpoch(qint64(head.first().start));
+    info_.deviceID = QDir(fileName).dirName();
+    info_.latitude = "???";
+    info_.longitude = "???";
+    size = archive->diskBytes();
+    next = first;
+    return true;
+}
+
+bool ArchiveReader::readData(DataBlock & block, int maxItems) {
+    while (slice.size() == 0) {
+        if (next >= end) {
+            return false;
+        }
+        readSlice();
+    }
+    const int count = qMin(maxItems, slice.size());
+    block = slice.mid(0, count);
+    slice = slice.mid(count);
+    return true;
+}
+
+void ArchiveReader::readSlice() {
+    const TimeStampType to = qMin(end, next + SLICE_SECS*1000.0);
+    const QList<Archive::Series> series = archive->query(QList<int>() << 0 << 1 << 2, next, to);
+    next = to;
+    slice = DataBlock();
+    // Series are ordered by channel: join pieces of the other channels to those of the first one
+    for (const Archive::Series & piece: series) {
+        if (piece.channel != 0) {
+            break;
+        }
+        const Archive::Series * parts[CHANNELS_NUM] = {&piece};
+        int count = piece.values.size();
+        for (const Archive::Series & other: series) {
+            if (other.channel != 0 && std::abs(other.start - piece.start) <= piece.period/2 && other.period == piece.period) {
+                parts[other.channel] = &other;
+                count = qMin(count, other.values.size());
+            }
+        }
+        if (std::find(parts, parts + CHANNELS_NUM, nullptr) != parts + CHANNELS_NUM) {
+            Logger::warning(tr("Data of archive %1 at %2 are missing in some channels, skipped")
+                            .arg(fileName, QDateTime::fromMSecsSinceEpoch(qint64(piece.start)).toString(Qt::ISODate)));
+            continue;
+        }
+        const int offset = slice.size();
+        slice.timestamps.resize(offset + count);
+        slice.data.resize(offset + count);
+        for (int i = 0; i < count; ++i) {
+            slice.timestamps[offset + i] = piece.start + i*piece.period;
+            for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+                slice.data[offset + i].byChannel[ch] = parts[ch]->values[i];
+            }
+        }
+    }
+}
+
+bool ArchiveReader::seekEntry(const FileIndex::Entry & entry) {
+    next = entry.time;
+    slice = DataBlock();
+    return true;
+}
+
+FileIndex::Entry ArchiveReader::startEntry(TimeStampType time) const {
+    // Slices are queried by time: no need to read from the beginning
+    FileIndex::Entry entry;
+    entry.sample = 0;
+    entry.time = time;
+    entry.offset = 0;
+    return entry;
+}
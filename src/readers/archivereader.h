@@ -0,0 +1,44 @@
+#ifndef ARCHIVEREADER_H
+#define ARCHIVEREADER_H
+
+#include "datareader.h"
+#include "../archive/archive.h"
+
+/*!
+ * \brief Reads an archive of station (\see Archive) as if it were one data file
+ *
+ * Made by DataReader::open for a directory with an archive, which is opened for
+ * reading only. Data are queried from the archive by slices of SLICE_SECS,
+ * so the whole archive is never in memory, and seeking to a time goes right
+ * to the chunks of that time. Times of items are counted from the start of
+ * each continuous piece of data. Pieces that are missing in some channel
+ * (e.g. a damaged chunk) are skipped.
+ *
+ * Header of "file" is made from the archive: device ID is the name of directory,
+ * coordinates and filter frequency are unknown.
+ */
+class ArchiveReader : public DataReader
+{
+public:
+    static const int SLICE_SECS = 60;
+
+    ArchiveReader() : next(0), end(0) {}
+
+    OutputFormat::Type type() const override { return OutputFormat::Binary; } // The closest one: values as they are
+
+protected:
+    bool readHeader() override;
+    bool readData(DataBlock & block, int maxItems) override;
+    bool seekEntry(const FileIndex::Entry & entry) override;
+    FileIndex::Entry startEntry(TimeStampType time) const override;
+
+private:
+    void readSlice();
+
+    QScopedPointer<Archive> archive;
+    TimeStampType next; // Start of the next slice
+    TimeStampType end;  // After the last sample
+    DataBlock slice;    // Items of slice that are not read yet
+};
+
+#endif // ARCHIVEREADER_H
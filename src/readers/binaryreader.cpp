@@ -0,0 +1,92 @@
+#include "binaryreader.h"
+#include "../logger.h"
+#include "../writers/binaryformat.h"
+
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+    const quint32 MAX_BLOCK_ITEMS = 1 << 24; // Larger count means damaged block
+
+    template <typename T>
+    T getLittleEndian(const char * src) {
+        return qFromLittleEndian<T>(reinterpret_cast<const uchar*>(src));
+    }
+
+    double getDouble(const char * src) {
+        quint64 bits = getLittleEndian<quint64>(src);
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    // NaN means unknown coordinate, written as "???" in FileInfo
+    QString coordinateText(double value) {
+        return (value == value) ? QString::number(value, 'f', 6) : QString("???");
+    }
+}
+
+bool BinaryReader::readHeader() {
+    if (size < BinaryFormat::HEADER_SIZE) {
+        return false;
+    }
+    const char * h = data;
+    const int headerSize = getLittleEndian<quint16>(h + 6);
+    if (getLittleEndian<quint16>(h + 4) != BinaryFormat::VERSION || getLittleEndian<quint16>(h + 8) != CHANNELS_NUM
+     || headerSize < BinaryFormat::HEADER_SIZE || headerSize > size) {
+        Logger::error(tr("Binary file %1 has unsupported version or number of channels").arg(fileName));
+        return false;
+    }
+    info_.samplingFreq = getLittleEndian<qint32>(h + 12);
+    info_.filterFreq = getLittleEndian<qint32>(h + 16);
+    info_.startTime = QDateTime::fromMSecsSinceEpoch(qint64(getDouble(h + 24)));
+    info_.deviceID = QString::fromLatin1(h + 32, int(qstrnlen(h + 32, 16)));
+    info_.latitude = coordinateText(getDouble(h + 48));
+    info_.longitude = coordinateText(getDouble(h + 56));
+    pos = headerSize; // Header can be larger in future versions
+    return true;
+}
+
+bool BinaryReader::readData(DataBlock & block, int maxItems) {
+    Q_UNUSED(maxItems); // Blocks are read as they are stored
+    if (size - pos < BinaryFormat::BLOCK_HEADER_SIZE) {
+        return false; // End of file
+    }
+    const char * blockHeader = data + pos;
+    const quint32 count = getLittleEndian<quint32>(blockHeader);
+    const TimeStampType first = getDouble(blockHeader + 8);
+    if (count > MAX_BLOCK_ITEMS) {
+        Logger::warning(tr("Damaged block in %1 at offset %2, reading stopped").arg(fileName).arg(pos));
+        return false;
+    }
+    const qint64 columnSize = qint64(sizeof(qint32))*count;
+    const qint64 blockSize = BinaryFormat::BLOCK_HEADER_SIZE + columnSize*CHANNELS_NUM;
+    if (size - pos < blockSize) {
+        return false; // Incomplete block at the end of file
+    }
+    const char * columns = blockHeader + BinaryFormat::BLOCK_HEADER_SIZE;
+    pos += blockSize;
+
+    block.timestamps.resize(int(count));
+    block.data.resize(int(count));
+    const double period = periodMsecs();
+    for (int i = 0; i < int(count); ++i) {
+        block.timestamps[i] = first + i*period;
+    }
+    DataItem * items = block.data.data();
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        const char * column = columns + columnSize*ch;
+        for (int i = 0; i < int(count); ++i) {
+            items[i].byChannel[ch] = getLittleEndian<qint32>(column + sizeof(qint32)*i);
+        }
+    }
+    return true;
+}
+
+bool BinaryReader::seekEntry(const FileIndex::Entry & entry) {
+    if (entry.offset < 0 || entry.offset > size) {
+        return false;
+    }
+    pos = entry.offset; // Blocks store their times
+    return true;
+}
@@ -0,0 +1,20 @@
+#ifndef BINARYREADER_H
+#define BINARYREADER_H
+
+#include "datareader.h"
+
+/*!
+ * \brief Reads binary files (BinaryFormat): fixed header, then blocks of int32 columns
+ */
+class BinaryReader : public DataReader
+{
+public:
+    OutputFormat::Type type() const override { return OutputFormat::Binary; }
+
+protected:
+    bool readHeader() override;
+    bool readData(DataBlock & block, int maxItems) override;
+    bool seekEntry(const FileIndex::Entry & entry) override;
+};
+
+#endif // BINARYREADER_H
@@ -0,0 +1,134 @@
+#include "datareader.h"
+#include "textreader.h"
+#include "binaryreader.h"
+#include "archivereader.h"
+#include "../logger.h"
+#include "../writers/binaryformat.h"
+#include "../writers/gzipcompressor.h"
+
+#include <QFileInfo>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    const char GZIP_MAGIC[] = "\x1f\x8b";
+    const int MAGIC_SIZE = 4;
+
+    bool startsWith(const char * data, qint64 size, const char * prefix, int prefixSize) {
+        return size >= prefixSize && memcmp(data, prefix, size_t(prefixSize)) == 0;
+    }
+}
+
+DataReader::DataReader() :
+    data(NULL), size(0), pos(0), compressed(false)
+{
+    dataStart.sample = 0;
+    dataStart.time = 0;
+    dataStart.offset = 0;
+}
+
+DataReader * DataReader::open(const QString & fileName) {
+    if (QFileInfo(fileName).isDir()) {
+        QScopedPointer<DataReader> reader(new ArchiveReader);
+        reader->fileName = fileName;
+        if ( ! reader->readHeader() ) {
+            return NULL; // Reported
+        }
+        reader->dataStart.time = reader->info_.startTime.toMSecsSinceEpoch();
+        return reader.take();
+    }
+    QScopedPointer<QFile> file(new QFile(fileName));
+    if ( ! file->open(QIODevice::ReadOnly) ) {
+        Logger::error(tr("Failed to open file %1: %2").arg(fileName, file->errorString()));
+        return NULL;
+    }
+    QByteArray contents;
+    qint64 size = file->size();
+    const char * data = reinterpret_cast<const char*>(file->map(0, size));
+    if (data == NULL) {
+        // Empty file, or cannot be mapped (e.g. doesn't fit into address space of 32-bit process)
+        contents = file->readAll();
+        data = contents.constData();
+        size = contents.size();
+    }
+    bool compressed = false;
+    if (startsWith(data, size, GZIP_MAGIC, 2)) {
+        // Compressed stream cannot be sought: decompress it all
+        QByteArray decompressed;
+        if ( ! GzipCompressor::decompress(data, size, decompressed) ) {
+            Logger::warning(tr("Compressed file %1 is not finished or damaged, reading what can be decompressed").arg(fileName));
+        }
+        contents = decompressed;
+        data = contents.constData();
+        size = contents.size();
+        file.reset(); // Also unmaps
+        compressed = true;
+    }
+
+    DataReader * reader;
+    if (startsWith(data, size, BinaryFormat::MAGIC, MAGIC_SIZE)) {
+        reader = new BinaryReader;
+    } else if (startsWith(data, size, "[", 1)) {
+        reader = new TextReader;
+    } else {
+        Logger::error(tr("Format of file %1 is not supported for reading").arg(fileName));
+        return NULL;
+    }
+    reader->file.swap(file);
+    reader->contents = contents;
+    reader->data = contents.isNull() ? data : reader->contents.constData();
+    reader->size = size;
+    reader->compressed = compressed;
+    reader->fileName = fileName;
+    if ( ! reader->readHeader() ) {
+        Logger::error(tr("Failed to read header of file %1").arg(fileName));
+        delete reader;
+        return NULL;
+    }
+    reader->dataStart.time = reader->info_.startTime.isValid() ? reader->info_.startTime.toMSecsSinceEpoch() : 0;
+    reader->dataStart.offset = reader->pos;
+    return reader;
+}
+
+QByteArray DataReader::readLine() {
+    const char * begin = data + pos;
+    const char * end = data + size;
+    const char * lineEnd = static_cast<const char*>(memchr(begin, '\n', size_t(end - begin)));
+    if (lineEnd == NULL) {
+        lineEnd = end;
+    }
+    pos = (lineEnd < end) ? (lineEnd + 1 - data) : size;
+    return QByteArray(begin, int(lineEnd - begin));
+}
+
+bool DataReader::readBlock(DataBlock & block, int maxItems) {
+    if (pending.size() > 0) {
+        block = pending;
+        pending = DataBlock();
+        return true;
+    }
+    return readData(block, maxItems);
+}
+
+FileIndex::Entry DataReader::startEntry(TimeStampType time) const {
+    Q_UNUSED(time);
+    return dataStart;
+}
+
+bool DataReader::seekTime(TimeStampType time, const FileIndex * index) {
+    pending = DataBlock();
+    const bool useIndex = (index != NULL) && ! index->entries().isEmpty() && ! compressed;
+    if ( ! seekEntry(useIndex ? index->entries()[index->find(time)] : startEntry(time)) ) {
+        return false;
+    }
+    DataBlock block;
+    while (readData(block, DEFAULT_BLOCK_ITEMS)) {
+        const TimeStampType * begin = block.timestamps.constData();
+        const TimeStampType * end = begin + block.size();
+        if (begin != end && *(end - 1) >= time) {
+            pending = block.mid(int(std::lower_bound(begin, end, time) - begin));
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,105 @@
+#ifndef DATAREADER_H
+#define DATAREADER_H
+
+#include "../protocol.h"
+#include "../writers/outputformat.h"
+#include "../writers/fileindex.h"
+
+#include <QFile>
+#include <QScopedPointer>
+#include <QCoreApplication>
+
+/*!
+ * \interface DataReader
+ * \brief Reads data files written by FileWriter back into data blocks
+ *
+ * Reader for a file is made by DataReader::open, which detects its format
+ * by contents. The file is mapped into memory, and readers parse it right there,
+ * without copying it through buffers of QIODevice. Files compressed with gzip
+ * are decompressed into memory first.
+ *
+ * Reading goes from the beginning of data, or from given time (\see seekTime):
+ * with index of the file (\see FileIndex) only a few samples before that time
+ * are read, without index the file is read from the beginning.
+ *
+ * Text files don't store time of each item, so times are counted from the nearest
+ * index entry, or from the start time in the header (which is precise to a second),
+ * using the sampling frequency.
+ *
+ * An archive of station is read like a file too (\see ArchiveReader).
+ */
+class DataReader
+{
+    Q_DECLARE_TR_FUNCTIONS(DataReader)
+public:
+    static const int DEFAULT_BLOCK_ITEMS = 4096;
+
+    /*!
+     * \brief Opens data file and reads its header. \a fileName can be a directory of archive.
+     * \return new reader (caller takes ownership), NULL if failed or format is not
+     *         supported (reported to Logger)
+     */
+    static DataReader * open(const QString & fileName);
+
+    virtual ~DataReader() {}
+
+    virtual OutputFormat::Type type() const = 0;
+
+    /// Description of data from the header of file
+    const OutputFormat::FileInfo & info() const { return info_; }
+
+    /// Whether the file is decompressed in memory (then its index is not applicable)
+    bool isCompressed() const { return compressed; }
+
+    /// Size of data in file (after decompression for compressed files)
+    qint64 dataSize() const { return size; }
+
+    /*!
+     * \brief Reads next portion of data: a stored block of binary file
+     *        or up to \a maxItems lines of text file
+     * \return false if there are no more data or failed to read (reported to Logger)
+     */
+    bool readBlock(DataBlock & block, int maxItems = DEFAULT_BLOCK_ITEMS);
+
+    /*!
+     * \brief Moves to the first item not earlier than \a time: the next readBlock starts from it
+     * \param index - index of the file, can be NULL or empty: then the file is read from the beginning
+     * \return false if there are no items after \a time
+     */
+    bool seekTime(TimeStampType time, const FileIndex * index = NULL);
+
+protected:
+    DataReader();
+
+    /// Reads header into info_ and moves pos after it. The position is at the beginning of file.
+    virtual bool readHeader() = 0;
+    /// Reads data from the current position, \see readBlock
+    virtual bool readData(DataBlock & block, int maxItems) = 0;
+    /// Moves to \a entry.offset, where item number \a entry.sample with time \a entry.time starts
+    virtual bool seekEntry(const FileIndex::Entry & entry) = 0;
+    /// Where to start looking for \a time without index: the first item by default
+    virtual FileIndex::Entry startEntry(TimeStampType time) const;
+
+    /// \return the next line (without line end) from pos, and moves pos after it
+    QByteArray readLine();
+
+    double periodMsecs() const { return 1000.0 / (info_.samplingFreq > 0 ? info_.samplingFreq : 1); }
+
+    // Contents of file: mapped into memory, or in `contents`
+    const char * data;
+    qint64 size;
+    qint64 pos;
+    OutputFormat::FileInfo info_;
+    QString fileName;
+
+private:
+    QScopedPointer<QFile> file; // Mapping stays valid while it is opened
+    QByteArray contents; // Decompressed, or read if file cannot be mapped
+    bool compressed;
+    FileIndex::Entry dataStart; // The first item, after header
+    DataBlock pending;          // Rest of block read by seekTime
+
+    Q_DISABLE_COPY(DataReader)
+};
+
+#endif // DATAREADER_H
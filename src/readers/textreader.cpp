@@ -0,0 +1,118 @@
+#include "textreader.h"
+#include "../logger.h"
+#include "../writers/textencoder.h"
+
+#include <cstring>
+
+namespace {
+    inline bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    // Leading number of line like "200 Hz"
+    int leadingInt(const QString & line) {
+        return line.section(' ', 0, 0).toInt();
+    }
+}
+
+TextReader::TextReader() :
+    sample(0), baseSample(0), baseTime(0), warnedInvalid(false)
+{}
+
+bool TextReader::readHeader() {
+    QString section;
+    QDate date;
+    QTime time;
+    int coordinateLine = 0;
+    while (pos < size) {
+        const QString line = QString::fromLocal8Bit(readLine()).trimmed();
+        if (line.startsWith('[')) {
+            section = line;
+            if (section == "[Values]") {
+                info_.startTime = QDateTime(date, time);
+                baseTime = info_.startTime.isValid() ? info_.startTime.toMSecsSinceEpoch() : 0;
+                return true;
+            }
+        } else if (section == "[Description]") {
+            info_.deviceID = line.section('=', 1);
+        } else if (section == "[Frequency]") {
+            info_.filterFreq = leadingInt(line);
+        } else if (section == "[Sample rate]") {
+            info_.samplingFreq = leadingInt(line);
+        } else if (section == "[Time]") {
+            time = QTime::fromString(line, "hh:mm:ss");
+        } else if (section == "[Date]") {
+            date = QDate::fromString(line, "dd.MM.yyyy");
+        } else if (section == "[Coordinates]") {
+            // Latitude, then longitude
+            (coordinateLine++ == 0 ? info_.latitude : info_.longitude) = line.section(' ', 0, 0);
+        }
+    }
+    return false; // No data section
+}
+
+bool TextReader::parseItem(const char * begin, const char * end, DataItem & item) {
+    const char * p = begin;
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        while (p < end && isSpace(*p)) {
+            ++p;
+        }
+        const bool negative = (p < end && *p == '-');
+        if (negative) {
+            ++p;
+        }
+        if (p == end || *p < '0' || *p > '9') {
+            return false;
+        }
+        // Accumulate as negative: the most negative value doesn't fit as positive
+        qint64 value = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            value = value*10 - (*p - '0');
+            ++p;
+        }
+        item.byChannel[ch] = DataType(negative ? value : -value);
+    }
+    return true;
+}
+
+bool TextReader::readData(DataBlock & block, int maxItems) {
+    block.timestamps.resize(0);
+    block.data.resize(0);
+    block.timestamps.reserve(maxItems);
+    block.data.reserve(maxItems);
+    const double period = periodMsecs();
+    const char * p = data + pos;
+    const char * end = data + size;
+    DataItem item;
+    while (block.data.size() < maxItems && p < end) {
+        // Lines are parsed right in the mapped file
+        const char * lineEnd = static_cast<const char*>(memchr(p, '\n', size_t(end - p)));
+        if (lineEnd == NULL) {
+            lineEnd = end;
+        }
+        const char * line = p;
+        p = (lineEnd < end) ? lineEnd + 1 : end;
+        if ( ! parseItem(line, lineEnd, item) ) {
+            if ( ! warnedInvalid && ! QByteArray(line, int(lineEnd - line)).trimmed().isEmpty() ) {
+                Logger::warning(tr("Invalid line after item %1 in %2 is skipped").arg(sample).arg(fileName));
+                warnedInvalid = true;
+            }
+            continue;
+        }
+        block.data << item;
+        block.timestamps << baseTime + (sample - baseSample)*period;
+        ++sample;
+    }
+    pos = p - data;
+    return block.size() > 0;
+}
+
+bool TextReader::seekEntry(const FileIndex::Entry & entry) {
+    if (entry.offset < 0 || entry.offset > size) {
+        return false;
+    }
+    pos = entry.offset;
+    sample = baseSample = entry.sample;
+    baseTime = entry.time;
+    return true;
+}
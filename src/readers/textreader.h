@@ -0,0 +1,34 @@
+#ifndef TEXTREADER_H
+#define TEXTREADER_H
+
+#include "datareader.h"
+
+/*!
+ * \brief Reads text files (TextFormat): header with sections, then one line per data item
+ */
+class TextReader : public DataReader
+{
+public:
+    TextReader();
+
+    OutputFormat::Type type() const override { return OutputFormat::Text; }
+
+    /*!
+     * \brief Parses one line of values separated by spaces, as formatted by TextEncoder
+     * \return false if the line doesn't contain a value for each channel
+     */
+    static bool parseItem(const char * begin, const char * end, DataItem & item);
+
+protected:
+    bool readHeader() override;
+    bool readData(DataBlock & block, int maxItems) override;
+    bool seekEntry(const FileIndex::Entry & entry) override;
+
+private:
+    qint64 sample;         // Number of the next item in file
+    qint64 baseSample;     // Item with known time...
+    TimeStampType baseTime; // ...and its time
+    bool warnedInvalid;
+};
+
+#endif // TEXTREADER_H
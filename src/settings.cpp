@@ -4,6 +4,12 @@
 
 #include "gui/timeplot.h" // for timeplot defaults
 #include "filewriter.h"   // for filewriter defaults
+#include "writers/gzipcompressor.h" // for compression defaults
+#include "archivewriter.h" // for archive defaults
+#include "archive/historyring.h" // for history defaults
+#include "dsp/ppsdstage.h" // for PPSD defaults
+#include "dsp/statsstage.h" // for stats defaults
+#include "dsp/butterworthfilter.h" // for filter defaults
 
 namespace {
     const QString SETTINGS_FILE = "seismoreg.ini";
@@ -21,6 +27,17 @@ namespace {
     const QString GPS_PORT_PREFIX  = "port_gps/";
     const QString GUI_PREFIX  = "gui/";
     const QString LOG_PREFIX  = "log/";
+    const QString ARCHIVE_PREFIX = "archive/";
+    const QString TRIGGER_PREFIX = "trigger/";
+    const QString SPECTRUM_PREFIX = "spectrum/";
+    const QString PPSD_PREFIX = "ppsd/";
+    const QString FILTER_PREFIX = "filter/";
+    const QString QUALITY_PREFIX = "quality/";
+    const QString RESPONSE_PREFIX = "response/";
+    const QString PICKER_PREFIX = "picker/";
+    const QString MAGNITUDE_PREFIX = "magnitude/";
+    const QString POLARIZATION_PREFIX = "polarization/";
+    const QString TEMPLATES_PREFIX = "templates/";
 
     QString prefixFor(Settings::WhichPort port) {
         return (port == Settings::PortADC) ? ADC_PORT_PREFIX : GPS_PORT_PREFIX;
@@ -32,10 +49,88 @@ namespace {
     const QString FILTR_FREQ = CORE_PREFIX + "filter_frequency";
     const QString OUTPUT_DIR = CORE_PREFIX + "output_dir";
     const QString FILE_FORMAT= CORE_PREFIX + "filename_format";
+    const QString SYNC_SECS  = CORE_PREFIX + "sync_interval_secs";
+    const QString SYNC_MB    = CORE_PREFIX + "sync_interval_mb";
+    const QString QUEUE_MB   = CORE_PREFIX + "queue_limit_mb";
+    const QString ROTATE_SECS= CORE_PREFIX + "rotation_period_secs";
+    const QString ROTATE_MB  = CORE_PREFIX + "rotation_size_mb";
+    const QString COMPRESS   = CORE_PREFIX + "compress";
+    const QString COMPRESS_LEVEL = CORE_PREFIX + "compression_level";
+    const QString INDEX_INTERVAL = CORE_PREFIX + "index_interval";
+    const QString HISTORY_HOURS  = CORE_PREFIX + "history_ring_hours";
+    const QString HISTORY_FILE   = CORE_PREFIX + "history_ring_file";
+    const QString STATS_WINDOW_SECS = CORE_PREFIX + "stats_window_secs";
+    const QString STATS_IN_HEADER   = CORE_PREFIX + "stats_in_header";
+    const QString EVENT_RECORDING= CORE_PREFIX + "event_recording";
+    const QString PRE_EVENT_SECS = CORE_PREFIX + "pre_event_secs";
+    const QString POST_EVENT_SECS= CORE_PREFIX + "post_event_secs";
+    const QString JOURNAL    = CORE_PREFIX + "journal";
+    const QString JOURNAL_BLOCKS = CORE_PREFIX + "journal_commit_blocks";
+    const QString JOURNAL_MSECS  = CORE_PREFIX + "journal_commit_msecs";
+    const QString OUT_FORMATS= CORE_PREFIX + "output_formats";
+    const QString MSEED_NET  = CORE_PREFIX + "mseed_network";
+    const QString MSEED_REC  = CORE_PREFIX + "mseed_record_length";
     const QString DEVICE_ID_FILE=CORE_PREFIX +"device_id_file";
+    const QString ARCHIVE    = ARCHIVE_PREFIX + "enabled";
+    const QString ARCHIVE_DIR= ARCHIVE_PREFIX + "dir";
+    const QString ARCHIVE_CHUNK_SECS = ARCHIVE_PREFIX + "chunk_secs";
+    const QString ARCHIVE_RETENTION  = ARCHIVE_PREFIX + "retention_days";
+    const QString TRIGGER    = TRIGGER_PREFIX + "enabled";
+    const QString TRIGGER_STA= TRIGGER_PREFIX + "sta_secs";
+    const QString TRIGGER_LTA= TRIGGER_PREFIX + "lta_secs";
+    const QString TRIGGER_COINCIDENCE = TRIGGER_PREFIX + "coincidence";
+    // Parameterized keys: use with .arg(channel number, from 1)
+    const QString TRIGGER_ON = TRIGGER_PREFIX + "on_ratio_%1";
+    const QString TRIGGER_OFF= TRIGGER_PREFIX + "off_ratio_%1";
+    const QString SPECTRUM_WINDOW  = SPECTRUM_PREFIX + "window_size";
+    const QString SPECTRUM_OVERLAP = SPECTRUM_PREFIX + "overlap_percent";
+    const QString SPECTRUM_AVERAGING = SPECTRUM_PREFIX + "averaging";
+    const QString PPSD       = PPSD_PREFIX + "enabled";
+    const QString PPSD_DIR   = PPSD_PREFIX + "dir";
+    const QString PPSD_SEGMENT_SECS = PPSD_PREFIX + "segment_secs";
+    const QString FILTER_TYPE= FILTER_PREFIX + "type";
+    const QString FILTER_ORDER = FILTER_PREFIX + "order";
+    const QString FILTER_LOW = FILTER_PREFIX + "low_freq";
+    const QString FILTER_HIGH= FILTER_PREFIX + "high_freq";
+    const QString FILTER_RECORDED = FILTER_PREFIX + "recorded";
+    const QString QUALITY    = QUALITY_PREFIX + "enabled";
+    const QString QUALITY_FULL_SCALE = QUALITY_PREFIX + "full_scale";
+    const QString QUALITY_CLIP = QUALITY_PREFIX + "clip_percent";
+    const QString QUALITY_FLATLINE = QUALITY_PREFIX + "flatline_secs";
+    const QString QUALITY_SPIKE_WINDOW = QUALITY_PREFIX + "spike_half_window";
+    const QString QUALITY_SPIKE_THRESHOLD = QUALITY_PREFIX + "spike_threshold";
+    const QString QUALITY_SPIKE_MIN = QUALITY_PREFIX + "spike_min_deviation";
+    const QString RESPONSE   = RESPONSE_PREFIX + "enabled";
+    const QString RESPONSE_ZEROS = RESPONSE_PREFIX + "zeros";
+    const QString RESPONSE_POLES = RESPONSE_PREFIX + "poles";
+    const QString RESPONSE_SENSITIVITY = RESPONSE_PREFIX + "sensitivity";
+    const QString RESPONSE_REFERENCE = RESPONSE_PREFIX + "reference_freq";
+    const QString RESPONSE_SENSOR = RESPONSE_PREFIX + "sensor_quantity";
+    const QString RESPONSE_OUTPUT = RESPONSE_PREFIX + "output_quantity";
+    const QString RESPONSE_HIGH_PASS = RESPONSE_PREFIX + "high_pass_freq";
+    const QString PICKER     = PICKER_PREFIX + "enabled";
+    const QString PICKER_PRE = PICKER_PREFIX + "pre_secs";
+    const QString PICKER_POST= PICKER_PREFIX + "post_secs";
+    const QString PICKER_S   = PICKER_PREFIX + "s_picks";
+    const QString PICKER_S_DELAY = PICKER_PREFIX + "s_delay_secs";
+    const QString PICKER_SNR_WINDOW = PICKER_PREFIX + "snr_secs";
+    const QString PICKER_MIN_SNR = PICKER_PREFIX + "min_snr";
+    const QString MAGNITUDE   = MAGNITUDE_PREFIX + "enabled";
+    const QString MAGNITUDE_DISTANCE = MAGNITUDE_PREFIX + "distance_km";
+    const QString MAGNITUDE_A = MAGNITUDE_PREFIX + "a";
+    const QString MAGNITUDE_B = MAGNITUDE_PREFIX + "b";
+    const QString MAGNITUDE_C = MAGNITUDE_PREFIX + "c";
+    const QString POLARIZATION = POLARIZATION_PREFIX + "enabled";
+    const QString POLARIZATION_WINDOW = POLARIZATION_PREFIX + "window_secs";
+    const QString POLARIZATION_HOP = POLARIZATION_PREFIX + "hop_secs";
+    const QString TEMPLATES = TEMPLATES_PREFIX + "enabled";
+    const QString TEMPLATES_DIR = TEMPLATES_PREFIX + "dir";
+    const QString TEMPLATES_THRESHOLD = TEMPLATES_PREFIX + "threshold_mads";
+    const QString TEMPLATES_MAD_SECS = TEMPLATES_PREFIX + "mad_secs";
     const QString TABLE_SHOWN    = GUI_PREFIX + "table_shown";
     const QString SETTINGS_SHOWN = GUI_PREFIX + "settings_shown";
     const QString STATS_SHOWN    = GUI_PREFIX + "stats_shown";
+    const QString SPECTROGRAM_SHOWN = GUI_PREFIX + "spectrogram_shown";
     const QString FIXED_SCALE    = GUI_PREFIX + "fixed_scale";
     const QString FIXED_SCALE_MAX= GUI_PREFIX + "fixed_scale_max";
     const QString FIXED_SCALE_MIN= GUI_PREFIX + "fixed_scale_min";
@@ -59,7 +154,22 @@ namespace {
     const bool TABLE_SHOWN_DEFAULT    = false;
     const bool SETTINGS_SHOWN_DEFAULT = true;
     const bool STATS_SHOWN_DEFAULT    = true;
+    const bool SPECTROGRAM_SHOWN_DEFAULT = true;
     const bool LOG_LEV_ENABLED_DEFAULT= true;
+    const bool COMPRESS_DEFAULT       = false;
+    const bool JOURNAL_DEFAULT        = true;
+    const bool ARCHIVE_DEFAULT        = false;
+    const bool TRIGGER_DEFAULT        = false;
+    const bool EVENT_RECORDING_DEFAULT= false;
+    const bool STATS_IN_HEADER_DEFAULT= false; // Headers stay the same as without statistics
+    const bool PPSD_DEFAULT           = false;
+    const bool FILTER_RECORDED_DEFAULT= false;
+    const bool QUALITY_DEFAULT        = true;
+    const bool RESPONSE_DEFAULT       = false;
+    const bool PICKER_DEFAULT         = false;
+    const bool MAGNITUDE_DEFAULT      = false;
+    const bool POLARIZATION_DEFAULT   = false;
+    const bool TEMPLATES_DEFAULT      = false;
 
     const QString levelToStr[Logger::_levelsCount] = {"trace", "info", "warning", "error"};
 
@@ -95,6 +205,55 @@ namespace {
         res[FLOW_XONXOFF]  = "software";
         return res;
     }
+    template<>
+    QHash<ButterworthFilter::Type,QString> stringMap<ButterworthFilter::Type>() {
+        QHash<ButterworthFilter::Type,QString> res;
+        res[ButterworthFilter::None]     = "none";
+        res[ButterworthFilter::LowPass]  = "lowpass";
+        res[ButterworthFilter::HighPass] = "highpass";
+        res[ButterworthFilter::BandPass] = "bandpass";
+        return res;
+    }
+    template<>
+    QHash<ResponseFilter::Quantity,QString> stringMap<ResponseFilter::Quantity>() {
+        QHash<ResponseFilter::Quantity,QString> res;
+        res[ResponseFilter::Displacement] = "displacement";
+        res[ResponseFilter::Velocity]     = "velocity";
+        res[ResponseFilter::Acceleration] = "acceleration";
+        return res;
+    }
+
+    // Roots (poles or zeros) are kept as a list of "re im" in rad/s, an empty string - no roots
+    QVariant toRootsVariant(const QVector<ResponseFilter::Root> & roots) {
+        QStringList res;
+        for (const ResponseFilter::Root & root: roots) {
+            res << QString("%1 %2").arg(root.real(), 0, 'g', 10).arg(root.imag(), 0, 'g', 10);
+        }
+        if (res.isEmpty()) {
+            return QString(""); // An empty list would be read as no value
+        }
+        return res;
+    }
+    QVector<ResponseFilter::Root> fromRootsVariant(QVariant variant, const QVector<ResponseFilter::Root> & defaultValue) {
+        if ( ! variant.isValid() ) {
+            return defaultValue;
+        }
+        QVector<ResponseFilter::Root> res;
+        for (const QString & item: variant.toStringList()) {
+            const QStringList parts = item.split(' ', QString::SkipEmptyParts);
+            if (parts.isEmpty()) {
+                continue;
+            }
+            bool okRe = false, okIm = (parts.size() < 2);
+            const double re = parts.value(0).toDouble(&okRe);
+            const double im = parts.size() < 2 ? 0 : parts[1].toDouble(&okIm);
+            if ( ! okRe || ! okIm || parts.size() > 2 ) {
+                return defaultValue;
+            }
+            res << ResponseFilter::Root(re, im);
+        }
+        return res;
+    }
 
     template<typename T>
     QVariant toStrVariant(T value) {
@@ -198,6 +357,444 @@ void Settings::setFileNameFormat(const QString &value) {
     settings.setValue(FILE_FORMAT, value);
 }
 
+int Settings::syncIntervalSecs() const {
+    return settings.value(SYNC_SECS, AsyncFileSink::DEFAULT_SYNC_SECS).toInt();
+}
+void Settings::setSyncIntervalSecs(int value) {
+    settings.setValue(SYNC_SECS, value);
+}
+
+int Settings::syncIntervalMegabytes() const {
+    return settings.value(SYNC_MB, int(AsyncFileSink::DEFAULT_SYNC_BYTES >> 20)).toInt();
+}
+void Settings::setSyncIntervalMegabytes(int value) {
+    settings.setValue(SYNC_MB, value);
+}
+
+int Settings::queueLimitMegabytes() const {
+    return settings.value(QUEUE_MB, FileWriter::DEFAULT_QUEUE_LIMIT_MB).toInt();
+}
+void Settings::setQueueLimitMegabytes(int value) {
+    settings.setValue(QUEUE_MB, value);
+}
+
+int Settings::rotationPeriodSecs() const {
+    return settings.value(ROTATE_SECS, FileWriter::DEFAULT_ROTATION_SECS).toInt();
+}
+void Settings::setRotationPeriodSecs(int value) {
+    settings.setValue(ROTATE_SECS, value);
+}
+
+int Settings::rotationSizeMegabytes() const {
+    return settings.value(ROTATE_MB, FileWriter::DEFAULT_ROTATION_MB).toInt();
+}
+void Settings::setRotationSizeMegabytes(int value) {
+    settings.setValue(ROTATE_MB, value);
+}
+
+bool Settings::isCompressionEnabled() const {
+    return settings.value(COMPRESS, COMPRESS_DEFAULT).toBool();
+}
+void Settings::setCompressionEnabled(bool value) {
+    settings.setValue(COMPRESS, value);
+}
+
+int Settings::compressionLevel() const {
+    return settings.value(COMPRESS_LEVEL, GzipCompressor::DEFAULT_LEVEL).toInt();
+}
+void Settings::setCompressionLevel(int value) {
+    settings.setValue(COMPRESS_LEVEL, value);
+}
+
+int Settings::indexInterval() const {
+    return settings.value(INDEX_INTERVAL, FileIndex::DEFAULT_INTERVAL).toInt();
+}
+void Settings::setIndexInterval(int value) {
+    settings.setValue(INDEX_INTERVAL, value);
+}
+
+bool Settings::isEventRecordingEnabled() const {
+    return settings.value(EVENT_RECORDING, EVENT_RECORDING_DEFAULT).toBool();
+}
+void Settings::setEventRecordingEnabled(bool value) {
+    settings.setValue(EVENT_RECORDING, value);
+}
+
+int Settings::preEventSecs() const {
+    return settings.value(PRE_EVENT_SECS, FileWriter::DEFAULT_PRE_EVENT_SECS).toInt();
+}
+void Settings::setPreEventSecs(int value) {
+    settings.setValue(PRE_EVENT_SECS, value);
+}
+
+int Settings::postEventSecs() const {
+    return settings.value(POST_EVENT_SECS, FileWriter::DEFAULT_POST_EVENT_SECS).toInt();
+}
+void Settings::setPostEventSecs(int value) {
+    settings.setValue(POST_EVENT_SECS, value);
+}
+
+int Settings::historyRingHours() const {
+    return settings.value(HISTORY_HOURS, HistoryRing::DEFAULT_HOURS).toInt();
+}
+void Settings::setHistoryRingHours(int value) {
+    settings.setValue(HISTORY_HOURS, value);
+}
+
+QString Settings::historyRingFile() const {
+    return settings.value(HISTORY_FILE, HistoryRing::defaultPath()).toString();
+}
+void Settings::setHistoryRingFile(const QString &value) {
+    settings.setValue(HISTORY_FILE, value);
+}
+
+int Settings::statsWindowSecs() const {
+    return settings.value(STATS_WINDOW_SECS, StatsStage::DEFAULT_WINDOW_SECS).toInt();
+}
+void Settings::setStatsWindowSecs(int value) {
+    settings.setValue(STATS_WINDOW_SECS, value);
+}
+
+bool Settings::isStatsInHeaderEnabled() const {
+    return settings.value(STATS_IN_HEADER, STATS_IN_HEADER_DEFAULT).toBool();
+}
+void Settings::setStatsInHeaderEnabled(bool value) {
+    settings.setValue(STATS_IN_HEADER, value);
+}
+
+bool Settings::isJournalEnabled() const {
+    return settings.value(JOURNAL, JOURNAL_DEFAULT).toBool();
+}
+void Settings::setJournalEnabled(bool value) {
+    settings.setValue(JOURNAL, value);
+}
+
+int Settings::journalCommitBlocks() const {
+    return settings.value(JOURNAL_BLOCKS, Journal::DEFAULT_COMMIT_BLOCKS).toInt();
+}
+void Settings::setJournalCommitBlocks(int value) {
+    settings.setValue(JOURNAL_BLOCKS, value);
+}
+
+int Settings::journalCommitMsecs() const {
+    return settings.value(JOURNAL_MSECS, Journal::DEFAULT_COMMIT_MSECS).toInt();
+}
+void Settings::setJournalCommitMsecs(int value) {
+    settings.setValue(JOURNAL_MSECS, value);
+}
+
+OutputFormat::Types Settings::outputFormats() const {
+    QStringList names = settings.value(OUT_FORMATS, OutputFormat::typeName(OutputFormat::Text)).toStringList();
+    OutputFormat::Types res;
+    for (const QString & name: names) {
+        res |= OutputFormat::typeFromName(name);
+    }
+    return res;
+}
+void Settings::setOutputFormats(OutputFormat::Types value) {
+    QStringList names;
+    for (OutputFormat::Type type: OutputFormat::ALL_TYPES) {
+        if (value.testFlag(type)) {
+            names << OutputFormat::typeName(type);
+        }
+    }
+    settings.setValue(OUT_FORMATS, names);
+}
+
+QString Settings::miniSeedNetwork() const {
+    return settings.value(MSEED_NET, MiniSeedEncoder::DEFAULT_NETWORK).toString();
+}
+void Settings::setMiniSeedNetwork(const QString &value) {
+    settings.setValue(MSEED_NET, value);
+}
+
+int Settings::miniSeedRecordLength() const {
+    return settings.value(MSEED_REC, MiniSeedEncoder::DEFAULT_RECORD_LENGTH).toInt();
+}
+void Settings::setMiniSeedRecordLength(int value) {
+    settings.setValue(MSEED_REC, value);
+}
+
+// Archive settings
+
+bool Settings::isArchiveEnabled() const {
+    return settings.value(ARCHIVE, ARCHIVE_DEFAULT).toBool();
+}
+void Settings::setArchiveEnabled(bool value) {
+    settings.setValue(ARCHIVE, value);
+}
+
+QString Settings::archiveDirectory() const {
+    return settings.value(ARCHIVE_DIR, ArchiveWriter::DEFAULT_ARCHIVE_DIR).toString();
+}
+void Settings::setArchiveDirectory(const QString &value) {
+    settings.setValue(ARCHIVE_DIR, value);
+}
+
+int Settings::archiveChunkSecs() const {
+    return settings.value(ARCHIVE_CHUNK_SECS, Archive::DEFAULT_CHUNK_SECS).toInt();
+}
+void Settings::setArchiveChunkSecs(int value) {
+    settings.setValue(ARCHIVE_CHUNK_SECS, value);
+}
+
+int Settings::archiveRetentionDays() const {
+    return settings.value(ARCHIVE_RETENTION, Archive::DEFAULT_RETENTION_DAYS).toInt();
+}
+void Settings::setArchiveRetentionDays(int value) {
+    settings.setValue(ARCHIVE_RETENTION, value);
+}
+
+// Trigger settings
+
+bool Settings::isTriggerEnabled() const {
+    return settings.value(TRIGGER, TRIGGER_DEFAULT).toBool();
+}
+void Settings::setTriggerEnabled(bool value) {
+    settings.setValue(TRIGGER, value);
+}
+
+StaLtaTrigger::Parameters Settings::triggerParameters() const {
+    StaLtaTrigger::Parameters res; // Defaults
+    res.staSecs = settings.value(TRIGGER_STA, res.staSecs).toDouble();
+    res.ltaSecs = settings.value(TRIGGER_LTA, res.ltaSecs).toDouble();
+    res.coincidence = settings.value(TRIGGER_COINCIDENCE, res.coincidence).toInt();
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        res.onRatio[ch]  = settings.value(TRIGGER_ON.arg(ch + 1),  res.onRatio[ch]).toDouble();
+        res.offRatio[ch] = settings.value(TRIGGER_OFF.arg(ch + 1), res.offRatio[ch]).toDouble();
+    }
+    return res;
+}
+void Settings::setTriggerParameters(const StaLtaTrigger::Parameters & value) {
+    settings.setValue(TRIGGER_STA, value.staSecs);
+    settings.setValue(TRIGGER_LTA, value.ltaSecs);
+    settings.setValue(TRIGGER_COINCIDENCE, value.coincidence);
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        settings.setValue(TRIGGER_ON.arg(ch + 1),  value.onRatio[ch]);
+        settings.setValue(TRIGGER_OFF.arg(ch + 1), value.offRatio[ch]);
+    }
+}
+
+// Spectrum settings
+
+SpectrumStage::Parameters Settings::spectrumParameters() const {
+    SpectrumStage::Parameters res; // Defaults
+    res.windowSize = settings.value(SPECTRUM_WINDOW, res.windowSize).toInt();
+    res.overlapPercent = settings.value(SPECTRUM_OVERLAP, res.overlapPercent).toInt();
+    res.averaging = settings.value(SPECTRUM_AVERAGING, res.averaging).toInt();
+    return res;
+}
+void Settings::setSpectrumParameters(const SpectrumStage::Parameters & value) {
+    settings.setValue(SPECTRUM_WINDOW, value.windowSize);
+    settings.setValue(SPECTRUM_OVERLAP, value.overlapPercent);
+    settings.setValue(SPECTRUM_AVERAGING, value.averaging);
+}
+
+// PPSD settings
+
+bool Settings::isPpsdEnabled() const {
+    return settings.value(PPSD, PPSD_DEFAULT).toBool();
+}
+void Settings::setPpsdEnabled(bool value) {
+    settings.setValue(PPSD, value);
+}
+
+QString Settings::ppsdDirectory() const {
+    return settings.value(PPSD_DIR, PpsdStage::DEFAULT_DIR).toString();
+}
+void Settings::setPpsdDirectory(const QString &value) {
+    settings.setValue(PPSD_DIR, value);
+}
+
+int Settings::ppsdSegmentSecs() const {
+    return settings.value(PPSD_SEGMENT_SECS, PpsdStage::DEFAULT_SEGMENT_SECS).toInt();
+}
+void Settings::setPpsdSegmentSecs(int value) {
+    settings.setValue(PPSD_SEGMENT_SECS, value);
+}
+
+// Filter settings
+
+ButterworthFilter::Parameters Settings::filterParameters() const {
+    ButterworthFilter::Parameters res; // Defaults
+    res.type = fromStrVariant<ButterworthFilter::Type>(settings.value(FILTER_TYPE), res.type);
+    res.order = settings.value(FILTER_ORDER, res.order).toInt();
+    res.lowFreq = settings.value(FILTER_LOW, res.lowFreq).toDouble();
+    res.highFreq = settings.value(FILTER_HIGH, res.highFreq).toDouble();
+    return res;
+}
+void Settings::setFilterParameters(const ButterworthFilter::Parameters & value) {
+    settings.setValue(FILTER_TYPE, toStrVariant(value.type));
+    settings.setValue(FILTER_ORDER, value.order);
+    settings.setValue(FILTER_LOW, value.lowFreq);
+    settings.setValue(FILTER_HIGH, value.highFreq);
+}
+
+bool Settings::isFilteredRecording() const {
+    return settings.value(FILTER_RECORDED, FILTER_RECORDED_DEFAULT).toBool();
+}
+void Settings::setFilteredRecording(bool value) {
+    settings.setValue(FILTER_RECORDED, value);
+}
+
+// Response settings
+
+bool Settings::isResponseCorrected() const {
+    return settings.value(RESPONSE, RESPONSE_DEFAULT).toBool();
+}
+void Settings::setResponseCorrected(bool value) {
+    settings.setValue(RESPONSE, value);
+}
+
+ResponseFilter::Parameters Settings::responseParameters() const {
+    ResponseFilter::Parameters res; // Defaults
+    res.zeros = fromRootsVariant(settings.value(RESPONSE_ZEROS), res.zeros);
+    res.poles = fromRootsVariant(settings.value(RESPONSE_POLES), res.poles);
+    res.sensitivity = settings.value(RESPONSE_SENSITIVITY, res.sensitivity).toDouble();
+    res.referenceFreq = settings.value(RESPONSE_REFERENCE, res.referenceFreq).toDouble();
+    res.sensorQuantity = fromStrVariant<ResponseFilter::Quantity>(settings.value(RESPONSE_SENSOR), res.sensorQuantity);
+    res.outputQuantity = fromStrVariant<ResponseFilter::Quantity>(settings.value(RESPONSE_OUTPUT), res.outputQuantity);
+    res.highPassFreq = settings.value(RESPONSE_HIGH_PASS, res.highPassFreq).toDouble();
+    return res;
+}
+void Settings::setResponseParameters(const ResponseFilter::Parameters & value) {
+    settings.setValue(RESPONSE_ZEROS, toRootsVariant(value.zeros));
+    settings.setValue(RESPONSE_POLES, toRootsVariant(value.poles));
+    settings.setValue(RESPONSE_SENSITIVITY, value.sensitivity);
+    settings.setValue(RESPONSE_REFERENCE, value.referenceFreq);
+    settings.setValue(RESPONSE_SENSOR, toStrVariant(value.sensorQuantity));
+    settings.setValue(RESPONSE_OUTPUT, toStrVariant(value.outputQuantity));
+    settings.setValue(RESPONSE_HIGH_PASS, value.highPassFreq);
+}
+
+// Picker settings
+
+bool Settings::isPickerEnabled() const {
+    return settings.value(PICKER, PICKER_DEFAULT).toBool();
+}
+void Settings::setPickerEnabled(bool value) {
+    settings.setValue(PICKER, value);
+}
+
+AicPicker::Parameters Settings::pickerParameters() const {
+    AicPicker::Parameters res; // Defaults
+    res.preSecs = settings.value(PICKER_PRE, res.preSecs).toDouble();
+    res.postSecs = settings.value(PICKER_POST, res.postSecs).toDouble();
+    res.sPicks = settings.value(PICKER_S, res.sPicks).toBool();
+    res.sDelaySecs = settings.value(PICKER_S_DELAY, res.sDelaySecs).toDouble();
+    res.snrSecs = settings.value(PICKER_SNR_WINDOW, res.snrSecs).toDouble();
+    res.minSnr = settings.value(PICKER_MIN_SNR, res.minSnr).toDouble();
+    return res;
+}
+void Settings::setPickerParameters(const AicPicker::Parameters & value) {
+    settings.setValue(PICKER_PRE, value.preSecs);
+    settings.setValue(PICKER_POST, value.postSecs);
+    settings.setValue(PICKER_S, value.sPicks);
+    settings.setValue(PICKER_S_DELAY, value.sDelaySecs);
+    settings.setValue(PICKER_SNR_WINDOW, value.snrSecs);
+    settings.setValue(PICKER_MIN_SNR, value.minSnr);
+}
+
+// Magnitude settings
+
+bool Settings::isMagnitudeEnabled() const {
+    return settings.value(MAGNITUDE, MAGNITUDE_DEFAULT).toBool();
+}
+void Settings::setMagnitudeEnabled(bool value) {
+    settings.setValue(MAGNITUDE, value);
+}
+
+MagnitudeStage::Parameters Settings::magnitudeParameters() const {
+    MagnitudeStage::Parameters res; // Defaults
+    res.inputQuantity = responseParameters().outputQuantity;
+    res.distanceKm = settings.value(MAGNITUDE_DISTANCE, res.distanceKm).toDouble();
+    res.a = settings.value(MAGNITUDE_A, res.a).toDouble();
+    res.b = settings.value(MAGNITUDE_B, res.b).toDouble();
+    res.c = settings.value(MAGNITUDE_C, res.c).toDouble();
+    return res;
+}
+void Settings::setMagnitudeParameters(const MagnitudeStage::Parameters & value) {
+    settings.setValue(MAGNITUDE_DISTANCE, value.distanceKm);
+    settings.setValue(MAGNITUDE_A, value.a);
+    settings.setValue(MAGNITUDE_B, value.b);
+    settings.setValue(MAGNITUDE_C, value.c);
+}
+
+// Polarization settings
+
+bool Settings::isPolarizationEnabled() const {
+    return settings.value(POLARIZATION, POLARIZATION_DEFAULT).toBool();
+}
+void Settings::setPolarizationEnabled(bool value) {
+    settings.setValue(POLARIZATION, value);
+}
+
+PolarizationStage::Parameters Settings::polarizationParameters() const {
+    PolarizationStage::Parameters res; // Defaults
+    res.windowSecs = settings.value(POLARIZATION_WINDOW, res.windowSecs).toDouble();
+    res.hopSecs = settings.value(POLARIZATION_HOP, res.hopSecs).toDouble();
+    return res;
+}
+void Settings::setPolarizationParameters(const PolarizationStage::Parameters & value) {
+    settings.setValue(POLARIZATION_WINDOW, value.windowSecs);
+    settings.setValue(POLARIZATION_HOP, value.hopSecs);
+}
+
+// Template settings
+
+bool Settings::isTemplateMatchingEnabled() const {
+    return settings.value(TEMPLATES, TEMPLATES_DEFAULT).toBool();
+}
+void Settings::setTemplateMatchingEnabled(bool value) {
+    settings.setValue(TEMPLATES, value);
+}
+
+QString Settings::templatesDirectory() const {
+    return settings.value(TEMPLATES_DIR, TemplateStage::DEFAULT_DIR).toString();
+}
+void Settings::setTemplatesDirectory(const QString &value) {
+    settings.setValue(TEMPLATES_DIR, value);
+}
+
+TemplateMatcher::Parameters Settings::templateParameters() const {
+    TemplateMatcher::Parameters res; // Defaults
+    res.thresholdMads = settings.value(TEMPLATES_THRESHOLD, res.thresholdMads).toDouble();
+    res.madSecs = settings.value(TEMPLATES_MAD_SECS, res.madSecs).toDouble();
+    return res;
+}
+void Settings::setTemplateParameters(const TemplateMatcher::Parameters & value) {
+    settings.setValue(TEMPLATES_THRESHOLD, value.thresholdMads);
+    settings.setValue(TEMPLATES_MAD_SECS, value.madSecs);
+}
+
+// Quality settings
+
+bool Settings::isQualityEnabled() const {
+    return settings.value(QUALITY, QUALITY_DEFAULT).toBool();
+}
+void Settings::setQualityEnabled(bool value) {
+    settings.setValue(QUALITY, value);
+}
+
+QualityStage::Parameters Settings::qualityParameters() const {
+    QualityStage::Parameters res; // Defaults
+    res.fullScale = settings.value(QUALITY_FULL_SCALE, res.fullScale).toInt();
+    res.clipPercent = settings.value(QUALITY_CLIP, res.clipPercent).toDouble();
+    res.flatlineSecs = settings.value(QUALITY_FLATLINE, res.flatlineSecs).toDouble();
+    res.spikeHalfWindow = settings.value(QUALITY_SPIKE_WINDOW, res.spikeHalfWindow).toInt();
+    res.spikeThreshold = settings.value(QUALITY_SPIKE_THRESHOLD, res.spikeThreshold).toDouble();
+    res.spikeMinDeviation = settings.value(QUALITY_SPIKE_MIN, res.spikeMinDeviation).toInt();
+    return res;
+}
+void Settings::setQualityParameters(const QualityStage::Parameters & value) {
+    settings.setValue(QUALITY_FULL_SCALE, value.fullScale);
+    settings.setValue(QUALITY_CLIP, value.clipPercent);
+    settings.setValue(QUALITY_FLATLINE, value.flatlineSecs);
+    settings.setValue(QUALITY_SPIKE_WINDOW, value.spikeHalfWindow);
+    settings.setValue(QUALITY_SPIKE_THRESHOLD, value.spikeThreshold);
+    settings.setValue(QUALITY_SPIKE_MIN, value.spikeMinDeviation);
+}
+
 // Ports settings
 
 QString Settings::portName(Settings::WhichPort port) const {
@@ -309,6 +906,13 @@ void Settings::setStatsShown(bool value) {
     settings.setValue(STATS_SHOWN, value);
 }
 
+bool Settings::isSpectrogramShown() const {
+    return settings.value(SPECTROGRAM_SHOWN, SPECTROGRAM_SHOWN_DEFAULT).toBool();
+}
+void Settings::setSpectrogramShown(bool value) {
+    settings.setValue(SPECTROGRAM_SHOWN, value);
+}
+
 bool Settings::isPlotFixedScale() const {
     return settings.value(FIXED_SCALE, TimePlot::FIXED_SCALE_DEFAULT).toBool();
 }
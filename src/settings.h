@@ -5,6 +5,16 @@
 #include <QSettings>
 #include "protocols/serialprotocol.h"
 #include "logger.h"
+#include "writers/outputformat.h"
+#include "dsp/staltatrigger.h"
+#include "dsp/spectrumstage.h"
+#include "dsp/butterworthfilter.h"
+#include "dsp/qualitystage.h"
+#include "dsp/responsefilter.h"
+#include "dsp/aicpicker.h"
+#include "dsp/magnitudestage.h"
+#include "dsp/polarizationstage.h"
+#include "dsp/templatestage.h"
 
 class Settings : public QObject
 {
@@ -29,6 +39,182 @@ public:
     QString fileNameFormat() const;
     void setFileNameFormat(const QString &value);
 
+    int  syncIntervalSecs() const;
+    void setSyncIntervalSecs(int value);
+
+    int  syncIntervalMegabytes() const;
+    void setSyncIntervalMegabytes(int value);
+
+    int  queueLimitMegabytes() const;
+    void setQueueLimitMegabytes(int value);
+
+    int  rotationPeriodSecs() const;
+    void setRotationPeriodSecs(int value);
+
+    int  rotationSizeMegabytes() const;
+    void setRotationSizeMegabytes(int value);
+
+    bool isCompressionEnabled() const;
+    void setCompressionEnabled(bool value);
+
+    int  compressionLevel() const;
+    void setCompressionLevel(int value);
+
+    int  indexInterval() const;
+    void setIndexInterval(int value);
+
+    bool isEventRecordingEnabled() const;
+    void setEventRecordingEnabled(bool value);
+
+    int  preEventSecs() const;
+    void setPreEventSecs(int value);
+
+    int  postEventSecs() const;
+    void setPostEventSecs(int value);
+
+    int  historyRingHours() const;
+    void setHistoryRingHours(int value);
+
+    QString historyRingFile() const;
+    void setHistoryRingFile(const QString &value);
+
+    int  statsWindowSecs() const;
+    void setStatsWindowSecs(int value);
+
+    bool isStatsInHeaderEnabled() const;
+    void setStatsInHeaderEnabled(bool value);
+
+    bool isJournalEnabled() const;
+    void setJournalEnabled(bool value);
+
+    int  journalCommitBlocks() const;
+    void setJournalCommitBlocks(int value);
+
+    int  journalCommitMsecs() const;
+    void setJournalCommitMsecs(int value);
+
+    OutputFormat::Types outputFormats() const;
+    void setOutputFormats(OutputFormat::Types value);
+
+    QString miniSeedNetwork() const;
+    void setMiniSeedNetwork(const QString &value);
+
+    int  miniSeedRecordLength() const;
+    void setMiniSeedRecordLength(int value);
+
+    // Archive settings
+
+    bool isArchiveEnabled() const;
+    void setArchiveEnabled(bool value);
+
+    QString archiveDirectory() const;
+    void setArchiveDirectory(const QString &value);
+
+    int  archiveChunkSecs() const;
+    void setArchiveChunkSecs(int value);
+
+    int  archiveRetentionDays() const;
+    void setArchiveRetentionDays(int value);
+
+    // Trigger settings
+
+    bool isTriggerEnabled() const;
+    void setTriggerEnabled(bool value);
+
+    // a convenience: get/set all parameters of STA/LTA trigger in one call
+    StaLtaTrigger::Parameters triggerParameters() const;
+    void setTriggerParameters(const StaLtaTrigger::Parameters & value);
+
+    // Spectrum settings
+
+    // a convenience: get/set all parameters of SpectrumStage in one call
+    SpectrumStage::Parameters spectrumParameters() const;
+    void setSpectrumParameters(const SpectrumStage::Parameters & value);
+
+    // PPSD settings
+
+    bool isPpsdEnabled() const;
+    void setPpsdEnabled(bool value);
+
+    QString ppsdDirectory() const;
+    void setPpsdDirectory(const QString &value);
+
+    int  ppsdSegmentSecs() const;
+    void setPpsdSegmentSecs(int value);
+
+    // Filter settings
+
+    // a convenience: get/set all parameters of the filter of live data in one call
+    ButterworthFilter::Parameters filterParameters() const;
+    void setFilterParameters(const ButterworthFilter::Parameters & value);
+
+    // Whether files are written from filtered (or corrected) data instead of raw ones
+    bool isFilteredRecording() const;
+    void setFilteredRecording(bool value);
+
+    // Response settings
+
+    // Whether data are converted from counts to physical units before the filter
+    bool isResponseCorrected() const;
+    void setResponseCorrected(bool value);
+
+    // a convenience: get/set all parameters of the instrument and conversion in one call
+    ResponseFilter::Parameters responseParameters() const;
+    void setResponseParameters(const ResponseFilter::Parameters & value);
+
+    // Picker settings
+
+    // Whether phases of triggered events are picked (needs the trigger)
+    bool isPickerEnabled() const;
+    void setPickerEnabled(bool value);
+
+    // a convenience: get/set all parameters of AicPicker in one call
+    AicPicker::Parameters pickerParameters() const;
+    void setPickerParameters(const AicPicker::Parameters & value);
+
+    // Magnitude settings
+
+    // Whether local magnitude of triggered events is estimated (needs the trigger and response correction)
+    bool isMagnitudeEnabled() const;
+    void setMagnitudeEnabled(bool value);
+
+    // a convenience: get/set the distance and its correction in one call;
+    // quantity of input is the output one of responseParameters()
+    MagnitudeStage::Parameters magnitudeParameters() const;
+    void setMagnitudeParameters(const MagnitudeStage::Parameters & value);
+
+    // Polarization settings
+
+    // Whether polarization of processed data is computed (series of events need the trigger)
+    bool isPolarizationEnabled() const;
+    void setPolarizationEnabled(bool value);
+
+    // a convenience: get/set window and hop in one call
+    PolarizationStage::Parameters polarizationParameters() const;
+    void setPolarizationParameters(const PolarizationStage::Parameters & value);
+
+    // Template settings
+
+    // Whether processed data are matched with templates from templatesDirectory
+    bool isTemplateMatchingEnabled() const;
+    void setTemplateMatchingEnabled(bool value);
+
+    QString templatesDirectory() const;
+    void setTemplatesDirectory(const QString &value);
+
+    // a convenience: get/set threshold and its window in one call
+    TemplateMatcher::Parameters templateParameters() const;
+    void setTemplateParameters(const TemplateMatcher::Parameters & value);
+
+    // Quality settings
+
+    bool isQualityEnabled() const;
+    void setQualityEnabled(bool value);
+
+    // a convenience: get/set all parameters of QualityStage in one call
+    QualityStage::Parameters qualityParameters() const;
+    void setQualityParameters(const QualityStage::Parameters & value);
+
     // Ports settings
 
     enum WhichPort {
@@ -77,6 +263,9 @@ public:
     bool isStatsShown() const;
     void setStatsShown(bool value);
 
+    bool isSpectrogramShown() const;
+    void setSpectrogramShown(bool value);
+
     bool isPlotFixedScale() const;
     void setPlotFixedScale(bool value);
 
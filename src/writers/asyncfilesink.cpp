@@ -0,0 +1,408 @@
+#include "asyncfilesink.h"
+#include "../logger.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+    const int IDLE_WAIT_MSECS = 1000; // How often I/O thread wakes up to check time-based sync
+
+    // Thin platform layer: POSIX calls, or their analogues from MSVC runtime on Windows
+
+#ifdef Q_OS_WIN
+    int openForAppend(const QString & fileName) {
+        return _wopen(reinterpret_cast<const wchar_t*>(fileName.utf16()), _O_WRONLY | _O_CREAT | _O_BINARY, _S_IREAD | _S_IWRITE);
+    }
+    qint64 fileSize(int fd) {
+        return _lseeki64(fd, 0, SEEK_END);
+    }
+    qint64 writeAt(int fd, const char * data, qint64 size, qint64 offset) {
+        // No pwrite on Windows, but the file is written by only one thread
+        if (_lseeki64(fd, offset, SEEK_SET) < 0) {
+            return -1;
+        }
+        return _write(fd, data, unsigned(size));
+    }
+    bool syncData(int fd) {
+        return _commit(fd) == 0;
+    }
+    void closeFile(int fd) {
+        _close(fd);
+    }
+    bool reserveSpace(int, qint64, qint64) {
+        return false;
+    }
+    void releaseSpace(int, qint64, qint64) {
+    }
+#else
+    int openForAppend(const QString & fileName) {
+        return ::open(QFile::encodeName(fileName).constData(), O_WRONLY | O_CREAT, 0644);
+    }
+    qint64 fileSize(int fd) {
+        return lseek(fd, 0, SEEK_END);
+    }
+    qint64 writeAt(int fd, const char * data, qint64 size, qint64 offset) {
+        return pwrite(fd, data, size_t(size), off_t(offset));
+    }
+    bool syncData(int fd) {
+#if defined(Q_OS_MAC)
+        return fsync(fd) == 0; // No fdatasync on Mac OS X
+#else
+        return fdatasync(fd) == 0;
+#endif
+    }
+    void closeFile(int fd) {
+        ::close(fd);
+    }
+    bool reserveSpace(int fd, qint64 offset, qint64 size) {
+#if defined(Q_OS_LINUX)
+        return fallocate(fd, FALLOC_FL_KEEP_SIZE, off_t(offset), off_t(size)) == 0;
+#else
+        Q_UNUSED(fd); Q_UNUSED(offset); Q_UNUSED(size);
+        return false;
+#endif
+    }
+    void releaseSpace(int fd, qint64 offset, qint64 size) {
+#if defined(Q_OS_LINUX)
+        // Reserved blocks beyond the end of file stay allocated after closing on some file systems
+        fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, off_t(offset), off_t(size));
+#else
+        Q_UNUSED(fd); Q_UNUSED(offset); Q_UNUSED(size);
+#endif
+    }
+#endif
+}
+
+AsyncFileSink::AsyncFileSink(QString fileName, SyncPolicy policy, int compressionLevel, QObject *parent) :
+    QThread(parent), fileName_(fileName), policy(policy), compressionLevel(compressionLevel),
+    fd(-1), offset(0), totalBytes(0),
+    current(NULL), overflowed(false), behind(false), queuedBytes(0), closing(false), syncedBytes(0), processedBytes(0), bytesSinceSync(0), failed(false), syncFailed(false), reservedEnd(0), compressor(NULL),
+    writeLatency(tr("write to %1").arg(QFileInfo(fileName).fileName())),
+    syncLatency(tr("sync of %1").arg(QFileInfo(fileName).fileName())),
+    compressLatency(tr("compression for %1").arg(QFileInfo(fileName).fileName()))
+{
+}
+
+bool AsyncFileSink::open() {
+    if (isOpen()) {
+        return true;
+    }
+    fd = openForAppend(fileName_);
+    if (fd < 0) {
+        Logger::error(tr("Failed to open file %1: %2").arg(fileName_).arg(QString::fromLocal8Bit(strerror(errno))));
+        return false;
+    }
+    offset = fileSize(fd);
+
+    if (compressionLevel != NO_COMPRESSION) {
+        compressor = new GzipCompressor(compressionLevel);
+        compressed.reserve(BUFFER_SIZE + BUFFER_SIZE/8); // Reserved capacity is kept when resized to 0
+    }
+
+    for (int i = 0; i < BUFFERS_COUNT; ++i) {
+        Buffer * buffer = new Buffer;
+        buffer->data = static_cast<char*>(qMallocAligned(BUFFER_SIZE, BUFFER_ALIGNMENT));
+        buffer->used = 0;
+        buffer->submitted = 0;
+        allBuffers << buffer;
+        freeBuffers << buffer;
+    }
+    current = takeFreeBuffer();
+    sinceFlush.start();
+
+    start();
+    return true;
+}
+
+bool AsyncFileSink::preallocate(qint64 bytes) {
+    if ( ! isOpen() || bytes <= 0 ) {
+        return false;
+    }
+    if ( ! reserveSpace(fd, offset, bytes) ) {
+        return false;
+    }
+    reservedEnd = offset + bytes;
+    return true;
+}
+
+bool AsyncFileSink::rename(const QString & newName) {
+    Q_ASSERT_X(totalBytes == 0, "AsyncFileSink::rename", "data already written");
+    if ( ! QFile::rename(fileName_, newName) ) {
+        return false;
+    }
+    fileName_ = newName;
+    return true;
+}
+
+void AsyncFileSink::write(const char * data, qint64 size) {
+    Q_ASSERT_X(current != NULL, "AsyncFileSink::write", "file not opened");
+    totalBytes += size;
+    while (size > 0 && ! overflowed) { // The file is broken anyway after overflow
+        qint64 portion = qMin(size, BUFFER_SIZE - current->used);
+        memcpy(current->data + current->used, data, size_t(portion));
+        current->used += portion;
+        data += portion;
+        size -= portion;
+        if (current->used == BUFFER_SIZE) {
+            handOver();
+            sinceFlush.start();
+        }
+    }
+    if ((policy.intervalSecs > 0) && (sinceFlush.elapsed() >= policy.intervalSecs*1000)) {
+        flush();
+    }
+}
+
+void AsyncFileSink::flush() {
+    if (current != NULL && current->used > current->submitted) {
+        submit(false, false);
+    }
+    sinceFlush.start();
+}
+
+void AsyncFileSink::commit() {
+    if (current == NULL) {
+        return;
+    }
+    // Even if empty: the previous chunks are synced after it
+    submit(true, false);
+    sinceFlush.start();
+}
+
+void AsyncFileSink::close() {
+    if ( ! isOpen() ) {
+        return;
+    }
+    flush();
+    QMutexLocker lock(&mutex);
+    closing = true;
+    hasWork.wakeOne();
+}
+
+AsyncFileSink::Buffer * AsyncFileSink::takeFreeBuffer() {
+    QMutexLocker lock(&mutex);
+    if ( ! freeBuffers.isEmpty() ) {
+        // Extra buffers are freed when written, so the disk has caught up
+        if (behind) {
+            Logger::info(tr("Disk has caught up with %1").arg(fileName_));
+            behind = false;
+        }
+        return freeBuffers.takeLast();
+    }
+    if (allBuffers.size() >= MAX_BUFFERS) {
+        return NULL;
+    }
+    // I/O thread is behind: don't wait for it, allocate one more buffer
+    Buffer * buffer = new Buffer;
+    buffer->data = static_cast<char*>(qMallocAligned(BUFFER_SIZE, BUFFER_ALIGNMENT));
+    buffer->used = 0;
+    buffer->submitted = 0;
+    allBuffers << buffer;
+    if ( ! behind ) {
+        Logger::warning(tr("Disk is too slow for %1: %2 KiB of data waiting to be written")
+                        .arg(fileName_).arg(queuedBytes >> 10));
+        behind = true;
+    }
+    return buffer;
+}
+
+void AsyncFileSink::handOver() {
+    Buffer * next = takeFreeBuffer();
+    if (next == NULL) {
+        // Don't grow without limit: drop newer data and fail the file, its journal is kept
+        if ( ! overflowed ) {
+            Logger::error(tr("Disk is stalled for %1: %2 MiB of data waiting to be written, newer data are dropped")
+                          .arg(fileName_).arg(qint64(MAX_BUFFERS)*BUFFER_SIZE >> 20));
+        }
+        overflowed = true;
+        return; // The full buffer is written on close
+    }
+    submit(false, true);
+    current = next;
+}
+
+void AsyncFileSink::submit(bool syncAfter, bool last) {
+    QMutexLocker lock(&mutex);
+    chunks.enqueue(Chunk{current, current->submitted, current->used, syncAfter, last});
+    queuedBytes += current->used - current->submitted;
+    current->submitted = current->used;
+    hasWork.wakeOne();
+}
+
+void AsyncFileSink::run() {
+    sinceOpen.start();
+    sinceSync.start();
+    forever {
+        Chunk chunk = {NULL, 0, 0, false, false};
+        bool finishing = false;
+        qint64 backlogBytes = 0;
+        {
+            QMutexLocker lock(&mutex);
+            if (chunks.isEmpty() && ! closing) {
+                hasWork.wait(&mutex, IDLE_WAIT_MSECS);
+            }
+            if ( ! chunks.isEmpty() ) {
+                chunk = chunks.dequeue();
+                queuedBytes -= chunk.to - chunk.from;
+                backlogBytes = queuedBytes;
+            } else {
+                finishing = closing;
+            }
+        }
+
+        if (chunk.buffer != NULL) {
+            // The writer fills the buffer only after chunk.to: no need to lock while writing
+            processChunk(chunk, backlogBytes);
+            processedBytes += chunk.to - chunk.from;
+        }
+        if (chunk.last) {
+            Buffer * buffer = chunk.buffer;
+            buffer->used = 0;
+            buffer->submitted = 0;
+            QMutexLocker lock(&mutex);
+            if (allBuffers.size() > BUFFERS_COUNT) {
+                // Allocated while the disk was behind: give the memory back
+                allBuffers.removeOne(buffer);
+                qFreeAligned(buffer->data);
+                delete buffer;
+            } else {
+                freeBuffers << buffer;
+            }
+        }
+
+        bool syncBySize = (policy.intervalBytes > 0) && (bytesSinceSync >= policy.intervalBytes);
+        bool syncByTime = (policy.intervalSecs > 0) && (bytesSinceSync > 0) && (sinceSync.elapsed() >= policy.intervalSecs*1000);
+        if (finishing) {
+            finishFile();
+        }
+        if (finishing || syncBySize || syncByTime || chunk.sync) {
+            sync();
+        }
+        if (finishing) {
+            break;
+        }
+    }
+    if (reservedEnd > offset) {
+        releaseSpace(fd, offset, reservedEnd - offset);
+    }
+    closeFile(fd);
+}
+
+void AsyncFileSink::processChunk(const Chunk & chunk, qint64 backlogBytes) {
+    const char * data = chunk.buffer->data + chunk.from;
+    const qint64 size = chunk.to - chunk.from;
+    if (size == 0) {
+        return; // Only a sync
+    }
+    if (compressor == NULL) {
+        writeData(data, size);
+        return;
+    }
+    // Don't let compression back up: if data pile up, compress faster until they are written
+    const int backlog = int(backlogBytes / BUFFER_SIZE);
+    int level = (backlog >= COMPRESSION_BACKLOG) ? qMin(compressionLevel, int(GzipCompressor::FAST_LEVEL)) : compressionLevel;
+    compressed.resize(0);
+    if (compressor->level() != level && compressor->setLevel(level, compressed) && level != compressionLevel) {
+        Logger::warning(tr("Compression is too slow for %1: %2 MiB of data waiting, switched to the fastest level")
+                        .arg(fileName_).arg(backlogBytes >> 20));
+    }
+    compressLatency.start();
+    compressor->compress(data, size, compressed); // Flush the block: it is decompressable after crash
+    compressLatency.stop();
+    writeData(compressed.constData(), compressed.size());
+}
+
+void AsyncFileSink::finishFile() {
+    if (compressor != NULL) {
+        compressed.resize(0);
+        compressor->finish(compressed);
+        writeData(compressed.constData(), compressed.size());
+    }
+}
+
+bool AsyncFileSink::writeData(const char * data, qint64 size) {
+    if (failed) {
+        return false; // Error is already reported, don't flood the log
+    }
+    writeLatency.start();
+    qint64 left = size;
+    while (left > 0) {
+        qint64 written = writeAt(fd, data, left, offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            Logger::error(tr("Failed to write to file %1: %2").arg(fileName_).arg(QString::fromLocal8Bit(strerror(errno))));
+            failed = true;
+            return false;
+        }
+        data += written;
+        left -= written;
+        offset += written;
+    }
+    writeLatency.stop();
+    bytesSinceSync += size;
+    return true;
+}
+
+void AsyncFileSink::sync() {
+    if (failed) {
+        return;
+    }
+    syncLatency.start();
+    if ( ! syncData(fd) ) {
+        Logger::warning(tr("Failed to sync file %1: %2").arg(fileName_).arg(QString::fromLocal8Bit(strerror(errno))));
+        syncFailed = true;
+    } else if ( ! syncFailed ) {
+        QMutexLocker lock(&mutex);
+        syncedBytes = processedBytes;
+    }
+    syncLatency.stop();
+    bytesSinceSync = 0;
+    sinceSync.start();
+}
+
+qint64 AsyncFileSink::durableBytes() const {
+    QMutexLocker lock(&mutex);
+    return syncedBytes;
+}
+
+void AsyncFileSink::reportResults() {
+    double secs = sinceOpen.isValid() ? sinceOpen.elapsed() / 1000.0 : 0;
+    double deviceSecs = (writeLatency.totalTime() + syncLatency.totalTime()) / 1000.0;
+    Logger::info(tr("Written %1 KiB to %2 in %3 s (%4 KiB/s), disk busy %5 s (%6 MiB/s)")
+                 .arg(totalBytes >> 10).arg(fileName_)
+                 .arg(secs, 0, 'f', 1).arg(secs > 0 ? totalBytes / 1024.0 / secs : 0, 0, 'f', 1)
+                 .arg(deviceSecs, 0, 'f', 3).arg(deviceSecs > 0 ? totalBytes / double(1 << 20) / deviceSecs : 0, 0, 'f', 1));
+    if (compressor != NULL) {
+        double compressSecs = compressLatency.totalTime() / 1000.0;
+        Logger::info(tr("Compressed %1 KiB into %2 KiB (%3 times) in %4 s of CPU (%5 MiB/s)")
+                     .arg(compressor->inputBytes() >> 10).arg(compressor->outputBytes() >> 10)
+                     .arg(compressor->ratio(), 0, 'f', 2)
+                     .arg(compressSecs, 0, 'f', 3)
+                     .arg(compressSecs > 0 ? compressor->inputBytes() / double(1 << 20) / compressSecs : 0, 0, 'f', 1));
+        compressLatency.reportResults();
+    }
+    writeLatency.reportResults();
+    syncLatency.reportResults();
+}
+
+AsyncFileSink::~AsyncFileSink() {
+    close();
+    wait();
+    for (Buffer * buffer: allBuffers) {
+        qFreeAligned(buffer->data);
+        delete buffer;
+    }
+    delete compressor;
+}
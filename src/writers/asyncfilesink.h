@@ -0,0 +1,218 @@
+#ifndef ASYNCFILESINK_H
+#define ASYNCFILESINK_H
+
+#include "../performancereporter.h"
+#include "gzipcompressor.h"
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QVector>
+#include <QElapsedTimer>
+
+/*!
+ * \brief AsyncFileSink writes bytes to file on its own I/O thread
+ *
+ * Data passed to AsyncFileSink::write is copied into one of large aligned buffers.
+ * When the buffer is full it is handed to the I/O thread, which writes it with pwrite,
+ * while the next buffer is being filled. AsyncFileSink::flush and AsyncFileSink::commit
+ * hand over only the part of the buffer filled since the last hand-over, and filling
+ * goes on in the same buffer: small commits don't take a buffer each.
+ *
+ * The caller never waits for the disk: if all buffers are still being written
+ * (slow SD card, NFS stall), a new buffer is allocated instead of blocking (reported
+ * once per stall), up to MAX_BUFFERS. Beyond that the data are dropped and the sink is failed (so the
+ * journal of the file is kept for recovery, \see isDurable). Buffers above
+ * BUFFERS_COUNT are freed as soon as they are written.
+ *
+ * When the data reach the disk is controlled by SyncPolicy: fdatasync is called
+ * when either given time or given amount of data passed since the last sync.
+ * Partially filled buffer is also handed to I/O thread if it is older than
+ * SyncPolicy::intervalSecs, so that slow data don't wait in memory for too long.
+ *
+ * Optionally the data are gzip-compressed on the I/O thread before writing (\see GzipCompressor).
+ * Each buffer is compressed with a block-level flush, so after a crash the file can be
+ * decompressed up to the last written buffer. If compression cannot keep up and buffers
+ * pile up, the fastest compression level is used until the backlog is cleared.
+ *
+ * Write, sync and compression latencies are measured on the I/O thread and reported
+ * to Logger when the sink is closed.
+ */
+class AsyncFileSink : public QThread
+{
+    Q_OBJECT
+public:
+    /*!
+     * \brief Durability policy: when written data should be synced to disk
+     */
+    struct SyncPolicy {
+        int intervalSecs;     /*!< sync at least once in this number of seconds (0 - don't sync by time) */
+        qint64 intervalBytes; /*!< sync after this number of bytes is written (0 - don't sync by size) */
+        SyncPolicy(int secs = DEFAULT_SYNC_SECS, qint64 bytes = DEFAULT_SYNC_BYTES)
+            : intervalSecs(secs), intervalBytes(bytes) {}
+    };
+
+    static const int DEFAULT_SYNC_SECS = 10;
+    static const qint64 DEFAULT_SYNC_BYTES = 4 << 20; // 4 MiB
+    static const int BUFFER_SIZE = 1 << 20;           // 1 MiB
+    static const int BUFFER_ALIGNMENT = 4096;         // Page size: good for DMA and O_DIRECT
+    static const int BUFFERS_COUNT = 2;               // Buffers allocated initially
+    static const int MAX_BUFFERS = 64;                // Buffers in flight at most: 64 MiB behind a stalled disk
+    static const int NO_COMPRESSION = -1;
+    static const int COMPRESSION_BACKLOG = 4;         // Buffers waiting for I/O thread when it should compress faster
+
+    /*!
+     * \param compressionLevel - gzip compression level from 0 to 9, or NO_COMPRESSION to write data as is
+     */
+    explicit AsyncFileSink(QString fileName, SyncPolicy policy = SyncPolicy(),
+                           int compressionLevel = NO_COMPRESSION, QObject *parent = nullptr);
+
+    QString fileName() const { return fileName_; }
+
+    /*!
+     * \brief Opens file for appending and starts I/O thread
+     * \return true if successfully opened, false otherwise (error is reported to Logger)
+     */
+    bool open();
+    bool isOpen() const { return fd >= 0; }
+
+    /*!
+     * \brief Reserves disk space for \a bytes more bytes, without changing file size,
+     *        so that writes don't need to allocate blocks and update file system metadata.
+     *
+     * Only supported on Linux (fallocate with FALLOC_FL_KEEP_SIZE), does nothing elsewhere.
+     * Can take a while, so better call it before writing, possibly from another thread.
+     * \return true if space is reserved
+     */
+    bool preallocate(qint64 bytes);
+
+    /*!
+     * \brief Renames opened file
+     * \warning Only before anything is written: the file name is used in reports of I/O thread
+     * \return true if renamed, false otherwise (e.g. file with new name exists, or OS
+     *         doesn't allow renaming of opened files)
+     */
+    bool rename(const QString & newName);
+
+    /*!
+     * \brief Copies data into buffer, never blocks on disk I/O
+     *
+     * If MAX_BUFFERS are waiting for the disk, the data are dropped (reported to Logger once).
+     */
+    void write(const char * data, qint64 size);
+    void write(const QByteArray & bytes) { write(bytes.constData(), bytes.size()); }
+
+    /*!
+     * \brief Hands data written since the last hand-over to I/O thread
+     */
+    void flush();
+
+    /*!
+     * \brief Hands data written since the last hand-over to I/O thread, which syncs the
+     *        file after writing them: a group commit that doesn't wait for the disk
+     */
+    void commit();
+
+    /*!
+     * \brief Flushes remaining data and asks the I/O thread to sync and close file.
+     *
+     * Doesn't wait for it: use QThread::wait for that, or connect QThread::finished
+     * to QObject::deleteLater.
+     */
+    void close();
+
+    /// Number of bytes passed to write() since opening
+    qint64 bytesWritten() const { return totalBytes; }
+
+    /*!
+     * \brief Number of bytes passed to write() that are written and synced to disk.
+     *        Unlike isDurable, can be called while the I/O thread is running.
+     *
+     * Doesn't grow any more after an error. Dropped data are never written, so it
+     * doesn't reach bytesWritten then.
+     */
+    qint64 durableBytes() const;
+
+    /*!
+     * \brief Whether all data were written and synced to disk without errors
+     * \warning Call it only after the I/O thread is finished
+     */
+    bool isDurable() const { return ! failed && ! syncFailed && ! overflowed; }
+
+    /*!
+     * \brief Reports latencies of writes and syncs, write throughput and compression ratio to Logger
+     * \warning Call it only after the I/O thread is finished
+     */
+    void reportResults();
+
+    ~AsyncFileSink();
+
+protected:
+    void run() override;
+
+private:
+    struct Buffer {
+        char * data;
+        qint64 used;
+        qint64 submitted; // Bytes handed to I/O thread
+    };
+
+    /// Part of buffer handed to I/O thread
+    struct Chunk {
+        Buffer * buffer;
+        qint64 from;
+        qint64 to;
+        bool sync; // Sync the file after writing it
+        bool last; // The buffer is full: return it when written
+    };
+
+    Buffer * takeFreeBuffer();
+    void handOver();
+    void submit(bool syncAfter, bool last);
+    void processChunk(const Chunk & chunk, qint64 backlogBytes);
+    bool writeData(const char * data, qint64 size);
+    void sync();
+    void finishFile();
+
+    QString fileName_;
+    const SyncPolicy policy;
+    const int compressionLevel;
+    int fd;
+    qint64 offset; // Used only by I/O thread after opening
+    qint64 totalBytes;
+
+    // Buffer being filled by writer thread
+    Buffer * current;
+    QElapsedTimer sinceFlush;
+    bool overflowed; // Data were dropped at MAX_BUFFERS
+    bool behind;     // Buffers are being allocated for the disk that is behind (reported)
+
+    // Shared between threads, guarded by mutex:
+    mutable QMutex mutex;
+    QWaitCondition hasWork;
+    QQueue<Chunk> chunks;
+    qint64 queuedBytes;
+    QVector<Buffer*> freeBuffers;
+    QVector<Buffer*> allBuffers;
+    bool closing;
+    qint64 syncedBytes; // Of data passed to write()
+
+    // Used only by I/O thread:
+    qint64 processedBytes; // Of data passed to write(), written to file (or failed)
+    qint64 bytesSinceSync;
+    QElapsedTimer sinceSync;
+    QElapsedTimer sinceOpen;
+    bool failed;
+    bool syncFailed;
+    qint64 reservedEnd; // End of disk space reserved by preallocate
+    GzipCompressor * compressor; // NULL if no compression
+    QByteArray compressed;
+    PerformanceReporter writeLatency;
+    PerformanceReporter syncLatency;
+    PerformanceReporter compressLatency;
+
+    Q_DISABLE_COPY(AsyncFileSink)
+};
+
+#endif // ASYNCFILESINK_H
@@ -0,0 +1,71 @@
+#include "binaryformat.h"
+#include <QtEndian>
+#include <qnumeric.h>
+#include <cstring>
+
+const char BinaryFormat::MAGIC[5] = "SRGB";
+const QString BinaryFormat::FILE_SUFFIX = ".bin";
+
+namespace {
+    const int DEVICE_ID_SIZE = 16;
+
+    template <typename T>
+    void putLittleEndian(char * dst, T value) {
+        qToLittleEndian(value, reinterpret_cast<uchar*>(dst));
+    }
+
+    void putDouble(char * dst, double value) {
+        quint64 bits;
+        memcpy(&bits, &value, sizeof(bits));
+        putLittleEndian<quint64>(dst, bits);
+    }
+
+    // Coordinates are kept as text in FileInfo: "???" means unknown
+    double coordinate(QString text) {
+        bool ok;
+        double value = text.toDouble(&ok);
+        return ok ? value : qQNaN();
+    }
+
+    // Zero-padded (and truncated if too long) text field
+    void putText(char * dst, QString text, int size) {
+        QByteArray bytes = text.toLatin1().left(size);
+        memcpy(dst, bytes.constData(), size_t(bytes.size()));
+    }
+}
+
+QByteArray BinaryFormat::header(const FileInfo & info) {
+    QByteArray res(HEADER_SIZE, '\0');
+    char * h = res.data();
+    memcpy(h, MAGIC, 4);
+    putLittleEndian<quint16>(h + 4, VERSION);
+    putLittleEndian<quint16>(h + 6, HEADER_SIZE);
+    putLittleEndian<quint16>(h + 8, CHANNELS_NUM);
+    putLittleEndian<qint32>(h + 12, info.samplingFreq);
+    putLittleEndian<qint32>(h + 16, info.filterFreq);
+    putDouble(h + 24, info.startTime.isValid() ? info.startTime.toMSecsSinceEpoch() : 0);
+    putText(h + 32, info.deviceID, DEVICE_ID_SIZE);
+    putDouble(h + 48, coordinate(info.latitude));
+    putDouble(h + 56, coordinate(info.longitude));
+    return res;
+}
+
+QByteArray BinaryFormat::appendBlock(const DataBlock & block) {
+    const int count = block.size();
+    if (count == 0) {
+        return QByteArray();
+    }
+    QByteArray res(BLOCK_HEADER_SIZE + int(sizeof(qint32))*count*CHANNELS_NUM, '\0');
+    char * b = res.data();
+    putLittleEndian<quint32>(b, quint32(count));
+    putDouble(b + 8, block.timestamps.first());
+
+    const DataItem * items = block.data.constData();
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        uchar * column = reinterpret_cast<uchar*>(b + BLOCK_HEADER_SIZE) + sizeof(qint32)*count*ch;
+        for (int i = 0; i < count; ++i) {
+            qToLittleEndian<qint32>(items[i].byChannel[ch], column + sizeof(qint32)*i);
+        }
+    }
+    return res;
+}
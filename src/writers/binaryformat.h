@@ -0,0 +1,53 @@
+#ifndef BINARYFORMAT_H
+#define BINARYFORMAT_H
+
+#include "outputformat.h"
+
+/*!
+ * \brief Raw binary format: fixed header, then blocks of little-endian int32 columns
+ *
+ * File header (HEADER_SIZE bytes, all numbers are little-endian):
+ *
+ * | Offset | Size | Contents                                       |
+ * |--------|------|------------------------------------------------|
+ * |      0 |    4 | MAGIC                                          |
+ * |      4 |    2 | VERSION                                        |
+ * |      6 |    2 | HEADER_SIZE                                    |
+ * |      8 |    2 | number of channels                             |
+ * |     10 |    2 | reserved (0)                                   |
+ * |     12 |    4 | sampling frequency, Hz                         |
+ * |     16 |    4 | filter frequency, Hz                           |
+ * |     20 |    4 | reserved (0)                                   |
+ * |     24 |    8 | start time: double, milliseconds since Epoch   |
+ * |     32 |   16 | device id, Latin-1, zero-padded                |
+ * |     48 |    8 | latitude: double, degrees (NaN if unknown)     |
+ * |     56 |    8 | longitude: double, degrees (NaN if unknown)    |
+ *
+ * Then data blocks, one per received block of data:
+ *
+ * | Offset | Size      | Contents                                             |
+ * |--------|-----------|------------------------------------------------------|
+ * |      0 |         4 | number of items N                                    |
+ * |      4 |         4 | reserved (0)                                         |
+ * |      8 |         8 | timestamp of the first item: double, ms since Epoch  |
+ * |     16 | 4*N*CHANS | values: N int32 of channel 0, then of channel 1, ... |
+ *
+ * Columns can be read directly into arrays, without any parsing.
+ */
+class BinaryFormat : public OutputFormat
+{
+public:
+    static const char MAGIC[5];
+    static const int VERSION = 1;
+    static const int HEADER_SIZE = 64;
+    static const int BLOCK_HEADER_SIZE = 16;
+    static const QString FILE_SUFFIX;
+
+    Type type() const override { return Binary; }
+    QString fileSuffix() const override { return FILE_SUFFIX; }
+    bool isIndexable() const override { return true; }
+    QByteArray header(const FileInfo & info) override;
+    QByteArray appendBlock(const DataBlock & block) override;
+};
+
+#endif // BINARYFORMAT_H
@@ -0,0 +1,125 @@
+#include "fileindex.h"
+#include "../logger.h"
+
+#include <QtEndian>
+#include <cstring>
+#include <algorithm>
+
+const QString FileIndex::FILE_SUFFIX = ".idx";
+
+namespace {
+    const char MAGIC[4] = {'S', 'R', 'G', 'I'};
+    const quint16 VERSION = 1;
+
+    template <typename T>
+    void putLittleEndian(char * dst, T value) {
+        qToLittleEndian(value, reinterpret_cast<uchar*>(dst));
+    }
+
+    template <typename T>
+    T getLittleEndian(const char * src) {
+        return qFromLittleEndian<T>(reinterpret_cast<const uchar*>(src));
+    }
+
+    void putDouble(char * dst, double value) {
+        quint64 bits;
+        memcpy(&bits, &value, sizeof(bits));
+        putLittleEndian<quint64>(dst, bits);
+    }
+
+    double getDouble(const char * src) {
+        quint64 bits = getLittleEndian<quint64>(src);
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+}
+
+FileIndex::FileIndex(int interval) :
+    interval_(qMax(1, interval)), samples(0), nextEntryAt(0)
+{}
+
+bool FileIndex::create(const QString & fileName) {
+    file.setFileName(fileName);
+    if ( ! file.open(QIODevice::WriteOnly | QIODevice::Truncate) ) {
+        Logger::warning(tr("Failed to create index %1: %2").arg(fileName, file.errorString()));
+        return false;
+    }
+    char header[HEADER_SIZE] = {0};
+    memcpy(header, MAGIC, sizeof(MAGIC));
+    putLittleEndian<quint16>(header + 4, VERSION);
+    putLittleEndian<quint16>(header + 6, ENTRY_SIZE);
+    putLittleEndian<quint32>(header + 8, quint32(interval_));
+    file.write(header, HEADER_SIZE);
+    entries_.clear();
+    samples = nextEntryAt = 0;
+    return true;
+}
+
+void FileIndex::addBlock(const DataBlock & block, qint64 offset) {
+    const int count = block.size();
+    if (count == 0) {
+        return;
+    }
+    if (samples + count > nextEntryAt) {
+        // The block contains the sample where an entry is due: point to the beginning of block
+        Entry entry;
+        entry.sample = samples;
+        entry.time = block.timestamps.first();
+        entry.offset = offset;
+        entries_ << entry;
+        writeEntry(entry);
+        nextEntryAt = samples + interval_;
+    }
+    samples += count;
+}
+
+void FileIndex::writeEntry(const Entry & entry) {
+    if ( ! file.isOpen() ) {
+        return;
+    }
+    char bytes[ENTRY_SIZE];
+    putLittleEndian<qint64>(bytes, entry.sample);
+    putDouble(bytes + 8, entry.time);
+    putLittleEndian<qint64>(bytes + 16, entry.offset);
+    file.write(bytes, ENTRY_SIZE);
+    file.flush(); // Rarely: at most once per interval
+}
+
+bool FileIndex::load(const QString & fileName) {
+    entries_.clear();
+    QFile in(fileName);
+    if ( ! in.open(QIODevice::ReadOnly) ) {
+        return false;
+    }
+    QByteArray bytes = in.readAll();
+    const char * data = bytes.constData();
+    if (bytes.size() < HEADER_SIZE || memcmp(data, MAGIC, sizeof(MAGIC)) != 0
+     || getLittleEndian<quint16>(data + 4) != VERSION) {
+        Logger::warning(tr("File %1 is not an index or has unsupported version").arg(fileName));
+        return false;
+    }
+    const int entrySize = getLittleEndian<quint16>(data + 6); // Can be larger in future versions
+    interval_ = int(getLittleEndian<quint32>(data + 8));
+    if (entrySize < ENTRY_SIZE) {
+        return false;
+    }
+    const int count = (bytes.size() - HEADER_SIZE) / entrySize; // Incomplete entry at the end is dropped
+    entries_.resize(count);
+    for (int i = 0; i < count; ++i) {
+        const char * e = data + HEADER_SIZE + i*entrySize;
+        entries_[i].sample = getLittleEndian<qint64>(e);
+        entries_[i].time = getDouble(e + 8);
+        entries_[i].offset = getLittleEndian<qint64>(e + 16);
+    }
+    return true;
+}
+
+int FileIndex::find(TimeStampType time) const {
+    if (entries_.isEmpty()) {
+        return -1;
+    }
+    auto after = std::upper_bound(entries_.constBegin(), entries_.constEnd(), time,
+                                  [](TimeStampType t, const Entry & entry) { return t < entry.time; });
+    return qMax(0, int(after - entries_.constBegin()) - 1);
+}
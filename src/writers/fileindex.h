@@ -0,0 +1,90 @@
+#ifndef FILEINDEX_H
+#define FILEINDEX_H
+
+#include "../protocol.h"
+#include <QFile>
+#include <QVector>
+#include <QCoreApplication>
+
+/*!
+ * \brief Sidecar index of data file: time and byte offset of every N-th sample
+ *
+ * Written by FileWriter next to each data file of a format whose blocks can be
+ * found by offset (\see OutputFormat::isIndexable), with FILE_SUFFIX appended to
+ * the file name. An entry is added at the first block that starts
+ * at least \a interval samples after the previous entry, so entries point to
+ * the beginnings of blocks, and there is always an entry for the first sample.
+ *
+ * Then a sample with given time is found with binary search over entries
+ * and reading of at most about \a interval samples from the file, instead of
+ * scanning the whole file (\see DataReader::seekTime).
+ *
+ * File layout (little-endian, like BinaryFormat: files are moved between machines):
+ *
+ *     "SRGI", quint16 version, quint16 entry size, quint32 interval, quint32 reserved
+ *     entries: qint64 sample number (from the beginning of file),
+ *              double time (ms since Epoch), qint64 byte offset in file
+ *
+ * Entry is written as soon as it is added, so after a crash the index describes
+ * the data that reached the file. An incomplete entry at the end is ignored.
+ */
+class FileIndex
+{
+    Q_DECLARE_TR_FUNCTIONS(FileIndex)
+public:
+    static const QString FILE_SUFFIX;
+    static const int DEFAULT_INTERVAL = 1000; // Samples
+    static const int HEADER_SIZE = 16;
+    static const int ENTRY_SIZE = 24;
+
+    struct Entry {
+        qint64 sample;
+        TimeStampType time;
+        qint64 offset;
+    };
+
+    /// Name of index of \a dataFileName
+    static QString fileNameFor(const QString & dataFileName) { return dataFileName + FILE_SUFFIX; }
+
+    explicit FileIndex(int interval = DEFAULT_INTERVAL);
+
+    /*!
+     * \brief Creates (or overwrites) index file for writing
+     * \return true if success, false otherwise (reported to Logger)
+     */
+    bool create(const QString & fileName);
+
+    /*!
+     * \brief Adds entry for \a block if it is time to
+     * \param offset - offset in data file where bytes of \a block start
+     */
+    void addBlock(const DataBlock & block, qint64 offset);
+
+    void close() { file.close(); }
+
+    /*!
+     * \brief Reads index file
+     * \return false if it doesn't exist or is not an index (then entries are empty)
+     */
+    bool load(const QString & fileName);
+
+    int interval() const { return interval_; }
+    const QVector<Entry> & entries() const { return entries_; }
+
+    /*!
+     * \brief Finds the entry to start reading from to reach \a time: the last one not after it
+     * \return index of entry, 0 if \a time is before all entries, -1 if there are no entries
+     */
+    int find(TimeStampType time) const;
+
+private:
+    void writeEntry(const Entry & entry);
+
+    QFile file;
+    int interval_;
+    QVector<Entry> entries_;
+    qint64 samples;     // Added so far
+    qint64 nextEntryAt; // Sample number
+};
+
+#endif // FILEINDEX_H
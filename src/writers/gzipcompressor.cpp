@@ -0,0 +1,114 @@
+#include "gzipcompressor.h"
+#include <zlib.h>
+
+const QString GzipCompressor::FILE_SUFFIX = ".gz";
+
+namespace {
+    const int GZIP_WINDOW_BITS = 15 + 16; // Maximum window, and gzip header instead of zlib one
+    const int MEMORY_LEVEL = 8;           // Default of zlib
+    const int FLUSH_MARKER_SIZE = 16;     // Empty stored block of Z_SYNC_FLUSH, with a margin
+    const int TRAILER_SIZE = 64;          // Final block and gzip trailer, with a margin
+    const int INFLATE_CHUNK = 1 << 20;
+}
+
+GzipCompressor::GzipCompressor(int level) :
+    stream(new z_stream), level_(qBound(int(Z_NO_COMPRESSION), level, int(Z_BEST_COMPRESSION))),
+    inputBytes_(0), outputBytes_(0)
+{
+    stream->zalloc = Z_NULL;
+    stream->zfree = Z_NULL;
+    stream->opaque = Z_NULL;
+    ok = (deflateInit2(stream, level_, Z_DEFLATED, GZIP_WINDOW_BITS, MEMORY_LEVEL, Z_DEFAULT_STRATEGY) == Z_OK);
+}
+
+GzipCompressor::~GzipCompressor() {
+    deflateEnd(stream);
+    delete stream;
+}
+
+bool GzipCompressor::deflateInto(QByteArray & out, int flush, qint64 bound) {
+    // Output space is reserved for the worst case, so one call of deflate is enough
+    const int oldSize = out.size();
+    out.resize(oldSize + int(bound));
+    stream->next_out = reinterpret_cast<Bytef*>(out.data() + oldSize);
+    stream->avail_out = uInt(bound);
+    int res = deflate(stream, flush);
+    const int produced = int(bound) - int(stream->avail_out);
+    out.resize(oldSize + produced);
+    outputBytes_ += produced;
+    ok = (flush == Z_FINISH) ? (res == Z_STREAM_END) : (res == Z_OK || res == Z_BUF_ERROR);
+    return ok && stream->avail_in == 0;
+}
+
+bool GzipCompressor::compress(const char * data, qint64 size, QByteArray & out, bool flushBlock) {
+    if ( ! ok ) {
+        return false;
+    }
+    stream->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    stream->avail_in = uInt(size);
+    inputBytes_ += size;
+    return deflateInto(out, flushBlock ? Z_SYNC_FLUSH : Z_NO_FLUSH, qint64(deflateBound(stream, uLong(size))) + FLUSH_MARKER_SIZE);
+}
+
+bool GzipCompressor::finish(QByteArray & out) {
+    if ( ! ok ) {
+        return false;
+    }
+    stream->next_in = Z_NULL;
+    stream->avail_in = 0;
+    bool res = deflateInto(out, Z_FINISH, qint64(deflateBound(stream, 0)) + TRAILER_SIZE);
+    ok = false; // No more data after finishing
+    return res;
+}
+
+bool GzipCompressor::setLevel(int level, QByteArray & out) {
+    level = qBound(int(Z_NO_COMPRESSION), level, int(Z_BEST_COMPRESSION));
+    if ( ! ok || level == level_ ) {
+        return ok;
+    }
+    // deflateParams compresses pending data with the old level: give it space for that
+    const int oldSize = out.size();
+    const int bound = int(deflateBound(stream, 0)) + FLUSH_MARKER_SIZE;
+    out.resize(oldSize + bound);
+    stream->next_in = Z_NULL;
+    stream->avail_in = 0;
+    stream->next_out = reinterpret_cast<Bytef*>(out.data() + oldSize);
+    stream->avail_out = uInt(bound);
+    int res = deflateParams(stream, level, Z_DEFAULT_STRATEGY);
+    const int produced = bound - int(stream->avail_out);
+    out.resize(oldSize + produced);
+    outputBytes_ += produced;
+    if (res != Z_OK) {
+        return false; // Level is not changed, but compression can continue
+    }
+    level_ = level;
+    return true;
+}
+
+bool GzipCompressor::decompress(const char * data, qint64 size, QByteArray & out) {
+    z_stream stream;
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    stream.avail_in = uInt(size);
+    if (inflateInit2(&stream, GZIP_WINDOW_BITS) != Z_OK) {
+        return false;
+    }
+    int res = Z_OK;
+    while (res == Z_OK) {
+        const int oldSize = out.size();
+        out.resize(oldSize + INFLATE_CHUNK);
+        stream.next_out = reinterpret_cast<Bytef*>(out.data() + oldSize);
+        stream.avail_out = uInt(INFLATE_CHUNK);
+        res = inflate(&stream, Z_NO_FLUSH);
+        out.resize(oldSize + INFLATE_CHUNK - int(stream.avail_out));
+        if (res == Z_STREAM_END && stream.avail_in > 0) {
+            res = inflateReset(&stream); // The next member
+        } else if (res == Z_BUF_ERROR && stream.avail_out > 0) {
+            break; // Input is over in the middle of a member
+        }
+    }
+    inflateEnd(&stream);
+    return res == Z_STREAM_END;
+}
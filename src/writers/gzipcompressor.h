@@ -0,0 +1,74 @@
+#ifndef GZIPCOMPRESSOR_H
+#define GZIPCOMPRESSOR_H
+
+#include <QByteArray>
+#include <QString>
+#include <QtGlobal>
+
+struct z_stream_s;
+
+/*!
+ * \brief Streaming gzip compression (zlib deflate)
+ *
+ * Compresses data portion by portion into one gzip member. After each portion
+ * the compressed stream can be flushed at a block boundary (Z_SYNC_FLUSH),
+ * so that everything written so far can be decompressed even if the file
+ * is never finished (e.g. after a crash or power loss). Files with several
+ * members (e.g. appended after restart) are also valid gzip files.
+ */
+class GzipCompressor
+{
+public:
+    static const int DEFAULT_LEVEL = 6;
+    static const int FAST_LEVEL = 1;
+    static const QString FILE_SUFFIX;
+
+    explicit GzipCompressor(int level = DEFAULT_LEVEL);
+    ~GzipCompressor();
+
+    /*!
+     * \brief Compresses \a size bytes of \a data and appends the result to \a out
+     * \param flushBlock - if true, all data passed so far can be decompressed from output
+     * \return false if compression failed (should not normally happen)
+     */
+    bool compress(const char * data, qint64 size, QByteArray & out, bool flushBlock = true);
+
+    /*!
+     * \brief Finishes gzip member (appends trailer to \a out). Compressor cannot be used after that.
+     */
+    bool finish(QByteArray & out);
+
+    /*!
+     * \brief Changes compression level for subsequent data. Better call it after
+     *        a flushed portion: otherwise pending data are compressed into \a out.
+     * \return true if level is changed
+     */
+    bool setLevel(int level, QByteArray & out);
+    int level() const { return level_; }
+
+    qint64 inputBytes() const { return inputBytes_; }
+    qint64 outputBytes() const { return outputBytes_; }
+
+    /// Compression ratio so far (input size / output size)
+    double ratio() const { return outputBytes_ > 0 ? double(inputBytes_) / outputBytes_ : 0; }
+
+    /*!
+     * \brief Decompresses gzip data (all members) of \a size bytes and appends them to \a out
+     * \return true if all members are complete, false if data are truncated (e.g. file
+     *         was not finished) or corrupted. Everything decoded up to that point is in \a out anyway.
+     */
+    static bool decompress(const char * data, qint64 size, QByteArray & out);
+
+private:
+    bool deflateInto(QByteArray & out, int flush, qint64 bound);
+
+    z_stream_s * stream;
+    bool ok;
+    int level_;
+    qint64 inputBytes_;
+    qint64 outputBytes_;
+
+    Q_DISABLE_COPY(GzipCompressor)
+};
+
+#endif // GZIPCOMPRESSOR_H
@@ -0,0 +1,240 @@
+#include "journal.h"
+#include "../logger.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFileInfo>
+#include <zlib.h>
+#include <cstring>
+
+const QString Journal::FILE_SUFFIX = ".journal";
+
+namespace {
+    const char MAGIC[4] = {'S', 'R', 'G', 'J'};
+    const quint16 VERSION = 1;
+    const int FILE_HEADER_SIZE = 8;
+    const int RECORD_HEADER_SIZE = 8; // Payload size and CRC
+    const quint32 MAX_PAYLOAD_SIZE = 256 << 20; // Larger size means damaged record
+
+    quint32 checksum(const char * data, quint32 size, quint32 crc = quint32(crc32(0, Z_NULL, 0))) {
+        return quint32(crc32(crc, reinterpret_cast<const Bytef*>(data), size));
+    }
+
+    QDataStream & operator<<(QDataStream & out, const Journal::Header & header) {
+        const OutputFormat::FileInfo & info = header.info;
+        out << info.deviceID << qint32(info.samplingFreq) << qint32(info.filterFreq)
+            << info.latitude << info.longitude << info.startTime
+            << header.formatOptions.miniSeedNetwork << qint32(header.formatOptions.miniSeedRecordLength)
+            << qint32(header.compressionLevel) << qint32(header.fileNames.size());
+        for (int i = 0; i < header.fileNames.size(); ++i) {
+            out << qint32(header.types[i]) << header.fileNames[i] << header.initialSizes[i];
+        }
+        return out;
+    }
+
+    QDataStream & operator>>(QDataStream & in, Journal::Header & header) {
+        OutputFormat::FileInfo & info = header.info;
+        qint32 samplingFreq, filterFreq, recordLength, compressionLevel, filesCount;
+        in >> info.deviceID >> samplingFreq >> filterFreq
+           >> info.latitude >> info.longitude >> info.startTime
+           >> header.formatOptions.miniSeedNetwork >> recordLength
+           >> compressionLevel >> filesCount;
+        info.samplingFreq = samplingFreq;
+        info.filterFreq = filterFreq;
+        header.formatOptions.miniSeedRecordLength = recordLength;
+        header.compressionLevel = compressionLevel;
+        for (int i = 0; i < filesCount && in.status() == QDataStream::Ok; ++i) {
+            qint32 type;
+            QString fileName;
+            qint64 initialSize;
+            in >> type >> fileName >> initialSize;
+            header.types << OutputFormat::Type(type);
+            header.fileNames << fileName;
+            header.initialSizes << initialSize;
+        }
+        return in;
+    }
+}
+
+Journal::Journal(QString fileName, CommitPolicy policy) :
+    sink(fileName, AsyncFileSink::SyncPolicy(0, 0)), policy(policy), pendingBlocks(0), finished(false), kept(false)
+{}
+
+bool Journal::open(const Header & header) {
+    // The sink appends: start from scratch
+    if (QFile::exists(sink.fileName()) && ! QFile::remove(sink.fileName())) {
+        Logger::error(tr("Failed to create journal %1: the file exists").arg(sink.fileName()));
+        return false;
+    }
+    if ( ! sink.open() ) {
+        return false; // Reported by sink
+    }
+    sink.write(MAGIC, sizeof(MAGIC));
+    const quint16 versionAndReserved[2] = {VERSION, 0};
+    sink.write(reinterpret_cast<const char*>(versionAndReserved), sizeof(versionAndReserved));
+
+    QByteArray payload;
+    {
+        QDataStream out(&payload, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_5_0);
+        out << header;
+    }
+    appendRecord(payload.constData(), quint32(payload.size()));
+    sinceCommit.start();
+    return commit();
+}
+
+void Journal::appendRecord(const char * payload, quint32 size) {
+    const quint32 recordHeader[2] = {size, checksum(payload, size)};
+    sink.write(reinterpret_cast<const char*>(recordHeader), sizeof(recordHeader));
+    sink.write(payload, size);
+}
+
+bool Journal::append(const DataBlock & block) {
+    if ( ! sink.isOpen() || finished ) {
+        return false;
+    }
+    // Payload goes right from the block into buffers of the sink, CRC is computed by parts
+    const qint32 count = block.size();
+    const int timesSize = int(sizeof(TimeStampType))*count;
+    const int itemsSize = int(sizeof(DataItem))*count;
+    const quint32 payloadSize = quint32(sizeof(count) + timesSize + itemsSize);
+    const char * times = reinterpret_cast<const char*>(block.timestamps.constData());
+    const char * items = reinterpret_cast<const char*>(block.data.constData());
+    quint32 crc = checksum(reinterpret_cast<const char*>(&count), sizeof(count));
+    crc = checksum(times, quint32(timesSize), crc);
+    crc = checksum(items, quint32(itemsSize), crc);
+    const quint32 recordHeader[2] = {payloadSize, crc};
+    sink.write(reinterpret_cast<const char*>(recordHeader), sizeof(recordHeader));
+    sink.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    sink.write(times, timesSize);
+    sink.write(items, itemsSize);
+    ++pendingBlocks;
+
+    if ((policy.blocks > 0 && pendingBlocks >= policy.blocks)
+     || (policy.msecs > 0 && sinceCommit.hasExpired(policy.msecs))) {
+        return commit();
+    }
+    return true;
+}
+
+bool Journal::commit() {
+    if ( ! sink.isOpen() || finished ) {
+        return false;
+    }
+    sink.commit();
+    pendingBlocks = 0;
+    sinceCommit.start();
+    return true;
+}
+
+void Journal::finish() {
+    if (finished) {
+        return;
+    }
+    // Closing syncs the rest: don't wait for it
+    sink.close();
+    finished = true;
+}
+
+Journal::~Journal() {
+    const bool complete = finished;
+    finish();
+    if ( ! sink.isOpen() ) {
+        return;
+    }
+    sink.wait(); // Usually done long ago: journal is released after its files are synced
+    sink.reportResults();
+    if ( ! sink.isDurable() ) {
+        Logger::warning(tr("Journal %1 may be incomplete on disk, it is kept").arg(sink.fileName()));
+        kept = true; // Committed part is still useful
+    }
+    if (complete && ! kept) {
+        QFile::remove(sink.fileName());
+    }
+}
+
+QString Journal::fileNameFor(const QString & baseName) {
+    QString fileName = baseName + FILE_SUFFIX;
+    for (int n = 1; QFile::exists(fileName); ++n) {
+        fileName = QString("%1-%2%3").arg(baseName).arg(n).arg(FILE_SUFFIX);
+    }
+    return fileName;
+}
+
+QStringList Journal::findAll(QString directory) {
+    QDir dir(directory);
+    QStringList res;
+    for (const QFileInfo & info: dir.entryInfoList(QStringList("*" + FILE_SUFFIX), QDir::Files, QDir::Time | QDir::Reversed)) {
+        res << info.filePath();
+    }
+    return res;
+}
+
+Journal::Reader::Reader(QString fileName) :
+    file(fileName), truncated(false)
+{}
+
+bool Journal::Reader::open(Header & header) {
+    if ( ! file.open(QIODevice::ReadOnly) ) {
+        Logger::error(tr("Failed to open journal %1: %2").arg(file.fileName(), file.errorString()));
+        return false;
+    }
+    QByteArray fileHeader = file.read(FILE_HEADER_SIZE);
+    QByteArray payload;
+    if (fileHeader.size() != FILE_HEADER_SIZE || memcmp(fileHeader.constData(), MAGIC, sizeof(MAGIC)) != 0 || ! readRecord(payload)) {
+        Logger::error(tr("File %1 is not a journal or is damaged").arg(file.fileName()));
+        return false;
+    }
+    quint16 version;
+    memcpy(&version, fileHeader.constData() + sizeof(MAGIC), sizeof(version));
+    if (version != VERSION) {
+        Logger::error(tr("Journal %1 has unsupported version %2").arg(file.fileName()).arg(version));
+        return false;
+    }
+    QDataStream in(payload);
+    in.setVersion(QDataStream::Qt_5_0);
+    header = Header();
+    in >> header;
+    return in.status() == QDataStream::Ok;
+}
+
+bool Journal::Reader::readRecord(QByteArray & payload) {
+    quint32 recordHeader[2];
+    const qint64 read = file.read(reinterpret_cast<char*>(recordHeader), sizeof(recordHeader));
+    if (read == 0) {
+        return false; // End of journal
+    }
+    if (read != sizeof(recordHeader) || recordHeader[0] > MAX_PAYLOAD_SIZE) {
+        truncated = true;
+        return false;
+    }
+    payload = file.read(recordHeader[0]);
+    if (payload.size() != int(recordHeader[0]) || checksum(payload.constData(), recordHeader[0]) != recordHeader[1]) {
+        truncated = true;
+        return false;
+    }
+    return true;
+}
+
+bool Journal::Reader::readBlock(DataBlock & block) {
+    QByteArray payload;
+    if ( ! readRecord(payload) ) {
+        return false;
+    }
+    qint32 count = -1;
+    if (payload.size() >= int(sizeof(count))) {
+        memcpy(&count, payload.constData(), sizeof(count));
+    }
+    const int timesSize = int(sizeof(TimeStampType))*count;
+    const int itemsSize = int(sizeof(DataItem))*count;
+    if (count < 0 || payload.size() != int(sizeof(count)) + timesSize + itemsSize) {
+        truncated = true;
+        return false;
+    }
+    block.timestamps.resize(count);
+    block.data.resize(count);
+    memcpy(block.timestamps.data(), payload.constData() + sizeof(count), size_t(timesSize));
+    memcpy(block.data.data(), payload.constData() + sizeof(count) + timesSize, size_t(itemsSize));
+    return true;
+}
@@ -0,0 +1,165 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "../protocol.h"
+#include "outputformat.h"
+#include "asyncfilesink.h"
+
+#include <QFile>
+#include <QStringList>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QCoreApplication>
+
+/*!
+ * \brief Write-ahead journal of data blocks written to one set of output files
+ *
+ * Blocks are appended to the journal before they are passed to output formats,
+ * so that data still in memory (buffers of AsyncFileSink, records being filled
+ * by output formats) can be restored after a crash or a power loss. The journal
+ * starts with a header that describes the output files (names, formats, sizes
+ * before writing), so it is enough to rewrite them from scratch.
+ *
+ * Appends are group-committed: blocks are collected in memory and written with
+ * one fdatasync per CommitPolicy::blocks blocks or CommitPolicy::msecs milliseconds,
+ * whatever happens first. So the data that can be lost are limited by the policy,
+ * without paying for a sync per block.
+ *
+ * Writes and syncs run on the I/O thread of AsyncFileSink: appending a block only
+ * copies it into a buffer, so a slow disk never stalls the writer (nor the other
+ * sinks on its thread). Errors of the I/O thread are reported by AsyncFileSink;
+ * the journal is kept then.
+ *
+ * File layout (native byte order: journal is read back on the same machine):
+ *
+ *     "SRGJ", quint16 version, quint16 reserved
+ *     records: quint32 payload size, quint32 CRC-32 of payload, payload
+ *
+ * The payload of the first record is Header (in QDataStream), payloads of the next
+ * ones are blocks as in SpillFile. A torn record at the end (crash during write)
+ * fails CRC check, so reading stops before it.
+ *
+ * When output files are closed, the journal is finished. It is removed when
+ * destroyed, unless keep() was called: FileWriter destroys it only after all
+ * its files are synced to disk successfully. The destructor waits for the I/O
+ * thread and reports latencies of writes and syncs to Logger.
+ */
+class Journal
+{
+    Q_DECLARE_TR_FUNCTIONS(Journal)
+public:
+    static const QString FILE_SUFFIX;
+    static const int DEFAULT_COMMIT_BLOCKS = 16;
+    static const int DEFAULT_COMMIT_MSECS = 1000;
+
+    /*!
+     * \brief When appended blocks are committed (written and synced to disk)
+     */
+    struct CommitPolicy {
+        int blocks; /*!< commit after this number of blocks (0 - don't commit by count) */
+        int msecs;  /*!< commit when this time passed since the last commit (0 - don't commit by time) */
+        CommitPolicy(int blocks = DEFAULT_COMMIT_BLOCKS, int msecs = DEFAULT_COMMIT_MSECS)
+            : blocks(blocks), msecs(msecs) {}
+    };
+
+    /*!
+     * \brief Output files that are journaled
+     */
+    struct Header {
+        OutputFormat::FileInfo info;
+        OutputFormat::Options formatOptions;
+        int compressionLevel;
+        QVector<OutputFormat::Type> types; // Format of each file
+        QStringList fileNames;
+        QVector<qint64> initialSizes;      // Sizes of files before writing: they are truncated to these sizes on replay
+        Header() : compressionLevel(-1) {}
+    };
+
+    /*!
+     * \param fileName - name of the journal file, usually one of output files with FILE_SUFFIX
+     */
+    explicit Journal(QString fileName, CommitPolicy policy = CommitPolicy());
+
+    /*!
+     * \brief Creates journal file and commits \a header to it
+     * \return true if success, false if failed (reported to Logger)
+     */
+    bool open(const Header & header);
+
+    /*!
+     * \brief Appends block, commits it together with previous ones if it is time to.
+     * \return false if journal is not opened
+     */
+    bool append(const DataBlock & block);
+
+    /*!
+     * \brief Hands all appended blocks to the I/O thread to be written and synced
+     */
+    bool commit();
+
+    /*!
+     * \brief Commits the rest of blocks and closes file: no more blocks will be appended.
+     *        The file will be removed when the journal is destroyed, unless keep() is called
+     *        or it failed to be written.
+     */
+    void finish();
+
+    /// Don't remove the file when destroyed: data of journaled files are not safe on disk
+    void keep() { kept = true; }
+
+    QString fileName() const { return sink.fileName(); }
+
+    ~Journal();
+
+    /*!
+     * \brief Name of journal for output files named \a baseName (without suffixes of formats).
+     *        Doesn't clash with existing journals: e.g. the previous journal of the same
+     *        files that is not removed yet.
+     */
+    static QString fileNameFor(const QString & baseName);
+
+    /*!
+     * \brief Names of all journal files in \a directory, the oldest first
+     */
+    static QStringList findAll(QString directory);
+
+    /*!
+     * \brief Reads journal file
+     *
+     * Usage: open, then readBlock until it returns false.
+     */
+    class Reader {
+        Q_DECLARE_TR_FUNCTIONS(Journal)
+    public:
+        explicit Reader(QString fileName);
+        /*!
+         * \return false if file cannot be read or it is not a journal (reported to Logger)
+         */
+        bool open(Header & header);
+        /*!
+         * \return false if there are no more blocks. If the last record is torn
+         *         (or damaged), isTruncated() returns true after that.
+         */
+        bool readBlock(DataBlock & block);
+        bool isTruncated() const { return truncated; }
+        void close() { file.close(); }
+    private:
+        bool readRecord(QByteArray & payload);
+        QFile file;
+        bool truncated;
+    };
+
+private:
+    void appendRecord(const char * payload, quint32 size);
+
+    AsyncFileSink sink;
+    const CommitPolicy policy;
+    int pendingBlocks; // Appended since the last commit
+    QElapsedTimer sinceCommit;
+    bool finished;
+    bool kept;
+
+    Q_DISABLE_COPY(Journal)
+};
+
+#endif // JOURNAL_H
@@ -0,0 +1,197 @@
+#include "miniseedencoder.h"
+#include "steim2.h"
+
+#include <QDateTime>
+#include <QtEndian>
+#include <QtConcurrent>
+#include <qmath.h>
+#include <cstring>
+
+const QString MiniSeedEncoder::DEFAULT_NETWORK = "XX";
+const QString MiniSeedEncoder::FILE_SUFFIX = ".mseed";
+
+namespace {
+    const int BLOCKETTE_1000_OFFSET = 48;
+    const quint8 ENCODING_STEIM2 = 11;
+    const quint8 WORD_ORDER_BIG_ENDIAN = 1;
+    const int SEQUENCE_NUMBER_MODULO = 1000000;
+
+    // SEED band code for short-period sensors with given sampling frequency
+    char bandCode(int samplingFreq) {
+        if (samplingFreq >= 80) {
+            return 'E';
+        } else if (samplingFreq >= 10) {
+            return 'S';
+        } else if (samplingFreq > 1) {
+            return 'M';
+        } else {
+            return 'L';
+        }
+    }
+
+    // Fixed-size field: left-justified, padded with spaces, upper case
+    QByteArray seedField(QString value, int size) {
+        return value.toUpper().toLatin1().leftJustified(size, ' ', true);
+    }
+
+    template <typename T>
+    void putBigEndian(char * dst, T value) {
+        qToBigEndian(value, reinterpret_cast<uchar*>(dst));
+    }
+}
+
+MiniSeedEncoder::MiniSeedEncoder(int recordLength, QString network, QString station, int samplingFreq) :
+    recordLength_(recordLength == SMALL_RECORD_LENGTH ? SMALL_RECORD_LENGTH : DEFAULT_RECORD_LENGTH),
+    framesCount((recordLength_ - DATA_OFFSET) / Steim2::FRAME_SIZE),
+    // Upper bound: all data words (except X0 and Xn) packed with 7 differences
+    maxSamplesInRecord((framesCount*(Steim2::WORDS_IN_FRAME - 1) - 2) * 7),
+    samplingFreq(samplingFreq > 0 ? samplingFreq : 1),
+    periodMsecs(1000.0 / this->samplingFreq),
+    network(seedField(network, 2)), station(seedField(station, 5)),
+    sequenceNumber(1)
+{
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        Stream & stream = streams[ch];
+        stream.channelCode[0] = bandCode(this->samplingFreq);
+        stream.channelCode[1] = 'H'; // High gain seismometer
+        stream.channelCode[2] = CHANNEL_COMPONENTS[ch];
+        stream.previous = 0;
+    }
+}
+
+QByteArray MiniSeedEncoder::appendBlock(const TimeStampsVector & t, const DataVector & d) {
+    int count = qMin(t.size(), d.size());
+    if (count == 0) {
+        return QByteArray();
+    }
+
+    QByteArray res;
+    const TimeStampsVector & lastTimes = streams[0].times;
+    if ( ! lastTimes.isEmpty() && qAbs(t.first() - lastTimes.last() - periodMsecs) > periodMsecs/2 ) {
+        // Gap or overlap: finish current records, new ones will start from new time
+        res += encodeAll(true);
+    }
+
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        Stream & stream = streams[ch];
+        int oldSize = stream.samples.size();
+        stream.samples.resize(oldSize + count);
+        qint32 * samples = stream.samples.data() + oldSize;
+        for (int i = 0; i < count; ++i) {
+            samples[i] = d[i].byChannel[ch];
+        }
+        stream.times += (count == t.size()) ? t : t.mid(0, count);
+    }
+
+    if (streams[0].samples.size() >= maxSamplesInRecord) {
+        res += encodeAll(false);
+    }
+    return res;
+}
+
+QByteArray MiniSeedEncoder::flush() {
+    return encodeAll(true);
+}
+
+QByteArray MiniSeedEncoder::encodeAll(bool flushAll) {
+    // Compress channels in parallel
+    QList< QFuture<void> > futures;
+    for (Stream & stream: streams) {
+        futures << QtConcurrent::run(this, &MiniSeedEncoder::encodeStream, &stream, flushAll);
+    }
+    for (QFuture<void> & future: futures) {
+        future.waitForFinished();
+    }
+
+    // Join records and number them
+    QByteArray res;
+    for (Stream & stream: streams) {
+        for (int offset = 0; offset < stream.records.size(); offset += recordLength_) {
+            QByteArray number = QByteArray::number(sequenceNumber).rightJustified(6, '0');
+            memcpy(stream.records.data() + offset, number.constData(), 6);
+            sequenceNumber = sequenceNumber % (SEQUENCE_NUMBER_MODULO - 1) + 1; // From 000001 to 999999
+        }
+        res += stream.records;
+        stream.records.clear();
+    }
+    return res;
+}
+
+void MiniSeedEncoder::encodeStream(Stream * stream, bool flushAll) {
+    const int minSamples = flushAll ? 1 : maxSamplesInRecord;
+    int encoded = 0;
+    while (stream->samples.size() - encoded >= minSamples) {
+        QByteArray record(recordLength_, '\0');
+        int n = Steim2::encode(stream->samples.constData() + encoded, stream->samples.size() - encoded, stream->previous,
+                               reinterpret_cast<uchar*>(record.data() + DATA_OFFSET), framesCount);
+        if (n <= 0) {
+            break; // Should not happen: at least one sample always fits
+        }
+        writeHeader(record.data(), *stream, stream->times[encoded], n);
+        stream->records += record;
+        stream->previous = stream->samples[encoded + n - 1];
+        encoded += n;
+    }
+    stream->samples.remove(0, encoded);
+    stream->times.remove(0, encoded);
+}
+
+void MiniSeedEncoder::writeHeader(char * record, const Stream & stream, TimeStampType start, int samplesCount) {
+    // Fixed section of data header
+    memcpy(record, "000000", 6); // Sequence number is set later
+    record[6] = 'D';
+    record[7] = ' ';
+    memcpy(record + 8, station.constData(), 5);
+    memcpy(record + 13, "  ", 2); // Location
+    memcpy(record + 15, stream.channelCode, 3);
+    memcpy(record + 18, network.constData(), 2);
+
+    // Start time (BTIME) in UTC, with 0.0001 s precision
+    qint64 secs = qint64(qFloor(start / 1000));
+    int ticks = qRound((start - secs*1000.0) * 10);
+    if (ticks >= 10000) {
+        ++secs;
+        ticks -= 10000;
+    }
+    QDateTime time = QDateTime::fromMSecsSinceEpoch(secs*1000).toUTC();
+    putBigEndian<quint16>(record + 20, quint16(time.date().year()));
+    putBigEndian<quint16>(record + 22, quint16(time.date().dayOfYear()));
+    record[24] = char(time.time().hour());
+    record[25] = char(time.time().minute());
+    record[26] = char(time.time().second());
+    record[27] = 0;
+    putBigEndian<quint16>(record + 28, quint16(ticks));
+
+    putBigEndian<quint16>(record + 30, quint16(samplesCount));
+    putBigEndian<qint16>(record + 32, qint16(samplingFreq)); // Sample rate factor...
+    putBigEndian<qint16>(record + 34, 1);                    // ...and multiplier
+    record[36] = record[37] = record[38] = 0; // Activity, I/O and data quality flags
+    record[39] = 1;                           // Number of blockettes
+    putBigEndian<qint32>(record + 40, 0);     // Time correction
+    putBigEndian<quint16>(record + 44, DATA_OFFSET);
+    putBigEndian<quint16>(record + 46, BLOCKETTE_1000_OFFSET);
+
+    // Blockette 1000: data only SEED
+    char * blockette = record + BLOCKETTE_1000_OFFSET;
+    putBigEndian<quint16>(blockette, 1000);
+    putBigEndian<quint16>(blockette + 2, 0); // No next blockette
+    blockette[4] = char(ENCODING_STEIM2);
+    blockette[5] = char(WORD_ORDER_BIG_ENDIAN);
+    blockette[6] = char(recordLength_ == SMALL_RECORD_LENGTH ? 9 : 12); // log2 of record length
+    blockette[7] = 0;
+}
+
+int MiniSeedEncoder::decodeRecord(const char * record, int recordLength, QVector<qint32> & dst) {
+    const uchar * bytes = reinterpret_cast<const uchar*>(record);
+    int samplesCount = qFromBigEndian<quint16>(bytes + 30);
+    int dataOffset = qFromBigEndian<quint16>(bytes + 44);
+    if (bytes[BLOCKETTE_1000_OFFSET + 4] != ENCODING_STEIM2 || dataOffset >= recordLength) {
+        return -1;
+    }
+    dst.resize(samplesCount);
+    int frames = (recordLength - dataOffset) / Steim2::FRAME_SIZE;
+    if ( ! Steim2::decode(bytes + dataOffset, frames, samplesCount, dst.data()) ) {
+        return -1;
+    }
+    return samplesCount;
+}
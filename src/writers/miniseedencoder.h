@@ -0,0 +1,82 @@
+#ifndef MINISEEDENCODER_H
+#define MINISEEDENCODER_H
+
+#include "../protocol.h"
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+/*!
+ * \brief Packs data into MiniSEED (SEED 2.4 data-only) records with Steim-2 compression
+ *
+ * Each channel is a separate stream of records with its own SEED channel code
+ * (band code by sampling frequency, 'H' for seismometer, component from CHANNEL_COMPONENTS).
+ * Records of all channels are written one after another into the same file.
+ *
+ * Samples are accumulated per channel until they surely fill a whole record,
+ * then channels are compressed in parallel. Start time of each record is
+ * the timestamp of its first sample. If timestamps are not continuous, the current
+ * record is finished and a new one is started.
+ */
+class MiniSeedEncoder
+{
+public:
+    static const int DEFAULT_RECORD_LENGTH = 4096;
+    static const int SMALL_RECORD_LENGTH = 512;
+    static const int DATA_OFFSET = 64; // Fixed header (48 bytes) + blockette 1000 (8 bytes) + padding
+    static const QString DEFAULT_NETWORK;
+    static const QString FILE_SUFFIX;
+
+    /*!
+     * \param recordLength - either 512 or 4096 bytes
+     * \param network - SEED network code (2 chars)
+     * \param station - SEED station code (up to 5 chars)
+     * \param samplingFreq - sampling frequency, Hz
+     */
+    MiniSeedEncoder(int recordLength, QString network, QString station, int samplingFreq);
+
+    /*!
+     * \brief Adds new data
+     * \return complete records that are ready to be written (may be empty)
+     */
+    QByteArray appendBlock(const TimeStampsVector & t, const DataVector & d);
+
+    /*!
+     * \brief Encodes all remaining samples, even if records are not full
+     * \return records that are ready to be written (may be empty)
+     */
+    QByteArray flush();
+
+    int recordLength() const { return recordLength_; }
+
+    /*!
+     * \brief Decodes samples of one record (for verification)
+     * \return number of samples decoded into \a dst, -1 if record is invalid
+     */
+    static int decodeRecord(const char * record, int recordLength, QVector<qint32> & dst);
+
+private:
+    struct Stream {
+        char channelCode[3];
+        QVector<qint32> samples;
+        TimeStampsVector times;
+        qint32 previous;   // The last sample of previous record
+        QByteArray records; // Encoded, waiting to be returned
+    };
+
+    void encodeStream(Stream * stream, bool flushAll);
+    void writeHeader(char * record, const Stream & stream, TimeStampType start, int samplesCount);
+    QByteArray encodeAll(bool flushAll);
+
+    const int recordLength_;
+    const int framesCount;
+    const int maxSamplesInRecord;
+    const int samplingFreq;
+    const double periodMsecs;
+    QByteArray network;
+    QByteArray station;
+    int sequenceNumber;
+    Stream streams[CHANNELS_NUM];
+};
+
+#endif // MINISEEDENCODER_H
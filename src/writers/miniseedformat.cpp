@@ -0,0 +1,28 @@
+#include "miniseedformat.h"
+
+MiniSeedFormat::MiniSeedFormat(QString network, int recordLength) :
+    network(network), recordLength(recordLength)
+{}
+
+void MiniSeedFormat::open(const FileInfo & info) {
+    // Station code is the device id
+    encoder.reset(new MiniSeedEncoder(recordLength, network, info.deviceID, info.samplingFreq));
+}
+
+QByteArray MiniSeedFormat::appendBlock(const DataBlock & block) {
+    if (encoder.isNull()) {
+        return QByteArray(); // Not opened
+    }
+    return encoder->appendBlock(block.timestamps, block.data);
+}
+
+QByteArray MiniSeedFormat::flush() {
+    if (encoder.isNull()) {
+        return QByteArray();
+    }
+    return encoder->flush();
+}
+
+void MiniSeedFormat::close() {
+    encoder.reset();
+}
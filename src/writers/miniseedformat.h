@@ -0,0 +1,35 @@
+#ifndef MINISEEDFORMAT_H
+#define MINISEEDFORMAT_H
+
+#include "outputformat.h"
+#include "miniseedencoder.h"
+#include <QScopedPointer>
+
+/*!
+ * \brief MiniSEED records, one stream per channel (\see MiniSeedEncoder)
+ *
+ * MiniSEED has no file header: each record is self-describing.
+ */
+class MiniSeedFormat : public OutputFormat
+{
+public:
+    /*!
+     * \param network - SEED network code (2 characters)
+     * \param recordLength - length of records, either 512 or 4096
+     */
+    MiniSeedFormat(QString network, int recordLength);
+
+    Type type() const override { return MiniSeed; }
+    QString fileSuffix() const override { return MiniSeedEncoder::FILE_SUFFIX; }
+    void open(const FileInfo & info) override;
+    QByteArray appendBlock(const DataBlock & block) override;
+    QByteArray flush() override;
+    void close() override;
+
+private:
+    const QString network;
+    const int recordLength;
+    QScopedPointer<MiniSeedEncoder> encoder; // Only while file is opened
+};
+
+#endif // MINISEEDFORMAT_H
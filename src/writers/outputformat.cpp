@@ -0,0 +1,38 @@
+#include "outputformat.h"
+#include "textformat.h"
+#include "miniseedformat.h"
+#include "binaryformat.h"
+
+const OutputFormat::Type OutputFormat::ALL_TYPES[OutputFormat::TYPES_COUNT] = {Text, MiniSeed, Binary};
+
+OutputFormat::Options::Options() :
+    miniSeedNetwork(MiniSeedEncoder::DEFAULT_NETWORK),
+    miniSeedRecordLength(MiniSeedEncoder::DEFAULT_RECORD_LENGTH)
+{}
+
+QString OutputFormat::typeName(Type type) {
+    switch (type) {
+    case Text:     return "text";
+    case MiniSeed: return "mseed";
+    case Binary:   return "bin";
+    }
+    return QString();
+}
+
+OutputFormat::Type OutputFormat::typeFromName(QString name) {
+    for (Type type: ALL_TYPES) {
+        if (typeName(type) == name.trimmed().toLower()) {
+            return type;
+        }
+    }
+    return static_cast<Type>(0);
+}
+
+OutputFormat * OutputFormat::create(Type type, const Options & options) {
+    switch (type) {
+    case Text:     return new TextFormat();
+    case MiniSeed: return new MiniSeedFormat(options.miniSeedNetwork, options.miniSeedRecordLength);
+    case Binary:   return new BinaryFormat();
+    }
+    return NULL;
+}
@@ -0,0 +1,123 @@
+#ifndef OUTPUTFORMAT_H
+#define OUTPUTFORMAT_H
+
+#include "../protocol.h"
+#include "../dsp/slidingstats.h"
+#include <QByteArray>
+#include <QDateTime>
+#include <QFlags>
+#include <QString>
+
+/*!
+ * \interface OutputFormat
+ * \brief Backend that turns stream of data blocks into bytes of a data file
+ *
+ * The backend doesn't do any I/O: it only returns bytes that should be appended
+ * to the file, so the same backend can be used with AsyncFileSink, an in-memory
+ * buffer or a converter. The life cycle for each file is:
+ *
+ *   open -> [header, only for a new file] -> appendBlock... -> flush -> close
+ *
+ * Several backends can be fed with the same data blocks at the same time,
+ * each of them writing into its own file (\see FileWriter::setOutputFormats).
+ */
+class OutputFormat
+{
+public:
+    /*!
+     * \brief Available backends, can be combined as flags
+     */
+    enum Type {
+        Text     = 0x1, /*!< Text table with header, one line per data item (TextFormat) */
+        MiniSeed = 0x2, /*!< MiniSEED records with Steim-2 compression (MiniSeedFormat) */
+        Binary   = 0x4  /*!< Raw little-endian int32 columns with fixed header (BinaryFormat) */
+    };
+    Q_DECLARE_FLAGS(Types, Type)
+
+    static const int TYPES_COUNT = 3;
+    static const Type ALL_TYPES[TYPES_COUNT];
+
+    /*!
+     * \brief Short name of backend type, used in settings and command line
+     */
+    static QString typeName(Type type);
+    /*!
+     * \return type with given typeName, or 0 if name is unknown
+     */
+    static Type typeFromName(QString name);
+
+    /*!
+     * \brief Description of data that are written to file
+     */
+    struct FileInfo {
+        QString deviceID;
+        int samplingFreq;
+        int filterFreq;
+        QString latitude;
+        QString longitude;
+        QDateTime startTime; // Time of the first data item
+        QVector<SlidingStats::Values> stats; // Of each channel before the start, empty if unknown
+        QString units; // Of values, empty - counts of ADC
+        FileInfo() : samplingFreq(0), filterFreq(0) {}
+    };
+
+    /*!
+     * \brief Parameters of backends that are not in FileInfo
+     */
+    struct Options {
+        QString miniSeedNetwork;
+        int miniSeedRecordLength;
+        Options();
+    };
+
+    /*!
+     * \brief Creates backend of given type
+     * \return new backend (caller takes ownership), NULL if \a type is not a single known type
+     */
+    static OutputFormat * create(Type type, const Options & options = Options());
+
+    virtual ~OutputFormat() {}
+
+    virtual Type type() const = 0;
+
+    /*!
+     * \brief Suffix appended to file name (FileWriter::buildFileName) to distinguish formats
+     */
+    virtual QString fileSuffix() const = 0;
+
+    /*!
+     * \brief Whether bytes returned by appendBlock start exactly with the first item
+     *        of the block, so that data can be read from that offset (\see FileIndex)
+     */
+    virtual bool isIndexable() const { return false; }
+
+    /*!
+     * \brief Starts a new file: resets state left from the previous one
+     */
+    virtual void open(const FileInfo & info) { Q_UNUSED(info); }
+
+    /*!
+     * \brief Bytes at the beginning of a new file (not written when appending to existing one)
+     */
+    virtual QByteArray header(const FileInfo & info) { Q_UNUSED(info); return QByteArray(); }
+
+    /*!
+     * \brief Encodes new data
+     * \return bytes to append to file. May be empty if backend accumulates data (\see flush)
+     */
+    virtual QByteArray appendBlock(const DataBlock & block) = 0;
+
+    /*!
+     * \brief Encodes all data accumulated by backend, even if they don't fill a whole record
+     */
+    virtual QByteArray flush() { return QByteArray(); }
+
+    /*!
+     * \brief Finishes the file. Data not returned by flush are lost.
+     */
+    virtual void close() {}
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(OutputFormat::Types)
+
+#endif // OUTPUTFORMAT_H
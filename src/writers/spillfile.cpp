@@ -0,0 +1,64 @@
+#include "spillfile.h"
+#include "../logger.h"
+
+namespace {
+    const QString FILE_TEMPLATE = "seismoreg-queue-XXXXXX.tmp";
+}
+
+SpillFile::SpillFile(QString directory) :
+    file(directory + "/" + FILE_TEMPLATE), bytes_(0)
+{}
+
+bool SpillFile::append(const DataBlock & block) {
+    if ( ! file.isOpen() && ! file.open() ) {
+        Logger::error(tr("Failed to create temporary file for queue in %1: %2").arg(file.fileTemplate(), file.errorString()));
+        return false;
+    }
+    const qint32 count = block.size();
+    const qint64 timesSize = qint64(sizeof(TimeStampType))*count;
+    const qint64 itemsSize = qint64(sizeof(DataItem))*count;
+    bool ok = file.seek(bytes_)
+           && file.write(reinterpret_cast<const char*>(&count), sizeof(count)) == sizeof(count)
+           && file.write(reinterpret_cast<const char*>(block.timestamps.constData()), timesSize) == timesSize
+           && file.write(reinterpret_cast<const char*>(block.data.constData()), itemsSize) == itemsSize;
+    if ( ! ok ) {
+        Logger::error(tr("Failed to write queue to temporary file %1: %2").arg(file.fileName(), file.errorString()));
+        file.resize(bytes_); // Don't leave partial block
+        return false;
+    }
+    bytes_ += sizeof(count) + timesSize + itemsSize;
+    return true;
+}
+
+bool SpillFile::startReading() {
+    return file.isOpen() && file.flush() && file.seek(0);
+}
+
+bool SpillFile::readBlock(DataBlock & block) {
+    if (file.pos() >= bytes_) {
+        return false; // No more blocks
+    }
+    qint32 count;
+    if (file.read(reinterpret_cast<char*>(&count), sizeof(count)) != sizeof(count) || count < 0) {
+        Logger::error(tr("Failed to read queue from temporary file %1: %2").arg(file.fileName(), file.errorString()));
+        return false;
+    }
+    block.timestamps.resize(count);
+    block.data.resize(count);
+    const qint64 timesSize = qint64(sizeof(TimeStampType))*count;
+    const qint64 itemsSize = qint64(sizeof(DataItem))*count;
+    if (file.read(reinterpret_cast<char*>(block.timestamps.data()), timesSize) != timesSize
+     || file.read(reinterpret_cast<char*>(block.data.data()), itemsSize) != itemsSize) {
+        Logger::error(tr("Failed to read queue from temporary file %1: %2").arg(file.fileName(), file.errorString()));
+        return false;
+    }
+    return true;
+}
+
+void SpillFile::clear() {
+    if (file.isOpen()) {
+        file.resize(0);
+        file.seek(0);
+    }
+    bytes_ = 0;
+}
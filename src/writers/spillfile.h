@@ -0,0 +1,65 @@
+#ifndef SPILLFILE_H
+#define SPILLFILE_H
+
+#include "../protocol.h"
+#include <QTemporaryFile>
+#include <QCoreApplication>
+
+/*!
+ * \brief Temporary file where data blocks are kept when they don't fit into memory
+ *
+ * Blocks are stored in native binary form, exactly as they are in memory:
+ *
+ *     qint32 count, count timestamps (TimeStampType), count items (DataItem)
+ *
+ * so that they are written and read back without any formatting. The file is
+ * only for the running program: it is removed when SpillFile is destroyed.
+ *
+ * Usage: append blocks, then read them all from the beginning with readBlock
+ * and clear the file.
+ */
+class SpillFile
+{
+    Q_DECLARE_TR_FUNCTIONS(SpillFile)
+public:
+    /*!
+     * \param directory - where to create the file. It is better to use the disk
+     *        of data files than the system temp dir: the latter can be in memory.
+     */
+    explicit SpillFile(QString directory);
+
+    /*!
+     * \brief Appends block to the end of file. Creates file if needed.
+     * \return true if success, false if failed (reported to Logger)
+     */
+    bool append(const DataBlock & block);
+
+    qint64 bytes() const { return bytes_; }
+    bool isEmpty() const { return bytes_ == 0; }
+
+    /*!
+     * \brief Moves to the first block: subsequent readBlock will read all blocks from the beginning
+     */
+    bool startReading();
+
+    /*!
+     * \brief Reads next block
+     * \return false if there is no more blocks or failed to read
+     */
+    bool readBlock(DataBlock & block);
+
+    /*!
+     * \brief Drops all blocks
+     */
+    void clear();
+
+    QString fileName() const { return file.fileName(); }
+
+private:
+    QTemporaryFile file;
+    qint64 bytes_;
+
+    Q_DISABLE_COPY(SpillFile)
+};
+
+#endif // SPILLFILE_H
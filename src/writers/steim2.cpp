@@ -0,0 +1,134 @@
+#include "steim2.h"
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+    // Possible ways to pack differences into one data word, from the densest one
+    struct Packing {
+        int count;      // differences in word
+        int bits;       // bits per difference
+        quint32 nibble; // 2-bit code in control word
+        quint32 dnib;   // 2-bit subcode in the top of data word (for nibbles 2 and 3)
+    };
+    const Packing PACKINGS[] = {
+        {7,  4, 3, 2},
+        {6,  5, 3, 1},
+        {5,  6, 3, 0},
+        {4,  8, 1, 0}, // nibble 1 has no subcode: all 32 bits are data
+        {3, 10, 2, 3},
+        {2, 15, 2, 2},
+        {1, 30, 2, 1},
+    };
+
+    inline bool fits(qint64 diff, int bits) {
+        const qint64 limit = qint64(1) << (bits - 1);
+        return (diff >= -limit) && (diff < limit);
+    }
+
+    inline qint32 signExtend(quint32 raw, int bits) {
+        return qint32(raw << (32 - bits)) >> (32 - bits);
+    }
+
+    inline quint32 nibbleOf(quint32 control, int word) {
+        return (control >> (30 - 2*word)) & 3;
+    }
+}
+
+int Steim2::encode(const qint32 * samples, int count, qint32 previous, uchar * dst, int framesCount) {
+    memset(dst, 0, size_t(framesCount)*FRAME_SIZE);
+    if (count <= 0 || framesCount <= 0) {
+        return 0;
+    }
+
+    // Differences are computed as 64-bit to avoid overflow on extreme values
+    qint64 firstDiff = qint64(samples[0]) - previous;
+    if ( ! fits(firstDiff, MAX_DIFFERENCE_BITS) ) {
+        firstDiff = 0; // Decoders restore the first sample from X0 anyway
+    }
+    auto diffAt = [&](int i) -> qint64 {
+        return (i == 0) ? firstDiff : qint64(samples[i]) - samples[i - 1];
+    };
+
+    int pos = 0;
+    bool stopped = false;
+    for (int f = 0; f < framesCount && pos < count && ! stopped; ++f) {
+        quint32 words[WORDS_IN_FRAME] = {0};
+        int firstWord = (f == 0) ? 3 : 1; // words 1 and 2 of the first frame are X0 and Xn
+        for (int w = firstWord; w < WORDS_IN_FRAME && pos < count; ++w) {
+            const Packing * chosen = NULL;
+            for (const Packing & p: PACKINGS) {
+                if (pos + p.count > count) {
+                    continue;
+                }
+                bool ok = true;
+                for (int i = 0; i < p.count && ok; ++i) {
+                    ok = fits(diffAt(pos + i), p.bits);
+                }
+                if (ok) {
+                    chosen = &p;
+                    break;
+                }
+            }
+            if (chosen == NULL) {
+                stopped = true; // Too large difference: the rest goes to another record
+                break;
+            }
+            quint32 word = (chosen->nibble == 1) ? 0 : (chosen->dnib << 30);
+            const quint32 mask = (chosen->bits == 32) ? ~0u : ((1u << chosen->bits) - 1);
+            for (int i = 0; i < chosen->count; ++i) {
+                quint32 value = quint32(qint32(diffAt(pos + i))) & mask;
+                word |= value << (chosen->bits*(chosen->count - 1 - i));
+            }
+            words[w] = word;
+            words[0] |= chosen->nibble << (30 - 2*w);
+            pos += chosen->count;
+        }
+        if (f == 0) {
+            words[1] = quint32(samples[0]);
+        }
+        for (int w = 0; w < WORDS_IN_FRAME; ++w) {
+            qToBigEndian(words[w], dst + f*FRAME_SIZE + w*4);
+        }
+    }
+    if (pos > 0) {
+        // Reverse integration constant: the last encoded sample
+        qToBigEndian(quint32(samples[pos - 1]), dst + 2*4);
+    }
+    return pos;
+}
+
+bool Steim2::decode(const uchar * src, int framesCount, int count, qint32 * dst) {
+    if (count <= 0) {
+        return true;
+    }
+    qint32 first = qint32(qFromBigEndian<quint32>(src + 4));
+    qint32 last  = qint32(qFromBigEndian<quint32>(src + 8));
+    int decoded = 0;
+    for (int f = 0; f < framesCount && decoded < count; ++f) {
+        const uchar * frame = src + f*FRAME_SIZE;
+        quint32 control = qFromBigEndian<quint32>(frame);
+        int firstWord = (f == 0) ? 3 : 1;
+        for (int w = firstWord; w < WORDS_IN_FRAME && decoded < count; ++w) {
+            quint32 word = qFromBigEndian<quint32>(frame + w*4);
+            quint32 nibble = nibbleOf(control, w);
+            quint32 dnib = word >> 30;
+            const Packing * packing = NULL;
+            for (const Packing & p: PACKINGS) {
+                if (p.nibble == nibble && (nibble == 1 || p.dnib == dnib)) {
+                    packing = &p;
+                    break;
+                }
+            }
+            if (packing == NULL) {
+                continue; // Empty word (nibble 0) or unknown code
+            }
+            for (int i = 0; i < packing->count && decoded < count; ++i) {
+                quint32 raw = word >> (packing->bits*(packing->count - 1 - i));
+                qint32 diff = signExtend(raw & ((1u << packing->bits) - 1), packing->bits);
+                dst[decoded] = (decoded == 0) ? first : dst[decoded - 1] + diff;
+                ++decoded;
+            }
+        }
+    }
+    return (decoded == count) && (dst[count - 1] == last);
+}
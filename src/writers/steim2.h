@@ -0,0 +1,44 @@
+#ifndef STEIM2_H
+#define STEIM2_H
+
+#include <QtGlobal>
+
+/*!
+ * \brief Steim-2 compression of integer samples, as used in (Mini)SEED data records
+ *
+ * Data are stored in 64-byte frames of 16 big-endian 32-bit words. The first word
+ * of each frame contains 2-bit codes for other 15 words, and every data word
+ * packs from 1 to 7 differences between subsequent samples, depending on their size.
+ * The first frame also stores the first and the last samples (integration constants).
+ */
+class Steim2
+{
+public:
+    static const int FRAME_SIZE = 64;
+    static const int WORDS_IN_FRAME = 16;
+
+    /// Samples whose differences don't fit into this many bits cannot be encoded
+    static const int MAX_DIFFERENCE_BITS = 30;
+
+    /*!
+     * \brief Encodes as many samples as fit into \a framesCount frames
+     * \param samples - samples to be encoded
+     * \param count - number of \a samples
+     * \param previous - last sample of the previous record (for the first difference)
+     * \param dst - output, at least \a framesCount*FRAME_SIZE bytes. Unused frames are zeroed.
+     * \param framesCount - number of frames available in \a dst
+     * \return number of samples encoded (from the beginning of \a samples). Can be less
+     *         than \a count if frames are full or if difference is too large (then
+     *         remaining samples should be encoded into another record).
+     */
+    static int encode(const qint32 * samples, int count, qint32 previous, uchar * dst, int framesCount);
+
+    /*!
+     * \brief Decodes \a count samples from \a framesCount frames at \a src
+     * \param dst - output, at least \a count samples
+     * \return true if decoded successfully and the last sample matches reverse integration constant
+     */
+    static bool decode(const uchar * src, int framesCount, int count, qint32 * dst);
+};
+
+#endif // STEIM2_H
@@ -0,0 +1,95 @@
+#include "textencoder.h"
+
+#include <cstring>
+
+namespace {
+    Q_STATIC_ASSERT_X(sizeof(DataType) == sizeof(quint32), "TextEncoder implementation assumes 32-bit DataType");
+
+    const char SEPARATOR[] = "    ";
+#ifdef Q_OS_WIN
+    const char NEWLINE[] = "\r\n";
+#else
+    const char NEWLINE[] = "\n";
+#endif
+
+    // All two-digit numbers "00".."99" one after another: two digits are written at once
+    const char DIGIT_PAIRS[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+    // Comparisons are compiled into flag-setting instructions, not jumps
+    inline int digitsCount(quint32 u) {
+        return 1 + (u >= 10u) + (u >= 100u) + (u >= 1000u) + (u >= 10000u) + (u >= 100000u)
+                 + (u >= 1000000u) + (u >= 10000000u) + (u >= 100000000u) + (u >= 1000000000u);
+    }
+}
+
+char * TextEncoder::formatValue(char * dst, DataType value) {
+    quint32 u = static_cast<quint32>(value);
+    if (value < 0) {
+        *dst++ = '-';
+        u = 0u - u; // also correct for the minimal integer
+    }
+    int length = digitsCount(u);
+    char * end = dst + length;
+    char * p = end;
+    while (u >= 100) {
+        const char * pair = DIGIT_PAIRS + 2*(u % 100);
+        u /= 100;
+        *--p = pair[1];
+        *--p = pair[0];
+    }
+    if (u >= 10) {
+        const char * pair = DIGIT_PAIRS + 2*u;
+        *--p = pair[1];
+        *--p = pair[0];
+    } else {
+        *--p = char('0' + u);
+    }
+    return end;
+}
+
+char * TextEncoder::formatItem(char * dst, const DataItem & item) {
+    for (unsigned ch = 0; ch < CHANNELS_NUM; ++ch) {
+        dst = formatValue(dst, item.byChannel[ch]);
+        if (ch < CHANNELS_NUM-1) {
+            memcpy(dst, SEPARATOR, SEPARATOR_LENGTH); // 4 spaces except the last column
+            dst += SEPARATOR_LENGTH;
+        }
+    }
+    memcpy(dst, NEWLINE, NEWLINE_LENGTH);
+    return dst + NEWLINE_LENGTH;
+}
+
+void TextEncoder::appendItems(QByteArray & out, const DataVector & items) {
+    int oldSize = out.size();
+    out.resize(oldSize + items.size()*MAX_LINE_LENGTH);
+    char * begin = out.data();
+    char * p = begin + oldSize;
+    for (const DataItem & item: items) {
+        p = formatItem(p, item);
+    }
+    out.resize(int(p - begin));
+}
+
+QByteArray TextEncoder::toFileText(const QString & text) {
+    QByteArray res = text.toLocal8Bit();
+#ifdef Q_OS_WIN
+    res.replace("\n", NEWLINE);
+#endif
+    return res;
+}
+
+QByteArray TextEncoder::encode(const DataVector & items) {
+    QByteArray res;
+    appendItems(res, items);
+    return res;
+}
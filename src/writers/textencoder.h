@@ -0,0 +1,69 @@
+#ifndef TEXTENCODER_H
+#define TEXTENCODER_H
+
+#include "../protocol.h"
+#include <QByteArray>
+
+/*!
+ * \brief Formats data items into the text layout of output files
+ *
+ * The layout is exactly the same as before: decimal value of each channel,
+ * columns separated by 4 spaces, one data item per line.
+ *
+ * Values are written straight into a presized QByteArray, without temporary
+ * strings and without conversion to QString (UTF-16), so the result can be
+ * written to file as is. Lines end with native line ending (CRLF on Windows),
+ * like it was when files were written in text mode.
+ */
+class TextEncoder
+{
+public:
+    /// Maximum length of one formatted value: sign and 10 digits of 32-bit integer
+    static const int MAX_VALUE_LENGTH = 11;
+    /// Columns are separated by 4 spaces
+    static const int SEPARATOR_LENGTH = 4;
+    /// Line ending is native, like in text mode files
+#ifdef Q_OS_WIN
+    static const int NEWLINE_LENGTH = 2;
+#else
+    static const int NEWLINE_LENGTH = 1;
+#endif
+    /// Maximum length of one formatted line, including line end
+    static const int MAX_LINE_LENGTH = CHANNELS_NUM*MAX_VALUE_LENGTH + (CHANNELS_NUM - 1)*SEPARATOR_LENGTH + NEWLINE_LENGTH;
+
+    /*!
+     * \brief Formats all \a items and appends them to the end of \a out
+     *
+     * Reserves space for the worst case once, then shrinks to the actual size
+     * (which doesn't cause reallocation).
+     */
+    static void appendItems(QByteArray & out, const DataVector & items);
+
+    /*!
+     * \brief Convenience wrapper for appendItems
+     * \return formatted \a items
+     */
+    static QByteArray encode(const DataVector & items);
+
+    /*!
+     * \brief Converts \a text to local 8-bit encoding with native line endings,
+     *        same as QTextStream on a text mode file does
+     */
+    static QByteArray toFileText(const QString & text);
+
+    /*!
+     * \brief Formats one data item (one line) into \a dst
+     * \warning \a dst must have at least MAX_LINE_LENGTH bytes available
+     * \return pointer to the byte after the last written one
+     */
+    static char * formatItem(char * dst, const DataItem & item);
+
+    /*!
+     * \brief Formats one value into \a dst, same as QByteArray::setNum does
+     * \warning \a dst must have at least MAX_VALUE_LENGTH bytes available
+     * \return pointer to the byte after the last written one
+     */
+    static char * formatValue(char * dst, DataType value);
+};
+
+#endif // TEXTENCODER_H
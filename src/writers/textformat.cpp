@@ -0,0 +1,42 @@
+#include "textformat.h"
+#include "textencoder.h"
+
+#include <QCoreApplication>
+
+QByteArray TextFormat::header(const FileInfo & info) {
+    // Translations are kept in the context of FileWriter, where this header was formed before
+    QString out;
+    out += QStringLiteral("[Description]\n");
+    out += QCoreApplication::translate("FileWriter", "Device ID=%1").arg(info.deviceID);
+    out += QStringLiteral("\n[Frequency]\n");
+    out += QCoreApplication::translate("FileWriter", "%1 Hz").arg(info.filterFreq);
+    out += QStringLiteral("\n[Sample rate]\n");
+    out += QCoreApplication::translate("FileWriter", "%1 Hz").arg(info.samplingFreq);
+    out += QStringLiteral("\n[Time]\n%1\n").arg(info.startTime.toString("hh:mm:ss"));
+    out += QStringLiteral("[Coordinates]\n");
+    out += QCoreApplication::translate("FileWriter", "%1 deg. - latitude\n").arg(info.latitude);
+    out += QCoreApplication::translate("FileWriter", "%1 deg. - longitude\n").arg(info.longitude);
+    out += QStringLiteral("[Date]\n%1\n").arg(info.startTime.toString("dd.MM.yyyy"));
+    if ( ! info.units.isEmpty() ) {
+        // Values are not counts of ADC: corrected for instrument response
+        out += QStringLiteral("[Units]\n%1\n").arg(info.units);
+    }
+    if ( ! info.stats.isEmpty() && info.samplingFreq > 0 ) {
+        // Only if enabled (\see FileWriter::setStats): readers skip unknown sections, but some
+        // compare headers byte by byte. Keys are for programs, so they are not translated
+        out += QStringLiteral("[Statistics]\n");
+        out += QStringLiteral("Window=%1 s\n").arg(double(info.stats[0].count) / info.samplingFreq);
+        for (int ch = 0; ch < info.stats.size(); ++ch) {
+            const SlidingStats::Values & s = info.stats[ch];
+            out += QStringLiteral("%1: min=%2 max=%3 mean=%4 rms=%5 std=%6\n")
+                    .arg(ch + 1).arg(s.min).arg(s.max)
+                    .arg(s.mean, 0, 'f', 1).arg(s.rms, 0, 'f', 1).arg(s.stdDev, 0, 'f', 1);
+        }
+    }
+    out += QStringLiteral("[Values]\n");
+    return TextEncoder::toFileText(out);
+}
+
+QByteArray TextFormat::appendBlock(const DataBlock & block) {
+    return TextEncoder::encode(block.data);
+}
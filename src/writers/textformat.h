@@ -0,0 +1,22 @@
+#ifndef TEXTFORMAT_H
+#define TEXTFORMAT_H
+
+#include "outputformat.h"
+
+/*!
+ * \brief The original text format: header with description of data,
+ *        then one line per data item with values of all channels
+ *
+ * Values are formatted by TextEncoder.
+ */
+class TextFormat : public OutputFormat
+{
+public:
+    Type type() const override { return Text; }
+    QString fileSuffix() const override { return QString(); } // Text files keep names given by user
+    bool isIndexable() const override { return true; }
+    QByteArray header(const FileInfo & info) override;
+    QByteArray appendBlock(const DataBlock & block) override;
+};
+
+#endif // TEXTFORMAT_H
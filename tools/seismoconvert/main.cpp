@@ -0,0 +1,9 @@
+#include "converter.h"
+#include <QCoreApplication>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("seismoconvert");
+    return Converter::run(a.arguments());
+}
@@ -0,0 +1,17 @@
+# Offline converter of recorded data files, shares data formats with the recorder
+QT       += core concurrent
+QT       -= gui
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+TARGET = seismoconvert
+TEMPLATE = app
+
+include(../../src/dataio.pri)
+
+SOURCES += main.cpp \
+    ../../src/converter.cpp \
+    ../../src/logger.cpp
+
+HEADERS += ../../src/converter.h \
+    ../../src/logger.h